@@ -8,36 +8,130 @@
 #define NG_ADAPTER_H_
 
 #include <deque>	/* for std::deque */
+#include <vector>	/* for std::vector */
+#include <string>	/* for std::string */
+#include <stdint.h>	/* for fixed width integer types */
 #include <pcap/pcap.h>	/* for libpcap types */
 
 #include "Exception.h"		/* for netgazer::Exception */
 #include "Packet.h"		/* for netgazer::Packet */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "SummaryBuffer.h"	/* for netgazer::SummaryBuffer */
+#include "PacketHandler.h"	/* for netgazer::PacketHandler */
+#include "Sampler.h"		/* for netgazer::Sampler */
+#include "TruncationPolicy.h"	/* for netgazer::TruncationPolicy */
+#include "MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
 
 namespace netgazer {
-	class Adapter {
+	/*
+	 * capture interface; as a MemoryConsumer it charges its retained
+	 * packets, summary buffer and kernel buffer, and sheds by dropping
+	 * the oldest retained packets
+	 */
+	class Adapter : public MemoryConsumer {
+	/* internal structures and enumerations */
+	public:
+		/* capture handle options */
+		struct Options {
+			Options();
+
+			bool promisc;		/* promiscuous mode */
+			int timeout;		/* read timeout in milliseconds */
+			int snaplen;		/* snapshot length */
+			int buffer_size;	/* kernel buffer size, 0 for default */
+			bool immediate;		/* deliver packets without buffering */
+			bool nano;		/* nanosecond timestamp precision */
+			const char * tstamp_type; /* timestamp source or NULL */
+			bool summaries;		/* retain summaries, not packets */
+			size_t retain;		/* retained packets or summaries,
+						 * at least one packet */
+			/* placement of the summary buffer only, retained
+			 * packets stay on the heap */
+			bool numa_local;	/* on the interface's node */
+			bool huge_pages;	/* on huge pages if any */
+		};
+		/* outcomes of next() */
+		enum Result {
+			PACKET = 0,		/* a packet was returned */
+			NONE = 1,		/* timeout or end of file */
+			FAILED = 2,		/* see error() */
+		};
+
 	/* constructors and destructor */
 	private:
-		Adapter(pcap_if_t * pcap_adapter) throw (Exception);
+		Adapter(const char * name, const char * description,
+			int ifindex) NG_THROWS;
 	public:
 		~Adapter();
 
 	/* public methods */
 	public:
-		void open(bool promisc, int timeout) throw (Exception);
+		void open(bool promisc, int timeout) NG_THROWS;
+		void open(const struct Options & options) NG_THROWS;
 		void close();
-		Packet * nextPacket() throw (Exception);
-		const char * name() const throw (Exception);
-		const char * description() const throw (Exception);
+		enum Result next(Packet ** packet) NG_NOEXCEPT;
+		Packet * nextPacket() NG_THROWS;
+		const PacketSummary * nextSummary() NG_THROWS;
+		const SummaryBuffer * summaries() const;
+		int dispatch(int count, PacketHandler * handler) NG_THROWS;
+		void inject(const u_char * data, size_t length) NG_THROWS;
+		int selectableFd() const NG_THROWS;
+		void setNonblock(bool nonblock) NG_THROWS;
+		void setSampler(Sampler * sampler);
+		Sampler * sampler() const;
+		void setTruncation(TruncationPolicy * policy);
+		TruncationPolicy * truncation() const;
+		struct pcap_stat stats() const NG_THROWS;
+		std::vector<const char *> timestampTypes() const NG_THROWS;
+		const char * name() const NG_THROWS;
+		const char * description() const NG_THROWS;
+		int ifindex() const;
+		bool present() const;
+		uint64_t errors() const;
+		const char * error() const;
+		virtual size_t shed(size_t bytes);
+
+	/* private methods */
+	private:
+		enum Result fetch(struct pcap_pkthdr ** header,
+			const u_char ** data) NG_NOEXCEPT;
+		Packet * decode(const struct pcap_pkthdr * header,
+			const u_char * data) NG_NOEXCEPT;
+		void keep(Packet * packet) NG_THROWS;
+		Packet * retain(const struct pcap_pkthdr * header,
+			const u_char * data) NG_THROWS;
+		enum Result fail(const char * error) NG_NOEXCEPT;
+		const PacketSummary * summarize(const struct pcap_pkthdr * header,
+			const u_char * data);
+
+	/* private static methods */
+	private:
+		static void dispatchOne(u_char * user,
+			const struct pcap_pkthdr * header, const u_char * data);
 
 	/* fields */
 	private:
-		pcap_if_t * m_pcap_adapter;
+		std::string m_name;
+		std::string m_description;
+		bool m_has_description;
+		int m_ifindex;
+		bool m_present;
 		pcap_t * m_pcap_handle;
 		bool m_promisc;
+		bool m_nano;
 		std::deque<Packet *> m_packets;
+		SummaryBuffer * m_summaries;
+		size_t m_retain;
+		size_t m_fixed;		/* charged for the buffers */
+		Sampler * m_sampler;
+		TruncationPolicy * m_truncation;
+		uint64_t m_errors;
+		const char * m_error;	/* static or libpcap owned */
 
 	/* friend declarations */
-	friend class NetworkService;
+	friend class AdapterRegistry;
+	friend class AdapterTest;
+	friend class CaptureWorkerTest;
 	};
 }
 
@@ -0,0 +1,85 @@
+/*
+ * header file for class AdapterRegistry
+ */
+
+#pragma once
+
+#ifndef NG_ADAPTER_REGISTRY_H_
+#define NG_ADAPTER_REGISTRY_H_
+
+#include <string>		/* for std::string */
+#include <vector>		/* for std::vector */
+#include <tr1/unordered_map>	/* for std::tr1::unordered_map */
+#include <stddef.h>		/* for size_t */
+
+#include "Exception.h"	/* for netgazer::Exception */
+#include "Adapter.h"	/* for netgazer::Adapter */
+
+namespace netgazer {
+	/*
+	 * cache of adapters indexed by name and interface index
+	 *
+	 * Interfaces are enumerated from sysfs and libpcap on first use,
+	 * and lookups by name or index resolve a single interface without
+	 * enumerating at all. A netlink socket subscribed to link events keeps the cache
+	 * up to date incrementally; poll() applies pending events. Each
+	 * interface maps to one Adapter for the lifetime of the registry,
+	 * adapters of removed interfaces are kept but marked absent. The
+	 * registry is not thread safe.
+	 */
+	class AdapterRegistry {
+	/* internal structures and enumerations */
+	public:
+		/* receiver of link changes, called from poll() */
+		class Listener {
+		public:
+			virtual ~Listener()
+			{
+			}
+
+			virtual void onAdded(Adapter * adapter) = 0;
+			virtual void onRemoved(Adapter * adapter) = 0;
+		};
+
+	/* constructors and destructor */
+	public:
+		AdapterRegistry() NG_THROWS;
+		~AdapterRegistry();
+
+	/* public methods */
+	public:
+		Adapter * byName(const char * name) NG_THROWS;
+		Adapter * byIndex(int ifindex) NG_THROWS;
+		const std::vector<Adapter *> & adapters() NG_THROWS;
+		size_t poll() NG_THROWS;
+		int fd() const;
+		void setListener(Listener * listener);
+
+	/* private methods */
+	private:
+		void enumerate() NG_THROWS;
+		void mergePcap() NG_THROWS;
+		Adapter * update(const char * name, int ifindex)
+			NG_THROWS;
+		void remove(int ifindex);
+		Adapter * insert(const char * name, const char * description,
+			int ifindex) NG_THROWS;
+		Adapter * lookupPcap(const char * name) NG_THROWS;
+
+	/* fields */
+	private:
+		int m_fd;			/* netlink socket */
+		bool m_enumerated;
+		std::vector<Adapter *> m_adapters;	/* by first sight */
+		std::tr1::unordered_map<std::string, Adapter *> m_by_name;
+		std::tr1::unordered_map<int, Adapter *> m_by_index;
+		Listener * m_listener;
+
+	/* disabled copy operations */
+	private:
+		AdapterRegistry(const AdapterRegistry &);
+		AdapterRegistry & operator=(const AdapterRegistry &);
+	};
+}
+
+#endif /* NG_ADAPTER_REGISTRY_H_ */
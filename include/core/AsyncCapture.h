@@ -0,0 +1,235 @@
+/*
+ * header file for class AsyncCapture
+ */
+
+#pragma once
+
+#ifndef NG_ASYNC_CAPTURE_H_
+#define NG_ASYNC_CAPTURE_H_
+
+#include <deque>	/* for std::deque */
+#include <map>		/* for std::map */
+#include <set>		/* for std::set */
+#include <utility>	/* for std::pair */
+#include <vector>	/* for std::vector */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pthread.h>	/* for pthread_mutex_t */
+#if __cplusplus >= 202002L
+#include <coroutine>	/* for std::coroutine_handle */
+#endif
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Adapter.h"		/* for netgazer::Adapter */
+#include "Packet.h"		/* for netgazer::Packet */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "PacketHandler.h"	/* for netgazer::PacketHandler */
+#include "MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+namespace netgazer {
+	/*
+	 * event loop completing asynchronous batch requests on many adapters
+	 * from a single thread; requests may be submitted and cancelled from
+	 * any thread, completions run on the thread calling run(); as a
+	 * MemoryConsumer it charges each batch while its callback runs,
+	 * batches are transient so it sheds nothing
+	 */
+	class AsyncCapture : public MemoryConsumer {
+	/* internal structures and enumerations */
+	public:
+		/* completion status of a request */
+		enum Status {
+			COMPLETED = 0,
+			TIMEOUT = 1,
+			CANCELLED = 2,
+			FAILED = 3,
+		};
+		/* a completed batch, owned by the loop until onBatch returns */
+		struct Batch {
+			uint64_t id;
+			Adapter * adapter;
+			enum Status status;
+			const char * error;
+			std::vector<Packet *> packets;
+			std::vector<struct PacketSummary> summaries;
+		};
+		/* receiver of completed batches */
+		class Callback {
+		public:
+			virtual ~Callback()
+			{
+			}
+
+			virtual void onBatch(struct Batch & batch) = 0;
+		};
+#if __cplusplus >= 202002L
+		/*
+		 * awaitable next batch of an adapter, see batch(); the
+		 * awaiting coroutine is resumed on the loop thread and owns
+		 * the packets of the batch it gets back
+		 */
+		class Awaiter : private Callback {
+		public:
+			Awaiter(AsyncCapture & loop, Adapter * adapter, int max,
+				int timeout, uint64_t * id)
+				: m_loop(loop), m_adapter(adapter), m_max(max),
+				  m_timeout(timeout), m_id(id)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				uint64_t id = 0;
+
+				this->m_handle = handle;
+				id = this->m_loop.nextBatch(this->m_adapter,
+					this->m_max, this->m_timeout, this);
+				if (this->m_id != nullptr) {
+					*this->m_id = id;
+				}
+			}
+
+			struct Batch await_resume()
+			{
+				return static_cast<struct Batch &&>(this->m_batch);
+			}
+
+		private:
+			void onBatch(struct Batch & batch)
+			{
+				/* take the packets before the loop frees them */
+				this->m_batch.id = batch.id;
+				this->m_batch.adapter = batch.adapter;
+				this->m_batch.status = batch.status;
+				this->m_batch.error = batch.error;
+				this->m_batch.packets.swap(batch.packets);
+				this->m_batch.summaries.swap(batch.summaries);
+				this->m_handle.resume();
+			}
+
+		private:
+			AsyncCapture & m_loop;
+			Adapter * m_adapter;
+			int m_max;
+			int m_timeout;
+			uint64_t * m_id;
+			std::coroutine_handle<> m_handle;
+			struct Batch m_batch;
+		};
+#endif
+
+	private:
+		/* a pending request */
+		struct Request {
+			uint64_t id;
+			Adapter * adapter;
+			int max;
+			int timeout;
+			uint64_t deadline_ms;	/* 0 for no deadline */
+			Callback * callback;
+			bool repeat;		/* re-armed after every batch */
+		};
+		/* per-adapter queue of pending requests */
+		struct Source {
+			Adapter * adapter;
+			std::deque<uint64_t> queue;
+			int fd;			/* registered, -1 if none */
+			bool armed;
+		};
+		/* collects a dispatched batch into a Batch */
+		class Collector : public PacketHandler {
+		public:
+			Collector(struct Batch & batch);
+
+			void onPacket(Adapter * adapter, Packet * packet)
+				NG_THROWS;
+			void onSummary(Adapter * adapter,
+				const PacketSummary * summary) NG_THROWS;
+
+		private:
+			struct Batch & m_batch;
+		};
+
+	/* constructors and destructor */
+	public:
+		AsyncCapture() NG_THROWS;
+		~AsyncCapture();
+
+	/* public methods */
+	public:
+		uint64_t nextBatch(Adapter * adapter, int max, int timeout,
+			Callback * callback) NG_THROWS;
+		uint64_t stream(Adapter * adapter, int max, Callback * callback)
+			NG_THROWS;
+		void cancel(uint64_t id);
+		void remove(Adapter * adapter) NG_THROWS;
+#if __cplusplus >= 202002L
+		/*
+		 * get the next batch of an adapter from a C++20 coroutine
+		 * running on the loop thread, as in
+		 *
+		 *     struct Batch b = co_await loop.batch(adapter, 64, 100);
+		 *
+		 * a stream is a loop of such awaits; the request may be
+		 * cancelled through its id, and the coroutine must not be
+		 * destroyed before it has been resumed
+		 *
+		 * @adapter: opened adapter to capture from
+		 * @max: maximum number of packets in the batch
+		 * @timeout: time to wait in milliseconds, -1 for infinite
+		 * @id: set to the request id once submitted, or NULL
+		 *
+		 * return: the awaitable, resuming with the completed batch
+		 */
+		Awaiter batch(Adapter * adapter, int max, int timeout,
+			uint64_t * id = nullptr)
+		{
+			return Awaiter(*this, adapter, max, timeout, id);
+		}
+#endif
+		int runOnce(int timeout) NG_THROWS;
+		void run() NG_THROWS;
+		void stop();
+		virtual size_t shed(size_t bytes);
+
+	/* private methods */
+	private:
+		uint64_t submit(const struct Request & r) NG_THROWS;
+		void accept() NG_THROWS;
+		void watch(struct Source * source) NG_THROWS;
+		void arm(struct Source * source) NG_THROWS;
+		void detach(Adapter * adapter, enum Status status,
+			const char * error);
+		int drain(struct Source * source) NG_THROWS;
+		void expire(uint64_t now_ms);
+		void complete(struct Request & r, struct Batch & batch);
+		void finish(uint64_t id, enum Status status, const char * error);
+
+	/* fields */
+	private:
+		int m_epoll_fd;
+		int m_wake_fd;
+		volatile bool m_running;
+		uint64_t m_next_id;
+		std::map<uint64_t, struct Request> m_requests;
+		std::map<Adapter *, struct Source *> m_sources;
+		std::set<std::pair<uint64_t, uint64_t> > m_deadlines;
+
+		/* submissions from other threads, protected by m_lock */
+		pthread_mutex_t m_lock;
+		std::vector<struct Request> m_inbox;
+		std::vector<uint64_t> m_cancels;
+		std::vector<Adapter *> m_removals;
+
+	/* disabled copy operations */
+	private:
+		AsyncCapture(const AsyncCapture &);
+		AsyncCapture & operator=(const AsyncCapture &);
+	};
+}
+
+#endif /* NG_ASYNC_CAPTURE_H_ */
@@ -0,0 +1,229 @@
+/*
+ * header file for class ByteCursor
+ */
+
+#pragma once
+
+#ifndef NG_BYTE_CURSOR_H_
+#define NG_BYTE_CURSOR_H_
+
+#include <cstring>	/* for std::memchr */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+namespace netgazer {
+	/*
+	 * bounds-checked reader over a byte view, reading big endian
+	 *
+	 * A read past the end fails, leaves the output untouched and marks
+	 * the cursor as failed; later reads keep failing, so a parser may
+	 * check ok() once after a sequence of reads.
+	 */
+	class ByteCursor {
+	/* constructors and destructor */
+	public:
+		/*
+		 * constructor of ByteCursor
+		 *
+		 * @data: first byte of the view
+		 * @length: number of bytes in the view
+		 */
+		ByteCursor(const u_char * data, size_t length) :
+			m_data(data), m_length(length), m_offset(0), m_ok(true)
+		{
+		}
+
+	/* public methods */
+	public:
+		/*
+		 * check whether n more bytes can be read
+		 *
+		 * @n: number of bytes
+		 *
+		 * return: true if readable, false otherwise
+		 */
+		inline bool has(size_t n) const
+		{
+			return this->m_ok && n <= this->m_length - this->m_offset;
+		}
+
+		inline bool u8(uint8_t & v)
+		{
+			if (!this->need(1)) {
+				return false;
+			}
+			v = this->m_data[this->m_offset++];
+			return true;
+		}
+
+		inline bool u16(uint16_t & v)
+		{
+			if (!this->need(2)) {
+				return false;
+			}
+			v = (uint16_t)((this->m_data[this->m_offset] << 8) |
+				this->m_data[this->m_offset + 1]);
+			this->m_offset += 2;
+			return true;
+		}
+
+		inline bool u24(uint32_t & v)
+		{
+			if (!this->need(3)) {
+				return false;
+			}
+			v = ((uint32_t)this->m_data[this->m_offset] << 16) |
+				((uint32_t)this->m_data[this->m_offset + 1] << 8) |
+				this->m_data[this->m_offset + 2];
+			this->m_offset += 3;
+			return true;
+		}
+
+		inline bool u32(uint32_t & v)
+		{
+			uint16_t high = 0;
+			uint16_t low = 0;
+
+			if (!this->need(4)) {
+				return false;
+			}
+			this->u16(high);
+			this->u16(low);
+			v = ((uint32_t)high << 16) | low;
+			return true;
+		}
+
+		/*
+		 * take a view of the next n bytes and move past them
+		 *
+		 * @n: number of bytes
+		 * @view: set to the first byte of the view
+		 *
+		 * return: true on success, false if fewer bytes are left
+		 */
+		inline bool bytes(size_t n, const u_char ** view)
+		{
+			if (!this->need(n)) {
+				return false;
+			}
+			*view = this->m_data + this->m_offset;
+			this->m_offset += n;
+			return true;
+		}
+
+		inline bool skip(size_t n)
+		{
+			if (!this->need(n)) {
+				return false;
+			}
+			this->m_offset += n;
+			return true;
+		}
+
+		/*
+		 * take a view of the next line and move past its end, for
+		 * text protocols
+		 *
+		 * @view: set to the first byte of the line
+		 * @n: set to the line length without CR LF or LF
+		 *
+		 * return: true on success, false if no line end is left
+		 */
+		inline bool line(const u_char ** view, size_t * n)
+		{
+			const u_char * start = this->m_data + this->m_offset;
+			const u_char * end = NULL;
+
+			if (!this->m_ok || (end = (const u_char *)std::memchr(
+				start, '\n', this->remaining())) == NULL) {
+				this->m_ok = false;
+				return false;
+			}
+			*view = start;
+			*n = end - start;
+			if (*n > 0 && end[-1] == '\r') {
+				--*n;
+			}
+			this->m_offset += end - start + 1;
+			return true;
+		}
+
+		/*
+		 * move to an absolute offset in the view
+		 *
+		 * @offset: new offset
+		 *
+		 * return: true on success, false if past the end
+		 */
+		inline bool seek(size_t offset)
+		{
+			if (!this->m_ok || offset > this->m_length) {
+				this->m_ok = false;
+				return false;
+			}
+			this->m_offset = offset;
+			return true;
+		}
+
+		/*
+		 * narrow a cursor to the next n bytes, e.g. a length-prefixed
+		 * structure, and move this cursor past them
+		 *
+		 * @n: number of bytes
+		 * @sub: set to a cursor over the n bytes
+		 *
+		 * return: true on success, false if fewer bytes are left
+		 */
+		inline bool sub(size_t n, ByteCursor & sub)
+		{
+			const u_char * view = NULL;
+
+			if (!this->bytes(n, &view)) {
+				return false;
+			}
+			sub = ByteCursor(view, n);
+			return true;
+		}
+
+		inline const u_char * data() const
+		{
+			return this->m_data;
+		}
+
+		inline size_t offset() const
+		{
+			return this->m_offset;
+		}
+
+		inline size_t remaining() const
+		{
+			return this->m_length - this->m_offset;
+		}
+
+		inline bool ok() const
+		{
+			return this->m_ok;
+		}
+
+	/* private methods */
+	private:
+		inline bool need(size_t n)
+		{
+			if (!this->has(n)) {
+				this->m_ok = false;
+				return false;
+			}
+			return true;
+		}
+
+	/* fields */
+	private:
+		const u_char * m_data;
+		size_t m_length;
+		size_t m_offset;
+		bool m_ok;
+	};
+}
+
+#endif /* NG_BYTE_CURSOR_H_ */
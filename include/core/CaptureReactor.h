@@ -0,0 +1,110 @@
+/*
+ * header file for class CaptureReactor
+ */
+
+#pragma once
+
+#ifndef NG_CAPTURE_REACTOR_H_
+#define NG_CAPTURE_REACTOR_H_
+
+#include <queue>	/* for std::priority_queue */
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Adapter.h"		/* for netgazer::Adapter */
+#include "Packet.h"		/* for netgazer::Packet */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "PacketHandler.h"	/* for netgazer::PacketHandler */
+#include "Deduplicator.h"	/* for netgazer::Deduplicator */
+#include "MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+namespace netgazer {
+	/*
+	 * single-threaded event loop capturing from many adapters at once,
+	 * adapters should be opened with Options::immediate for
+	 * sub-millisecond latency; as a MemoryConsumer it charges the
+	 * packets held in the reorder window and sheds by delivering the
+	 * oldest ones early
+	 */
+	class CaptureReactor : public MemoryConsumer, private PacketHandler {
+	/* internal structures and enumerations */
+	private:
+		/* a packet waiting in the reorder window */
+		struct Pending {
+			uint64_t ts_ns;
+			uint64_t seq;
+			Adapter * adapter;
+			Packet * packet;	/* owned copy, NULL for summaries */
+			struct PacketSummary summary;
+		};
+		/* orders the heap by timestamp, then by arrival */
+		struct Later {
+			bool operator()(const struct Pending & a,
+				const struct Pending & b) const
+			{
+				return a.ts_ns != b.ts_ns ? a.ts_ns > b.ts_ns :
+					a.seq > b.seq;
+			}
+		};
+
+	/* constructors and destructor */
+	public:
+		CaptureReactor(PacketHandler * handler, int batch = 64)
+			NG_THROWS;
+		~CaptureReactor();
+
+	/* public methods */
+	public:
+		void add(Adapter * adapter) NG_THROWS;
+		void remove(Adapter * adapter) NG_THROWS;
+		void setMerge(bool merge, uint64_t window_ns = 1000000,
+			size_t max_pending = 65536);
+		void setDeduplicator(Deduplicator * dedup);
+		int poll(int timeout) NG_THROWS;
+		void run() NG_THROWS;
+		void stop();
+		void flush() NG_THROWS;
+		size_t pending() const;
+		virtual size_t shed(size_t bytes);
+
+	/* private methods */
+	private:
+		void onPacket(Adapter * adapter, Packet * packet)
+			NG_THROWS;
+		void onSummary(Adapter * adapter, const PacketSummary * summary)
+			NG_THROWS;
+		void drainTo(uint64_t watermark) NG_THROWS;
+		void deliver(const struct Pending & p) NG_THROWS;
+
+	/* private static methods */
+	private:
+		static size_t footprint(const struct Pending & p);
+
+	/* fields */
+	private:
+		PacketHandler * m_handler;
+		int m_batch;
+		int m_epoll_fd;
+		int m_wake_fd;
+		volatile bool m_running;
+		std::vector<Adapter *> m_adapters;
+		bool m_merge;
+		uint64_t m_window_ns;
+		size_t m_max_pending;
+		Deduplicator * m_dedup;
+		uint64_t m_seq;
+		uint64_t m_newest_ns;
+		uint64_t m_newest_at;	/* monotonic time it was captured */
+		std::priority_queue<struct Pending, std::vector<struct Pending>,
+			struct Later> m_pending;
+
+	/* disabled copy operations */
+	private:
+		CaptureReactor(const CaptureReactor &);
+		CaptureReactor & operator=(const CaptureReactor &);
+	};
+}
+
+#endif /* NG_CAPTURE_REACTOR_H_ */
@@ -0,0 +1,128 @@
+/*
+ * header file for class Checkpoint
+ */
+
+#pragma once
+
+#ifndef NG_CHECKPOINT_H_
+#define NG_CHECKPOINT_H_
+
+#include <string>	/* for std::string */
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <sys/types.h>	/* for pid_t */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Checkpointable.h"	/* for netgazer::Checkpointable */
+
+namespace netgazer {
+	/*
+	 * periodic snapshots of analysis state, restored at startup
+	 *
+	 * save() forks; the child writes the extents of every registered
+	 * component from its copy-on-write view while the parent goes on,
+	 * so the caller only pays for the fork. Snapshots alternate between
+	 * two files, "<path>.0" and "<path>.1", so that a crash while
+	 * writing one leaves the other intact. A file is rewritten in
+	 * place: blocks equal to what it already holds are not written
+	 * again, which keeps checkpoints of slowly changing state cheap.
+	 * Extents are hashed and the file is only marked valid once synced.
+	 * restore() maps the newest valid file and copies its extents back.
+	 */
+	class Checkpoint {
+	/* internal structures and enumerations */
+	public:
+		/* cost of checkpoints and restores */
+		struct Stats {
+			uint64_t checkpoints;	/* completed */
+			uint64_t failures;	/* writers that failed */
+			uint64_t sequence;	/* of the newest snapshot */
+			double pause;		/* seconds save() blocked */
+			double duration;	/* seconds the writer took */
+			uint64_t bytes;		/* state in the last snapshot */
+			uint64_t written;	/* bytes changed by the last */
+			double restore_time;	/* seconds, mapping included */
+			uint64_t restored;	/* bytes restored */
+			uint64_t refused;	/* components not matching */
+		};
+
+	private:
+		enum {
+			MAGIC = 0x5043474e,	/* "NGCP" */
+			VERSION = 1,
+			HEADER_SIZE = 4096,	/* header, then the directory */
+			BLOCK = 65536,		/* unit of incremental writes */
+		};
+		/* file header */
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t sequence;	/* 0 while being written */
+			uint64_t size;		/* file size */
+			uint64_t entries;	/* directory entries */
+			uint64_t created_ns;	/* realtime, at the fork */
+			uint64_t duration_ns;	/* time taken by the writer */
+			uint64_t written;	/* bytes changed */
+			uint64_t hash;		/* of the directory */
+		};
+		/* directory entry, one per extent */
+		struct Entry {
+			char name[32];		/* component, NUL padded */
+			uint32_t index;		/* extent of the component */
+			uint32_t pad;
+			uint64_t offset;
+			uint64_t length;
+			uint64_t hash;		/* of the data */
+		};
+		/* a registered component */
+		struct Component {
+			Checkpointable * component;
+			std::string name;
+		};
+
+	/* constructors and destructor */
+	public:
+		Checkpoint(const char * path) NG_THROWS;
+		~Checkpoint();
+
+	/* public methods */
+	public:
+		void add(Checkpointable * component, const char * name)
+			NG_THROWS;
+		bool save() NG_THROWS;
+		bool poll();
+		void wait();
+		bool restore() NG_THROWS;
+		const struct Stats & stats() const;
+
+	/* private methods */
+	private:
+		void finish(int status);
+		bool load(int slot, const struct Header & header)
+			NG_THROWS;
+
+	/* private static methods */
+	private:
+		static bool header(const char * file, struct Header & header);
+		static int write(const char * file, struct Header & header,
+			struct Entry * entries,
+			const struct Checkpointable::Extent * extents);
+
+	/* fields */
+	private:
+		std::string m_files[2];
+		std::vector<struct Component> m_components;
+		pid_t m_writer;		/* 0 when none is running */
+		int m_slot;		/* file being written */
+		int m_newest;		/* file of the newest snapshot, or -1 */
+		struct Stats m_stats;
+
+	/* disabled copy operations */
+	private:
+		Checkpoint(const Checkpoint &);
+		Checkpoint & operator=(const Checkpoint &);
+	};
+}
+
+#endif /* NG_CHECKPOINT_H_ */
@@ -0,0 +1,59 @@
+/*
+ * header file for class Checkpointable
+ */
+
+#pragma once
+
+#ifndef NG_CHECKPOINTABLE_H_
+#define NG_CHECKPOINTABLE_H_
+
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+
+#include "Exception.h"	/* for netgazer::Exception */
+
+namespace netgazer {
+	/*
+	 * base of components whose state survives restarts through a
+	 * Checkpoint
+	 *
+	 * State is described as extents of flat memory rather than
+	 * serialized, so a checkpoint copies nothing on the hot path: the
+	 * extents are written by a forked child from its copy-on-write view
+	 * of them. A snapshot is restored by copying the saved extents back
+	 * over the current ones, provided the dimension extents, such as
+	 * table sizes, are equal.
+	 */
+	class Checkpointable {
+	/* internal structures and enumerations */
+	public:
+		/* a piece of flat state */
+		struct Extent {
+			const void * data;
+			size_t length;
+			bool dimension;		/* must match, not restored */
+		};
+
+	/* constructors and destructor */
+	public:
+		virtual ~Checkpointable()
+		{
+		}
+
+	/* public methods */
+	public:
+		/*
+		 * describe the state; the extents must stay valid and
+		 * unchanged until the checkpoint has forked
+		 *
+		 * @extents: the extents are appended to it
+		 */
+		virtual void extents(std::vector<struct Extent> & extents) const
+			NG_THROWS = 0;
+
+		virtual void restore(const std::vector<struct Extent> & saved)
+			NG_THROWS;
+	};
+}
+
+#endif /* NG_CHECKPOINTABLE_H_ */
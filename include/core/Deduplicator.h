@@ -0,0 +1,95 @@
+/*
+ * header file for class Deduplicator
+ */
+
+#pragma once
+
+#ifndef NG_DEDUPLICATOR_H_
+#define NG_DEDUPLICATOR_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "Exception.h"	/* for netgazer::Exception */
+#include "Packet.h"	/* for netgazer::Packet */
+
+namespace netgazer {
+	/*
+	 * suppression of packets seen twice within a time window, e.g. on
+	 * a SPAN port and a tap, or on a bridge and one of its members
+	 *
+	 * A packet is fingerprinted from its network layer on, with the
+	 * IPv4 TTL and header checksum masked so that copies taken before
+	 * and after a hop still match; link headers and VLAN tags are left
+	 * out. Fingerprints go into a ring of blocked Bloom filters, one
+	 * 512-bit block per packet and filter, each filter covering a slice
+	 * of the window; the oldest filter is cleared when the ring turns.
+	 * Copies on the same adapter within the window are suppressed too.
+	 * Adapters must capture at least the hashed bytes for their copies
+	 * to match.
+	 */
+	class Deduplicator {
+	/* internal structures and enumerations */
+	public:
+		/* counters and filter state */
+		struct Statistics {
+			uint64_t packets;	/* packets checked */
+			uint64_t duplicates;	/* packets suppressed */
+			uint64_t rotations;	/* filters cleared */
+			double fill;		/* set bit ratio, current filter */
+			double false_positive_rate;	/* estimated */
+		};
+
+	/* constructors and destructor */
+	public:
+		Deduplicator(uint64_t window_ns = 10000000,
+			size_t memory_limit = 1 << 20,
+			uint64_t expected_pps = 1000000, unsigned generations = 4)
+			NG_THROWS;
+		~Deduplicator();
+
+	/* public methods */
+	public:
+		bool duplicate(const Packet * packet) NG_THROWS;
+		bool duplicate(uint64_t ts_ns, const u_char * data, size_t caplen,
+			uint32_t length);
+		bool check(uint64_t ts_ns, uint64_t fingerprint);
+		double falsePositiveRate() const;
+		struct Statistics statistics() const;
+		void clear();
+		unsigned hashes() const;
+		size_t memory() const;
+
+	/* public static methods */
+	public:
+		static uint64_t fingerprint(const u_char * data, size_t caplen,
+			uint32_t length);
+
+	/* private methods */
+	private:
+		void rotate(uint64_t ts_ns);
+
+	/* fields */
+	private:
+		uint64_t * m_bits;	/* generations x blocks x 8 words */
+		size_t m_blocks;	/* blocks per filter, a power of two */
+		unsigned m_generations;
+		unsigned m_current;
+		unsigned m_hashes;	/* bits set per packet */
+		uint64_t * m_set;	/* set bits per filter */
+		uint64_t * m_inserted;	/* fingerprints per filter */
+		uint64_t m_span_ns;	/* time covered by one filter */
+		uint64_t m_rotate_ns;	/* when the current filter is done */
+		uint64_t m_packets;
+		uint64_t m_duplicates;
+		uint64_t m_rotations;
+
+	/* disabled copy operations */
+	private:
+		Deduplicator(const Deduplicator &);
+		Deduplicator & operator=(const Deduplicator &);
+	};
+}
+
+#endif /* NG_DEDUPLICATOR_H_ */
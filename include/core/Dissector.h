@@ -0,0 +1,52 @@
+/*
+ * header file for class Dissector
+ */
+
+#pragma once
+
+#ifndef NG_DISSECTOR_H_
+#define NG_DISSECTOR_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+namespace netgazer {
+	class Dissector {
+	/* internal structures and enumerations */
+	public:
+		/* dissection flags */
+		enum Flag {
+			HAS_IPV4 = 0x01,	/* an IPv4 header was found */
+			HAS_PORTS = 0x02,	/* TCP or UDP ports are valid */
+			FRAGMENT = 0x04,	/* non-first IPv4 fragment */
+			TRUNCATED = 0x08,	/* headers cut by the snaplen */
+		};
+		/* layer offsets and header fields of a frame */
+		struct Dissection {
+			uint16_t ether_type;	/* host order, after VLAN tags */
+			uint16_t l3_offset;	/* offset of the network header */
+			uint16_t l4_offset;	/* offset of the transport header */
+			uint16_t payload_offset; /* offset of the L4 payload */
+			uint32_t src_addr;	/* network order */
+			uint32_t dest_addr;	/* network order */
+			uint16_t src_port;	/* host order */
+			uint16_t dest_port;	/* host order */
+			uint32_t seq;		/* TCP sequence number, host order */
+			uint32_t ack;		/* TCP ack number, host order */
+			uint16_t window;	/* raw TCP window, host order */
+			uint8_t protocol;	/* IPv4 protocol number */
+			uint8_t tcp_flags;	/* raw TCP flags byte */
+			uint8_t flags;		/* enum Flag bits */
+		};
+
+	/* public static methods */
+	public:
+		static void dissect(const u_char * data, size_t caplen,
+			struct Dissection & d);
+		static size_t payloadLength(const u_char * data, size_t caplen,
+			const struct Dissection & d);
+	};
+}
+
+#endif /* NG_DISSECTOR_H_ */
@@ -0,0 +1,98 @@
+/*
+ * header file for class DistinctTable
+ */
+
+#pragma once
+
+#ifndef NG_DISTINCT_TABLE_H_
+#define NG_DISTINCT_TABLE_H_
+
+#include <vector>	/* for std::vector */
+#include <utility>	/* for std::pair */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+
+namespace netgazer {
+	/*
+	 * memory-capped table of per-key HyperLogLog estimators, e.g.
+	 * distinct sources per destination /24 or distinct destination
+	 * ports per source; it keeps the current and the previous window
+	 * and keys beyond the cap share a single overflow estimator; both
+	 * windows are charged as a MemoryConsumer, within the memory limit
+	 * and never shed
+	 */
+	class DistinctTable : public Checkpointable, public MemoryConsumer {
+	/* internal structures and enumerations */
+	public:
+		/* packet fields usable as keys or counted items */
+		enum Field {
+			SRC_ADDR = 0,
+			DEST_ADDR = 1,
+			SRC_PORT = 2,
+			DEST_PORT = 3,
+		};
+
+	private:
+		/* one window worth of estimators */
+		struct Generation {
+			uint32_t * keys;
+			uint8_t * used;
+			uint8_t * registers;	/* 2^precision per slot */
+			uint8_t * overflow;	/* registers of unindexed keys */
+			size_t size;
+			uint64_t overflowed;	/* packets of unindexed keys */
+		};
+
+	/* constructors and destructor */
+	public:
+		DistinctTable(enum Field key, unsigned prefix, enum Field item,
+			size_t memory_limit, unsigned precision = 8)
+			NG_THROWS;
+		~DistinctTable();
+
+	/* public methods */
+	public:
+		void add(const struct PacketSummary & s);
+		double estimate(uint32_t key, bool previous = false) const;
+		double overflowEstimate(bool previous = false) const;
+		std::vector<std::pair<uint32_t, double> > top(size_t n,
+			bool previous = false) const NG_THROWS;
+		void rotate();
+		size_t size() const;
+		size_t capacity() const;
+		uint64_t overflowed() const;
+		size_t memory() const;
+		virtual void extents(
+			std::vector<struct Checkpointable::Extent> & extents)
+			const NG_THROWS;
+		virtual size_t shed(size_t bytes);
+
+	/* private methods */
+	private:
+		long find(const struct Generation & g, uint32_t key) const;
+		void reset(struct Generation & g);
+
+	/* fields */
+	private:
+		enum Field m_key;
+		enum Field m_item;
+		uint32_t m_mask;
+		unsigned m_precision;
+		size_t m_slots;		/* power of two */
+		size_t m_max_keys;	/* 3/4 of the slots, always below */
+		struct Generation m_generations[2];
+		int m_current;
+
+	/* disabled copy operations */
+	private:
+		DistinctTable(const DistinctTable &);
+		DistinctTable & operator=(const DistinctTable &);
+	};
+}
+
+#endif /* NG_DISTINCT_TABLE_H_ */
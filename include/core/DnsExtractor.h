@@ -0,0 +1,66 @@
+/*
+ * header file for class DnsExtractor
+ */
+
+#pragma once
+
+#ifndef NG_DNS_EXTRACTOR_H_
+#define NG_DNS_EXTRACTOR_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "ByteCursor.h"	/* for netgazer::ByteCursor */
+#include "Dissector.h"	/* for netgazer::Dissector */
+
+namespace netgazer {
+	/*
+	 * extractor of the question and IPv4 answers of DNS messages,
+	 * parsing in place without allocating
+	 */
+	class DnsExtractor {
+	/* internal structures and enumerations */
+	public:
+		/* record limits */
+		enum {
+			MAX_NAME = 255,		/* presentation form, no NUL */
+			MAX_ADDRESSES = 8,
+		};
+		/* record flags */
+		enum Flag {
+			RESPONSE = 0x01,	/* QR bit */
+			AUTHORITATIVE = 0x02,	/* AA bit */
+			TRUNCATED = 0x04,	/* TC bit */
+			NAME_TRUNCATED = 0x08,	/* name cut at MAX_NAME */
+		};
+		/* metadata of a DNS message */
+		struct Record {
+			uint16_t id;
+			uint16_t qtype;
+			uint16_t qclass;
+			uint16_t answer_count;	/* ANCOUNT of the header */
+			uint8_t opcode;
+			uint8_t rcode;
+			uint8_t flags;		/* enum Flag bits */
+			uint8_t address_count;	/* A answers in addresses */
+			uint16_t name_length;
+			char name[MAX_NAME + 1];	/* NUL terminated */
+			uint32_t addresses[MAX_ADDRESSES]; /* network order */
+		};
+
+	/* public static methods */
+	public:
+		static bool extract(const u_char * payload, size_t length,
+			struct Record & r);
+		static bool extract(const u_char * data, size_t caplen,
+			const struct Dissector::Dissection & d, struct Record & r);
+
+	/* private static methods */
+	private:
+		static bool name(ByteCursor & c, char * out, uint16_t * length,
+			bool * truncated);
+	};
+}
+
+#endif /* NG_DNS_EXTRACTOR_H_ */
@@ -9,6 +9,19 @@
 
 #include <string>	/* for std::string */
 
+/*
+ * exception specifications: NG_THROWS marks functions that may throw a
+ * netgazer::Exception, NG_NOEXCEPT those that never throw; dynamic
+ * specifications are gone from C++17, so newer standards get noexcept
+ */
+#if __cplusplus >= 201103L
+#define NG_THROWS	noexcept(false)
+#define NG_NOEXCEPT	noexcept
+#else
+#define NG_THROWS	throw (netgazer::Exception)
+#define NG_NOEXCEPT	throw ()
+#endif
+
 namespace netgazer {
 	class Exception {
 	/* constructors and destructor */
@@ -0,0 +1,101 @@
+/*
+ * header file for struct FlowKey
+ */
+
+#pragma once
+
+#ifndef NG_FLOW_KEY_H_
+#define NG_FLOW_KEY_H_
+
+#include <cstring>	/* for std::memset and std::memcmp */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "Hash.h"		/* for netgazer::Hash */
+
+namespace netgazer {
+	/*
+	 * 16-byte IPv4 flow key, fields that are not part of a given key
+	 * type are zero so keys can be hashed and compared as raw bytes
+	 */
+	struct FlowKey {
+	/* internal structures and enumerations */
+	public:
+		/* which packet fields make up the key */
+		enum KeyType {
+			SOURCE = 0,		/* source address */
+			DESTINATION = 1,	/* destination address */
+			PAIR = 2,		/* source and destination address */
+			FIVE_TUPLE = 3,		/* addresses, ports and protocol */
+		};
+
+	/* public static methods */
+	public:
+		/*
+		 * build a key from a summary record; the key is all zeros
+		 * for packets without IPv4, which callers should skip
+		 *
+		 * @s: summary record
+		 * @type: which fields make up the key
+		 *
+		 * return: the key
+		 */
+		static inline struct FlowKey make(const struct PacketSummary & s,
+			enum KeyType type)
+		{
+			struct FlowKey k;
+
+			std::memset(&k, 0, sizeof(k));
+			if (type != FlowKey::DESTINATION) {
+				k.src_addr = s.src_addr;
+			}
+			if (type != FlowKey::SOURCE) {
+				k.dest_addr = s.dest_addr;
+			}
+			if (type == FlowKey::FIVE_TUPLE) {
+				k.src_port = s.src_port;
+				k.dest_port = s.dest_port;
+				k.protocol = s.protocol;
+			}
+			return k;
+		}
+
+	/* public methods */
+	public:
+		/*
+		 * hash the key
+		 *
+		 * return: 64-bit hash value
+		 */
+		inline uint64_t hash() const
+		{
+			uint64_t a = 0, b = 0;
+
+			std::memcpy(&a, this, 8);
+			std::memcpy(&b, (const char *)this + 8, 8);
+			return Hash::mix64(a ^ Hash::mix64(b ^
+				0x9e3779b97f4a7c15ULL));
+		}
+
+		inline bool operator==(const struct FlowKey & other) const
+		{
+			return std::memcmp(this, &other, sizeof(other)) == 0;
+		}
+
+		inline bool operator<(const struct FlowKey & other) const
+		{
+			return std::memcmp(this, &other, sizeof(other)) < 0;
+		}
+
+	/* fields */
+	public:
+		uint32_t src_addr;	/* network order */
+		uint32_t dest_addr;	/* network order */
+		uint16_t src_port;	/* host order */
+		uint16_t dest_port;	/* host order */
+		uint8_t protocol;
+		uint8_t pad[3];
+	};
+}
+
+#endif /* NG_FLOW_KEY_H_ */
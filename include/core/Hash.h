@@ -0,0 +1,66 @@
+/*
+ * header file for class Hash
+ */
+
+#pragma once
+
+#ifndef NG_HASH_H_
+#define NG_HASH_H_
+
+#include <cstring>	/* for std::memcpy */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+namespace netgazer {
+	class Hash {
+	/* public static methods */
+	public:
+		/*
+		 * finalize a 64-bit value so that every input bit affects
+		 * every output bit (MurmurHash3 fmix64)
+		 *
+		 * @x: value to mix
+		 *
+		 * return: mixed value
+		 */
+		static inline uint64_t mix64(uint64_t x)
+		{
+			x ^= x >> 33;
+			x *= 0xff51afd7ed558ccdULL;
+			x ^= x >> 33;
+			x *= 0xc4ceb9fe1a85ec53ULL;
+			x ^= x >> 33;
+			return x;
+		}
+
+		/*
+		 * hash a byte string, eight bytes at a time
+		 *
+		 * @data: bytes to hash
+		 * @length: number of bytes
+		 * @seed: hash seed
+		 *
+		 * return: 64-bit hash value
+		 */
+		static inline uint64_t bytes(const void * data, size_t length,
+			uint64_t seed = 0)
+		{
+			const unsigned char * p = (const unsigned char *)data;
+			uint64_t h = seed ^ (length * 0x9e3779b97f4a7c15ULL);
+			uint64_t w = 0;
+
+			for (; length >= 8; length -= 8, p += 8) {
+				std::memcpy(&w, p, 8);
+				h = (h ^ Hash::mix64(w)) * 0x9e3779b97f4a7c15ULL;
+			}
+			if (length > 0) {
+				w = 0;
+				std::memcpy(&w, p, length);
+				h = (h ^ Hash::mix64(w)) * 0x9e3779b97f4a7c15ULL;
+			}
+			return Hash::mix64(h);
+		}
+	};
+}
+
+#endif /* NG_HASH_H_ */
@@ -0,0 +1,140 @@
+/*
+ * header file for class HeavyHitters
+ */
+
+#pragma once
+
+#ifndef NG_HEAVY_HITTERS_H_
+#define NG_HEAVY_HITTERS_H_
+
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "FlowKey.h"		/* for netgazer::FlowKey */
+
+namespace netgazer {
+	/*
+	 * constant-memory streaming top-K, combining a Space-Saving summary
+	 * of k counters with a Count-Min sketch of depth x width counters
+	 * using conservative update
+	 *
+	 * With N the total weight added:
+	 *  - estimate() never underestimates, and overestimates by more
+	 *    than e * N / width with probability at most exp(-depth);
+	 *  - a key enters the top-K only once its sketch estimate exceeds
+	 *    the smallest monitored count, so one-off keys (e.g. spoofed
+	 *    sources) cannot evict heavy ones;
+	 *  - every reported entry satisfies count - error <= true weight
+	 *    <= count, and count - true weight is bounded by the sketch
+	 *    error above;
+	 *  - any key whose weight exceeds N / k + e * N / width is reported
+	 *    with probability at least 1 - exp(-depth).
+	 * Instances with equal parameters can be merged, so each capture
+	 * thread may keep its own and combine them when reporting. Like
+	 * DistinctTable, it ignores summaries of packets without IPv4. The
+	 * counters and the sketch are charged to the MemoryConsumer base;
+	 * they are sized up front and never shed.
+	 */
+	class HeavyHitters : public Checkpointable, public MemoryConsumer {
+	/* internal structures and enumerations */
+	public:
+		/* what a key is weighted by */
+		enum Weight {
+			PACKETS = 0,
+			BYTES = 1,
+		};
+		/* a reported key */
+		struct Entry {
+			struct FlowKey key;
+			uint64_t count;		/* upper bound of the weight */
+			uint64_t error;		/* count - error is a lower bound */
+		};
+
+	private:
+		/* a monitored key, kept in a min-heap by count */
+		struct Counter {
+			struct FlowKey key;
+			uint64_t hash;
+			uint64_t count;
+			uint64_t error;
+			uint32_t slot;		/* position in m_table */
+		};
+
+	/* constructors and destructor */
+	public:
+		HeavyHitters(size_t k, enum FlowKey::KeyType type,
+			enum Weight weight, size_t width = 4096, size_t depth = 4)
+			NG_THROWS;
+		~HeavyHitters();
+
+	/* public methods */
+	public:
+		/*
+		 * account a packet; packets without IPv4 have no flow key
+		 * and are skipped, so they count neither as a flow nor in
+		 * the total
+		 *
+		 * @s: summary record of the packet
+		 * @rate: sampling rate the packet was kept at, one in rate
+		 *        packets, so that estimates are scaled back up
+		 */
+		inline void add(const struct PacketSummary & s,
+			uint32_t rate = 1)
+		{
+			if (!(s.flags & PacketSummary::IPV4)) {
+				return;
+			}
+			this->add(FlowKey::make(s, this->m_type),
+				(this->m_weight == HeavyHitters::BYTES ?
+				(uint64_t)s.length : 1) * rate);
+		}
+
+		void add(const struct FlowKey & key, uint64_t weight);
+		uint64_t estimate(const struct FlowKey & key) const;
+		std::vector<struct Entry> top(size_t n) const NG_THROWS;
+		void merge(const HeavyHitters & other) NG_THROWS;
+		void clear();
+		uint64_t total() const;
+		size_t memory() const;
+		virtual void extents(
+			std::vector<struct Checkpointable::Extent> & extents)
+			const NG_THROWS;
+		virtual size_t shed(size_t bytes);
+
+	/* private methods */
+	private:
+		long find(const struct FlowKey & key, uint64_t hash) const;
+		void insert(size_t pos);
+		void erase(size_t pos);
+		void swap(size_t a, size_t b);
+		void siftDown(size_t pos);
+		uint64_t update(uint64_t hash, uint64_t weight);
+		uint64_t sketch(uint64_t hash) const;
+
+	/* fields */
+	private:
+		size_t m_k;
+		enum FlowKey::KeyType m_type;
+		enum Weight m_weight;
+		struct Counter * m_heap;
+		size_t m_size;
+		uint32_t * m_table;	/* heap position + 1, 0 for empty */
+		size_t m_table_mask;
+		uint64_t * m_cms;
+		size_t m_width;
+		size_t m_depth;
+		uint64_t m_total;
+
+	/* disabled copy operations */
+	private:
+		HeavyHitters(const HeavyHitters &);
+		HeavyHitters & operator=(const HeavyHitters &);
+	};
+}
+
+#endif /* NG_HEAVY_HITTERS_H_ */
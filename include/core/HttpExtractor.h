@@ -0,0 +1,60 @@
+/*
+ * header file for class HttpExtractor
+ */
+
+#pragma once
+
+#ifndef NG_HTTP_EXTRACTOR_H_
+#define NG_HTTP_EXTRACTOR_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "Dissector.h"	/* for netgazer::Dissector */
+
+namespace netgazer {
+	/*
+	 * extractor of the request line and Host header of HTTP/1.x
+	 * requests, parsing in place without allocating; only the headers
+	 * within the first segment of a request are seen
+	 */
+	class HttpExtractor {
+	/* internal structures and enumerations */
+	public:
+		/* record limits */
+		enum {
+			MAX_METHOD = 15,
+			MAX_URI = 255,
+			MAX_HOST = 255,
+		};
+		/* record flags */
+		enum Flag {
+			HAS_HOST = 0x01,	/* a Host header was found */
+			URI_TRUNCATED = 0x02,	/* URI cut at MAX_URI */
+			HOST_TRUNCATED = 0x04,	/* host cut at MAX_HOST */
+			INCOMPLETE = 0x08,	/* headers continue past the view */
+		};
+		/* metadata of an HTTP request, strings NUL terminated */
+		struct Record {
+			uint8_t version_major;
+			uint8_t version_minor;
+			uint8_t flags;		/* enum Flag bits */
+			uint8_t method_length;
+			uint16_t uri_length;
+			uint16_t host_length;
+			char method[MAX_METHOD + 1];
+			char uri[MAX_URI + 1];
+			char host[MAX_HOST + 1];
+		};
+
+	/* public static methods */
+	public:
+		static bool extract(const u_char * payload, size_t length,
+			struct Record & r);
+		static bool extract(const u_char * data, size_t caplen,
+			const struct Dissector::Dissection & d, struct Record & r);
+	};
+}
+
+#endif /* NG_HTTP_EXTRACTOR_H_ */
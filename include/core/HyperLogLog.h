@@ -0,0 +1,90 @@
+/*
+ * header file for class HyperLogLog
+ */
+
+#pragma once
+
+#ifndef NG_HYPER_LOG_LOG_H_
+#define NG_HYPER_LOG_LOG_H_
+
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Checkpointable.h"	/* for netgazer::Checkpointable */
+
+namespace netgazer {
+	/*
+	 * HyperLogLog distinct-count estimator with 2^p one-byte registers,
+	 * the relative standard error is about 1.04 / sqrt(2^p)
+	 */
+	class HyperLogLog : public Checkpointable {
+	/* constructors and destructor */
+	public:
+		HyperLogLog(unsigned precision = 12) NG_THROWS;
+		~HyperLogLog();
+
+	/* public methods */
+	public:
+		/*
+		 * add an item
+		 *
+		 * @hash: 64-bit hash of the item
+		 */
+		inline void add(uint64_t hash)
+		{
+			HyperLogLog::add(this->m_registers, this->m_precision,
+				hash);
+		}
+
+		double estimate() const;
+		void merge(const HyperLogLog & other) NG_THROWS;
+		void clear();
+		unsigned precision() const;
+		size_t memory() const;
+		virtual void extents(
+			std::vector<struct Checkpointable::Extent> & extents)
+			const NG_THROWS;
+
+	/* public static methods */
+	public:
+		/*
+		 * add an item to a register array
+		 *
+		 * @registers: 2^precision registers
+		 * @precision: number of index bits
+		 * @hash: 64-bit hash of the item
+		 */
+		static inline void add(uint8_t * registers, unsigned precision,
+			uint64_t hash)
+		{
+			size_t index = hash >> (64 - precision);
+			/* the sentinel bit bounds the rank by 64 - p + 1 */
+			uint64_t rest = (hash << precision) |
+				(1ULL << (precision - 1));
+			uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+
+			if (registers[index] < rank) {
+				registers[index] = rank;
+			}
+		}
+
+		static double estimate(const uint8_t * registers,
+			unsigned precision);
+		static void merge(uint8_t * dest, const uint8_t * src,
+			size_t count);
+
+	/* fields */
+	private:
+		unsigned m_precision;
+		uint8_t * m_registers;
+
+	/* disabled copy operations */
+	private:
+		HyperLogLog(const HyperLogLog &);
+		HyperLogLog & operator=(const HyperLogLog &);
+	};
+}
+
+#endif /* NG_HYPER_LOG_LOG_H_ */
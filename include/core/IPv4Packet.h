@@ -44,19 +44,90 @@ namespace netgazer {
 
 	/* constructors and destructor */
 	private:
-		IPv4Packet(const struct pcap_pkthdr * header, const u_char * data)
-			throw (Exception);
+		IPv4Packet(const struct pcap_pkthdr * header, const u_char * data,
+			bool nano = false) NG_THROWS;
 	public:
 		~IPv4Packet();
 
 	/* public methods */
 	public:
-		int headerLength() const throw (Exception);
-		int totalLength() const throw (Exception);
-		enum IPType ipType() const throw (Exception);
-		u_short checksum() const throw (Exception);
-		struct IPv4Addr srcIPv4Addr() const throw (Exception);
-		struct IPv4Addr destIPv4Addr() const throw (Exception);
+		/*
+		 * get the IP packet header length
+		 *
+		 * return: header length of this IPv4Packet
+		 */
+		inline int headerLength() const NG_NOEXCEPT
+		{
+			return this->m_ip_header->ihl;
+		}
+
+		/*
+		 * get the IP packet length
+		 *
+		 * return: total length of this IPv4Packet
+		 */
+		inline int totalLength() const NG_NOEXCEPT
+		{
+			return this->m_ip_header->length;
+		}
+
+		/*
+		 * get the IP type
+		 *
+		 * return: IP type of this IPv4Packet
+		 */
+		inline enum IPType ipType() const NG_NOEXCEPT
+		{
+			switch (this->m_ip_header->protocol) {
+			/* Internet Control Message Protocol */
+			case 1:
+				return IPv4Packet::ICMP;
+
+			/* The Internet Group Management Protocol */
+			case 2:
+				return IPv4Packet::IGMP;
+
+			/* Transmission Control Protocol */
+			case 6:
+				return IPv4Packet::TCP;
+
+			/* User Datagram Protocol */
+			case 17:
+				return IPv4Packet::UDP;
+
+			/* other protocols */
+			default:
+				return IPv4Packet::OTHER;
+			}
+		}
+
+		inline u_short checksum() const NG_NOEXCEPT
+		{
+			return this->m_ip_header->checksum;
+		}
+
+		/*
+		 * get the packet source IPv4 address
+		 *
+		 * return: source IPv4 address of this Packet
+		 */
+		inline struct IPv4Addr srcIPv4Addr() const NG_NOEXCEPT
+		{
+			return this->m_ip_header->src;
+		}
+
+		/*
+		 * get the packet destination IPv4 address
+		 *
+		 * return: destination IPv4 address of this Packet
+		 */
+		inline struct IPv4Addr destIPv4Addr() const NG_NOEXCEPT
+		{
+			return this->m_ip_header->dest;
+		}
+
+		Packet * clone() const NG_THROWS;
+		size_t memory() const NG_NOEXCEPT;
 
 	/* fields */
 	private:
@@ -64,6 +135,7 @@ namespace netgazer {
 
 	/* friend declarations */
 	friend class Adapter;
+	friend class PcapReplay;
 	};
 
 	/* overriden operators for std::ostream */
@@ -0,0 +1,78 @@
+/*
+ * header file for class MemoryConsumer
+ */
+
+#pragma once
+
+#ifndef NG_MEMORY_CONSUMER_H_
+#define NG_MEMORY_CONSUMER_H_
+
+#include <string>	/* for std::string */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+namespace netgazer {
+	class MemoryGovernor;
+
+	/*
+	 * base of components owning buffers that grow with traffic, which
+	 * charge what they allocate and give memory back when asked
+	 *
+	 * A component charges its allocations and releases what it frees.
+	 * When charge() returns false the component is over its quota or
+	 * the MemoryGovernor asked it to make room for more important ones,
+	 * and it calls relieve() once its structures are consistent. Until
+	 * it is registered with the MemoryGovernor only usage is counted.
+	 */
+	class MemoryConsumer {
+	/* constructors and destructor */
+	public:
+		MemoryConsumer();
+		virtual ~MemoryConsumer();
+
+	/* public methods */
+	public:
+		/*
+		 * free about the given amount of memory, releasing what was
+		 * freed
+		 *
+		 * @bytes: amount of memory to give back
+		 *
+		 * return: number of bytes released
+		 */
+		virtual size_t shed(size_t bytes) = 0;
+
+		size_t memoryUsage() const;
+		size_t memoryPeak() const;
+
+	/* protected methods */
+	protected:
+		bool charge(size_t bytes);
+		void release(size_t bytes);
+		size_t excess() const;
+		void relieve();
+
+	/* fields */
+	private:
+		MemoryGovernor * m_governor;	/* NULL if unregistered */
+		std::string m_label;
+		size_t m_quota;			/* 0 for no quota */
+		int m_priority;
+		size_t m_current;
+		size_t m_peak;
+		size_t m_pressure;		/* bytes asked back */
+		size_t m_floor;			/* usage it could not shed */
+		uint64_t m_shed;
+		uint64_t m_denied;
+
+	/* disabled copy operations */
+	private:
+		MemoryConsumer(const MemoryConsumer &);
+		MemoryConsumer & operator=(const MemoryConsumer &);
+
+	/* friend declarations */
+	friend class MemoryGovernor;
+	};
+}
+
+#endif /* NG_MEMORY_CONSUMER_H_ */
@@ -0,0 +1,98 @@
+/*
+ * header file for class MemoryGovernor
+ */
+
+#pragma once
+
+#ifndef NG_MEMORY_GOVERNOR_H_
+#define NG_MEMORY_GOVERNOR_H_
+
+#include <string>	/* for std::string */
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pthread.h>	/* for pthread_mutex_t */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+namespace netgazer {
+	/*
+	 * process-wide memory budget shared by the registered consumers
+	 *
+	 * Each consumer may have a quota of its own. When the budget is
+	 * exceeded, the excess is asked back from the consumers of lowest
+	 * priority first, so higher priorities are only shed once the lower
+	 * ones are empty. The request is recorded on the consumer and acted
+	 * on by its own thread, at its next charge, so components need no
+	 * locking of their own; single-threaded programs may call
+	 * reclaim() to shed idle consumers right away.
+	 */
+	class MemoryGovernor {
+	/* internal structures and enumerations */
+	public:
+		/* accounting of a consumer */
+		struct Usage {
+			std::string name;
+			size_t current;		/* bytes */
+			size_t peak;		/* bytes */
+			size_t quota;		/* bytes, 0 for no quota */
+			int priority;
+			uint64_t shed;		/* bytes given back when asked */
+			uint64_t denied;	/* charges over quota or budget */
+		};
+
+	/* constructors and destructor */
+	private:
+		MemoryGovernor() NG_THROWS;
+	public:
+		~MemoryGovernor();
+
+	/* public methods */
+	public:
+		void add(MemoryConsumer * consumer, const char * name,
+			size_t quota = 0, int priority = 0) NG_THROWS;
+		void remove(MemoryConsumer * consumer);
+		void setBudget(size_t bytes);
+		size_t budget() const;
+		size_t current() const;
+		size_t peak() const;
+		std::vector<struct Usage> usage() const NG_THROWS;
+		size_t reclaim() NG_THROWS;
+
+	/* public static methods */
+	public:
+		static MemoryGovernor * instance() NG_THROWS;
+		static void dispose();
+
+	/* private methods */
+	private:
+		bool charge(MemoryConsumer * consumer, size_t bytes);
+		void release(MemoryConsumer * consumer, size_t bytes);
+		void settle(MemoryConsumer * consumer);
+		void squeeze(size_t bytes);
+
+	/* fields */
+	private:
+		size_t m_budget;	/* 0 for no budget */
+		size_t m_total;
+		size_t m_peak;
+		size_t m_pending;	/* bytes asked back, not released yet */
+		std::vector<MemoryConsumer *> m_consumers; /* by priority */
+		mutable pthread_mutex_t m_lock;
+
+	/* static fields */
+	private:
+		static MemoryGovernor * ref;
+
+	/* disabled copy operations */
+	private:
+		MemoryGovernor(const MemoryGovernor &);
+		MemoryGovernor & operator=(const MemoryGovernor &);
+
+	/* friend declarations */
+	friend class MemoryConsumer;
+	};
+}
+
+#endif /* NG_MEMORY_GOVERNOR_H_ */
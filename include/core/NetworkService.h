@@ -7,37 +7,38 @@
 #ifndef NG_NETWORK_SERVICE_H_
 #define NG_NETWORK_SERVICE_H_
 
-#include <vector>	/* for std::vector */
-#include <pcap/pcap.h>	/* for libpcap types */
+#include <stddef.h>	/* for size_t */
 
-#include "Exception.h"	/* for netgazer::Exception */
-#include "Adapter.h"	/* for netgazer::Adapter */
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Adapter.h"		/* for netgazer::Adapter */
+#include "AdapterRegistry.h"	/* for netgazer::AdapterRegistry */
 
 namespace netgazer {
 	class NetworkService {
 	/* constructors and destructor */
 	private:
-		NetworkService() throw (Exception);
+		NetworkService() NG_THROWS;
 	public:
 		~NetworkService();
 
 	/* public methods */
 	public:
-		Adapter * nextAdapter() throw (Exception);
-		Adapter * adapterBy(const char * name) throw (Exception);
-		Adapter * adapterBy(int index) throw (Exception);
-		void reset() throw (Exception);
+		Adapter * nextAdapter() NG_THROWS;
+		Adapter * adapterBy(const char * name) NG_THROWS;
+		Adapter * adapterBy(int index) NG_THROWS;
+		Adapter * adapterByIfindex(int ifindex) NG_THROWS;
+		AdapterRegistry * registry();
+		void reset() NG_THROWS;
 
 	/* public static methods */
 	public:
-		static NetworkService * instance() throw (Exception);
+		static NetworkService * instance() NG_THROWS;
 		static void dispose();
 
 	/* fields */
 	private:
-		pcap_if_t * m_pcap_all_adapters;
-		pcap_if_t * m_pcap_adapter;
-		std::vector<Adapter *> m_adapters;
+		AdapterRegistry m_registry;
+		size_t m_cursor;
 
 	/* static fields */
 	private:
@@ -8,11 +8,20 @@
 #define NG_PACKET_H_
 
 #include <iostream>	/* for std::ostream */
+#include <cstring>	/* for std::memcpy */
+#include <ctime>	/* for struct timespec */
 #include <pcap/pcap.h>	/* for libpcap types */
 
 #include "Exception.h"	/* for netgazer::Exception */
 
 namespace netgazer {
+	/*
+	 * captured frame owning a copy of its data
+	 *
+	 * A Packet only exists once its header and data have been checked
+	 * by the constructor, so its accessors never throw and compile down
+	 * to plain loads on the capture path.
+	 */
 	class Packet {
 	/* internal structures and enumerations */
 	public:
@@ -36,38 +45,157 @@ namespace netgazer {
 
 	/* constructors and destructor */
 	protected:
-		Packet(const struct pcap_pkthdr * header, const u_char * data)
-			throw (Exception);
+		Packet(const struct pcap_pkthdr * header, const u_char * data,
+			bool nano = false) NG_THROWS;
 	public:
 		virtual ~Packet();
 
 	/* public methods */
 	public:
-		size_t length() const throw (Exception);
-		const u_char * data() const throw (Exception);
-		struct timeval timestamp() const throw (Exception);
-		enum EthernetType ethernetType() const throw (Exception);
-		struct MacAddr srcMacAddr() const throw (Exception);
-		struct MacAddr destMacAddr() const throw (Exception);
+		/*
+		 * get the packet length
+		 *
+		 * return: length of this Packet
+		 */
+		inline size_t length() const NG_NOEXCEPT
+		{
+			return this->m_header->len;
+		}
+
+		/*
+		 * get the number of bytes actually captured, which is less
+		 * than length() when the snapshot length or a truncation
+		 * policy cut the packet
+		 *
+		 * return: captured length of this Packet
+		 */
+		inline size_t capturedLength() const NG_NOEXCEPT
+		{
+			return this->m_header->caplen;
+		}
+
+		/*
+		 * get the packet data
+		 *
+		 * return: data of this Packet
+		 */
+		inline const u_char * data() const NG_NOEXCEPT
+		{
+			return this->m_data;
+		}
+
+		/*
+		 * get the packet timestamp
+		 *
+		 * return: timestamp of this Packet
+		 */
+		inline struct timeval timestamp() const NG_NOEXCEPT
+		{
+			struct timeval ts = this->m_header->ts;
+
+			if (this->m_nano) {
+				ts.tv_usec /= 1000;
+			}
+			return ts;
+		}
+
+		/*
+		 * get the packet timestamp with nanosecond resolution, the
+		 * nanoseconds are only significant if the adapter was opened
+		 * with nanosecond precision
+		 *
+		 * return: timestamp of this Packet
+		 */
+		inline struct timespec preciseTimestamp() const NG_NOEXCEPT
+		{
+			struct timespec ts;
+
+			/* libpcap stores nanoseconds in tv_usec in nano mode */
+			ts.tv_sec = this->m_header->ts.tv_sec;
+			ts.tv_nsec = this->m_nano ? this->m_header->ts.tv_usec :
+				this->m_header->ts.tv_usec * 1000;
+			return ts;
+		}
+
+		/*
+		 * get the Ethernet packet type
+		 *
+		 * return: Ethernet type of this Packet
+		 */
+		inline enum EthernetType ethernetType() const NG_NOEXCEPT
+		{
+			switch (((const struct PacketHeader *)
+				this->m_data)->type) {
+			/* Internet Protocol */
+			case 0x0800: case 0x0008:
+				return Packet::IP;
+
+			/* Address Resolution Protocol */
+			case 0x0806: case 0x0608:
+				return Packet::ARP;
+
+			/* Reverse Address Resolution Protocol */
+			case 0x8035: case 0x3508:
+				return Packet::RARP;
+
+			/* other protocols */
+			default:
+				return Packet::OTHER;
+			}
+		}
+
+		/*
+		 * get the packet source MAC address
+		 *
+		 * return: source MAC address of this Packet
+		 */
+		inline struct MacAddr srcMacAddr() const NG_NOEXCEPT
+		{
+			struct MacAddr mac;
+
+			std::memcpy(&mac, &(((const struct PacketHeader *)
+				this->m_data)->src), sizeof(mac));
+			return mac;
+		}
+
+		/*
+		 * get the packet destination MAC address
+		 *
+		 * return: destination MAC address of this Packet
+		 */
+		inline struct MacAddr destMacAddr() const NG_NOEXCEPT
+		{
+			struct MacAddr mac;
+
+			std::memcpy(&mac, &(((const struct PacketHeader *)
+				this->m_data)->dest), sizeof(mac));
+			return mac;
+		}
+
+		virtual Packet * clone() const NG_THROWS;
+		virtual size_t memory() const NG_NOEXCEPT;
 
 	/* protected static methods */
 	protected:
 		static bool isIpv4Packet(const struct pcap_pkthdr * pcap_header,
-			const u_char * data) throw (Exception);
+			const u_char * data) NG_NOEXCEPT;
 
 	/* fields */
 	protected:
 		struct pcap_pkthdr * m_header;
 		u_char * m_data;
+		bool m_nano;
 
 	/* friend declarations */
 	friend class Adapter;
+	friend class PcapReplay;
 	};
 
 	/* overriden operators for std::ostream */
 	std::ostream & operator<<(std::ostream & os,
 		enum Packet::EthernetType type);
 	std::ostream & operator<<(std::ostream & os, const struct timeval & ts);
+	std::ostream & operator<<(std::ostream & os, const struct timespec & ts);
 	std::ostream & operator<<(std::ostream & os,
 		const struct Packet::MacAddr & mac);
 }
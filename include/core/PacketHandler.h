@@ -0,0 +1,41 @@
+/*
+ * header file for class PacketHandler
+ */
+
+#pragma once
+
+#ifndef NG_PACKET_HANDLER_H_
+#define NG_PACKET_HANDLER_H_
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Packet.h"		/* for netgazer::Packet */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+
+namespace netgazer {
+	class Adapter;
+
+	/*
+	 * receiver of packets delivered in batches, the packet or summary
+	 * is owned by the adapter and only guaranteed to stay valid until
+	 * the call returns
+	 */
+	class PacketHandler {
+	/* constructors and destructor */
+	public:
+		virtual ~PacketHandler()
+		{
+		}
+
+	/* public methods */
+	public:
+		virtual void onPacket(Adapter * adapter, Packet * packet)
+			NG_THROWS = 0;
+
+		virtual void onSummary(Adapter * /* adapter */,
+			const PacketSummary * /* summary */) NG_THROWS
+		{
+		}
+	};
+}
+
+#endif /* NG_PACKET_HANDLER_H_ */
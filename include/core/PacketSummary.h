@@ -0,0 +1,55 @@
+/*
+ * header file for struct PacketSummary
+ */
+
+#pragma once
+
+#ifndef NG_PACKET_SUMMARY_H_
+#define NG_PACKET_SUMMARY_H_
+
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+namespace netgazer {
+	/*
+	 * fixed-size packet metadata record, two of which fit in a cache
+	 * line; it is a POD so that arrays of it can be copied, mapped and
+	 * scanned without touching the frame data
+	 */
+	struct PacketSummary {
+	/* internal structures and enumerations */
+	public:
+		/* summary flags */
+		enum Flag {
+			IPV4 = 0x01,		/* addresses are valid */
+			PORTS = 0x02,		/* ports are valid */
+			FRAGMENT = 0x04,	/* non-first IPv4 fragment */
+			TRUNCATED = 0x08,	/* headers cut by the snaplen */
+			TCP_FIN = 0x10,
+			TCP_SYN = 0x20,
+			TCP_RST = 0x40,
+			TCP_ACK = 0x80,
+		};
+
+	/* public static methods */
+	public:
+		static void summarize(const struct pcap_pkthdr * header,
+			const u_char * data, bool nano,
+			struct PacketSummary & summary);
+
+	/* fields */
+	public:
+		uint64_t ts_ns;		/* nanoseconds since the epoch */
+		uint32_t length;	/* original frame length */
+		uint32_t mac_hash;	/* hash of both MAC addresses */
+		uint32_t src_addr;	/* IPv4 source, network order */
+		uint32_t dest_addr;	/* IPv4 destination, network order */
+		uint16_t src_port;	/* host order */
+		uint16_t dest_port;	/* host order */
+		uint16_t ether_type;	/* host order, after VLAN tags */
+		uint8_t protocol;	/* IPv4 protocol number */
+		uint8_t flags;		/* enum Flag bits */
+	} __attribute__((packed));
+}
+
+#endif /* NG_PACKET_SUMMARY_H_ */
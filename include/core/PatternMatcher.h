@@ -0,0 +1,114 @@
+/*
+ * header file for class PatternMatcher
+ */
+
+#pragma once
+
+#ifndef NG_PATTERN_MATCHER_H_
+#define NG_PATTERN_MATCHER_H_
+
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "Exception.h"	/* for netgazer::Exception */
+#include "Packet.h"	/* for netgazer::Packet */
+
+namespace netgazer {
+	/*
+	 * multi-pattern matcher over packet payloads and streams
+	 *
+	 * Patterns are compiled into an Aho-Corasick automaton whose
+	 * transitions are fully resolved into a DFA table over byte
+	 * classes, one row per state. A shift-or prefilter over the first
+	 * bytes of all patterns runs ahead of the DFA and skips payloads in
+	 * which no pattern can start, which is the common case. Scanning
+	 * never allocates.
+	 */
+	class PatternMatcher {
+	/* internal structures and enumerations */
+	public:
+		/* a pattern occurrence */
+		struct Match {
+			uint32_t id;		/* id given to add() */
+			uint32_t packet;	/* index in the batch */
+			uint64_t offset;	/* first byte, in the payload or stream */
+		};
+		/* receiver of matches */
+		class Callback {
+		public:
+			virtual ~Callback()
+			{
+			}
+
+			/* return false to stop scanning the current input */
+			virtual bool onMatch(const struct Match & match) = 0;
+		};
+		/* scan state carried across the segments of a stream */
+		struct Stream {
+			uint32_t state;		/* DFA state */
+			uint64_t shift;		/* shift-or state */
+			uint64_t offset;	/* stream offset of the next byte */
+		};
+
+	private:
+		/* output list of a DFA state */
+		struct Output {
+			uint32_t first;		/* index in m_outputs */
+			uint32_t count;
+		};
+
+	/* constructors and destructor */
+	public:
+		PatternMatcher();
+		~PatternMatcher();
+
+	/* public methods */
+	public:
+		void add(const void * pattern, size_t length, uint32_t id)
+			NG_THROWS;
+		void compile() NG_THROWS;
+		size_t scan(const u_char * data, size_t length,
+			Callback * callback) const NG_THROWS;
+		size_t scan(Packet * const * packets, size_t count,
+			Callback * callback) const NG_THROWS;
+		void reset(struct Stream & stream) const;
+		size_t scan(struct Stream & stream, const u_char * data,
+			size_t length, Callback * callback) const
+			NG_THROWS;
+		size_t patterns() const;
+		size_t states() const;
+		size_t memory() const;
+
+	/* private methods */
+	private:
+		bool candidate(const u_char * data, size_t length,
+			uint64_t & shift, size_t * start) const;
+		size_t run(uint32_t & state, const u_char * data, size_t length,
+			uint64_t base, uint32_t packet, Callback * callback,
+			bool * stopped) const;
+
+	/* fields */
+	private:
+		/* patterns, concatenated */
+		std::vector<u_char> m_bytes;
+		std::vector<uint32_t> m_starts;	/* m_bytes offsets, + end */
+		std::vector<uint32_t> m_ids;
+
+		/* compiled automaton */
+		bool m_compiled;
+		uint8_t m_classes[256];		/* byte to class */
+		uint32_t m_class_count;
+		std::vector<uint32_t> m_table;	/* state * classes + class */
+		std::vector<uint16_t> m_depths;	/* trie depth, saturated */
+		std::vector<struct Output> m_accepts;	/* by state */
+		std::vector<uint32_t> m_outputs;	/* pattern indices */
+
+		/* shift-or prefilter over the first m_prefix bytes */
+		uint64_t m_masks[256];
+		unsigned m_prefix;		/* 0 disables the prefilter */
+	};
+}
+
+#endif /* NG_PATTERN_MATCHER_H_ */
@@ -0,0 +1,179 @@
+/*
+ * header file for class PcapAnalyzer
+ */
+
+#pragma once
+
+#ifndef NG_PCAP_ANALYZER_H_
+#define NG_PCAP_ANALYZER_H_
+
+#include <vector>	/* for std::vector */
+#include <string>	/* for std::string */
+#include <tr1/unordered_map>	/* for std::tr1::unordered_map */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pthread.h>	/* for pthread_mutex_t */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Dissector.h"		/* for netgazer::Dissector */
+#include "FlowKey.h"		/* for netgazer::FlowKey */
+
+namespace netgazer {
+	/*
+	 * offline analysis of a pcap file on several threads
+	 *
+	 * The file is mapped and cut into chunks of a fixed size. The first
+	 * record of a chunk is found by scanning for an offset where a
+	 * chain of plausible record headers starts, so no index is needed;
+	 * should payload pass for such a chain, the chunk is decoded again
+	 * from where the previous one stopped. Each chunk is decoded into
+	 * counters and a flow table of its own; results are merged in chunk
+	 * order as chunks complete, so the outcome does not depend on the
+	 * number of threads or on their scheduling, and finished chunks do
+	 * not pile up in memory.
+	 */
+	class PcapAnalyzer {
+	/* internal structures and enumerations */
+	public:
+		/* analysis options */
+		struct Options {
+			Options();
+
+			unsigned threads;	/* 0 for one per online CPU */
+			size_t chunk_size;	/* bytes per chunk */
+			bool flows;		/* build the flow table */
+			enum FlowKey::KeyType key_type;
+		};
+		/* traffic of a flow */
+		struct Flow {
+			struct FlowKey key;
+			uint64_t packets;
+			uint64_t bytes;		/* original lengths */
+			uint64_t first_ns;
+			uint64_t last_ns;
+		};
+		/* counters over the whole file */
+		struct Totals {
+			uint64_t packets;
+			uint64_t bytes;		/* original lengths */
+			uint64_t captured;	/* captured lengths */
+			uint64_t ipv4;
+			uint64_t tcp;
+			uint64_t udp;
+			uint64_t fragments;	/* non-first IPv4 fragments */
+			uint64_t truncated;	/* headers cut by the snaplen */
+			uint64_t first_ns;	/* 0 if there is no packet */
+			uint64_t last_ns;
+		};
+		/* outcome of an analysis */
+		struct Result {
+			struct Totals totals;
+			std::vector<struct Flow> flows;	/* ordered by key */
+			size_t chunks;
+			unsigned threads;
+			uint64_t resyncs;	/* corrupt records skipped over */
+			uint64_t skipped;	/* bytes not parsed as records */
+			uint64_t mismatches;	/* chunks decoded again from a boundary */
+			double elapsed;		/* seconds */
+		};
+		/*
+		 * user analysis run on every record; one is forked per chunk
+		 * and folded into the original in chunk order; chunks are
+		 * forked concurrently from a prototype forked before the run,
+		 * so fork() must only read its object
+		 */
+		class Analysis {
+		public:
+			virtual ~Analysis()
+			{
+			}
+
+			virtual Analysis * fork() const = 0;
+			virtual void add(uint64_t ts_ns, const u_char * data,
+				uint32_t caplen, uint32_t length,
+				const struct Dissector::Dissection & d) = 0;
+			virtual void merge(const Analysis & later) = 0;
+		};
+
+	private:
+		/* hash of flow keys */
+		struct KeyHash {
+			size_t operator()(const struct FlowKey & key) const
+			{
+				return (size_t)key.hash();
+			}
+		};
+		typedef std::tr1::unordered_map<struct FlowKey, struct Flow,
+			struct KeyHash> FlowTable;
+		/* state and outcome of one chunk */
+		struct Chunk {
+			size_t begin;		/* first record */
+			size_t end;		/* first byte of the next chunk */
+			size_t stop;		/* where decoding stopped */
+			struct Totals totals;
+			FlowTable flows;
+			Analysis * analysis;
+			uint64_t resyncs;
+			uint64_t skipped;
+		};
+		/* shared state of a run */
+		struct Job {
+			PcapAnalyzer * owner;
+			const struct Options * options;
+			Analysis * analysis;
+			const Analysis * prototype;	/* forked per chunk */
+			size_t count;			/* number of chunks */
+			size_t next;			/* next chunk to take */
+			pthread_mutex_t lock;
+			std::vector<struct Chunk *> done; /* waiting to merge */
+			size_t merged;			/* chunks merged */
+			struct Chunk * total;
+			size_t last_stop;		/* stop of the last merged */
+			uint64_t mismatches;
+			std::string error;		/* first failure */
+		};
+
+	/* constructors and destructor */
+	public:
+		PcapAnalyzer(const char * file) NG_THROWS;
+		~PcapAnalyzer();
+
+	/* public methods */
+	public:
+		struct Result run(const struct Options & options,
+			Analysis * analysis = NULL) NG_THROWS;
+		size_t size() const;
+		int linkType() const;
+		bool nano() const;
+
+	/* private methods */
+	private:
+		bool header(size_t offset, uint64_t * ts_ns, uint32_t * caplen,
+			uint32_t * length) const;
+		bool plausible(size_t offset) const;
+		size_t sync(size_t from, size_t limit) const;
+		void decode(struct Chunk & c, const struct Options & options)
+			const;
+		static void merge(struct Chunk & into, struct Chunk & from);
+		static void fail(struct Job * job, struct Chunk * c,
+			const char * error);
+		static void * work(void * arg);
+
+	/* fields */
+	private:
+		const u_char * m_data;
+		size_t m_size;
+		bool m_swapped;		/* byte order differs from ours */
+		bool m_nano;
+		uint32_t m_snaplen;
+		int m_link_type;
+
+	/* disabled copy operations */
+	private:
+		PcapAnalyzer(const PcapAnalyzer &);
+		PcapAnalyzer & operator=(const PcapAnalyzer &);
+	};
+}
+
+#endif /* NG_PCAP_ANALYZER_H_ */
@@ -0,0 +1,138 @@
+/*
+ * header file for class PcapReplay
+ */
+
+#pragma once
+
+#ifndef NG_PCAP_REPLAY_H_
+#define NG_PCAP_REPLAY_H_
+
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Adapter.h"		/* for netgazer::Adapter */
+#include "PacketHandler.h"	/* for netgazer::PacketHandler */
+
+namespace netgazer {
+	/*
+	 * replay of a pcap file into a PacketHandler or out of an adapter,
+	 * at the recorded timing, a multiple of it, a fixed packet or bit
+	 * rate, or as fast as possible
+	 *
+	 * The file is loaded into memory up front so that disk reads do not
+	 * disturb the pacing. Packets are sent on a schedule kept in TSC
+	 * ticks: gaps longer than a fraction of a millisecond are slept,
+	 * the rest is spun. Packets handed to a PacketHandler are stamped
+	 * with the time they are sent and come from a NULL adapter. On
+	 * every pass after the first, IPv4 addresses can be shifted with
+	 * the checksums fixed up, so that loops look like new flows.
+	 */
+	class PcapReplay {
+	/* internal structures and enumerations */
+	public:
+		/* pacing modes */
+		enum Mode {
+			ORIGINAL = 0,	/* recorded timing */
+			SCALED = 1,	/* recorded timing, speed times faster */
+			FIXED_PPS = 2,	/* rate packets per second */
+			FIXED_BPS = 3,	/* rate bits per second */
+			FLAT_OUT = 4,	/* no pacing */
+		};
+		/* replay options */
+		struct Options {
+			Options();
+
+			enum Mode mode;
+			double speed;		/* SCALED: multiple of the timing */
+			double rate;		/* FIXED_PPS or FIXED_BPS rate */
+			unsigned loops;		/* passes, 0 to run until stop() */
+			uint32_t address_step;	/* added to addresses per pass */
+			bool summaries;		/* deliver summaries, not packets */
+		};
+		/* outcome of a replay, rates count original frame lengths */
+		struct Report {
+			uint64_t packets;	/* packets sent */
+			uint64_t bytes;		/* original bytes sent */
+			uint64_t skipped;	/* frames too short to deliver */
+			double elapsed;		/* seconds */
+			double requested_pps;	/* 0 for FLAT_OUT */
+			double requested_bps;	/* 0 for FLAT_OUT */
+			double achieved_pps;
+			double achieved_bps;
+			uint64_t late;		/* sent over 10us behind schedule */
+			double max_lateness;	/* seconds */
+		};
+
+	private:
+		/* a loaded frame */
+		struct Record {
+			uint64_t ts_ns;		/* recorded timestamp */
+			size_t offset;		/* in m_data */
+			uint32_t caplen;
+			uint32_t length;
+		};
+
+	/* constructors and destructor */
+	public:
+		PcapReplay(const char * file) NG_THROWS;
+		~PcapReplay();
+
+	/* public methods */
+	public:
+		struct Report replay(PacketHandler * handler,
+			const struct Options & options) NG_THROWS;
+		struct Report replay(Adapter * output,
+			const struct Options & options) NG_THROWS;
+		void stop();
+		size_t packets() const;
+		uint64_t bytes() const;
+		uint64_t duration() const;
+		int linkType() const;
+
+	/* private methods */
+	private:
+		struct Report start(PacketHandler * handler, Adapter * output,
+			const struct Options & options) NG_THROWS;
+		struct Report run(PacketHandler * handler, Adapter * output,
+			const struct Options & options) NG_THROWS;
+		bool deliver(PacketHandler * handler, Adapter * output,
+			const struct Record & r, uint64_t ts_ns, uint32_t delta,
+			bool summaries, u_char * scratch) NG_THROWS;
+
+		/*
+		 * tell whether stop() was called
+		 *
+		 * return: true if the replay has to stop
+		 */
+		inline bool stopping() const
+		{
+			return __atomic_load_n(&(this->m_stop),
+				__ATOMIC_ACQUIRE);
+		}
+
+	/* private static methods */
+	private:
+		static void rewrite(u_char * frame, size_t caplen,
+			uint32_t delta);
+		static double ticksPerNs();
+
+	/* fields */
+	private:
+		std::vector<u_char> m_data;
+		std::vector<struct Record> m_records;
+		uint64_t m_bytes;
+		int m_link_type;
+		bool m_running;		/* atomic, a replay is in progress */
+		bool m_stop;		/* atomic, stop() was called */
+
+	/* disabled copy operations */
+	private:
+		PcapReplay(const PcapReplay &);
+		PcapReplay & operator=(const PcapReplay &);
+	};
+}
+
+#endif /* NG_PCAP_REPLAY_H_ */
@@ -0,0 +1,107 @@
+/*
+ * header file for class PrefixTable
+ */
+
+#pragma once
+
+#ifndef NG_PREFIX_TABLE_H_
+#define NG_PREFIX_TABLE_H_
+
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <arpa/inet.h>	/* for ntohl */
+
+#include "Exception.h"	/* for netgazer::Exception */
+#include "Topology.h"	/* for netgazer::Topology */
+
+namespace netgazer {
+	/*
+	 * longest-prefix match of IPv4 addresses to label ids
+	 *
+	 * Prefixes are compiled into a DIR-24-8 table: the first 24 bits of
+	 * an address index a 2^24-entry table which holds the label of the
+	 * longest prefix of /24 or shorter, or the number of a 256-entry
+	 * group resolving the last 8 bits when a longer prefix exists. A
+	 * lookup is therefore one or two memory accesses whatever the
+	 * number of prefixes. The big table is placed on huge pages when
+	 * there are any. Label 0 means no prefix matched.
+	 */
+	class PrefixTable {
+	/* internal structures and enumerations */
+	public:
+		enum {
+			MAX_LABEL = 0x7fffffff,	/* largest label id */
+		};
+
+	private:
+		/* a prefix given to add() */
+		struct Prefix {
+			uint32_t addr;		/* host order, no host bits */
+			uint32_t length;
+			uint32_t label;
+		};
+		/* orders prefixes from short to long */
+		struct Shorter {
+			bool operator()(const struct Prefix & a,
+				const struct Prefix & b) const
+			{
+				return a.length < b.length;
+			}
+		};
+
+		enum {
+			EXTENDED = 0x80000000,	/* rest is a group number */
+		};
+
+	/* constructors and destructor */
+	public:
+		PrefixTable() NG_THROWS;
+		~PrefixTable();
+
+	/* public methods */
+	public:
+		void add(uint32_t addr, unsigned length, uint32_t label)
+			NG_THROWS;
+		void compile() NG_THROWS;
+
+		/*
+		 * find the label of the longest prefix covering an address
+		 *
+		 * @addr: IPv4 address, network order
+		 *
+		 * return: label id, 0 if no prefix matches
+		 */
+		inline uint32_t lookup(uint32_t addr) const
+		{
+			uint32_t a = ntohl(addr);
+			uint32_t e = this->m_tbl24[a >> 8];
+
+			if (e & PrefixTable::EXTENDED) {
+				e ^= PrefixTable::EXTENDED;
+				e = this->m_tbl8[(size_t)e << 8 | (a & 0xff)];
+			}
+			return e;
+		}
+
+		void lookup(const uint32_t * addrs, uint32_t * labels,
+			size_t count) const;
+		size_t prefixes() const;
+		size_t groups() const;
+		size_t memory() const;
+
+	/* fields */
+	private:
+		std::vector<struct Prefix> m_prefixes;
+		struct Topology::Region m_region;	/* backs m_tbl24 */
+		uint32_t * m_tbl24;
+		std::vector<uint32_t> m_tbl8;
+
+	/* disabled copy operations */
+	private:
+		PrefixTable(const PrefixTable &);
+		PrefixTable & operator=(const PrefixTable &);
+	};
+}
+
+#endif /* NG_PREFIX_TABLE_H_ */
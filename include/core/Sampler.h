@@ -0,0 +1,171 @@
+/*
+ * header file for class Sampler
+ */
+
+#pragma once
+
+#ifndef NG_SAMPLER_H_
+#define NG_SAMPLER_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+
+namespace netgazer {
+	/*
+	 * packet sampler keeping on average one in rate packets
+	 *
+	 * The rate may be changed from another thread, e.g. by a
+	 * SamplingController, while the capture thread samples. Statistics
+	 * built from sampled packets should be scaled by the rate the
+	 * packets were kept at.
+	 */
+	class Sampler {
+	/* internal structures and enumerations */
+	public:
+		/* sampling modes */
+		enum Mode {
+			ONE_IN_N = 0,		/* every rate-th packet */
+			PROBABILISTIC = 1,	/* each with probability 1/rate */
+			FLOW_HASH = 2,		/* whole flows, both directions */
+		};
+
+	/* constructors and destructor */
+	public:
+		Sampler(enum Mode mode, uint32_t rate = 1, uint64_t seed = 0)
+			NG_THROWS;
+
+	/* public methods */
+	public:
+		/*
+		 * decide whether to keep a captured frame
+		 *
+		 * @header: pcap header of the frame
+		 * @data: frame data
+		 *
+		 * return: true to keep the frame, false to drop it
+		 */
+		inline bool sample(const struct pcap_pkthdr * header,
+			const u_char * data)
+		{
+			uint64_t hash = 0;
+
+			if (this->m_mode == Sampler::FLOW_HASH &&
+				this->threshold() <= 0xffffffffU) {
+				hash = Sampler::flowHash(data, header->caplen,
+					this->m_seed);
+			}
+			return this->decide(hash);
+		}
+
+		/*
+		 * decide whether to keep a summarized packet
+		 *
+		 * @s: summary record of the packet
+		 *
+		 * return: true to keep the packet, false to drop it
+		 */
+		inline bool sample(const struct PacketSummary & s)
+		{
+			uint64_t hash = 0;
+
+			if (this->m_mode == Sampler::FLOW_HASH &&
+				this->threshold() <= 0xffffffffU) {
+				hash = Sampler::flowHash(s, this->m_seed);
+			}
+			return this->decide(hash);
+		}
+
+		void setRate(uint32_t rate);
+		uint32_t rate() const;
+		enum Mode mode() const;
+		uint64_t offered() const;
+		uint64_t kept() const;
+		double effectiveRate() const;
+		void resetCounters();
+
+	/* private methods */
+	private:
+		/*
+		 * get the keep threshold of a 32-bit hash or random number
+		 *
+		 * return: 2^32 / rate
+		 */
+		inline uint64_t threshold() const
+		{
+			return __atomic_load_n(&(this->m_threshold),
+				__ATOMIC_RELAXED);
+		}
+
+		/*
+		 * account a packet and decide by the mode
+		 *
+		 * @hash: flow hash of the packet in FLOW_HASH mode
+		 *
+		 * return: true to keep the packet, false to drop it
+		 */
+		inline bool decide(uint64_t hash)
+		{
+			uint64_t threshold = this->threshold();
+			bool keep = true;
+
+			++this->m_offered;
+			if (threshold <= 0xffffffffU) {
+				switch (this->m_mode) {
+				case Sampler::ONE_IN_N:
+					keep = ++this->m_skip >= this->rate();
+					if (keep) {
+						this->m_skip = 0;
+					}
+					break;
+				case Sampler::PROBABILISTIC:
+					keep = (this->next() >> 32) < threshold;
+					break;
+				default:
+					keep = (hash >> 32) < threshold;
+					break;
+				}
+			}
+			if (keep) {
+				++this->m_kept;
+			}
+			return keep;
+		}
+
+		/*
+		 * xorshift64* pseudo-random number generator
+		 *
+		 * return: the next random number
+		 */
+		inline uint64_t next()
+		{
+			this->m_state ^= this->m_state >> 12;
+			this->m_state ^= this->m_state << 25;
+			this->m_state ^= this->m_state >> 27;
+			return this->m_state * 0x2545f4914f6cdd1dULL;
+		}
+
+	/* private static methods */
+	private:
+		static uint64_t flowHash(const u_char * data, size_t caplen,
+			uint64_t seed);
+		static uint64_t flowHash(const struct PacketSummary & s,
+			uint64_t seed);
+
+	/* fields */
+	private:
+		enum Mode m_mode;
+		uint64_t m_seed;
+		uint32_t m_rate;
+		uint64_t m_threshold;
+		uint32_t m_skip;
+		uint64_t m_state;
+		uint64_t m_offered;
+		uint64_t m_kept;
+	};
+}
+
+#endif /* NG_SAMPLER_H_ */
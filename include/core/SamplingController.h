@@ -0,0 +1,57 @@
+/*
+ * header file for class SamplingController
+ */
+
+#pragma once
+
+#ifndef NG_SAMPLING_CONTROLLER_H_
+#define NG_SAMPLING_CONTROLLER_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for struct pcap_stat */
+
+#include "Exception.h"	/* for netgazer::Exception */
+#include "Adapter.h"	/* for netgazer::Adapter */
+#include "Sampler.h"	/* for netgazer::Sampler */
+
+namespace netgazer {
+	/*
+	 * load shedding controller driving the rate of a Sampler
+	 *
+	 * Called periodically with the depth of the queue in front of the
+	 * analysis and the capture statistics of the adapter. Kernel drops
+	 * or a queue above the high mark double the rate at once; the rate
+	 * is halved again only after the queue stayed below the low mark
+	 * for a number of consecutive updates, so it does not oscillate.
+	 */
+	class SamplingController {
+	/* constructors and destructor */
+	public:
+		SamplingController(Sampler * sampler, uint32_t max_rate = 1024,
+			double high_mark = 0.75, double low_mark = 0.25,
+			unsigned patience = 4) NG_THROWS;
+
+	/* public methods */
+	public:
+		uint32_t update(size_t depth, size_t capacity,
+			const struct pcap_stat & stats);
+		uint32_t update(Adapter * adapter, size_t depth,
+			size_t capacity) NG_THROWS;
+		uint64_t drops() const;
+
+	/* fields */
+	private:
+		Sampler * m_sampler;
+		uint32_t m_max_rate;
+		double m_high_mark;
+		double m_low_mark;
+		unsigned m_patience;
+		unsigned m_calm;	/* consecutive updates below low mark */
+		bool m_primed;		/* m_last_drops is valid */
+		uint64_t m_last_drops;
+		uint64_t m_drops;	/* kernel drops seen while controlling */
+	};
+}
+
+#endif /* NG_SAMPLING_CONTROLLER_H_ */
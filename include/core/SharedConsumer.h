@@ -0,0 +1,85 @@
+/*
+ * header file for class SharedConsumer
+ */
+
+#pragma once
+
+#ifndef NG_SHARED_CONSUMER_H_
+#define NG_SHARED_CONSUMER_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "SharedRing.h"		/* for netgazer::SharedRing */
+
+namespace netgazer {
+	/*
+	 * reader of a shared-memory ring written by a SharedPublisher,
+	 * returning views into the ring without copying
+	 *
+	 * A view stays readable until the publisher wraps around to its
+	 * slot; valid() tells afterwards whether that happened while the
+	 * view was in use, in which case what was read must be discarded.
+	 * Reading never blocks the publisher. The reader entry in the ring
+	 * is renewed from next(); a reader that stops calling it for longer
+	 * than the lease loses the entry and claims a new one when it
+	 * resumes.
+	 */
+	class SharedConsumer {
+	/* internal structures and enumerations */
+	public:
+		/* a packet in the ring */
+		struct View {
+			uint64_t sequence;	/* packet number in the ring */
+			uint64_t ts_ns;		/* nanoseconds since the epoch */
+			uint32_t caplen;	/* bytes at data */
+			uint32_t length;	/* original length of the frame */
+			const u_char * data;
+		};
+
+	/* constructors and destructor */
+	public:
+		SharedConsumer(const char * name, bool oldest = false)
+			NG_THROWS;
+		SharedConsumer(int fd, bool oldest = false) NG_THROWS;
+		~SharedConsumer();
+
+	/* public methods */
+	public:
+		bool next(struct View & view);
+		bool valid(const struct View & view) const;
+		uint64_t cursor() const;
+		uint64_t lag() const;
+		uint64_t received() const;
+		uint64_t drops() const;
+		bool registered() const;
+
+	/* private methods */
+	private:
+		void attach(int fd, bool oldest) NG_THROWS;
+		void claim(uint64_t now);
+		void renew();
+
+	/* fields */
+	private:
+		struct SharedRing::Header * m_header;
+		const u_char * m_slots;
+		uint64_t m_mask;	/* slots - 1 */
+		size_t m_stride;
+		uint64_t m_cursor;	/* next packet to read */
+		uint64_t m_received;
+		uint64_t m_drops;
+		struct SharedRing::Reader * m_reader;	/* NULL if unregistered */
+		uint64_t m_token;	/* owner value of the reader entry */
+		uint64_t m_renew_ns;	/* next lease renewal */
+
+	/* disabled copy operations */
+	private:
+		SharedConsumer(const SharedConsumer &);
+		SharedConsumer & operator=(const SharedConsumer &);
+	};
+}
+
+#endif /* NG_SHARED_CONSUMER_H_ */
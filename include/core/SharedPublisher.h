@@ -0,0 +1,91 @@
+/*
+ * header file for class SharedPublisher
+ */
+
+#pragma once
+
+#ifndef NG_SHARED_PUBLISHER_H_
+#define NG_SHARED_PUBLISHER_H_
+
+#include <string>	/* for std::string */
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <sys/types.h>	/* for pid_t */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Packet.h"		/* for netgazer::Packet */
+#include "PacketHandler.h"	/* for netgazer::PacketHandler */
+#include "SharedRing.h"		/* for netgazer::SharedRing */
+#include "TruncationPolicy.h"	/* for netgazer::TruncationPolicy */
+#include "MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+namespace netgazer {
+	class Adapter;
+
+	/*
+	 * writer of captured packets into a shared-memory ring, so that
+	 * local tools read them without a capture handle of their own; as a
+	 * PacketHandler it can be passed to Adapter::dispatch directly, as a
+	 * MemoryConsumer it charges the mapping of the ring, which stays
+	 * whole as long as consumers may be attached
+	 */
+	class SharedPublisher : public PacketHandler, public MemoryConsumer {
+	/* internal structures and enumerations */
+	public:
+		/* a registered reader */
+		struct ReaderInfo {
+			pid_t pid;		/* in the namespace of the reader */
+			uint64_t cursor;	/* next packet it will read */
+			uint64_t lag;		/* packets published, not read */
+			uint64_t drops;		/* packets it was lapped on */
+		};
+
+	/* constructors and destructor */
+	public:
+		SharedPublisher(const char * name, size_t slot_count = 65536,
+			size_t snaplen = 2048) NG_THROWS;
+		~SharedPublisher();
+
+	/* public methods */
+	public:
+		virtual void onPacket(Adapter * adapter, Packet * packet)
+			NG_THROWS;
+		void publish(const struct pcap_pkthdr * header,
+			const u_char * data, bool nano = false);
+		void publish(uint64_t ts_ns, const u_char * data, uint32_t caplen,
+			uint32_t length);
+		void setTruncation(TruncationPolicy * policy);
+		TruncationPolicy * truncation() const;
+		std::vector<struct ReaderInfo> readers() const
+			NG_THROWS;
+		uint64_t published() const;
+		uint64_t truncated() const;
+		size_t slotCount() const;
+		size_t snaplen() const;
+		int fd() const;
+		const char * name() const;
+		virtual size_t shed(size_t bytes);
+
+	/* fields */
+	private:
+		std::string m_name;	/* empty for an anonymous memfd */
+		int m_fd;
+		struct SharedRing::Header * m_header;
+		u_char * m_slots;
+		uint64_t m_mask;	/* slots - 1 */
+		size_t m_stride;
+		size_t m_snaplen;
+		uint64_t m_head;	/* local copy of the header head */
+		uint64_t m_truncated;
+		TruncationPolicy * m_truncation;
+
+	/* disabled copy operations */
+	private:
+		SharedPublisher(const SharedPublisher &);
+		SharedPublisher & operator=(const SharedPublisher &);
+	};
+}
+
+#endif /* NG_SHARED_PUBLISHER_H_ */
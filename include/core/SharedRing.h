@@ -0,0 +1,96 @@
+/*
+ * header file for struct SharedRing
+ */
+
+#pragma once
+
+#ifndef NG_SHARED_RING_H_
+#define NG_SHARED_RING_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for clock_gettime */
+
+namespace netgazer {
+	/*
+	 * layout of a shared-memory packet ring written by one
+	 * SharedPublisher and read by any number of SharedConsumers
+	 *
+	 * The mapping starts with a page-aligned Header followed by a power
+	 * of two of fixed-size slots. Packet n goes to slot n % slots, whose
+	 * sequence is 2n + 1 while it is written and 2n + 2 once complete;
+	 * the header head is the number of packets published. The writer
+	 * never waits: a reader that falls a full ring behind finds a later
+	 * sequence in its slot and skips ahead, counting the packets lost.
+	 * Readers may register in the header so the publisher can report
+	 * their cursors. A registration is a lease that the reader renews
+	 * while it reads, and the publisher frees entries whose lease ran
+	 * out; process ids are only reported, as they mean nothing across
+	 * PID namespaces.
+	 */
+	struct SharedRing {
+	/* internal structures and enumerations */
+	public:
+		/* layout constants */
+		enum {
+			MAGIC = 0x4e475352,	/* "NGSR" */
+			VERSION = 2,
+			MAX_READERS = 16,
+			LEASE_MS = 10000,	/* lease of a reader entry */
+		};
+		/* a registered reader, written by that reader only */
+		struct Reader {
+			uint64_t owner;		/* token, 0 for a free entry */
+			uint64_t lease_ns;	/* expiry, see now() */
+			uint64_t cursor;	/* next packet it will read */
+			uint64_t drops;		/* packets it was lapped on */
+			int32_t pid;		/* in the namespace of the reader */
+			uint32_t pad;
+		} __attribute__((aligned(64)));
+		/* start of the mapping */
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t slot_count;	/* number of slots */
+			uint64_t stride;	/* bytes per slot */
+			uint64_t size;		/* bytes of the whole mapping */
+			uint64_t head __attribute__((aligned(64)));
+			struct Reader readers[MAX_READERS];
+		};
+		/* a slot, the captured bytes follow it */
+		struct Slot {
+			uint64_t sequence;	/* seqlock, see above */
+			uint64_t ts_ns;		/* nanoseconds since the epoch */
+			uint32_t caplen;	/* bytes stored in the slot */
+			uint32_t length;	/* original length of the frame */
+		};
+
+	/* public static methods */
+	public:
+		/*
+		 * get the offset of the first slot
+		 *
+		 * return: offset in bytes, a multiple of the page size
+		 */
+		static inline size_t slotsOffset()
+		{
+			return (sizeof(struct Header) + 4095) & ~(size_t)4095;
+		}
+
+		/*
+		 * get the clock reader leases are measured with, which is
+		 * shared by all processes of the host
+		 *
+		 * return: CLOCK_MONOTONIC time in nanoseconds
+		 */
+		static inline uint64_t now()
+		{
+			struct timespec ts;
+
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+		}
+	};
+}
+
+#endif /* NG_SHARED_RING_H_ */
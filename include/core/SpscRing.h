@@ -0,0 +1,136 @@
+/*
+ * header file for class template SpscRing
+ */
+
+#pragma once
+
+#ifndef NG_SPSC_RING_H_
+#define NG_SPSC_RING_H_
+
+#include <new>		/* for std::bad_alloc */
+#include <stddef.h>	/* for size_t */
+
+#include "Exception.h"	/* for netgazer::Exception */
+
+namespace netgazer {
+	/*
+	 * bounded lock-free queue for exactly one producer thread and one
+	 * consumer thread
+	 */
+	template <typename T>
+	class SpscRing {
+	/* constructors and destructor */
+	public:
+		/*
+		 * constructor of SpscRing
+		 *
+		 * @capacity: maximum number of items, rounded up to a power
+		 *            of two
+		 */
+		SpscRing(size_t capacity) NG_THROWS
+		{
+			size_t n = 1;
+
+			while (n < capacity) {
+				n <<= 1;
+			}
+			try {
+				this->m_items = new T[n];
+			} catch (std::bad_alloc & e) {
+				throw Exception(e.what());
+			}
+			this->m_mask = n - 1;
+			this->m_head = 0;
+			this->m_tail = 0;
+		}
+
+		/*
+		 * destructor of SpscRing
+		 */
+		~SpscRing()
+		{
+			delete[] this->m_items;
+		}
+
+	/* public methods */
+	public:
+		/*
+		 * append an item, producer thread only
+		 *
+		 * @item: item to append
+		 *
+		 * return: true on success, false if the ring is full
+		 */
+		bool push(const T & item)
+		{
+			size_t head = this->m_head;
+
+			if (head - __atomic_load_n(&(this->m_tail),
+				__ATOMIC_ACQUIRE) > this->m_mask) {
+				return false;
+			}
+			this->m_items[head & this->m_mask] = item;
+			__atomic_store_n(&(this->m_head), head + 1,
+				__ATOMIC_RELEASE);
+			return true;
+		}
+
+		/*
+		 * remove the oldest item, consumer thread only
+		 *
+		 * @item: set to the removed item
+		 *
+		 * return: true on success, false if the ring is empty
+		 */
+		bool pop(T & item)
+		{
+			size_t tail = this->m_tail;
+
+			if (tail == __atomic_load_n(&(this->m_head),
+				__ATOMIC_ACQUIRE)) {
+				return false;
+			}
+			item = this->m_items[tail & this->m_mask];
+			__atomic_store_n(&(this->m_tail), tail + 1,
+				__ATOMIC_RELEASE);
+			return true;
+		}
+
+		/*
+		 * get the number of queued items, exact only when called from
+		 * the producer or the consumer thread
+		 *
+		 * return: number of queued items
+		 */
+		size_t size() const
+		{
+			return __atomic_load_n(&(this->m_head), __ATOMIC_ACQUIRE) -
+				__atomic_load_n(&(this->m_tail), __ATOMIC_ACQUIRE);
+		}
+
+		/*
+		 * get the maximum number of queued items
+		 *
+		 * return: capacity of this SpscRing
+		 */
+		size_t capacity() const
+		{
+			return this->m_mask + 1;
+		}
+
+	/* fields */
+	private:
+		T * m_items;
+		size_t m_mask;
+		/* keep the cursors on separate cache lines */
+		size_t m_head __attribute__((aligned(64)));
+		size_t m_tail __attribute__((aligned(64)));
+
+	/* disabled copy operations */
+	private:
+		SpscRing(const SpscRing &);
+		SpscRing & operator=(const SpscRing &);
+	};
+}
+
+#endif /* NG_SPSC_RING_H_ */
@@ -0,0 +1,91 @@
+/*
+ * header file for class SubnetTagger
+ */
+
+#pragma once
+
+#ifndef NG_SUBNET_TAGGER_H_
+#define NG_SUBNET_TAGGER_H_
+
+#include <string>	/* for std::string */
+#include <deque>	/* for std::deque */
+#include <map>		/* for std::map */
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pthread.h>	/* for pthread_mutex_t */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "PrefixTable.h"	/* for netgazer::PrefixTable */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+
+namespace netgazer {
+	/*
+	 * tags packets with the labels of their source and destination
+	 * subnets, such as a site, a customer or an ASN
+	 *
+	 * Label names are interned into ids which stay the same across
+	 * reloads, so they may be used as group-by keys. A new prefix table
+	 * is swapped in atomically while capture goes on: each capture
+	 * thread looks up through a Reader of its own, which announces the
+	 * table generation it entered with, and the previous table is only
+	 * freed once no reader is still inside it. Readers never wait.
+	 */
+	class SubnetTagger {
+	/* internal structures and enumerations */
+	public:
+		/* per-thread lookup handle, owned by the tagger */
+		class Reader {
+		public:
+			void lookup(const uint32_t * addrs, uint32_t * labels,
+				size_t count);
+			void tag(const struct PacketSummary * summaries,
+				size_t count, uint32_t * src_labels,
+				uint32_t * dest_labels);
+
+		private:
+			Reader(SubnetTagger * owner);
+
+			const PrefixTable * enter();
+			void leave();
+
+		private:
+			SubnetTagger * m_owner;
+			uint64_t m_generation;	/* 0 outside any table */
+
+		friend class SubnetTagger;
+		};
+
+	/* constructors and destructor */
+	public:
+		SubnetTagger() NG_THROWS;
+		~SubnetTagger();
+
+	/* public methods */
+	public:
+		Reader * reader() NG_THROWS;
+		uint32_t label(const char * name) NG_THROWS;
+		const char * name(uint32_t label) const;
+		size_t labels() const;
+		void install(PrefixTable * table) NG_THROWS;
+		void load(const char * file) NG_THROWS;
+		uint64_t generation() const;
+
+	/* fields */
+	private:
+		PrefixTable * m_table;		/* current, NULL before any */
+		uint64_t m_generation;		/* bumped by each install */
+		std::vector<Reader *> m_readers;
+		std::deque<std::string> m_names;	/* by label - 1 */
+		std::map<std::string, uint32_t> m_labels;
+		mutable pthread_mutex_t m_lock;	/* readers and labels */
+		pthread_mutex_t m_install_lock;
+
+	/* disabled copy operations */
+	private:
+		SubnetTagger(const SubnetTagger &);
+		SubnetTagger & operator=(const SubnetTagger &);
+	};
+}
+
+#endif /* NG_SUBNET_TAGGER_H_ */
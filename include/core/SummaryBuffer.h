@@ -0,0 +1,86 @@
+/*
+ * header file for class SummaryBuffer
+ */
+
+#pragma once
+
+#ifndef NG_SUMMARY_BUFFER_H_
+#define NG_SUMMARY_BUFFER_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "Topology.h"		/* for netgazer::Topology */
+
+namespace netgazer {
+	class SummaryBuffer {
+	/* constructors and destructor */
+	public:
+		SummaryBuffer(size_t capacity, int node = -1,
+			bool huge_pages = false) NG_THROWS;
+		~SummaryBuffer();
+
+	/* public methods */
+	public:
+		/*
+		 * append a record, overwriting the oldest one when full
+		 *
+		 * return: reference to the record slot to fill in
+		 */
+		inline struct PacketSummary & push()
+		{
+			struct PacketSummary & s = this->m_records[this->m_head];
+
+			if (++this->m_head == this->m_capacity) {
+				this->m_head = 0;
+			}
+			if (this->m_size < this->m_capacity) {
+				++this->m_size;
+			}
+			++this->m_total;
+			return s;
+		}
+
+		/*
+		 * get a retained record
+		 *
+		 * @index: zero-based index, 0 being the oldest record
+		 *
+		 * return: reference to the record
+		 */
+		inline const struct PacketSummary & at(size_t index) const
+		{
+			size_t i = this->m_head + this->m_capacity - this->m_size +
+				index;
+
+			return this->m_records[i >= this->m_capacity ?
+				i - this->m_capacity : i];
+		}
+
+		size_t size() const;
+		size_t capacity() const;
+		uint64_t total() const;
+		void clear();
+		size_t segments(const struct PacketSummary ** first,
+			size_t * first_size, const struct PacketSummary ** second,
+			size_t * second_size) const;
+
+	/* fields */
+	private:
+		struct PacketSummary * m_records;
+		struct Topology::Region m_region;	/* addr NULL if new[] */
+		size_t m_capacity;
+		size_t m_head;
+		size_t m_size;
+		uint64_t m_total;
+
+	/* disabled copy operations */
+	private:
+		SummaryBuffer(const SummaryBuffer &);
+		SummaryBuffer & operator=(const SummaryBuffer &);
+	};
+}
+
+#endif /* NG_SUMMARY_BUFFER_H_ */
@@ -0,0 +1,192 @@
+/*
+ * header file for class TcpAnalyzer
+ */
+
+#pragma once
+
+#ifndef NG_TCP_ANALYZER_H_
+#define NG_TCP_ANALYZER_H_
+
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "Packet.h"		/* for netgazer::Packet */
+#include "PacketHandler.h"	/* for netgazer::PacketHandler */
+#include "Dissector.h"		/* for netgazer::Dissector */
+#include "Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+namespace netgazer {
+	class Adapter;
+
+	/*
+	 * passive TCP analytics: handshake RTT, retransmissions, out-of-order
+	 * segments and zero-window events per connection
+	 *
+	 * Connections live in a fixed table of 64-byte entries, four to a
+	 * bucket, so a packet costs one hash and the probe of a single
+	 * bucket. When a bucket is full the least recently seen connection is
+	 * evicted; idle connections are removed by expire(). Finished,
+	 * reset, evicted and expired connections are handed to the listener
+	 * and RTTs are accumulated into log2 histograms.
+	 *
+	 * The handshake RTT is split at the capture point into the server
+	 * leg (SYN to SYN/ACK) and the client leg (SYN/ACK to ACK). A segment
+	 * carrying only already seen sequence space counts as out-of-order
+	 * if it arrives within one RTT of the sequence last advancing, and
+	 * as a retransmission otherwise.
+	 *
+	 * As a MemoryConsumer it charges the connection table, whose size
+	 * is fixed, so it never sheds and only makes others shed.
+	 */
+	class TcpAnalyzer : public PacketHandler, public Checkpointable,
+		public MemoryConsumer {
+	/* internal structures and enumerations */
+	public:
+		/* record flags */
+		enum Flag {
+			HANDSHAKE = 0x01,	/* the RTTs were measured */
+			MIDSTREAM = 0x02,	/* no SYN seen, client unknown */
+			FINISHED = 0x04,	/* both sides sent FIN */
+			RESET = 0x08,		/* a side sent RST */
+			EVICTED = 0x10,		/* dropped for a new connection */
+			EXPIRED = 0x20,		/* idle past the timeout */
+		};
+		/* per-connection results, side 0 is the client */
+		struct Record {
+			uint32_t addr[2];	/* network order */
+			uint16_t port[2];	/* host order */
+			uint64_t first_seen;	/* nanoseconds since the epoch */
+			uint64_t last_seen;	/* nanoseconds since the epoch */
+			uint32_t server_rtt;	/* SYN to SYN/ACK, microseconds */
+			uint32_t client_rtt;	/* SYN/ACK to ACK, microseconds */
+			uint16_t retransmissions[2];	/* by sender, saturated */
+			uint16_t out_of_order[2];	/* by sender, saturated */
+			uint16_t zero_windows[2];	/* by advertiser, saturated */
+			uint8_t flags;		/* enum Flag bits */
+		};
+		/* log2 histogram, bucket i holds values in [2^i, 2^(i+1)) */
+		struct Histogram {
+			uint64_t buckets[32];
+			uint64_t count;
+			uint64_t sum;
+		};
+		/* aggregate counters */
+		struct Totals {
+			uint64_t packets;	/* TCP segments analyzed */
+			uint64_t connections;	/* connections tracked */
+			uint64_t handshakes;	/* RTTs measured */
+			uint64_t retransmissions;
+			uint64_t out_of_order;
+			uint64_t zero_windows;
+			uint64_t evictions;
+			uint64_t expirations;
+		};
+		/* receiver of connections leaving the table */
+		class Listener {
+		public:
+			virtual ~Listener()
+			{
+			}
+
+			virtual void onConnection(const struct Record & r) = 0;
+		};
+
+	private:
+		/* connection states */
+		enum State {
+			FREE = 0,
+			SYN_SENT,
+			SYN_RECEIVED,
+			ESTABLISHED,
+			CLOSED,		/* reported, kept to absorb stragglers */
+		};
+		/* connection entry flags, per side bits shifted by the side */
+		enum EntryFlag {
+			SEQ_KNOWN = 0x01,	/* next_seq is valid, x2 */
+			ZERO_WINDOW = 0x04,	/* window is currently 0, x2 */
+			FIN_SEEN = 0x10,	/* x2 */
+			NO_CLIENT = 0x40,	/* side 0 is the first sender */
+			SYN_RETRANSMITTED = 0x80,	/* RTT is ambiguous */
+		};
+		/* a tracked connection, 64 bytes */
+		struct Connection {
+			uint64_t first_seen;	/* microseconds since the epoch */
+			uint32_t addr[2];	/* network order */
+			uint16_t port[2];	/* host order */
+			uint32_t last_seen;	/* milliseconds since first_seen */
+			uint32_t rtt[2];	/* server and client leg, us */
+			uint32_t next_seq[2];	/* next sequence number by side */
+			uint32_t advanced[2];	/* us since first_seen, wraps */
+			uint16_t retransmissions[2];
+			uint16_t out_of_order[2];
+			uint16_t zero_windows[2];
+			uint8_t state;		/* enum State */
+			uint8_t flags;		/* enum EntryFlag bits */
+		};
+
+	/* constructors and destructor */
+	public:
+		TcpAnalyzer(size_t capacity = 65536, unsigned idle_timeout = 300)
+			NG_THROWS;
+		~TcpAnalyzer();
+
+	/* public methods */
+	public:
+		virtual void onPacket(Adapter * adapter, Packet * packet)
+			NG_THROWS;
+		void add(const struct pcap_pkthdr * header, const u_char * data,
+			bool nano = false);
+		void add(uint64_t ts_ns, const u_char * data, size_t caplen,
+			const struct Dissector::Dissection & d);
+		size_t expire(uint64_t now_ns);
+		std::vector<struct Record> connections() const NG_THROWS;
+		void setListener(Listener * listener);
+		const struct Totals & totals() const;
+		const struct Histogram & serverRtt() const;
+		const struct Histogram & clientRtt() const;
+		const struct Histogram & handshakeRtt() const;
+		void clear();
+		size_t capacity() const;
+		size_t memory() const;
+		virtual void extents(
+			std::vector<struct Checkpointable::Extent> & extents)
+			const NG_THROWS;
+		virtual size_t shed(size_t bytes);
+
+	/* public static methods */
+	public:
+		static uint64_t quantile(const struct Histogram & h, double q);
+
+	/* private methods */
+	private:
+		struct Connection * lookup(const struct Dissector::Dissection & d,
+			uint64_t now_us, int * side);
+		void sequence(struct Connection * c, int side, uint32_t seq,
+			uint32_t length, uint32_t now);
+		void close(struct Connection * c, uint8_t reason);
+		void record(const struct Connection * c, uint8_t reason,
+			struct Record & r) const;
+
+	/* fields */
+	private:
+		struct Connection * m_table;
+		size_t m_bucket_mask;	/* buckets - 1 */
+		uint64_t m_idle_timeout;	/* microseconds */
+		Listener * m_listener;
+		struct Totals m_totals;
+		struct Histogram m_server_rtt;
+		struct Histogram m_client_rtt;
+		struct Histogram m_handshake_rtt;
+
+	/* disabled copy operations */
+	private:
+		TcpAnalyzer(const TcpAnalyzer &);
+		TcpAnalyzer & operator=(const TcpAnalyzer &);
+	};
+}
+
+#endif /* NG_TCP_ANALYZER_H_ */
@@ -0,0 +1,65 @@
+/*
+ * header file for class TlsExtractor
+ */
+
+#pragma once
+
+#ifndef NG_TLS_EXTRACTOR_H_
+#define NG_TLS_EXTRACTOR_H_
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "ByteCursor.h"	/* for netgazer::ByteCursor */
+#include "Dissector.h"	/* for netgazer::Dissector */
+
+namespace netgazer {
+	/*
+	 * extractor of the server name and first ALPN protocol of TLS
+	 * ClientHello messages, parsing in place without allocating; only
+	 * the part of the hello within the first segment is seen
+	 */
+	class TlsExtractor {
+	/* internal structures and enumerations */
+	public:
+		/* record limits */
+		enum {
+			MAX_SNI = 255,
+			MAX_ALPN = 31,
+		};
+		/* record flags */
+		enum Flag {
+			HAS_SNI = 0x01,		/* server_name was found */
+			HAS_ALPN = 0x02,	/* ALPN was found */
+			SNI_TRUNCATED = 0x04,	/* name cut at MAX_SNI */
+			INCOMPLETE = 0x08,	/* hello continues past the view */
+		};
+		/* metadata of a ClientHello, strings NUL terminated */
+		struct Record {
+			uint16_t record_version;
+			uint16_t client_version;
+			uint16_t cipher_count;
+			uint16_t extension_count;
+			uint8_t flags;		/* enum Flag bits */
+			uint8_t alpn_length;
+			uint16_t sni_length;
+			char sni[MAX_SNI + 1];
+			char alpn[MAX_ALPN + 1];
+		};
+
+	/* public static methods */
+	public:
+		static bool extract(const u_char * payload, size_t length,
+			struct Record & r);
+		static bool extract(const u_char * data, size_t caplen,
+			const struct Dissector::Dissection & d, struct Record & r);
+
+	/* private static methods */
+	private:
+		static void serverName(ByteCursor & c, struct Record & r);
+		static void alpn(ByteCursor & c, struct Record & r);
+	};
+}
+
+#endif /* NG_TLS_EXTRACTOR_H_ */
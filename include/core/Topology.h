@@ -0,0 +1,68 @@
+/*
+ * header file for class Topology
+ */
+
+#pragma once
+
+#ifndef NG_TOPOLOGY_H_
+#define NG_TOPOLOGY_H_
+
+#include <iostream>	/* for std::ostream */
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <pthread.h>	/* for pthread_t */
+
+#include "Exception.h"	/* for netgazer::Exception */
+
+namespace netgazer {
+	class Adapter;
+
+	/*
+	 * CPU and NUMA layout of the host, read from sysfs, with helpers to
+	 * pin threads and to place buffers on a node and on huge pages
+	 *
+	 * Nothing here is fatal on hosts without NUMA or huge pages: nodes
+	 * are then reported as -1 and buffers fall back to normal pages.
+	 */
+	class Topology {
+	/* internal structures and enumerations */
+	public:
+		/* page sizes backing a region */
+		enum PageSize {
+			SMALL_PAGES = 0,	/* base pages, THP advised */
+			HUGE_2M = 1,
+			HUGE_1G = 2,
+		};
+		/* a mapped buffer */
+		struct Region {
+			void * addr;
+			size_t size;		/* requested bytes */
+			size_t mapped;		/* bytes mapped, page multiple */
+			int node;		/* preferred node, -1 for any */
+			enum PageSize pages;
+		};
+
+	/* public static methods */
+	public:
+		static int cpus();
+		static int nodes();
+		static int nodeOfCpu(int cpu);
+		static int nodeOfAdapter(const char * name);
+		static std::vector<int> cpusOfNode(int node) NG_THROWS;
+		static std::vector<int> parseCpuList(const char * list)
+			NG_THROWS;
+		static void pin(pthread_t thread, const std::vector<int> & cpus)
+			NG_THROWS;
+		static std::vector<int> affinity(pthread_t thread)
+			NG_THROWS;
+		static struct Region allocate(size_t size, int node = -1,
+			enum PageSize largest = HUGE_1G) NG_THROWS;
+		static void release(const struct Region & region);
+		static long freeHugePages(enum PageSize pages);
+		static void report(std::ostream & os,
+			const std::vector<Adapter *> & adapters) NG_THROWS;
+		static const char * pageSizeName(enum PageSize pages);
+	};
+}
+
+#endif /* NG_TOPOLOGY_H_ */
@@ -0,0 +1,138 @@
+/*
+ * header file for class Trace
+ */
+
+#pragma once
+
+#ifndef NG_TRACE_H_
+#define NG_TRACE_H_
+
+#include <iostream>	/* for std::ostream */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for clock_gettime */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>	/* for __rdtsc */
+#endif
+#ifdef NG_ENABLE_USDT
+#include <sys/sdt.h>	/* for DTRACE_PROBE */
+#endif
+
+#include "Exception.h"	/* for netgazer::Exception */
+
+namespace netgazer {
+	class Trace {
+	/* internal structures and enumerations */
+	public:
+		/* traced hot-path stages */
+		enum Stage {
+			WAIT = 0,
+			DECODE = 1,
+			RETAIN = 2,
+			OUTPUT = 3,
+			STAGE_COUNT = 4,
+		};
+		/* a recorded span, timestamps are in ticks */
+		struct Span {
+			uint64_t begin;
+			uint64_t end;
+			uint32_t stage;
+			uint32_t count;
+		};
+		/*
+		 * per-thread ring of spans, written by its owner thread only;
+		 * the ring of an exited thread is kept for dump() until a new
+		 * thread takes it over
+		 */
+		struct Ring {
+			enum { CAPACITY = 1 << 16 };
+			struct Span spans[CAPACITY];
+			uint64_t head;
+			uint32_t tid;
+			bool owned;		/* false once its thread exited */
+			struct Ring * next;
+		};
+
+	/* public static methods */
+	public:
+		static void enable(bool on) NG_THROWS;
+		static void record(enum Stage stage, uint64_t begin, uint64_t end,
+			uint32_t count);
+		static void dump(std::ostream & os) NG_THROWS;
+		static const char * stageName(enum Stage stage);
+
+		/*
+		 * check whether span recording is enabled
+		 *
+		 * return: true if enabled, false otherwise
+		 */
+		static inline bool enabled()
+		{
+			/* a plain load on common targets, ordering nothing */
+			return __builtin_expect(__atomic_load_n(&(Trace::on),
+				__ATOMIC_RELAXED), 0);
+		}
+
+		/*
+		 * read the current tick counter
+		 *
+		 * return: TSC value on x86, monotonic nanoseconds elsewhere
+		 */
+		static inline uint64_t now()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			struct timespec ts;
+
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+		}
+
+	/* private static methods */
+	private:
+		static struct Ring * ring() NG_THROWS;
+		static void createKey();
+		static void release(void * ring);
+
+	/* static fields */
+	private:
+		static bool on;			/* atomic */
+		static struct Ring * rings;
+		static uint64_t base_ticks;
+		static uint64_t base_ns;
+		static __thread struct Ring * local;
+	};
+}
+
+/*
+ * trace point macros, compiled out entirely unless NG_ENABLE_TRACE is
+ * defined; USDT probes are emitted independently when NG_ENABLE_USDT is
+ * defined so that perf/bpftrace can attach to release builds
+ */
+#ifdef NG_ENABLE_USDT
+#define NG_USDT_PROBE(stage, edge, count) \
+	DTRACE_PROBE1(netgazer, stage##_##edge, (count))
+#else
+#define NG_USDT_PROBE(stage, edge, count) do { } while (0)
+#endif
+
+#ifdef NG_ENABLE_TRACE
+#define NG_TRACE_BEGIN(stage, var) \
+	NG_USDT_PROBE(stage, begin, 0); \
+	uint64_t var = netgazer::Trace::enabled() ? \
+		netgazer::Trace::now() : 0
+#define NG_TRACE_END(stage, var, count) \
+	do { \
+		NG_USDT_PROBE(stage, end, (count)); \
+		if (var != 0) { \
+			netgazer::Trace::record(netgazer::Trace::stage, var, \
+				netgazer::Trace::now(), (count)); \
+		} \
+	} while (0)
+#else
+#define NG_TRACE_BEGIN(stage, var) NG_USDT_PROBE(stage, begin, 0)
+#define NG_TRACE_END(stage, var, count) NG_USDT_PROBE(stage, end, (count))
+#endif
+
+#endif /* NG_TRACE_H_ */
@@ -0,0 +1,100 @@
+/*
+ * header file for class TruncationPolicy
+ */
+
+#pragma once
+
+#ifndef NG_TRUNCATION_POLICY_H_
+#define NG_TRUNCATION_POLICY_H_
+
+#include <vector>		/* for std::vector */
+#include <tr1/unordered_map>	/* for std::tr1::unordered_map */
+#include <stddef.h>		/* for size_t */
+#include <stdint.h>		/* for fixed width integer types */
+#include <pcap/pcap.h>		/* for libpcap types */
+
+#include "Exception.h"	/* for netgazer::Exception */
+#include "Dissector.h"	/* for netgazer::Dissector */
+#include "FlowKey.h"	/* for netgazer::FlowKey */
+
+namespace netgazer {
+	/*
+	 * per-packet decision of how many captured bytes to keep, made on
+	 * the dissection of the frame
+	 *
+	 * A rule keeps the headers plus up to a number of payload bytes:
+	 * HEADERS keeps the headers only, FULL the whole frame. Rules are
+	 * looked up by flow, then by port, then by IPv4 protocol, and the
+	 * default applies to frames no rule matches. Only the captured
+	 * length is cut; the original length of the frame is kept. Like a
+	 * Sampler, a policy counts what it is offered and is meant for one
+	 * capture thread.
+	 */
+	class TruncationPolicy {
+	/* internal structures and enumerations */
+	public:
+		/* payload bytes of a rule */
+		enum Payload {
+			HEADERS = 0,		/* headers only */
+			FULL = 0x7fffffff,	/* the whole frame */
+		};
+		/* what the policy was offered and kept */
+		struct Stats {
+			uint64_t packets;	/* frames evaluated */
+			uint64_t truncated;	/* frames cut */
+			uint64_t captured;	/* bytes offered */
+			uint64_t retained;	/* bytes kept */
+		};
+
+	private:
+		enum {
+			NONE = 0xffffffff,	/* no rule */
+		};
+		/* hash of flow keys */
+		struct KeyHash {
+			size_t operator()(const struct FlowKey & key) const
+			{
+				return (size_t)key.hash();
+			}
+		};
+
+	/* constructors and destructor */
+	public:
+		TruncationPolicy(uint32_t payload = TruncationPolicy::FULL)
+			NG_THROWS;
+
+	/* public methods */
+	public:
+		void setDefault(uint32_t payload);
+		void byProtocol(uint8_t protocol, uint32_t payload);
+		void byPort(uint16_t port, uint32_t payload) NG_THROWS;
+		void byFlow(const struct FlowKey & key, uint32_t payload)
+			NG_THROWS;
+		void clear();
+		size_t retain(const u_char * data, size_t caplen);
+		size_t retain(const u_char * data, size_t caplen,
+			const struct Dissector::Dissection & d);
+		const struct Stats & stats() const;
+		void resetCounters();
+
+	/* private methods */
+	private:
+		uint32_t payload(const struct Dissector::Dissection & d) const;
+
+	/* private static methods */
+	private:
+		static size_t headers(const u_char * data,
+			const struct Dissector::Dissection & d);
+
+	/* fields */
+	private:
+		uint32_t m_default;
+		uint32_t m_protocols[256];
+		std::vector<uint32_t> m_ports;	/* empty without port rules */
+		std::tr1::unordered_map<struct FlowKey, uint32_t,
+			struct KeyHash> m_flows;	/* both directions */
+		struct Stats m_stats;
+	};
+}
+
+#endif /* NG_TRUNCATION_POLICY_H_ */
@@ -0,0 +1,204 @@
+/*
+ * header file for class WindowAggregator
+ */
+
+#pragma once
+
+#ifndef NG_WINDOW_AGGREGATOR_H_
+#define NG_WINDOW_AGGREGATOR_H_
+
+#include <deque>	/* for std::deque */
+#include <map>		/* for std::map */
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pthread.h>	/* for pthread types */
+
+#include "Exception.h"		/* for netgazer::Exception */
+#include "PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+namespace netgazer {
+	/*
+	 * windowed group-by aggregation over packet timestamps
+	 *
+	 * Each capture thread feeds its own Partial without locking.
+	 * Partials aggregate into panes of one slide length. Finished panes
+	 * are handed to an emitter thread, which merges the panes of all
+	 * partials and reports each window to the callback. Closing a
+	 * window therefore never runs on the capture path. As a
+	 * MemoryConsumer the emitter thread charges the open panes and
+	 * sheds by reporting the oldest windows before they complete; such
+	 * windows are flagged as incomplete, and panes sealed after all
+	 * their windows were reported are dropped and counted by late().
+	 * Checkpoints save the panes merged by the emitter thread, copied
+	 * when the extents are asked for; panes still held by partials are
+	 * not saved.
+	 */
+	class WindowAggregator : public Checkpointable, public MemoryConsumer {
+	/* internal structures and enumerations */
+	public:
+		/* group-by fields, combined as a bit mask */
+		enum GroupBy {
+			BY_ETHER_TYPE = 0x01,
+			BY_IP_TYPE = 0x02,
+			BY_SRC_ADDR = 0x04,
+			BY_DEST_ADDR = 0x08,
+			BY_SRC_PORT = 0x10,
+			BY_DEST_PORT = 0x20,
+			BY_SRC_LABEL = 0x40,	/* SubnetTagger label */
+			BY_DEST_LABEL = 0x80,	/* SubnetTagger label */
+		};
+		/* values of the group-by fields, unused fields are zero */
+		struct GroupKey {
+			uint32_t src_addr;	/* network order */
+			uint32_t dest_addr;	/* network order */
+			uint32_t src_label;
+			uint32_t dest_label;
+			uint16_t src_port;
+			uint16_t dest_port;
+			uint16_t ether_type;
+			uint8_t ip_type;	/* enum IPv4Packet::IPType */
+			uint8_t pad;
+		};
+		/* aggregates of a group */
+		struct Aggregate {
+			uint64_t count;		/* sampled packets */
+			uint64_t bytes;		/* sampled bytes */
+			uint64_t scaled_count;	/* packets before sampling */
+			uint64_t scaled_bytes;	/* bytes before sampling */
+			uint32_t min_length;
+			uint32_t max_length;
+		};
+		/* aggregates of a group in a closed window */
+		struct Result {
+			struct GroupKey key;
+			struct Aggregate aggregate;
+
+			double averageLength() const;
+			double samplingRate() const;
+		};
+		/*
+		 * receiver of closed windows, runs on the emitter thread;
+		 * complete is false for windows reported early to shed
+		 * memory, whose counts may miss packets of slower partials
+		 */
+		class Callback {
+		public:
+			virtual ~Callback()
+			{
+			}
+
+			virtual void onWindow(uint64_t start_ns, uint64_t end_ns,
+				const std::vector<struct Result> & results,
+				bool complete) = 0;
+		};
+
+	private:
+		/* one slide worth of aggregates */
+		class Pane {
+		public:
+			Pane(uint64_t index);
+
+			struct Aggregate & at(const struct GroupKey & key);
+			void merge(const Pane & other);
+			size_t memory() const;
+
+		public:
+			uint64_t index;
+			std::vector<struct Result> entries;
+			std::vector<uint32_t> buckets;	/* entry + 1, 0 empty */
+		};
+		/* a group of an open pane, as saved by checkpoints */
+		struct Row {
+			uint64_t index;		/* of the pane */
+			struct Result result;
+		};
+
+	public:
+		/* per-thread feeder, owned by the aggregator */
+		class Partial {
+		public:
+			void add(const struct PacketSummary & s, uint32_t rate = 1,
+				uint32_t src_label = 0, uint32_t dest_label = 0)
+				NG_THROWS;
+			void tick(uint64_t now_ns) NG_THROWS;
+			uint64_t late() const;
+
+		private:
+			Partial(WindowAggregator * owner);
+			~Partial();
+
+			void seal(uint64_t next) NG_THROWS;
+
+		private:
+			WindowAggregator * m_owner;
+			Pane * m_pane;
+			volatile uint64_t m_progress;	/* panes below are sealed */
+			uint64_t m_late;
+
+		friend class WindowAggregator;
+		};
+
+	/* constructors and destructor */
+	public:
+		WindowAggregator(unsigned group_by, uint64_t size_ns,
+			uint64_t slide_ns, Callback * callback) NG_THROWS;
+		~WindowAggregator();
+
+	/* public methods */
+	public:
+		Partial * partial() NG_THROWS;
+		void close() NG_THROWS;
+		uint64_t late() const;
+		virtual void extents(
+			std::vector<struct Checkpointable::Extent> & extents)
+			const NG_THROWS;
+		virtual void restore(
+			const std::vector<struct Checkpointable::Extent> & saved)
+			NG_THROWS;
+		virtual size_t shed(size_t bytes);
+
+	/* private methods */
+	private:
+		void submit(Pane * pane) NG_THROWS;
+		void publish(uint64_t until);
+		size_t footprint() const;
+		void account();
+		static void * run(void * arg);
+
+	/* fields */
+	private:
+		unsigned m_group_by;
+		uint64_t m_pane_ns;
+		uint64_t m_panes_per_window;
+		Callback * m_callback;
+		std::vector<Partial *> m_partials;
+		std::map<uint64_t, Pane *> m_open;	/* emitter thread only */
+		uint64_t m_next_emit;			/* emitter thread only */
+		uint64_t m_settled;			/* emitter thread only */
+		uint64_t m_late;			/* atomic */
+		size_t m_charged;			/* emitter thread only */
+
+		/* m_open and m_next_emit against checkpoints */
+		mutable pthread_mutex_t m_state_lock;
+		mutable std::vector<struct Row> m_image;	/* saved panes */
+		mutable uint64_t m_image_emit;		/* saved m_next_emit */
+
+		/* handoff from partials to the emitter thread */
+		pthread_mutex_t m_lock;
+		pthread_cond_t m_cond;
+		std::deque<Pane *> m_sealed;
+		bool m_dirty;
+		bool m_stopping;
+		pthread_t m_thread;
+
+	/* disabled copy operations */
+	private:
+		WindowAggregator(const WindowAggregator &);
+		WindowAggregator & operator=(const WindowAggregator &);
+	};
+}
+
+#endif /* NG_WINDOW_AGGREGATOR_H_ */
@@ -6,10 +6,51 @@
 /* core */
 #include "core/Exception.h"
 #include "core/NetworkService.h"
+#include "core/MemoryConsumer.h"
+#include "core/MemoryGovernor.h"
+#include "core/Checkpointable.h"
+#include "core/Checkpoint.h"
+#include "core/Topology.h"
+#include "core/AdapterRegistry.h"
 #include "core/Adapter.h"
 #include "core/Packet.h"
 #include "core/IPv4Packet.h"
+#include "core/Dissector.h"
+#include "core/TruncationPolicy.h"
+#include "core/PacketSummary.h"
+#include "core/SummaryBuffer.h"
+#include "core/ByteCursor.h"
+#include "core/DnsExtractor.h"
+#include "core/HttpExtractor.h"
+#include "core/TlsExtractor.h"
+#include "core/PatternMatcher.h"
+#include "core/TcpAnalyzer.h"
+#include "core/PacketHandler.h"
+#include "core/Deduplicator.h"
+#include "core/SharedRing.h"
+#include "core/SharedPublisher.h"
+#include "core/SharedConsumer.h"
+#include "core/PcapReplay.h"
+#include "core/PcapAnalyzer.h"
+#include "core/Sampler.h"
+#include "core/SamplingController.h"
+#include "core/CaptureReactor.h"
+#include "core/AsyncCapture.h"
+#include "core/FlowKey.h"
+#include "core/PrefixTable.h"
+#include "core/SubnetTagger.h"
+#include "core/HeavyHitters.h"
+#include "core/HyperLogLog.h"
+#include "core/DistinctTable.h"
+#include "core/WindowAggregator.h"
+#include "core/Trace.h"
+#include "core/SpscRing.h"
 
 /* ui */
+#ifdef QT_CORE_LIB
+#include "ui/PacketTableModel.h"
+#include "ui/CaptureWorker.h"
+#include "ui/PacketListDialog.h"
+#endif /* QT_CORE_LIB */
 
 #endif /* NG_NET_GAZER_H_ */
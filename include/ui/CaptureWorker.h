@@ -0,0 +1,89 @@
+/*
+ * header file for class CaptureWorker
+ */
+
+#pragma once
+
+#ifndef NG_CAPTURE_WORKER_H_
+#define NG_CAPTURE_WORKER_H_
+
+#include <QThread>	/* for QThread */
+#include <QString>	/* for QString */
+#include <vector>	/* for std::vector */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "core/Adapter.h"	/* for netgazer::Adapter */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/PacketHandler.h"	/* for netgazer::PacketHandler */
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/SpscRing.h"	/* for netgazer::SpscRing */
+
+namespace netgazer {
+	/*
+	 * capture loop on its own thread, publishing summary records to the
+	 * GUI thread in batches at most once per frame
+	 *
+	 * Batches travel through a lock-free ring and come back through
+	 * another one for reuse, so neither thread blocks or allocates in
+	 * steady state. While the GUI falls behind, the worker keeps
+	 * filling its current batch, keeping only the newest records.
+	 */
+	class CaptureWorker : public QThread, private PacketHandler {
+		Q_OBJECT
+
+	/* internal structures and enumerations */
+	public:
+		/* records captured during one frame */
+		struct Batch {
+			std::vector<struct PacketSummary> records;
+			uint64_t dropped;	/* records cut to fit the limit */
+		};
+
+	/* constructors and destructor */
+	public:
+		CaptureWorker(Adapter * adapter, int fps, size_t max_batch,
+			QObject * parent = NULL) NG_THROWS;
+		~CaptureWorker();
+
+	/* public methods */
+	public:
+		void stop();
+		void setAffinity(const std::vector<int> & cpus)
+			NG_THROWS;
+		struct Batch * take();
+		void recycle(struct Batch * batch);
+
+	/* signals */
+	signals:
+		void failed(const QString & message);
+
+	/* protected methods */
+	protected:
+		void run();
+
+	/* private methods */
+	private:
+		void onPacket(Adapter * adapter, Packet * packet)
+			NG_THROWS;
+		void onSummary(Adapter * adapter,
+			const struct PacketSummary * summary) NG_THROWS;
+		void publish();
+
+	/* fields */
+	private:
+		Adapter * m_adapter;
+		int m_frame_ms;
+		size_t m_max_batch;
+		std::vector<int> m_cpus;	/* empty for no pinning */
+		volatile bool m_stopping;
+		struct Batch * m_back;		/* worker thread only */
+		SpscRing<struct Batch *> m_published;	/* worker to GUI */
+		SpscRing<struct Batch *> m_free;	/* GUI to worker */
+
+	/* friend declarations */
+	friend class CaptureWorkerTest;
+	};
+}
+
+#endif /* NG_CAPTURE_WORKER_H_ */
@@ -0,0 +1,56 @@
+/*
+ * header file for class PacketListDialog
+ */
+
+#pragma once
+
+#ifndef NG_PACKET_LIST_DIALOG_H_
+#define NG_PACKET_LIST_DIALOG_H_
+
+#include <QDialog>	/* for QDialog */
+#include <QTimer>	/* for QTimer */
+#include <QString>	/* for QString */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "core/Adapter.h"		/* for netgazer::Adapter */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "ui/CaptureWorker.h"		/* for netgazer::CaptureWorker */
+#include "ui/PacketTableModel.h"	/* for netgazer::PacketTableModel */
+#include "ui_packetList.h"		/* for Ui::packetListDialog */
+
+namespace netgazer {
+	/*
+	 * live packet list of an adapter, refreshed at a fixed frame rate
+	 */
+	class PacketListDialog : public QDialog {
+		Q_OBJECT
+
+	/* constructors and destructor */
+	public:
+		PacketListDialog(Adapter * adapter, QWidget * parent = NULL)
+			NG_THROWS;
+		~PacketListDialog();
+
+	/* private slots */
+	private slots:
+		void refresh();
+		void captureFailed(const QString & message);
+
+	/* fields */
+	private:
+		Ui::packetListDialog m_ui;
+		PacketTableModel * m_model;
+		CaptureWorker * m_worker;
+		QTimer m_timer;
+		uint64_t m_dropped;
+
+	/* static fields */
+	private:
+		static const int FRAME_RATE = 30;
+		static const size_t ROWS = 1 << 20;
+		static const size_t MAX_BATCH = 1 << 18;
+	};
+}
+
+#endif /* NG_PACKET_LIST_DIALOG_H_ */
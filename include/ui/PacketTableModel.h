@@ -0,0 +1,70 @@
+/*
+ * header file for class PacketTableModel
+ */
+
+#pragma once
+
+#ifndef NG_PACKET_TABLE_MODEL_H_
+#define NG_PACKET_TABLE_MODEL_H_
+
+#include <QAbstractTableModel>	/* for QAbstractTableModel */
+#include <QModelIndex>		/* for QModelIndex */
+#include <QVariant>		/* for QVariant */
+#include <stddef.h>		/* for size_t */
+
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/SummaryBuffer.h"	/* for netgazer::SummaryBuffer */
+
+namespace netgazer {
+	/*
+	 * virtualized table of the most recent packets, backed by a
+	 * SummaryBuffer; cells are formatted only when the view asks for
+	 * them, i.e. for visible rows
+	 */
+	class PacketTableModel : public QAbstractTableModel {
+		Q_OBJECT
+
+	/* internal structures and enumerations */
+	public:
+		/* table columns */
+		enum Column {
+			NUMBER = 0,
+			TIME = 1,
+			SOURCE = 2,
+			DESTINATION = 3,
+			PROTOCOL = 4,
+			LENGTH = 5,
+			INFO = 6,
+			COLUMN_COUNT = 7,
+		};
+
+	/* constructors and destructor */
+	public:
+		PacketTableModel(size_t capacity, QObject * parent = NULL);
+		~PacketTableModel();
+
+	/* public methods */
+	public:
+		int rowCount(const QModelIndex & parent = QModelIndex()) const;
+		int columnCount(const QModelIndex & parent = QModelIndex())
+			const;
+		QVariant data(const QModelIndex & index,
+			int role = Qt::DisplayRole) const;
+		QVariant headerData(int section, Qt::Orientation orientation,
+			int role = Qt::DisplayRole) const;
+		void append(const struct PacketSummary * records, size_t count);
+		void clear();
+
+	/* private methods */
+	private:
+		QVariant format(const struct PacketSummary & s, int column,
+			int row) const;
+
+	/* fields */
+	private:
+		SummaryBuffer m_buffer;
+		size_t m_hidden;	/* rows being removed from the front */
+	};
+}
+
+#endif /* NG_PACKET_TABLE_MODEL_H_ */
@@ -3,6 +3,9 @@
  */
 
 #include <deque>	/* for std::deque */
+#include <vector>	/* for std::vector */
+#include <string>	/* for std::string */
+#include <stdint.h>	/* for fixed width integer types */
 #include <new>		/* for std::bad_alloc */
 #include <pcap/pcap.h>	/* for libpcap types and functions */
 
@@ -10,25 +13,54 @@
 #include "core/Exception.h"	/* for netgazer::Exception */
 #include "core/Packet.h"	/* for netgazer::Packet */
 #include "core/IPv4Packet.h"	/* for netgazer::IPv4Packet */
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/SummaryBuffer.h"	/* for netgazer::SummaryBuffer */
+#include "core/Sampler.h"	/* for netgazer::Sampler */
+#include "core/TruncationPolicy.h"	/* for netgazer::TruncationPolicy */
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+#include "core/Topology.h"	/* for netgazer::Topology */
+#include "core/Trace.h"		/* for NG_TRACE_BEGIN and NG_TRACE_END */
 
 using std::deque;
+using std::vector;
+using std::string;
 using std::bad_alloc;
 
 namespace netgazer {
 	/*
 	 * constructor of Adapter
 	 *
-	 * @pcap_adapter: a pointer to pcap interface
+	 * @name: interface name
+	 * @description: interface description, or NULL if none
+	 * @ifindex: kernel interface index, 0 if unknown
 	 */
-	Adapter::Adapter(pcap_if_t * pcap_adapter) throw (Exception)
+	Adapter::Adapter(const char * name, const char * description,
+		int ifindex) NG_THROWS
 	{
-		if (pcap_adapter == NULL) {
-			throw Exception("pcap_adapter is NULL");
+		if (name == NULL) {
+			throw Exception("name is NULL");
 		}
 
-		this->m_pcap_adapter = pcap_adapter;
+		try {
+			this->m_name = name;
+			this->m_description = description != NULL ?
+				description : "";
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		this->m_has_description = description != NULL;
+		this->m_ifindex = ifindex;
+		this->m_present = true;
 		this->m_pcap_handle = NULL;
+		this->m_summaries = NULL;
+		this->m_retain = 100;
+		this->m_fixed = 0;
+		this->m_sampler = NULL;
+		this->m_truncation = NULL;
+		this->m_errors = 0;
+		this->m_error = "";
 		this->m_promisc = false;
+		this->m_nano = false;
 	}
 
 	/*
@@ -39,30 +71,128 @@ namespace netgazer {
 		this->close();
 	}
 
+	/*
+	 * constructor of Adapter::Options, fills in the defaults
+	 */
+	Adapter::Options::Options()
+		: promisc(false), timeout(1000), snaplen(65536), buffer_size(0),
+		  immediate(false), nano(false), tstamp_type(NULL),
+		  summaries(false), retain(100), numa_local(false),
+		  huge_pages(false)
+	{
+	}
+
 	/*
 	 * open an adapter
 	 *
 	 * @promisc: whether to be put into promiscuous mode
 	 * @timeout: the read timeout in milliseconds
 	 */
-	void Adapter::open(bool promisc, int timeout) throw (Exception)
+	void Adapter::open(bool promisc, int timeout) NG_THROWS
+	{
+		struct Adapter::Options options;
+
+		options.promisc = promisc;
+		options.timeout = timeout;
+		this->open(options);
+	}
+
+	/*
+	 * open an adapter with tunable capture handle options
+	 *
+	 * @options: capture handle options
+	 */
+	void Adapter::open(const struct Adapter::Options & options)
+		NG_THROWS
 	{
 		char errbuf[PCAP_ERRBUF_SIZE];
+		pcap_t * handle = NULL;
+		int tstamp_type = -1;
+		int ret = 0;
 
 		/* close first to make sure resources are deallocated */
 		this->close();
 
-		/* do open */
-		this->m_pcap_handle = pcap_open_live(
-			this->m_pcap_adapter->name,	/* device name */
-			65536,				/* snapshot length */
-			promisc,			/* promiscuous mode */
-			timeout,			/* timeout */
-			errbuf);
-		if (this->m_pcap_handle == NULL) {
+		if (!this->m_present) {
+			throw Exception("interface has been removed");
+		}
+		if (options.tstamp_type != NULL) {
+			tstamp_type = pcap_tstamp_type_name_to_val(
+				options.tstamp_type);
+			if (tstamp_type < 0) {
+				throw Exception("unknown timestamp type");
+			}
+		}
+
+		/* create the handle */
+		handle = pcap_create(this->m_name.c_str(), errbuf);
+		if (handle == NULL) {
 			throw Exception(errbuf);
 		}
-		this->m_promisc = promisc;
+
+		/* apply options, these only fail on an activated handle */
+		pcap_set_snaplen(handle, options.snaplen);
+		pcap_set_promisc(handle, options.promisc);
+		pcap_set_timeout(handle, options.timeout);
+		if (options.buffer_size > 0) {
+			pcap_set_buffer_size(handle, options.buffer_size);
+		}
+		if (options.immediate) {
+			pcap_set_immediate_mode(handle, 1);
+		}
+		if (tstamp_type >= 0 &&
+			pcap_set_tstamp_type(handle, tstamp_type) < 0) {
+			pcap_close(handle);
+			throw Exception("timestamp type not supported");
+		}
+		/* fall back to microseconds if nanoseconds are unsupported */
+		if (options.nano) {
+			pcap_set_tstamp_precision(handle,
+				PCAP_TSTAMP_PRECISION_NANO);
+		}
+
+		/* do activate, warnings are not fatal */
+		ret = pcap_activate(handle);
+		if (ret < 0) {
+			string msg = (ret == PCAP_ERROR) ? pcap_geterr(handle) :
+				pcap_statustostr(ret);
+
+			pcap_close(handle);
+			throw Exception(msg.c_str());
+		}
+
+		/* allocate the retention buffer */
+		if (options.summaries) {
+			try {
+				this->m_summaries = new SummaryBuffer(
+					options.retain, options.numa_local ?
+					Topology::nodeOfAdapter(
+					this->m_name.c_str()) : -1,
+					options.huge_pages);
+			} catch (bad_alloc & e) {
+				pcap_close(handle);
+				throw Exception(e.what());
+			} catch (Exception & e) {
+				pcap_close(handle);
+				throw e;
+			}
+		}
+
+		this->m_pcap_handle = handle;
+		this->m_retain = options.retain;
+		this->m_promisc = options.promisc;
+		this->m_nano = (pcap_get_tstamp_precision(handle) ==
+			PCAP_TSTAMP_PRECISION_NANO);
+
+		/* the buffers cannot be shed, they only make others shed */
+		this->m_fixed = options.buffer_size > 0 ? options.buffer_size :
+			2 * 1024 * 1024;	/* libpcap default on Linux */
+		if (options.summaries) {
+			this->m_fixed += options.retain * sizeof(PacketSummary);
+		}
+		if (!this->charge(this->m_fixed)) {
+			this->relieve();
+		}
 	}
 
 	/*
@@ -70,12 +200,21 @@ namespace netgazer {
 	 */
 	void Adapter::close()
 	{
+		size_t freed = this->m_fixed;
+
 		/* free all captured packets */
 		for (deque<Packet *>::iterator i = this->m_packets.begin();
 			i != this->m_packets.end(); ++i) {
+			freed += (*i)->memory();
 			delete *i;
 		}
 		this->m_packets.clear();
+		this->m_fixed = 0;
+		this->release(freed);
+
+		/* free all captured summaries */
+		delete this->m_summaries;
+		this->m_summaries = NULL;
 
 		/* close opened adapter */
 		if (this->m_pcap_handle != NULL) {
@@ -84,6 +223,54 @@ namespace netgazer {
 		}
 
 		this->m_promisc = false;
+		this->m_nano = false;
+	}
+
+	/*
+	 * get the next packet without throwing, for capture loops; the
+	 * packet needs not to be freed by the caller
+	 *
+	 * @packet: set to the next packet, NULL unless one is returned
+	 *
+	 * return: PACKET if a packet was returned, NONE on timeout or EOF,
+	 *         FAILED on errors, which are counted and described by
+	 *         error()
+	 */
+	enum Adapter::Result Adapter::next(Packet ** packet) NG_NOEXCEPT
+	{
+		struct pcap_pkthdr * header = NULL;
+		const u_char * data = NULL;
+		enum Adapter::Result ret = Adapter::NONE;
+
+		*packet = NULL;
+		if (this->m_summaries != NULL) {
+			return this->fail("adapter retains summaries");
+		}
+		do {
+			ret = this->fetch(&header, &data);
+			if (ret != Adapter::PACKET) {
+				return ret;
+			}
+		} while (this->m_sampler != NULL &&
+			!this->m_sampler->sample(header, data));
+
+		*packet = this->decode(header, data);
+		if (*packet == NULL) {
+			return Adapter::FAILED;
+		}
+		try {
+			this->keep(*packet);
+		} catch (bad_alloc &) {
+			delete *packet;
+			*packet = NULL;
+			return this->fail("out of memory");
+		} catch (Exception &) {
+			/* only the retention queue can fail to grow */
+			delete *packet;
+			*packet = NULL;
+			return this->fail("out of memory");
+		}
+		return Adapter::PACKET;
 	}
 
 	/*
@@ -91,76 +278,582 @@ namespace netgazer {
 	 *
 	 * return: a pointer to the next packet on success, NULL otherwise
 	 */
-	Packet * Adapter::nextPacket() throw (Exception)
+	Packet * Adapter::nextPacket() NG_THROWS
+	{
+		Packet * p = NULL;
+
+		if (this->next(&p) == Adapter::FAILED) {
+			throw Exception(this->m_error);
+		}
+		return p;
+	}
+
+	/*
+	 * get the summary of the next packet, only valid for adapters
+	 * opened with summaries enabled; the record is owned by the adapter
+	 * and stays valid until it is overwritten by newer ones
+	 *
+	 * return: a pointer to the next summary on success, NULL otherwise
+	 */
+	const PacketSummary * Adapter::nextSummary() NG_THROWS
 	{
 		struct pcap_pkthdr * header = NULL;
 		const u_char * data = NULL;
-		Packet * p = NULL;
+
+		if (this->m_summaries == NULL) {
+			throw Exception("adapter retains packets");
+		}
+		do {
+			switch (this->fetch(&header, &data)) {
+			case Adapter::NONE:
+				return NULL;
+			case Adapter::FAILED:
+				throw Exception(this->m_error);
+			default:
+				break;
+			}
+		} while (this->m_sampler != NULL &&
+			!this->m_sampler->sample(header, data));
+		return this->summarize(header, data);
+	}
+
+	/*
+	 * get the retained summaries
+	 *
+	 * return: a pointer to the summary buffer, NULL if the adapter
+	 *         retains packets
+	 */
+	const SummaryBuffer * Adapter::summaries() const
+	{
+		return this->m_summaries;
+	}
+
+	/* state shared with dispatchOne() during a dispatch() call */
+	struct DispatchContext {
+		Adapter * adapter;
+		PacketHandler * handler;
+		bool failed;
+		string error;
+	};
+
+	/*
+	 * record the failure of a handler and break the loop of
+	 * pcap_dispatch(), nothing may unwind through libpcap
+	 *
+	 * @ctx: context of the dispatch
+	 * @handle: capture handle running the loop
+	 * @error: error message
+	 */
+	static void abortDispatch(struct DispatchContext * ctx,
+		pcap_t * handle, const char * error)
+	{
+		ctx->failed = true;
+		try {
+			ctx->error = error;
+		} catch (...) {
+			/* the failure still stops the dispatch */
+		}
+		pcap_breakloop(handle);
+	}
+
+	/*
+	 * process a batch of packets, handing each one to a handler as a
+	 * Packet or, for adapters retaining summaries, as a PacketSummary;
+	 * on a non-blocking adapter this returns immediately when nothing
+	 * is pending
+	 *
+	 * @count: maximum number of packets to process, -1 for one buffer
+	 * @handler: receiver of the packets
+	 *
+	 * return: number of packets processed
+	 */
+	int Adapter::dispatch(int count, PacketHandler * handler)
+		NG_THROWS
+	{
+		struct DispatchContext ctx;
 		int ret = -1;
 
-		/* check first if the adapter is not opened */
 		if (this->m_pcap_handle == NULL) {
 			throw Exception("adapter is not opened");
 		}
+		if (handler == NULL) {
+			throw Exception("handler is NULL");
+		}
+
+		ctx.adapter = this;
+		ctx.handler = handler;
+		ctx.failed = false;
+
+		NG_TRACE_BEGIN(WAIT, wait_begin);
+		ret = pcap_dispatch(this->m_pcap_handle, count,
+			Adapter::dispatchOne, (u_char *)&ctx);
+		NG_TRACE_END(WAIT, wait_begin, ret > 0 ? ret : 0);
+
+		/* exceptions must not unwind through libpcap */
+		if (ctx.failed) {
+			throw Exception(ctx.error.c_str());
+		}
+		switch (ret) {
+		/* loop broken */
+		case -2:
+			return 0;
+
+		/* error */
+		case -1:
+			throw Exception(pcap_geterr(this->m_pcap_handle));
+
+		default:
+			return ret;
+		}
+	}
+
+	/*
+	 * pcap_dispatch() callback of dispatch()
+	 *
+	 * @user: a pointer to the DispatchContext
+	 * @header: a pointer to the pcap packet header
+	 * @data: frame data
+	 */
+	void Adapter::dispatchOne(u_char * user,
+		const struct pcap_pkthdr * header, const u_char * data)
+	{
+		struct DispatchContext * ctx = (struct DispatchContext *)user;
+		Adapter * adapter = ctx->adapter;
+
+		if (ctx->failed || (adapter->m_sampler != NULL &&
+			!adapter->m_sampler->sample(header, data))) {
+			return;
+		}
+		try {
+			if (adapter->m_summaries != NULL) {
+				ctx->handler->onSummary(adapter,
+					adapter->summarize(header, data));
+			} else {
+				ctx->handler->onPacket(adapter,
+					adapter->retain(header, data));
+			}
+		} catch (Exception & e) {
+			abortDispatch(ctx, adapter->m_pcap_handle, e.what());
+		} catch (bad_alloc & e) {
+			abortDispatch(ctx, adapter->m_pcap_handle, e.what());
+		} catch (...) {
+			abortDispatch(ctx, adapter->m_pcap_handle,
+				"packet handler failed");
+		}
+	}
+
+	/*
+	 * send a frame out of the opened adapter
+	 *
+	 * @data: frame data, starting with the link header
+	 * @length: length of the frame
+	 */
+	void Adapter::inject(const u_char * data, size_t length)
+		NG_THROWS
+	{
+		if (this->m_pcap_handle == NULL) {
+			throw Exception("adapter is not opened");
+		}
+		if (pcap_inject(this->m_pcap_handle, data, length) < 0) {
+			throw Exception(pcap_geterr(this->m_pcap_handle));
+		}
+	}
+
+	/*
+	 * get a file descriptor that becomes readable when packets are
+	 * pending, for use with select, poll or epoll
+	 *
+	 * return: selectable file descriptor
+	 */
+	int Adapter::selectableFd() const NG_THROWS
+	{
+		int fd = -1;
+
+		if (this->m_pcap_handle == NULL) {
+			throw Exception("adapter is not opened");
+		}
+		fd = pcap_get_selectable_fd(this->m_pcap_handle);
+		if (fd < 0) {
+			throw Exception("adapter is not selectable");
+		}
+		return fd;
+	}
+
+	/*
+	 * put the opened adapter into or out of non-blocking mode
+	 *
+	 * @nonblock: whether reads should return immediately
+	 */
+	void Adapter::setNonblock(bool nonblock) NG_THROWS
+	{
+		char errbuf[PCAP_ERRBUF_SIZE];
+
+		if (this->m_pcap_handle == NULL) {
+			throw Exception("adapter is not opened");
+		}
+		if (pcap_setnonblock(this->m_pcap_handle, nonblock,
+			errbuf) < 0) {
+			throw Exception(errbuf);
+		}
+	}
+
+	/*
+	 * sample packets before they are retained or delivered, the
+	 * sampler is not owned by the adapter
+	 *
+	 * @sampler: the sampler, NULL to keep every packet
+	 */
+	void Adapter::setSampler(Sampler * sampler)
+	{
+		this->m_sampler = sampler;
+	}
+
+	/*
+	 * get the sampler packets pass through, whose rate scales the
+	 * statistics of the delivered packets back up
+	 *
+	 * return: the sampler, NULL if every packet is kept
+	 */
+	Sampler * Adapter::sampler() const
+	{
+		return this->m_sampler;
+	}
+
+	/*
+	 * cut retained packets down to what a policy keeps of them, the
+	 * policy is not owned by the adapter; summaries are not affected
+	 *
+	 * @policy: the policy, NULL to retain whole frames
+	 */
+	void Adapter::setTruncation(TruncationPolicy * policy)
+	{
+		this->m_truncation = policy;
+	}
+
+	/*
+	 * get the policy retained packets are cut by
+	 *
+	 * return: the policy, NULL if whole frames are retained
+	 */
+	TruncationPolicy * Adapter::truncation() const
+	{
+		return this->m_truncation;
+	}
+
+	/*
+	 * wait for the next frame from libpcap
+	 *
+	 * @header: set to the pcap packet header
+	 * @data: set to the frame data
+	 *
+	 * return: PACKET if a frame was read, NONE on timeout or EOF,
+	 *         FAILED on errors
+	 */
+	enum Adapter::Result Adapter::fetch(struct pcap_pkthdr ** header,
+		const u_char ** data) NG_NOEXCEPT
+	{
+		int ret = -1;
+
+		/* check first if the adapter is not opened */
+		if (this->m_pcap_handle == NULL) {
+			return this->fail("adapter is not opened");
+		}
 
 		/* do get the next packet */
-		ret = pcap_next_ex(this->m_pcap_handle, &header, &data);
+		NG_TRACE_BEGIN(WAIT, wait_begin);
+		ret = pcap_next_ex(this->m_pcap_handle, header, data);
+		NG_TRACE_END(WAIT, wait_begin, ret == 1);
 		switch (ret) {
 		/* success */
 		case 1:
-			try {
-				if (Packet::isIpv4Packet(header, data)) {
-					p = new IPv4Packet(header, data);
-				} else {
-					p = new Packet(header, data);
-				}
-			} catch (bad_alloc & e) {
-				throw Exception(e.what());
-			}
-			this->m_packets.push_back(p);
-			/* keep a maximum size of 100 */
-			if (this->m_packets.size() >= 100) {
-				delete this->m_packets.front();
-				this->m_packets.pop_front();
-			}
-			/* fall-through */
+			return Adapter::PACKET;
 
 		/* timeout or EOF */
 		case 0: case -2:
-			return p;
+			return Adapter::NONE;
 
 		/* error */
 		case -1:
-			throw Exception(pcap_geterr(this->m_pcap_handle));
+			return this->fail(pcap_geterr(this->m_pcap_handle));
 
 		default:
-			throw Exception("pcap error");
+			return this->fail("pcap error");
 		}
 	}
 
+	/*
+	 * decode a frame into a Packet with only the bytes the truncation
+	 * policy keeps; this is where frames are validated, so that the
+	 * accessors of the Packet need not check anything
+	 *
+	 * @header: a pointer to the pcap packet header
+	 * @data: frame data
+	 *
+	 * return: a pointer to the packet, owned by the caller, or NULL on
+	 *         errors
+	 */
+	Packet * Adapter::decode(const struct pcap_pkthdr * header,
+		const u_char * data) NG_NOEXCEPT
+	{
+		struct pcap_pkthdr cut;
+		Packet * p = NULL;
+
+		NG_TRACE_BEGIN(DECODE, decode_begin);
+		if (this->m_truncation != NULL) {
+			cut = *header;
+			cut.caplen = (bpf_u_int32)this->m_truncation->retain(
+				data, header->caplen);
+			header = &cut;
+		}
+		if (header->caplen < sizeof(struct Packet::PacketHeader)) {
+			this->fail("data size too small");
+			NG_TRACE_END(DECODE, decode_begin, 0);
+			return NULL;
+		}
+		try {
+			if (Packet::isIpv4Packet(header, data)) {
+				p = new IPv4Packet(header, data, this->m_nano);
+			} else {
+				p = new Packet(header, data, this->m_nano);
+			}
+		} catch (bad_alloc &) {
+			this->fail("out of memory");
+		} catch (Exception &) {
+			/* the sizes are checked, only allocations fail */
+			this->fail("out of memory");
+		}
+		NG_TRACE_END(DECODE, decode_begin, p != NULL);
+
+		return p;
+	}
+
+	/*
+	 * retain a decoded packet, first freeing the oldest ones to make
+	 * room for it; the packet being returned is always retained, so a
+	 * retention of 0 behaves as 1
+	 *
+	 * @packet: the packet, owned by the adapter from now on, or still
+	 *          by the caller if this throws
+	 */
+	void Adapter::keep(Packet * packet) NG_THROWS
+	{
+		NG_TRACE_BEGIN(RETAIN, retain_begin);
+		while (!this->m_packets.empty() &&
+			this->m_packets.size() >= this->m_retain) {
+			this->release(this->m_packets.front()->memory());
+			delete this->m_packets.front();
+			this->m_packets.pop_front();
+		}
+		try {
+			this->m_packets.push_back(packet);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		if (!this->charge(packet->memory())) {
+			this->relieve();
+		}
+		NG_TRACE_END(RETAIN, retain_begin, 1);
+	}
+
+	/*
+	 * decode a frame into a Packet and retain it
+	 *
+	 * @header: a pointer to the pcap packet header
+	 * @data: frame data
+	 *
+	 * return: a pointer to the retained packet
+	 */
+	Packet * Adapter::retain(const struct pcap_pkthdr * header,
+		const u_char * data) NG_THROWS
+	{
+		Packet * p = this->decode(header, data);
+
+		if (p == NULL) {
+			throw Exception(this->m_error);
+		}
+		try {
+			this->keep(p);
+		} catch (Exception & e) {
+			delete p;
+			throw e;
+		}
+		return p;
+	}
+
+	/*
+	 * count an error and remember its description
+	 *
+	 * @error: description, static or owned by libpcap
+	 *
+	 * return: FAILED
+	 */
+	enum Adapter::Result Adapter::fail(const char * error) NG_NOEXCEPT
+	{
+		++this->m_errors;
+		this->m_error = error;
+		return Adapter::FAILED;
+	}
+
+	/*
+	 * summarize a frame into the summary buffer
+	 *
+	 * @header: a pointer to the pcap packet header
+	 * @data: frame data
+	 *
+	 * return: a pointer to the retained summary
+	 */
+	const PacketSummary * Adapter::summarize(
+		const struct pcap_pkthdr * header, const u_char * data)
+	{
+		NG_TRACE_BEGIN(DECODE, decode_begin);
+		struct PacketSummary & s = this->m_summaries->push();
+		PacketSummary::summarize(header, data, this->m_nano, s);
+		NG_TRACE_END(DECODE, decode_begin, 1);
+
+		return &s;
+	}
+
+	/*
+	 * get the capture statistics of the opened adapter
+	 *
+	 * return: packets received and dropped since the adapter was opened
+	 */
+	struct pcap_stat Adapter::stats() const NG_THROWS
+	{
+		struct pcap_stat st;
+
+		if (this->m_pcap_handle == NULL) {
+			throw Exception("adapter is not opened");
+		}
+		if (pcap_stats(this->m_pcap_handle, &st) < 0) {
+			throw Exception(pcap_geterr(this->m_pcap_handle));
+		}
+		return st;
+	}
+
+	/*
+	 * get the timestamp sources offered by this adapter, such as
+	 * "host", "adapter" or "adapter_unsynced"
+	 *
+	 * return: names of the supported timestamp types
+	 */
+	vector<const char *> Adapter::timestampTypes() const NG_THROWS
+	{
+		char errbuf[PCAP_ERRBUF_SIZE];
+		pcap_t * handle = this->m_pcap_handle;
+		vector<const char *> names;
+		int * types = NULL;
+		int n = 0;
+
+		/* an unactivated handle is enough to query the types */
+		if (handle == NULL) {
+			handle = pcap_create(this->m_name.c_str(), errbuf);
+			if (handle == NULL) {
+				throw Exception(errbuf);
+			}
+		}
+
+		n = pcap_list_tstamp_types(handle, &types);
+		if (n < 0) {
+			string msg = pcap_geterr(handle);
+
+			if (handle != this->m_pcap_handle) {
+				pcap_close(handle);
+			}
+			throw Exception(msg.c_str());
+		}
+		for (int i = 0; i < n; ++i) {
+			names.push_back(pcap_tstamp_type_val_to_name(types[i]));
+		}
+		pcap_free_tstamp_types(types);
+
+		if (handle != this->m_pcap_handle) {
+			pcap_close(handle);
+		}
+		return names;
+	}
+
 	/*
 	 * get the adapter name
 	 *
 	 * return: name of this Adapter
 	 */
-	const char * Adapter::name() const throw (Exception)
+	const char * Adapter::name() const NG_THROWS
 	{
-		if (this->m_pcap_adapter != NULL) {
-			return this->m_pcap_adapter->name;
-		}
-		throw Exception("pcap_adapter is NULL");
+		return this->m_name.c_str();
 	}
 
 	/*
 	 * get the adapter description
 	 *
-	 * return: description of this Adapter
+	 * return: description of this Adapter, NULL if it has none
 	 */
-	const char * Adapter::description() const throw (Exception)
+	const char * Adapter::description() const NG_THROWS
 	{
-		if (this->m_pcap_adapter != NULL) {
-			return this->m_pcap_adapter->description;
+		return this->m_has_description ? this->m_description.c_str() :
+			NULL;
+	}
+
+	/*
+	 * get the kernel interface index
+	 *
+	 * return: interface index, 0 if unknown
+	 */
+	int Adapter::ifindex() const
+	{
+		return this->m_ifindex;
+	}
+
+	/*
+	 * check whether the interface still exists, adapters of removed
+	 * interfaces stay valid but can no longer be opened
+	 *
+	 * return: true if the interface exists, false otherwise
+	 */
+	bool Adapter::present() const
+	{
+		return this->m_present;
+	}
+
+	/*
+	 * get the number of errors, including those reported by exceptions
+	 *
+	 * return: number of failed calls
+	 */
+	uint64_t Adapter::errors() const
+	{
+		return this->m_errors;
+	}
+
+	/*
+	 * get the description of the last error
+	 *
+	 * return: description, empty if there was none; valid until the
+	 *         next error or until the adapter is closed
+	 */
+	const char * Adapter::error() const
+	{
+		return this->m_error;
+	}
+
+	/*
+	 * give memory back by freeing the oldest retained packets, the
+	 * newest one is kept as it may just have been returned
+	 *
+	 * @bytes: amount of memory to give back
+	 *
+	 * return: number of bytes released
+	 */
+	size_t Adapter::shed(size_t bytes)
+	{
+		size_t freed = 0;
+
+		while (freed < bytes && this->m_packets.size() > 1) {
+			freed += this->m_packets.front()->memory();
+			delete this->m_packets.front();
+			this->m_packets.pop_front();
 		}
-		throw Exception("pcap_adapter is NULL");
+		this->release(freed);
+		return freed;
 	}
 }
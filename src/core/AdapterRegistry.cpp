@@ -0,0 +1,553 @@
+/*
+ * implementation of class AdapterRegistry
+ */
+
+#include <string>		/* for std::string */
+#include <vector>		/* for std::vector */
+#include <utility>		/* for std::pair and std::make_pair */
+#include <algorithm>		/* for std::sort */
+#include <tr1/unordered_map>	/* for std::tr1::unordered_map */
+#include <tr1/unordered_set>	/* for std::tr1::unordered_set */
+#include <new>			/* for std::bad_alloc */
+#include <cstdio>		/* for std::fopen and std::fscanf */
+#include <cstring>		/* for std::strcmp and std::memchr */
+#include <cerrno>		/* for errno */
+#include <stddef.h>		/* for size_t */
+#include <unistd.h>		/* for close */
+#include <dirent.h>		/* for opendir and readdir */
+#include <sys/socket.h>		/* for socket, bind and recvfrom */
+#include <net/if.h>		/* for if_nametoindex and if_indextoname */
+#include <linux/netlink.h>	/* for netlink types and macros */
+#include <linux/rtnetlink.h>	/* for rtnetlink types and macros */
+#include <pcap/pcap.h>		/* for pcap_findalldevs */
+
+#include "core/AdapterRegistry.h"	/* for netgazer::AdapterRegistry */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "core/Adapter.h"		/* for netgazer::Adapter */
+
+using std::string;
+using std::vector;
+using std::pair;
+using std::make_pair;
+using std::sort;
+using std::tr1::unordered_map;
+using std::tr1::unordered_set;
+using std::bad_alloc;
+using std::fopen;
+using std::fscanf;
+using std::fclose;
+using std::strcmp;
+using std::strerror;
+using std::memset;
+using std::memchr;
+
+namespace netgazer {
+	/* directory of network interfaces in sysfs */
+	static const char * const SYSFS_NET = "/sys/class/net";
+
+	/*
+	 * read the interface index of an interface from sysfs
+	 *
+	 * @name: interface name
+	 *
+	 * return: interface index, 0 if unavailable
+	 */
+	static int readIfindex(const char * name)
+	{
+		string path;
+		FILE * f = NULL;
+		int ifindex = 0;
+
+		try {
+			path = string(SYSFS_NET) + "/" + name + "/ifindex";
+		} catch (bad_alloc &) {
+			return 0;
+		}
+		if ((f = fopen(path.c_str(), "r")) == NULL) {
+			return 0;
+		}
+		if (fscanf(f, "%d", &ifindex) != 1) {
+			ifindex = 0;
+		}
+		fclose(f);
+		return ifindex;
+	}
+
+	/*
+	 * constructor of AdapterRegistry, subscribes to link events but
+	 * does not enumerate yet
+	 */
+	AdapterRegistry::AdapterRegistry() NG_THROWS
+	{
+		struct sockaddr_nl addr;
+
+		this->m_fd = socket(AF_NETLINK,
+			SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+		if (this->m_fd < 0) {
+			throw Exception(strerror(errno));
+		}
+
+		memset(&addr, 0, sizeof(addr));
+		addr.nl_family = AF_NETLINK;
+		addr.nl_groups = RTMGRP_LINK;
+		if (bind(this->m_fd, (struct sockaddr *)&addr,
+			sizeof(addr)) < 0) {
+			int error = errno;
+
+			::close(this->m_fd);
+			throw Exception(strerror(error));
+		}
+
+		this->m_enumerated = false;
+		this->m_listener = NULL;
+	}
+
+	/*
+	 * destructor of AdapterRegistry, frees all adapters
+	 */
+	AdapterRegistry::~AdapterRegistry()
+	{
+		for (vector<Adapter *>::iterator i = this->m_adapters.begin();
+			i != this->m_adapters.end(); ++i) {
+			delete *i;
+		}
+		::close(this->m_fd);
+	}
+
+	/*
+	 * get the adapter of an interface by name without enumerating,
+	 * it needs not to be freed by the caller
+	 *
+	 * @name: interface name
+	 *
+	 * return: a pointer to the adapter, NULL if there is no such
+	 *         interface
+	 */
+	Adapter * AdapterRegistry::byName(const char * name) NG_THROWS
+	{
+		unordered_map<string, Adapter *>::iterator i;
+		int ifindex = 0;
+
+		if (name == NULL) {
+			throw Exception("name is NULL");
+		}
+
+		try {
+			i = this->m_by_name.find(name);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		if (i != this->m_by_name.end()) {
+			return i->second->m_present ? i->second : NULL;
+		}
+
+		/* unseen yet, ask the kernel about this one interface */
+		if ((ifindex = if_nametoindex(name)) > 0) {
+			return this->update(name, ifindex);
+		}
+		return this->lookupPcap(name);
+	}
+
+	/*
+	 * get the adapter of an interface by interface index without
+	 * enumerating, it needs not to be freed by the caller
+	 *
+	 * @ifindex: interface index
+	 *
+	 * return: a pointer to the adapter, NULL if there is no such
+	 *         interface
+	 */
+	Adapter * AdapterRegistry::byIndex(int ifindex) NG_THROWS
+	{
+		unordered_map<int, Adapter *>::iterator i =
+			this->m_by_index.find(ifindex);
+		char name[IF_NAMESIZE];
+
+		if (i != this->m_by_index.end()) {
+			return i->second;
+		}
+		if (ifindex <= 0 || if_indextoname(ifindex, name) == NULL) {
+			return NULL;
+		}
+		return this->update(name, ifindex);
+	}
+
+	/*
+	 * get all adapters, enumerating interfaces on the first call
+	 *
+	 * return: adapters in the order they were first seen, including
+	 *         those of removed interfaces
+	 */
+	const vector<Adapter *> & AdapterRegistry::adapters() NG_THROWS
+	{
+		if (!this->m_enumerated) {
+			this->enumerate();
+		}
+		return this->m_adapters;
+	}
+
+	/*
+	 * apply pending link events without blocking
+	 *
+	 * return: number of link events applied
+	 */
+	size_t AdapterRegistry::poll() NG_THROWS
+	{
+		char buffer[16384] __attribute__((aligned(NLMSG_ALIGNTO)));
+		struct sockaddr_nl sender;
+		socklen_t sender_len = 0;
+		size_t events = 0;
+		ssize_t len = 0;
+		int remaining = 0;
+
+		for (;;) {
+			sender_len = sizeof(sender);
+			len = recvfrom(this->m_fd, buffer, sizeof(buffer), 0,
+				(struct sockaddr *)&sender, &sender_len);
+			if (len < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					break;
+				}
+				/* events were lost, rescan to catch up */
+				if (errno == ENOBUFS) {
+					this->enumerate();
+					++events;
+					continue;
+				}
+				throw Exception(strerror(errno));
+			}
+			/* only trust the kernel */
+			if (sender.nl_pid != 0) {
+				continue;
+			}
+
+			remaining = (int)len;
+			for (struct nlmsghdr * h = (struct nlmsghdr *)buffer;
+				NLMSG_OK(h, remaining);
+				h = NLMSG_NEXT(h, remaining)) {
+				struct ifinfomsg * info = NULL;
+				struct rtattr * attr = NULL;
+				const char * name = NULL;
+				int attr_len = 0;
+
+				if (h->nlmsg_type != RTM_NEWLINK &&
+					h->nlmsg_type != RTM_DELLINK) {
+					continue;
+				}
+				if (h->nlmsg_len < NLMSG_LENGTH(sizeof(*info))) {
+					continue;
+				}
+				info = (struct ifinfomsg *)NLMSG_DATA(h);
+				if (h->nlmsg_type == RTM_DELLINK) {
+					this->remove(info->ifi_index);
+					++events;
+					continue;
+				}
+
+				attr = IFLA_RTA(info);
+				attr_len = IFLA_PAYLOAD(h);
+				for (; RTA_OK(attr, attr_len);
+					attr = RTA_NEXT(attr, attr_len)) {
+					if (attr->rta_type == IFLA_IFNAME) {
+						name = (const char *)RTA_DATA(attr);
+						break;
+					}
+				}
+				if (name != NULL && memchr(name, '\0',
+					RTA_PAYLOAD(attr)) != NULL) {
+					this->update(name, info->ifi_index);
+					++events;
+				}
+			}
+		}
+		return events;
+	}
+
+	/*
+	 * get the netlink socket, readable when link events are pending
+	 *
+	 * return: file descriptor to poll for input
+	 */
+	int AdapterRegistry::fd() const
+	{
+		return this->m_fd;
+	}
+
+	/*
+	 * set the receiver of link changes
+	 *
+	 * @listener: the listener, NULL for none
+	 */
+	void AdapterRegistry::setListener(AdapterRegistry::Listener * listener)
+	{
+		this->m_listener = listener;
+	}
+
+	/*
+	 * enumerate interfaces from sysfs and mark the cached ones that are
+	 * gone as removed, then merge the devices of libpcap, which adds
+	 * pseudo-devices such as "any" and the descriptions
+	 */
+	void AdapterRegistry::enumerate() NG_THROWS
+	{
+		vector<pair<int, string> > found;
+		unordered_set<int> seen;
+		struct dirent * entry = NULL;
+		DIR * dir = opendir(SYSFS_NET);
+
+		if (dir == NULL) {
+			this->mergePcap();
+			this->m_enumerated = true;
+			return;
+		}
+
+		try {
+			while ((entry = readdir(dir)) != NULL) {
+				int ifindex = 0;
+
+				if (entry->d_name[0] == '.') {
+					continue;
+				}
+				if ((ifindex = readIfindex(entry->d_name)) > 0) {
+					found.push_back(make_pair(ifindex,
+						string(entry->d_name)));
+				}
+			}
+		} catch (bad_alloc & e) {
+			closedir(dir);
+			throw Exception(e.what());
+		}
+		closedir(dir);
+
+		/* interface index order is creation order */
+		sort(found.begin(), found.end());
+		try {
+			for (vector<pair<int, string> >::iterator i =
+				found.begin(); i != found.end(); ++i) {
+				this->update(i->second.c_str(), i->first);
+				seen.insert(i->first);
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		for (vector<Adapter *>::iterator i = this->m_adapters.begin();
+			i != this->m_adapters.end(); ++i) {
+			if ((*i)->m_present && (*i)->m_ifindex > 0 &&
+				seen.find((*i)->m_ifindex) == seen.end()) {
+				this->remove((*i)->m_ifindex);
+			}
+		}
+		this->mergePcap();
+		this->m_enumerated = true;
+	}
+
+	/*
+	 * add the capture devices of libpcap that are not cached yet and
+	 * fill in the descriptions of cached ones
+	 */
+	void AdapterRegistry::mergePcap() NG_THROWS
+	{
+		unordered_map<string, Adapter *>::iterator j;
+		char errbuf[PCAP_ERRBUF_SIZE];
+		pcap_if_t * all = NULL;
+
+		if (pcap_findalldevs(&all, errbuf) == -1) {
+			throw Exception(errbuf);
+		}
+		try {
+			for (pcap_if_t * p = all; p != NULL; p = p->next) {
+				Adapter * adapter = NULL;
+
+				j = this->m_by_name.find(p->name);
+				if (j == this->m_by_name.end()) {
+					this->insert(p->name, p->description,
+						(int)if_nametoindex(p->name));
+					continue;
+				}
+				adapter = j->second;
+				if (!adapter->m_has_description &&
+					p->description != NULL) {
+					adapter->m_description = p->description;
+					adapter->m_has_description = true;
+				}
+			}
+		} catch (bad_alloc & e) {
+			pcap_freealldevs(all);
+			throw Exception(e.what());
+		} catch (Exception & e) {
+			pcap_freealldevs(all);
+			throw e;
+		}
+		pcap_freealldevs(all);
+	}
+
+	/*
+	 * record that an interface exists, handling renames and interfaces
+	 * recreated under a new index
+	 *
+	 * @name: interface name
+	 * @ifindex: interface index
+	 *
+	 * return: the adapter of the interface
+	 */
+	Adapter * AdapterRegistry::update(const char * name, int ifindex)
+		NG_THROWS
+	{
+		unordered_map<int, Adapter *>::iterator i =
+			this->m_by_index.find(ifindex);
+		unordered_map<string, Adapter *>::iterator j;
+		Adapter * adapter = NULL;
+		bool added = false;
+
+		try {
+			/* known index, possibly renamed */
+			if (i != this->m_by_index.end()) {
+				adapter = i->second;
+				if (adapter->m_name != name) {
+					j = this->m_by_name.find(adapter->m_name);
+					if (j != this->m_by_name.end() &&
+						j->second == adapter) {
+						this->m_by_name.erase(j);
+					}
+					adapter->m_name = name;
+					this->m_by_name[adapter->m_name] = adapter;
+				}
+				return adapter;
+			}
+
+			/* known name, recreated or first seen through libpcap */
+			j = this->m_by_name.find(name);
+			if (j != this->m_by_name.end()) {
+				adapter = j->second;
+				added = !adapter->m_present;
+				if (adapter->m_ifindex > 0) {
+					this->m_by_index.erase(adapter->m_ifindex);
+				}
+				adapter->m_ifindex = ifindex;
+				adapter->m_present = true;
+				this->m_by_index[ifindex] = adapter;
+			} else {
+				return this->insert(name, NULL, ifindex);
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		if (added && this->m_listener != NULL) {
+			this->m_listener->onAdded(adapter);
+		}
+		return adapter;
+	}
+
+	/*
+	 * record that an interface is gone, its adapter stays cached
+	 *
+	 * @ifindex: interface index
+	 */
+	void AdapterRegistry::remove(int ifindex)
+	{
+		unordered_map<int, Adapter *>::iterator i =
+			this->m_by_index.find(ifindex);
+		Adapter * adapter = NULL;
+
+		if (i == this->m_by_index.end()) {
+			return;
+		}
+		adapter = i->second;
+		this->m_by_index.erase(i);
+		adapter->m_present = false;
+
+		if (this->m_listener != NULL) {
+			this->m_listener->onRemoved(adapter);
+		}
+	}
+
+	/*
+	 * look up a capture device only libpcap knows about, such as "any"
+	 * or a USB bus; this enumerates with libpcap and is slow
+	 *
+	 * @name: device name
+	 *
+	 * return: a pointer to the adapter, NULL if there is no such device
+	 */
+	Adapter * AdapterRegistry::lookupPcap(const char * name)
+		NG_THROWS
+	{
+		unordered_map<string, Adapter *>::iterator j;
+		char errbuf[PCAP_ERRBUF_SIZE];
+		pcap_if_t * all = NULL;
+		pcap_if_t * p = NULL;
+		Adapter * adapter = NULL;
+
+		try {
+			j = this->m_by_name.find(name);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		if (j != this->m_by_name.end()) {
+			return j->second;
+		}
+
+		if (pcap_findalldevs(&all, errbuf) == -1) {
+			throw Exception(errbuf);
+		}
+		for (p = all; p != NULL; p = p->next) {
+			if (p->name != NULL && strcmp(p->name, name) == 0) {
+				break;
+			}
+		}
+		if (p == NULL) {
+			pcap_freealldevs(all);
+			return NULL;
+		}
+
+		try {
+			adapter = this->insert(p->name, p->description,
+				(int)if_nametoindex(p->name));
+		} catch (Exception & e) {
+			pcap_freealldevs(all);
+			throw e;
+		}
+		pcap_freealldevs(all);
+		return adapter;
+	}
+
+	/*
+	 * cache a new adapter
+	 *
+	 * @name: interface name
+	 * @description: interface description, or NULL if none
+	 * @ifindex: interface index, 0 if unknown
+	 *
+	 * return: the new adapter
+	 */
+	Adapter * AdapterRegistry::insert(const char * name,
+		const char * description, int ifindex) NG_THROWS
+	{
+		Adapter * adapter = new Adapter(name, description, ifindex);
+
+		try {
+			this->m_adapters.push_back(adapter);
+		} catch (bad_alloc & e) {
+			delete adapter;
+			throw Exception(e.what());
+		}
+		try {
+			this->m_by_name[adapter->m_name] = adapter;
+			if (ifindex > 0) {
+				this->m_by_index[ifindex] = adapter;
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		if (this->m_listener != NULL) {
+			this->m_listener->onAdded(adapter);
+		}
+		return adapter;
+	}
+}
@@ -0,0 +1,717 @@
+/*
+ * implementation of class AsyncCapture
+ */
+
+#include <deque>	/* for std::deque */
+#include <map>		/* for std::map */
+#include <set>		/* for std::set */
+#include <utility>	/* for std::pair and std::make_pair */
+#include <vector>	/* for std::vector */
+#include <algorithm>	/* for std::find */
+#include <new>		/* for std::bad_alloc */
+#include <cerrno>	/* for errno */
+#include <cstring>	/* for std::strerror */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for clock_gettime */
+#include <unistd.h>	/* for read, write and close */
+#include <pthread.h>	/* for pthread_mutex_t */
+#include <sys/epoll.h>	/* for epoll functions */
+#include <sys/eventfd.h>	/* for eventfd */
+
+#include "core/AsyncCapture.h"	/* for netgazer::AsyncCapture */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/Adapter.h"	/* for netgazer::Adapter */
+#include "core/Packet.h"	/* for netgazer::Packet */
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+using std::deque;
+using std::map;
+using std::set;
+using std::pair;
+using std::make_pair;
+using std::vector;
+using std::find;
+using std::bad_alloc;
+using std::strerror;
+
+namespace netgazer {
+	/*
+	 * read the monotonic clock
+	 *
+	 * return: monotonic time in milliseconds
+	 */
+	static uint64_t monotonicMs()
+	{
+		struct timespec ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+	}
+
+	/*
+	 * free the packets of a batch
+	 *
+	 * @batch: the batch, left without packets
+	 */
+	static void freePackets(struct AsyncCapture::Batch & batch)
+	{
+		for (vector<Packet *>::iterator i = batch.packets.begin();
+			i != batch.packets.end(); ++i) {
+			delete *i;
+		}
+		batch.packets.clear();
+	}
+
+	/*
+	 * estimate the memory held by a batch
+	 *
+	 * @batch: the batch
+	 *
+	 * return: number of bytes
+	 */
+	static size_t footprint(const struct AsyncCapture::Batch & batch)
+	{
+		size_t bytes = batch.summaries.size() *
+			sizeof(struct PacketSummary);
+
+		for (vector<Packet *>::const_iterator i = batch.packets.begin();
+			i != batch.packets.end(); ++i) {
+			bytes += (*i)->memory();
+		}
+		return bytes;
+	}
+
+	/*
+	 * constructor of AsyncCapture::Collector
+	 *
+	 * @batch: batch to collect into
+	 */
+	AsyncCapture::Collector::Collector(struct AsyncCapture::Batch & batch)
+		: m_batch(batch)
+	{
+	}
+
+	/*
+	 * copy a dispatched packet into the batch
+	 *
+	 * @adapter: adapter the packet was captured on
+	 * @packet: captured packet, owned by the adapter
+	 */
+	void AsyncCapture::Collector::onPacket(Adapter * /* adapter */,
+		Packet * packet) NG_THROWS
+	{
+		Packet * p = packet->clone();
+
+		try {
+			this->m_batch.packets.push_back(p);
+		} catch (bad_alloc & e) {
+			delete p;
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * copy a dispatched summary into the batch
+	 *
+	 * @adapter: adapter the packet was captured on
+	 * @summary: summary record, owned by the adapter
+	 */
+	void AsyncCapture::Collector::onSummary(Adapter * /* adapter */,
+		const PacketSummary * summary) NG_THROWS
+	{
+		try {
+			this->m_batch.summaries.push_back(*summary);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * constructor of AsyncCapture
+	 */
+	AsyncCapture::AsyncCapture() NG_THROWS
+	{
+		struct epoll_event ev;
+
+		this->m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (this->m_epoll_fd < 0) {
+			throw Exception(strerror(errno));
+		}
+		this->m_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (this->m_wake_fd < 0) {
+			::close(this->m_epoll_fd);
+			throw Exception(strerror(errno));
+		}
+
+		/* the wakeup eventfd is tagged with a NULL source */
+		ev.events = EPOLLIN;
+		ev.data.ptr = NULL;
+		if (epoll_ctl(this->m_epoll_fd, EPOLL_CTL_ADD, this->m_wake_fd,
+			&ev) < 0) {
+			::close(this->m_wake_fd);
+			::close(this->m_epoll_fd);
+			throw Exception(strerror(errno));
+		}
+
+		pthread_mutex_init(&(this->m_lock), NULL);
+		this->m_running = false;
+		this->m_next_id = 0;
+	}
+
+	/*
+	 * destructor of AsyncCapture, pending requests are dropped without
+	 * completion and the adapters are not closed
+	 */
+	AsyncCapture::~AsyncCapture()
+	{
+		for (map<Adapter *, struct Source *>::iterator i =
+			this->m_sources.begin(); i != this->m_sources.end(); ++i) {
+			delete i->second;
+		}
+		this->m_sources.clear();
+
+		pthread_mutex_destroy(&(this->m_lock));
+		::close(this->m_wake_fd);
+		::close(this->m_epoll_fd);
+	}
+
+	/*
+	 * request the next batch of packets from an adapter, the callback
+	 * runs once with COMPLETED, TIMEOUT, CANCELLED or FAILED
+	 *
+	 * @adapter: opened adapter to capture from
+	 * @max: maximum number of packets in the batch
+	 * @timeout: time to wait in milliseconds, -1 for infinite
+	 * @callback: receiver of the batch
+	 *
+	 * return: request id, usable with cancel()
+	 */
+	uint64_t AsyncCapture::nextBatch(Adapter * adapter, int max,
+		int timeout, Callback * callback) NG_THROWS
+	{
+		struct AsyncCapture::Request r;
+
+		r.adapter = adapter;
+		r.max = max > 0 ? max : 1;
+		r.timeout = timeout;
+		r.callback = callback;
+		r.repeat = false;
+		return this->submit(r);
+	}
+
+	/*
+	 * request a stream of batches from an adapter, the callback runs for
+	 * every batch until the stream is cancelled or fails
+	 *
+	 * @adapter: opened adapter to capture from
+	 * @max: maximum number of packets per batch
+	 * @callback: receiver of the batches
+	 *
+	 * return: request id, usable with cancel()
+	 */
+	uint64_t AsyncCapture::stream(Adapter * adapter, int max,
+		Callback * callback) NG_THROWS
+	{
+		struct AsyncCapture::Request r;
+
+		r.adapter = adapter;
+		r.max = max > 0 ? max : 1;
+		r.timeout = -1;
+		r.callback = callback;
+		r.repeat = true;
+		return this->submit(r);
+	}
+
+	/*
+	 * cancel a pending request or stream, its callback runs with
+	 * CANCELLED unless it already completed
+	 *
+	 * @id: request id
+	 */
+	void AsyncCapture::cancel(uint64_t id)
+	{
+		uint64_t one = 1;
+
+		pthread_mutex_lock(&(this->m_lock));
+		this->m_cancels.push_back(id);
+		pthread_mutex_unlock(&(this->m_lock));
+
+		if (write(this->m_wake_fd, &one, sizeof(one)) < 0) {
+			/* the counter is already non-zero */
+		}
+	}
+
+	/*
+	 * stop watching an adapter, safe to call from any thread; its
+	 * pending requests and streams complete with CANCELLED on the loop
+	 * thread, so the adapter must stay valid until they did, but it may
+	 * be closed already
+	 *
+	 * @adapter: adapter to forget
+	 */
+	void AsyncCapture::remove(Adapter * adapter) NG_THROWS
+	{
+		uint64_t one = 1;
+
+		pthread_mutex_lock(&(this->m_lock));
+		try {
+			this->m_removals.push_back(adapter);
+		} catch (bad_alloc & e) {
+			pthread_mutex_unlock(&(this->m_lock));
+			throw Exception(e.what());
+		}
+		pthread_mutex_unlock(&(this->m_lock));
+
+		if (write(this->m_wake_fd, &one, sizeof(one)) < 0) {
+			/* the counter is already non-zero */
+		}
+	}
+
+	/*
+	 * run one iteration of the event loop: accept submissions, complete
+	 * requests on readable adapters and expire timed out ones
+	 *
+	 * @timeout: maximum time to wait in milliseconds, -1 for infinite
+	 *
+	 * return: number of packets delivered
+	 */
+	int AsyncCapture::runOnce(int timeout) NG_THROWS
+	{
+		struct epoll_event events[64];
+		uint64_t now = 0;
+		int delivered = 0;
+		int n = 0;
+
+		this->accept();
+
+		/* wake up in time for the nearest deadline */
+		if (!this->m_deadlines.empty()) {
+			uint64_t nearest = this->m_deadlines.begin()->first;
+			int wait = 0;
+
+			now = monotonicMs();
+			wait = nearest > now ? (int)(nearest - now) : 0;
+			if (timeout < 0 || wait < timeout) {
+				timeout = wait;
+			}
+		}
+
+		n = epoll_wait(this->m_epoll_fd, events,
+			sizeof(events) / sizeof(events[0]), timeout);
+		if (n < 0 && errno != EINTR) {
+			throw Exception(strerror(errno));
+		}
+
+		for (int i = 0; i < n; ++i) {
+			struct Source * source = (struct Source *)
+				events[i].data.ptr;
+			uint64_t value = 0;
+
+			if (source == NULL) {
+				/* drain the wakeup counter */
+				if (read(this->m_wake_fd, &value,
+					sizeof(value)) < 0) {
+					/* nothing to drain */
+				}
+				continue;
+			}
+			delivered += this->drain(source);
+		}
+
+		this->accept();
+		this->expire(monotonicMs());
+		return delivered;
+	}
+
+	/*
+	 * run the event loop until stop() is called
+	 */
+	void AsyncCapture::run() NG_THROWS
+	{
+		this->m_running = true;
+		while (this->m_running) {
+			this->runOnce(-1);
+		}
+	}
+
+	/*
+	 * make run() return, safe to call from any thread
+	 */
+	void AsyncCapture::stop()
+	{
+		uint64_t one = 1;
+
+		this->m_running = false;
+		if (write(this->m_wake_fd, &one, sizeof(one)) < 0) {
+			/* the counter is already non-zero */
+		}
+	}
+
+	/*
+	 * give memory back, which transient batches cannot do
+	 *
+	 * @bytes: amount of memory asked back
+	 *
+	 * return: 0
+	 */
+	size_t AsyncCapture::shed(size_t /* bytes */)
+	{
+		return 0;
+	}
+
+	/*
+	 * queue a request for the loop thread
+	 *
+	 * @r: request, its id and deadline are filled in here
+	 *
+	 * return: request id
+	 */
+	uint64_t AsyncCapture::submit(const struct AsyncCapture::Request & r)
+		NG_THROWS
+	{
+		struct AsyncCapture::Request q = r;
+		uint64_t one = 1;
+
+		if (q.adapter == NULL) {
+			throw Exception("adapter is NULL");
+		}
+		if (q.callback == NULL) {
+			throw Exception("callback is NULL");
+		}
+		q.deadline_ms = q.timeout >= 0 ? monotonicMs() + q.timeout : 0;
+
+		pthread_mutex_lock(&(this->m_lock));
+		q.id = ++this->m_next_id;
+		try {
+			this->m_inbox.push_back(q);
+		} catch (bad_alloc & e) {
+			pthread_mutex_unlock(&(this->m_lock));
+			throw Exception(e.what());
+		}
+		pthread_mutex_unlock(&(this->m_lock));
+
+		if (write(this->m_wake_fd, &one, sizeof(one)) < 0) {
+			/* the counter is already non-zero */
+		}
+		return q.id;
+	}
+
+	/*
+	 * move submitted requests, cancellations and removals into the loop
+	 * state
+	 */
+	void AsyncCapture::accept() NG_THROWS
+	{
+		vector<struct AsyncCapture::Request> inbox;
+		vector<uint64_t> cancels;
+		vector<Adapter *> removals;
+
+		pthread_mutex_lock(&(this->m_lock));
+		inbox.swap(this->m_inbox);
+		cancels.swap(this->m_cancels);
+		removals.swap(this->m_removals);
+		pthread_mutex_unlock(&(this->m_lock));
+
+		for (vector<struct AsyncCapture::Request>::iterator i =
+			inbox.begin(); i != inbox.end(); ++i) {
+			map<Adapter *, struct Source *>::iterator s =
+				this->m_sources.find(i->adapter);
+			struct Source * source = NULL;
+
+			/* first request on this adapter */
+			if (s == this->m_sources.end()) {
+				try {
+					source = new struct Source;
+					source->adapter = i->adapter;
+					source->fd = -1;
+					source->armed = false;
+					this->m_sources[i->adapter] = source;
+				} catch (bad_alloc & e) {
+					delete source;
+					throw Exception(e.what());
+				}
+			} else {
+				source = s->second;
+			}
+
+			try {
+				this->m_requests[i->id] = *i;
+				source->queue.push_back(i->id);
+			} catch (bad_alloc & e) {
+				this->m_requests.erase(i->id);
+				throw Exception(e.what());
+			}
+			if (i->deadline_ms != 0) {
+				this->m_deadlines.insert(make_pair(i->deadline_ms,
+					i->id));
+			}
+
+			/*
+			 * a reopened adapter may have another fd, or the same
+			 * number no longer registered, so arm it again
+			 */
+			try {
+				this->watch(source);
+				source->armed = false;
+				this->arm(source);
+			} catch (Exception & e) {
+				this->detach(i->adapter, AsyncCapture::FAILED,
+					e.what());
+			}
+		}
+
+		for (vector<uint64_t>::iterator i = cancels.begin();
+			i != cancels.end(); ++i) {
+			this->finish(*i, AsyncCapture::CANCELLED, NULL);
+		}
+		for (vector<Adapter *>::iterator i = removals.begin();
+			i != removals.end(); ++i) {
+			this->detach(*i, AsyncCapture::CANCELLED, NULL);
+		}
+	}
+
+	/*
+	 * register the current fd of an adapter, unwatched until armed,
+	 * replacing the one it was registered with
+	 *
+	 * @source: adapter state
+	 */
+	void AsyncCapture::watch(struct AsyncCapture::Source * source)
+		NG_THROWS
+	{
+		int fd = source->adapter->selectableFd();
+		struct epoll_event ev;
+
+		if (fd == source->fd) {
+			return;
+		}
+		if (source->fd >= 0) {
+			/* fails if the old fd was closed, which dropped it */
+			epoll_ctl(this->m_epoll_fd, EPOLL_CTL_DEL, source->fd,
+				&ev);
+			source->fd = -1;
+			source->armed = false;
+		}
+		source->adapter->setNonblock(true);
+		ev.events = 0;
+		ev.data.ptr = source;
+		if (epoll_ctl(this->m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			throw Exception(strerror(errno));
+		}
+		source->fd = fd;
+	}
+
+	/*
+	 * watch an adapter only while requests are pending on it, since a
+	 * level-triggered fd without readers would spin the loop
+	 *
+	 * @source: adapter state
+	 */
+	void AsyncCapture::arm(struct AsyncCapture::Source * source)
+		NG_THROWS
+	{
+		bool want = !source->queue.empty();
+		struct epoll_event ev;
+
+		if (want == source->armed) {
+			return;
+		}
+		ev.events = want ? (uint32_t)EPOLLIN : 0;
+		ev.data.ptr = source;
+		if (source->fd < 0) {
+			throw Exception("adapter is not registered");
+		}
+		/* the same fd number after a close and reopen is not watched */
+		if (epoll_ctl(this->m_epoll_fd, EPOLL_CTL_MOD, source->fd,
+			&ev) < 0 && (errno != ENOENT || epoll_ctl(
+			this->m_epoll_fd, EPOLL_CTL_ADD, source->fd, &ev) < 0)) {
+			throw Exception(strerror(errno));
+		}
+		source->armed = want;
+	}
+
+	/*
+	 * forget an adapter and complete all its pending requests
+	 *
+	 * @adapter: adapter to forget
+	 * @status: completion status of its requests
+	 * @error: error message for FAILED, NULL otherwise
+	 */
+	void AsyncCapture::detach(Adapter * adapter,
+		enum AsyncCapture::Status status, const char * error)
+	{
+		map<Adapter *, struct Source *>::iterator s =
+			this->m_sources.find(adapter);
+		deque<uint64_t> queue;
+		struct epoll_event ev;
+
+		if (s == this->m_sources.end()) {
+			return;
+		}
+		queue.swap(s->second->queue);
+		if (s->second->fd >= 0) {
+			/* fails if the adapter was closed, which dropped it */
+			epoll_ctl(this->m_epoll_fd, EPOLL_CTL_DEL, s->second->fd,
+				&ev);
+		}
+		delete s->second;
+		this->m_sources.erase(s);
+
+		for (deque<uint64_t>::iterator i = queue.begin();
+			i != queue.end(); ++i) {
+			this->finish(*i, status, error);
+		}
+	}
+
+	/*
+	 * complete requests on a readable adapter in submission order; an
+	 * adapter failing to dispatch is detached with all its requests
+	 *
+	 * @source: adapter state, freed if detached
+	 *
+	 * return: number of packets delivered
+	 */
+	int AsyncCapture::drain(struct AsyncCapture::Source * source)
+		NG_THROWS
+	{
+		size_t rounds = source->queue.size();
+		int delivered = 0;
+
+		/* serve each request at most once per wakeup */
+		for (; rounds > 0 && !source->queue.empty(); --rounds) {
+			uint64_t id = source->queue.front();
+			struct AsyncCapture::Request & r = this->m_requests[id];
+			struct AsyncCapture::Batch batch;
+			AsyncCapture::Collector collector(batch);
+			int n = 0;
+
+			batch.id = id;
+			batch.adapter = source->adapter;
+			batch.status = AsyncCapture::COMPLETED;
+			batch.error = NULL;
+			try {
+				n = source->adapter->dispatch(r.max, &collector);
+			} catch (Exception & e) {
+				/* packets collected before the failure */
+				freePackets(batch);
+				this->detach(source->adapter, AsyncCapture::FAILED,
+					e.what());
+				return delivered;
+			}
+			if (n == 0 && batch.packets.empty() &&
+				batch.summaries.empty()) {
+				break;
+			}
+
+			/* streams go to the back to share the adapter fairly */
+			source->queue.pop_front();
+			if (r.deadline_ms != 0) {
+				this->m_deadlines.erase(make_pair(r.deadline_ms,
+					id));
+			}
+			delivered += (int)(batch.packets.size() +
+				batch.summaries.size());
+			if (r.repeat) {
+				source->queue.push_back(id);
+				this->complete(r, batch);
+			} else {
+				struct AsyncCapture::Request done = r;
+
+				this->m_requests.erase(id);
+				this->complete(done, batch);
+			}
+		}
+
+		this->arm(source);
+		return delivered;
+	}
+
+	/*
+	 * complete requests whose deadline has passed
+	 *
+	 * @now_ms: current monotonic time in milliseconds
+	 */
+	void AsyncCapture::expire(uint64_t now_ms)
+	{
+		while (!this->m_deadlines.empty() &&
+			this->m_deadlines.begin()->first <= now_ms) {
+			this->finish(this->m_deadlines.begin()->second,
+				AsyncCapture::TIMEOUT, NULL);
+		}
+	}
+
+	/*
+	 * hand a batch to the callback of a request and free its packets,
+	 * also when the callback throws; the batch is charged meanwhile
+	 *
+	 * @r: request
+	 * @batch: completed batch
+	 */
+	void AsyncCapture::complete(struct AsyncCapture::Request & r,
+		struct AsyncCapture::Batch & batch)
+	{
+		size_t bytes = footprint(batch);
+
+		try {
+			if (!this->charge(bytes)) {
+				this->relieve();
+			}
+			r.callback->onBatch(batch);
+		} catch (...) {
+			freePackets(batch);
+			this->release(bytes);
+			throw;
+		}
+		freePackets(batch);
+		this->release(bytes);
+	}
+
+	/*
+	 * complete a request without packets and forget it
+	 *
+	 * @id: request id
+	 * @status: completion status
+	 * @error: error message for FAILED, NULL otherwise
+	 */
+	void AsyncCapture::finish(uint64_t id, enum AsyncCapture::Status status,
+		const char * error)
+	{
+		map<uint64_t, struct AsyncCapture::Request>::iterator i =
+			this->m_requests.find(id);
+		map<Adapter *, struct Source *>::iterator s;
+		struct AsyncCapture::Request r;
+		struct AsyncCapture::Batch batch;
+
+		/* already completed */
+		if (i == this->m_requests.end()) {
+			return;
+		}
+		r = i->second;
+		this->m_requests.erase(i);
+		if (r.deadline_ms != 0) {
+			this->m_deadlines.erase(make_pair(r.deadline_ms, id));
+		}
+
+		s = this->m_sources.find(r.adapter);
+		if (s != this->m_sources.end()) {
+			deque<uint64_t> & q = s->second->queue;
+			deque<uint64_t>::iterator j = find(q.begin(), q.end(), id);
+
+			if (j != q.end()) {
+				q.erase(j);
+			}
+			try {
+				this->arm(s->second);
+			} catch (Exception & e) {
+				/* the adapter was closed under us */
+			}
+		}
+
+		batch.id = id;
+		batch.adapter = r.adapter;
+		batch.status = status;
+		batch.error = error;
+		this->complete(r, batch);
+	}
+}
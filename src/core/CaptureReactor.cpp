@@ -0,0 +1,476 @@
+/*
+ * implementation of class CaptureReactor
+ */
+
+#include <vector>	/* for std::vector */
+#include <algorithm>	/* for std::find */
+#include <new>		/* for std::bad_alloc */
+#include <cerrno>	/* for errno */
+#include <cstring>	/* for std::strerror */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for clock_gettime */
+#include <unistd.h>	/* for read, write and close */
+#include <sys/epoll.h>	/* for epoll functions */
+#include <sys/eventfd.h>	/* for eventfd */
+
+#include "core/CaptureReactor.h"	/* for netgazer::CaptureReactor */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "core/Adapter.h"		/* for netgazer::Adapter */
+#include "core/Packet.h"		/* for netgazer::Packet */
+#include "core/PacketSummary.h"		/* for netgazer::PacketSummary */
+#include "core/PacketHandler.h"		/* for netgazer::PacketHandler */
+#include "core/Deduplicator.h"		/* for netgazer::Deduplicator */
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+using std::vector;
+using std::find;
+using std::bad_alloc;
+using std::strerror;
+
+namespace netgazer {
+	/*
+	 * read the monotonic clock
+	 *
+	 * return: monotonic time in nanoseconds
+	 */
+	static uint64_t monotonicNs()
+	{
+		struct timespec ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+	/*
+	 * constructor of CaptureReactor
+	 *
+	 * @handler: receiver of all captured packets
+	 * @batch: maximum number of packets drained from an adapter per
+	 *         wakeup, which bounds how long one busy adapter can starve
+	 *         the others
+	 */
+	CaptureReactor::CaptureReactor(PacketHandler * handler, int batch)
+		NG_THROWS
+	{
+		struct epoll_event ev;
+
+		if (handler == NULL) {
+			throw Exception("handler is NULL");
+		}
+
+		this->m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (this->m_epoll_fd < 0) {
+			throw Exception(strerror(errno));
+		}
+		this->m_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (this->m_wake_fd < 0) {
+			::close(this->m_epoll_fd);
+			throw Exception(strerror(errno));
+		}
+
+		/* the wakeup eventfd is tagged with a NULL adapter */
+		ev.events = EPOLLIN;
+		ev.data.ptr = NULL;
+		if (epoll_ctl(this->m_epoll_fd, EPOLL_CTL_ADD, this->m_wake_fd,
+			&ev) < 0) {
+			::close(this->m_wake_fd);
+			::close(this->m_epoll_fd);
+			throw Exception(strerror(errno));
+		}
+
+		this->m_handler = handler;
+		this->m_batch = batch > 0 ? batch : 64;
+		this->m_running = false;
+		this->m_merge = false;
+		this->m_window_ns = 1000000;
+		this->m_max_pending = 65536;
+		this->m_dedup = NULL;
+		this->m_seq = 0;
+		this->m_newest_ns = 0;
+		this->m_newest_at = 0;
+	}
+
+	/*
+	 * destructor of CaptureReactor, the adapters are not closed
+	 */
+	CaptureReactor::~CaptureReactor()
+	{
+		/* free packets still waiting in the reorder window */
+		while (!this->m_pending.empty()) {
+			this->release(CaptureReactor::footprint(
+				this->m_pending.top()));
+			delete this->m_pending.top().packet;
+			this->m_pending.pop();
+		}
+
+		::close(this->m_wake_fd);
+		::close(this->m_epoll_fd);
+	}
+
+	/*
+	 * register an opened adapter, which is switched to non-blocking mode
+	 *
+	 * @adapter: adapter to capture from
+	 */
+	void CaptureReactor::add(Adapter * adapter) NG_THROWS
+	{
+		struct epoll_event ev;
+
+		if (adapter == NULL) {
+			throw Exception("adapter is NULL");
+		}
+
+		adapter->setNonblock(true);
+		ev.events = EPOLLIN;
+		ev.data.ptr = adapter;
+		if (epoll_ctl(this->m_epoll_fd, EPOLL_CTL_ADD,
+			adapter->selectableFd(), &ev) < 0) {
+			throw Exception(strerror(errno));
+		}
+		this->m_adapters.push_back(adapter);
+	}
+
+	/*
+	 * unregister an adapter; packets of it already in the reorder window
+	 * are delivered right away, along with the older packets of other
+	 * adapters, so that none refers to the adapter afterwards
+	 *
+	 * @adapter: adapter to stop capturing from
+	 */
+	void CaptureReactor::remove(Adapter * adapter) NG_THROWS
+	{
+		vector<Adapter *>::iterator i = find(this->m_adapters.begin(),
+			this->m_adapters.end(), adapter);
+		bool held = false;
+		uint64_t newest = 0;
+
+		if (i == this->m_adapters.end()) {
+			throw Exception("adapter is not registered");
+		}
+		epoll_ctl(this->m_epoll_fd, EPOLL_CTL_DEL,
+			adapter->selectableFd(), NULL);
+		this->m_adapters.erase(i);
+
+		/* find its newest held packet on a copy of the heap */
+		if (!this->m_pending.empty()) {
+			std::priority_queue<struct CaptureReactor::Pending,
+				vector<struct CaptureReactor::Pending>,
+				struct CaptureReactor::Later> copy =
+				this->m_pending;
+
+			for (; !copy.empty(); copy.pop()) {
+				if (copy.top().adapter == adapter) {
+					held = true;
+					newest = copy.top().ts_ns;
+				}
+			}
+		}
+		if (held) {
+			this->drainTo(newest);
+		}
+	}
+
+	/*
+	 * enable or disable merging all adapters into a single stream
+	 * ordered by timestamp; packets are held back until every adapter
+	 * had the chance to deliver older ones, up to a bounded window
+	 *
+	 * @merge: whether to merge by timestamp
+	 * @window_ns: reorder window in nanoseconds
+	 * @max_pending: maximum number of packets held in the window
+	 */
+	void CaptureReactor::setMerge(bool merge, uint64_t window_ns,
+		size_t max_pending)
+	{
+		this->m_merge = merge;
+		this->m_window_ns = window_ns;
+		this->m_max_pending = max_pending > 0 ? max_pending : 1;
+	}
+
+	/*
+	 * suppress packets captured more than once across the adapters,
+	 * before they enter the reorder window; summaries are not checked
+	 * as they lack the bytes to fingerprint. The deduplicator is not
+	 * owned by the reactor.
+	 *
+	 * @dedup: the deduplicator, NULL to deliver every packet
+	 */
+	void CaptureReactor::setDeduplicator(Deduplicator * dedup)
+	{
+		this->m_dedup = dedup;
+	}
+
+	/*
+	 * wait for adapters to become readable and drain them in batches
+	 *
+	 * @timeout: maximum time to wait in milliseconds, -1 for infinite
+	 *
+	 * return: number of packets captured
+	 */
+	int CaptureReactor::poll(int timeout) NG_THROWS
+	{
+		struct epoll_event events[64];
+		uint64_t watermark = 0;
+		int captured = 0;
+		int n = 0;
+
+		/* held packets must be released even if all adapters idle */
+		if (this->m_merge && !this->m_pending.empty() &&
+			(timeout < 0 || timeout > 1)) {
+			timeout = 1;
+		}
+
+		n = epoll_wait(this->m_epoll_fd, events,
+			sizeof(events) / sizeof(events[0]), timeout);
+		if (n < 0) {
+			if (errno == EINTR) {
+				return 0;
+			}
+			throw Exception(strerror(errno));
+		}
+
+		for (int i = 0; i < n; ++i) {
+			Adapter * adapter = (Adapter *)events[i].data.ptr;
+			uint64_t value = 0;
+
+			if (adapter == NULL) {
+				/* drain the wakeup counter */
+				if (read(this->m_wake_fd, &value,
+					sizeof(value)) < 0) {
+					/* nothing to drain */
+				}
+				continue;
+			}
+			captured += adapter->dispatch(this->m_batch,
+				this->m_merge || this->m_dedup != NULL ?
+				this : this->m_handler);
+		}
+
+		if (this->m_merge) {
+			uint64_t now = monotonicNs();
+
+			if (captured > 0) {
+				this->m_newest_at = now;
+			}
+
+			/* when idle, packet time is taken to go on at the
+			 * pace of the monotonic clock since the newest packet,
+			 * which also holds for replayed and offline captures */
+			if (captured == 0 && this->m_newest_ns > 0) {
+				watermark = this->m_newest_ns +
+					(now - this->m_newest_at);
+			} else {
+				watermark = this->m_newest_ns;
+			}
+			watermark = watermark > this->m_window_ns ?
+				watermark - this->m_window_ns : 0;
+			this->drainTo(watermark);
+		}
+		return captured;
+	}
+
+	/*
+	 * run the event loop until stop() is called, then deliver the
+	 * packets still held in the reorder window
+	 */
+	void CaptureReactor::run() NG_THROWS
+	{
+		this->m_running = true;
+		while (this->m_running) {
+			this->poll(-1);
+		}
+		this->flush();
+	}
+
+	/*
+	 * make run() return, safe to call from any thread or signal handler
+	 */
+	void CaptureReactor::stop()
+	{
+		uint64_t one = 1;
+
+		this->m_running = false;
+		if (write(this->m_wake_fd, &one, sizeof(one)) < 0) {
+			/* the counter is already non-zero */
+		}
+	}
+
+	/*
+	 * get the number of packets held in the reorder window, e.g. as the
+	 * queue depth of a SamplingController
+	 *
+	 * return: number of packets
+	 */
+	size_t CaptureReactor::pending() const
+	{
+		return this->m_pending.size();
+	}
+
+	/*
+	 * give memory back by delivering the oldest held packets ahead of
+	 * the watermark, at the risk of ordering them before stragglers
+	 *
+	 * @bytes: amount of memory to give back
+	 *
+	 * return: number of bytes released
+	 */
+	size_t CaptureReactor::shed(size_t bytes)
+	{
+		size_t freed = 0;
+
+		while (freed < bytes && !this->m_pending.empty()) {
+			struct CaptureReactor::Pending p = this->m_pending.top();
+			size_t n = CaptureReactor::footprint(p);
+
+			this->m_pending.pop();
+			this->release(n);
+			freed += n;
+			this->deliver(p);
+		}
+		return freed;
+	}
+
+	/*
+	 * deliver every packet held in the reorder window
+	 */
+	void CaptureReactor::flush() NG_THROWS
+	{
+		this->drainTo((uint64_t)-1);
+	}
+
+	/*
+	 * collect a packet from an adapter into the reorder window, or
+	 * deliver it right away when not merging
+	 *
+	 * @adapter: adapter the packet was captured on
+	 * @packet: captured packet, owned by the adapter
+	 */
+	void CaptureReactor::onPacket(Adapter * adapter, Packet * packet)
+		NG_THROWS
+	{
+		struct CaptureReactor::Pending p;
+		struct timespec ts = packet->preciseTimestamp();
+
+		p.ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+		if (this->m_dedup != NULL && this->m_dedup->duplicate(p.ts_ns,
+			packet->data(), packet->capturedLength(),
+			(uint32_t)packet->length())) {
+			return;
+		}
+		if (!this->m_merge) {
+			this->m_handler->onPacket(adapter, packet);
+			return;
+		}
+
+		p.seq = this->m_seq++;
+		p.adapter = adapter;
+		p.packet = packet->clone();
+		try {
+			this->m_pending.push(p);
+		} catch (bad_alloc & e) {
+			delete p.packet;
+			throw Exception(e.what());
+		}
+		if (!this->charge(CaptureReactor::footprint(p))) {
+			this->relieve();
+		}
+
+		if (p.ts_ns > this->m_newest_ns) {
+			this->m_newest_ns = p.ts_ns;
+		}
+		if (this->m_pending.size() > this->m_max_pending) {
+			this->drainTo(0);
+		}
+	}
+
+	/*
+	 * collect a summary from an adapter into the reorder window, or
+	 * deliver it right away when not merging
+	 *
+	 * @adapter: adapter the packet was captured on
+	 * @summary: summary record, owned by the adapter
+	 */
+	void CaptureReactor::onSummary(Adapter * adapter,
+		const PacketSummary * summary) NG_THROWS
+	{
+		struct CaptureReactor::Pending p;
+
+		if (!this->m_merge) {
+			this->m_handler->onSummary(adapter, summary);
+			return;
+		}
+		p.ts_ns = summary->ts_ns;
+		p.seq = this->m_seq++;
+		p.adapter = adapter;
+		p.packet = NULL;
+		p.summary = *summary;
+		try {
+			this->m_pending.push(p);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		if (!this->charge(CaptureReactor::footprint(p))) {
+			this->relieve();
+		}
+
+		if (p.ts_ns > this->m_newest_ns) {
+			this->m_newest_ns = p.ts_ns;
+		}
+		if (this->m_pending.size() > this->m_max_pending) {
+			this->drainTo(0);
+		}
+	}
+
+	/*
+	 * deliver held packets in timestamp order, up to the watermark or
+	 * until the window is back within its size limit
+	 *
+	 * @watermark: packets at or before this timestamp are delivered
+	 */
+	void CaptureReactor::drainTo(uint64_t watermark) NG_THROWS
+	{
+		while (!this->m_pending.empty() &&
+			(this->m_pending.top().ts_ns <= watermark ||
+			this->m_pending.size() > this->m_max_pending)) {
+			struct CaptureReactor::Pending p = this->m_pending.top();
+
+			this->m_pending.pop();
+			this->release(CaptureReactor::footprint(p));
+			this->deliver(p);
+		}
+	}
+
+	/*
+	 * deliver a held packet to the handler and free it
+	 *
+	 * @p: held packet
+	 */
+	void CaptureReactor::deliver(
+		const struct CaptureReactor::Pending & p) NG_THROWS
+	{
+		if (p.packet == NULL) {
+			this->m_handler->onSummary(p.adapter, &(p.summary));
+			return;
+		}
+
+		try {
+			this->m_handler->onPacket(p.adapter, p.packet);
+		} catch (Exception & e) {
+			delete p.packet;
+			throw e;
+		}
+		delete p.packet;
+	}
+
+	/*
+	 * estimate the memory held by a packet in the reorder window
+	 *
+	 * @p: held packet
+	 *
+	 * return: number of bytes
+	 */
+	size_t CaptureReactor::footprint(const struct CaptureReactor::Pending & p)
+	{
+		return sizeof(p) + (p.packet != NULL ? p.packet->memory() : 0);
+	}
+}
@@ -0,0 +1,534 @@
+/*
+ * implementation of class Checkpoint
+ */
+
+#include <string>	/* for std::string */
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <cerrno>	/* for errno */
+#include <cstring>	/* for std::strerror, std::strcmp and friends */
+#include <stddef.h>	/* for size_t and offsetof */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for clock_gettime */
+#include <fcntl.h>	/* for open */
+#include <unistd.h>	/* for fork, pread, ftruncate and _exit */
+#include <sys/mman.h>	/* for mmap and msync */
+#include <sys/stat.h>	/* for fstat */
+#include <sys/wait.h>	/* for waitpid */
+
+#include "core/Checkpoint.h"		/* for netgazer::Checkpoint */
+#include "core/Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "core/Hash.h"			/* for netgazer::Hash */
+
+using std::string;
+using std::vector;
+using std::bad_alloc;
+using std::strerror;
+using std::strcmp;
+using std::strlen;
+using std::strncpy;
+using std::memcmp;
+using std::memcpy;
+using std::memset;
+
+namespace netgazer {
+	/*
+	 * read a clock in nanoseconds
+	 *
+	 * @clock: clock id
+	 *
+	 * return: nanoseconds
+	 */
+	static uint64_t nanoseconds(clockid_t clock)
+	{
+		struct timespec ts;
+
+		clock_gettime(clock, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+	/*
+	 * constructor of Checkpoint
+	 *
+	 * @path: snapshot path, ".0" and ".1" are appended
+	 */
+	Checkpoint::Checkpoint(const char * path) NG_THROWS
+	{
+		if (path == NULL) {
+			throw Exception("path is NULL");
+		}
+
+		try {
+			this->m_files[0] = string(path) + ".0";
+			this->m_files[1] = string(path) + ".1";
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		this->m_writer = 0;
+		this->m_slot = -1;
+		this->m_newest = -1;
+		memset(&(this->m_stats), 0, sizeof(this->m_stats));
+	}
+
+	/*
+	 * destructor of Checkpoint, waits for a running writer
+	 */
+	Checkpoint::~Checkpoint()
+	{
+		this->wait();
+	}
+
+	/*
+	 * register a component
+	 *
+	 * @component: the component
+	 * @name: name of its state in snapshots, under 32 characters
+	 */
+	void Checkpoint::add(Checkpointable * component, const char * name)
+		NG_THROWS
+	{
+		struct Checkpoint::Component c;
+
+		if (component == NULL || name == NULL) {
+			throw Exception("component or name is NULL");
+		}
+		if (strlen(name) >= sizeof(((struct Checkpoint::Entry *)NULL)->
+			name)) {
+			throw Exception("name too long");
+		}
+		for (vector<struct Checkpoint::Component>::iterator i =
+			this->m_components.begin();
+			i != this->m_components.end(); ++i) {
+			if (i->name == name) {
+				throw Exception("name already registered");
+			}
+		}
+
+		try {
+			c.component = component;
+			c.name = name;
+			this->m_components.push_back(c);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * start a checkpoint; the registered components must not change
+	 * during the call, e.g. call it between batches from the thread
+	 * feeding them
+	 *
+	 * return: true if started, false if the last one is still being
+	 *         written
+	 */
+	bool Checkpoint::save() NG_THROWS
+	{
+		vector<struct Checkpointable::Extent> extents;
+		vector<struct Checkpoint::Entry> entries;
+		struct Checkpoint::Header h;
+		uint64_t start = nanoseconds(CLOCK_MONOTONIC);
+		uint64_t offset = 0;
+		uint64_t bytes = 0;
+		int slot = 0;
+		pid_t pid = 0;
+
+		if (this->m_writer != 0 && !this->poll()) {
+			return false;
+		}
+		slot = this->m_newest == 0 ? 1 : 0;
+
+		try {
+			for (vector<struct Checkpoint::Component>::iterator i =
+				this->m_components.begin();
+				i != this->m_components.end(); ++i) {
+				size_t first = extents.size();
+
+				i->component->extents(extents);
+				for (size_t j = first; j < extents.size(); ++j) {
+					struct Checkpoint::Entry e;
+
+					memset(&e, 0, sizeof(e));
+					strncpy(e.name, i->name.c_str(),
+						sizeof(e.name) - 1);
+					e.index = j - first;
+					e.length = extents[j].length;
+					entries.push_back(e);
+				}
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		/* data follows the directory, extents 64-byte aligned */
+		offset = (Checkpoint::HEADER_SIZE + entries.size() *
+			sizeof(struct Checkpoint::Entry) +
+			Checkpoint::HEADER_SIZE - 1) &
+			~(uint64_t)(Checkpoint::HEADER_SIZE - 1);
+		for (vector<struct Checkpoint::Entry>::iterator i =
+			entries.begin(); i != entries.end(); ++i) {
+			i->offset = offset;
+			offset += (i->length + 63) & ~(uint64_t)63;
+			bytes += i->length;
+		}
+
+		memset(&h, 0, sizeof(h));
+		h.magic = Checkpoint::MAGIC;
+		h.version = Checkpoint::VERSION;
+		h.sequence = this->m_stats.sequence + 1;
+		h.size = offset;
+		h.entries = entries.size();
+		h.created_ns = nanoseconds(CLOCK_REALTIME);
+
+		if ((pid = fork()) < 0) {
+			throw Exception(strerror(errno));
+		}
+		if (pid == 0) {
+			_exit(Checkpoint::write(this->m_files[slot].c_str(), h,
+				entries.empty() ? NULL : &(entries[0]),
+				extents.empty() ? NULL : &(extents[0])));
+		}
+
+		this->m_writer = pid;
+		this->m_slot = slot;
+		this->m_stats.pause = (nanoseconds(CLOCK_MONOTONIC) - start) *
+			1e-9;
+		this->m_stats.bytes = bytes;
+		return true;
+	}
+
+	/*
+	 * collect a finished writer without waiting
+	 *
+	 * return: true if no checkpoint is being written any more
+	 */
+	bool Checkpoint::poll()
+	{
+		pid_t pid = 0;
+		int status = 0;
+
+		if (this->m_writer == 0) {
+			return true;
+		}
+		if ((pid = waitpid(this->m_writer, &status, WNOHANG)) == 0) {
+			return false;
+		}
+		this->finish(pid == this->m_writer ? status : -1);
+		return true;
+	}
+
+	/*
+	 * wait for a running writer to finish
+	 */
+	void Checkpoint::wait()
+	{
+		pid_t pid = 0;
+		int status = 0;
+
+		if (this->m_writer == 0) {
+			return;
+		}
+		while ((pid = waitpid(this->m_writer, &status, 0)) < 0 &&
+			errno == EINTR) {
+		}
+		this->finish(pid == this->m_writer ? status : -1);
+	}
+
+	/*
+	 * restore the registered components from the newest valid
+	 * snapshot, before capture starts; a component whose dimensions
+	 * changed keeps its state and is counted as refused
+	 *
+	 * return: true if a snapshot was restored, false if there is none
+	 */
+	bool Checkpoint::restore() NG_THROWS
+	{
+		struct Checkpoint::Header h[2];
+		bool valid[2];
+		uint64_t start = nanoseconds(CLOCK_MONOTONIC);
+		int first = 0;
+
+		if (this->m_writer != 0) {
+			throw Exception("a checkpoint is being written");
+		}
+
+		for (int i = 0; i < 2; ++i) {
+			valid[i] = Checkpoint::header(this->m_files[i].c_str(),
+				h[i]);
+		}
+		first = valid[1] && (!valid[0] ||
+			h[1].sequence > h[0].sequence) ? 1 : 0;
+
+		/* fall back to the older snapshot if the newer is damaged */
+		for (int i = 0; i < 2; ++i) {
+			int slot = i == 0 ? first : 1 - first;
+
+			if (valid[slot] && this->load(slot, h[slot])) {
+				this->m_newest = slot;
+				this->m_stats.sequence = h[slot].sequence;
+				this->m_stats.restore_time = (nanoseconds(
+					CLOCK_MONOTONIC) - start) * 1e-9;
+				return true;
+			}
+		}
+		this->m_stats.restore_time = (nanoseconds(CLOCK_MONOTONIC) -
+			start) * 1e-9;
+		return false;
+	}
+
+	/*
+	 * get the cost of checkpoints and restores
+	 *
+	 * return: the statistics
+	 */
+	const struct Checkpoint::Stats & Checkpoint::stats() const
+	{
+		return this->m_stats;
+	}
+
+	/*
+	 * account a writer that exited
+	 *
+	 * @status: wait status of the writer, -1 if it was lost
+	 */
+	void Checkpoint::finish(int status)
+	{
+		struct Checkpoint::Header h;
+
+		this->m_writer = 0;
+		if (status != -1 && WIFEXITED(status) &&
+			WEXITSTATUS(status) == 0 && Checkpoint::header(
+			this->m_files[this->m_slot].c_str(), h)) {
+			++this->m_stats.checkpoints;
+			this->m_stats.sequence = h.sequence;
+			this->m_stats.duration = h.duration_ns * 1e-9;
+			this->m_stats.written = h.written;
+			this->m_newest = this->m_slot;
+		} else {
+			++this->m_stats.failures;
+		}
+	}
+
+	/*
+	 * check a snapshot and restore the components from it
+	 *
+	 * @slot: file of the snapshot
+	 * @header: its header
+	 *
+	 * return: true if restored, false if the snapshot is damaged
+	 */
+	bool Checkpoint::load(int slot, const struct Checkpoint::Header & h)
+		NG_THROWS
+	{
+		const struct Checkpoint::Entry * entries = NULL;
+		const u_char * map = NULL;
+		struct stat st;
+		uint64_t restored = 0;
+		bool ok = true;
+		void * p = NULL;
+		int fd = -1;
+
+		if ((fd = open(this->m_files[slot].c_str(),
+			O_RDONLY | O_CLOEXEC)) < 0) {
+			return false;
+		}
+		if (fstat(fd, &st) < 0 || (uint64_t)st.st_size != h.size ||
+			h.entries > (h.size - Checkpoint::HEADER_SIZE) /
+			sizeof(struct Checkpoint::Entry)) {
+			close(fd);
+			return false;
+		}
+		p = mmap(NULL, h.size, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+			fd, 0);
+		close(fd);
+		if (p == MAP_FAILED) {
+			return false;
+		}
+		map = (const u_char *)p;
+		entries = (const struct Checkpoint::Entry *)(map +
+			Checkpoint::HEADER_SIZE);
+
+		/* check everything before touching any component */
+		ok = Hash::bytes(entries, h.entries *
+			sizeof(struct Checkpoint::Entry)) == h.hash;
+		for (uint64_t i = 0; ok && i < h.entries; ++i) {
+			const struct Checkpoint::Entry & e = entries[i];
+
+			ok = e.name[sizeof(e.name) - 1] == '\0' &&
+				e.offset <= h.size &&
+				e.length <= h.size - e.offset &&
+				Hash::bytes(map + e.offset, e.length) == e.hash;
+		}
+		if (!ok) {
+			munmap(p, h.size);
+			return false;
+		}
+
+		try {
+			for (vector<struct Checkpoint::Component>::iterator i =
+				this->m_components.begin();
+				i != this->m_components.end(); ++i) {
+				vector<struct Checkpointable::Extent> saved;
+				uint64_t bytes = 0;
+
+				for (uint64_t j = 0; j < h.entries; ++j) {
+					struct Checkpointable::Extent x;
+
+					if (strcmp(entries[j].name,
+						i->name.c_str()) != 0 ||
+						entries[j].index != saved.size()) {
+						continue;
+					}
+					x.data = map + entries[j].offset;
+					x.length = entries[j].length;
+					x.dimension = false;
+					saved.push_back(x);
+					bytes += x.length;
+				}
+				if (saved.empty()) {
+					continue;
+				}
+				try {
+					i->component->restore(saved);
+					restored += bytes;
+				} catch (Exception & e) {
+					++this->m_stats.refused;
+				}
+			}
+		} catch (bad_alloc & e) {
+			munmap(p, h.size);
+			throw Exception(e.what());
+		}
+		munmap(p, h.size);
+		this->m_stats.restored = restored;
+		return true;
+	}
+
+	/*
+	 * read the header of a complete snapshot
+	 *
+	 * @file: snapshot file
+	 * @header: receives the header
+	 *
+	 * return: true if the file holds a complete snapshot
+	 */
+	bool Checkpoint::header(const char * file,
+		struct Checkpoint::Header & header)
+	{
+		int fd = open(file, O_RDONLY | O_CLOEXEC);
+		ssize_t n = 0;
+
+		if (fd < 0) {
+			return false;
+		}
+		n = pread(fd, &header, sizeof(header), 0);
+		close(fd);
+		return n == (ssize_t)sizeof(header) &&
+			header.magic == Checkpoint::MAGIC &&
+			header.version == Checkpoint::VERSION &&
+			header.sequence != 0;
+	}
+
+	/*
+	 * write a snapshot, in the forked child; only blocks that differ
+	 * from the file are written, unless its layout changed
+	 *
+	 * @file: snapshot file
+	 * @h: header, completed here
+	 * @entries: directory, hashes filled in here
+	 * @extents: data of the entries
+	 *
+	 * return: exit status, 0 on success
+	 */
+	int Checkpoint::write(const char * file, struct Checkpoint::Header & h,
+		struct Checkpoint::Entry * entries,
+		const struct Checkpointable::Extent * extents)
+	{
+		uint64_t start = nanoseconds(CLOCK_MONOTONIC);
+		struct Checkpoint::Header * old = NULL;
+		struct stat st;
+		u_char * map = NULL;
+		void * p = NULL;
+		bool fresh = false;
+		int fd = -1;
+
+		if ((fd = open(file, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0) {
+			return 1;
+		}
+		if (fstat(fd, &st) < 0) {
+			close(fd);
+			return 1;
+		}
+		fresh = (uint64_t)st.st_size != h.size;
+		if (fresh && (ftruncate(fd, 0) < 0 ||
+			ftruncate(fd, h.size) < 0)) {
+			close(fd);
+			return 1;
+		}
+		p = mmap(NULL, h.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+			0);
+		close(fd);
+		if (p == MAP_FAILED) {
+			return 1;
+		}
+		map = (u_char *)p;
+		old = (struct Checkpoint::Header *)map;
+
+		/* blocks are only comparable within the same layout */
+		if (!fresh) {
+			const struct Checkpoint::Entry * e =
+				(const struct Checkpoint::Entry *)(map +
+				Checkpoint::HEADER_SIZE);
+			size_t layout = offsetof(struct Checkpoint::Entry, hash);
+
+			fresh = old->magic != Checkpoint::MAGIC ||
+				old->version != Checkpoint::VERSION ||
+				old->entries != h.entries;
+			for (uint64_t i = 0; !fresh && i < h.entries; ++i) {
+				fresh = memcmp(&(e[i]), &(entries[i]), layout) != 0;
+			}
+		}
+
+		/* invalid until complete */
+		old->sequence = 0;
+		if (msync(map, Checkpoint::HEADER_SIZE, MS_SYNC) < 0) {
+			munmap(p, h.size);
+			return 1;
+		}
+
+		for (uint64_t i = 0; i < h.entries; ++i) {
+			const u_char * src = (const u_char *)extents[i].data;
+			u_char * dst = map + entries[i].offset;
+			uint64_t length = entries[i].length;
+
+			uint64_t block = Checkpoint::BLOCK;
+
+			for (uint64_t o = 0; o < length; o += block) {
+				size_t n = length - o < block ? length - o : block;
+
+				if (fresh || memcmp(dst + o, src + o, n) != 0) {
+					memcpy(dst + o, src + o, n);
+					h.written += n;
+				}
+			}
+			entries[i].hash = Hash::bytes(src, length);
+		}
+		memcpy(map + Checkpoint::HEADER_SIZE, entries,
+			h.entries * sizeof(struct Checkpoint::Entry));
+		if (msync(map, h.size, MS_SYNC) < 0) {
+			munmap(p, h.size);
+			return 1;
+		}
+
+		h.hash = Hash::bytes(entries, h.entries *
+			sizeof(struct Checkpoint::Entry));
+		h.duration_ns = nanoseconds(CLOCK_MONOTONIC) - start;
+		memcpy(map, &h, sizeof(h));
+		if (msync(map, Checkpoint::HEADER_SIZE, MS_SYNC) < 0) {
+			munmap(p, h.size);
+			return 1;
+		}
+		munmap(p, h.size);
+		return 0;
+	}
+}
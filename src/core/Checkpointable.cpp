@@ -0,0 +1,48 @@
+/*
+ * implementation of class Checkpointable
+ */
+
+#include <vector>	/* for std::vector */
+#include <cstring>	/* for std::memcmp and std::memcpy */
+#include <stddef.h>	/* for size_t */
+
+#include "core/Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "core/Exception.h"		/* for netgazer::Exception */
+
+using std::vector;
+using std::memcmp;
+using std::memcpy;
+
+namespace netgazer {
+	/*
+	 * replace the state by a saved one; a snapshot of other dimensions
+	 * is refused and the state is left as it was
+	 *
+	 * @saved: the extents saved, valid during the call only
+	 */
+	void Checkpointable::restore(
+		const vector<struct Checkpointable::Extent> & saved)
+		NG_THROWS
+	{
+		vector<struct Checkpointable::Extent> current;
+
+		this->extents(current);
+		if (saved.size() != current.size()) {
+			throw Exception("snapshot dimensions differ");
+		}
+		for (size_t i = 0; i < current.size(); ++i) {
+			if (saved[i].length != current[i].length ||
+				(current[i].dimension && memcmp(saved[i].data,
+				current[i].data, current[i].length) != 0)) {
+				throw Exception("snapshot dimensions differ");
+			}
+		}
+
+		for (size_t i = 0; i < current.size(); ++i) {
+			if (!current[i].dimension) {
+				memcpy((void *)current[i].data, saved[i].data,
+					current[i].length);
+			}
+		}
+	}
+}
@@ -0,0 +1,353 @@
+/*
+ * implementation of class Deduplicator
+ */
+
+#include <new>		/* for std::bad_alloc */
+#include <cmath>	/* for std::log, std::exp, std::sqrt and std::pow */
+#include <cstring>	/* for std::memset and std::memcpy */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for struct timespec */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/Deduplicator.h"	/* for netgazer::Deduplicator */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/Packet.h"	/* for netgazer::Packet */
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+#include "core/Hash.h"		/* for netgazer::Hash */
+
+using std::bad_alloc;
+using std::log;
+using std::exp;
+using std::sqrt;
+using std::pow;
+using std::memset;
+using std::memcpy;
+
+namespace netgazer {
+	/* bits per filter block, one cache line */
+	static const unsigned BLOCK_BITS = 512;
+	/* network layer bytes hashed into a fingerprint */
+	static const size_t FINGERPRINT_BYTES = 64;
+	/* bounds of the number of bits set per packet */
+	static const unsigned MAX_HASHES = 16;
+
+	/*
+	 * constructor of Deduplicator
+	 *
+	 * @window_ns: time within which a second copy is a duplicate
+	 * @memory_limit: memory budget of the filters in bytes
+	 * @expected_pps: packet rate the number of hashes is tuned for
+	 * @generations: number of filters in the ring, at least 2; more
+	 *               filters expire fingerprints closer to the window
+	 */
+	Deduplicator::Deduplicator(uint64_t window_ns, size_t memory_limit,
+		uint64_t expected_pps, unsigned generations) NG_THROWS
+	{
+		size_t block_bytes = BLOCK_BITS / 8;
+		double per_filter = 0;
+		double bits = 0;
+		unsigned k = 0;
+
+		if (window_ns == 0) {
+			throw Exception("window is zero");
+		}
+		if (generations < 2) {
+			throw Exception("at least two generations are needed");
+		}
+		if (memory_limit < generations * block_bytes) {
+			throw Exception("memory limit too small");
+		}
+
+		/* the older filters together always cover the window */
+		this->m_generations = generations;
+		this->m_span_ns = window_ns / (generations - 1);
+		if (this->m_span_ns == 0) {
+			this->m_span_ns = 1;
+		}
+		this->m_blocks = 1;
+		while (this->m_blocks * 2 * generations * block_bytes <=
+			memory_limit) {
+			this->m_blocks *= 2;
+		}
+
+		/* optimal k for the packets one filter is expected to hold */
+		per_filter = (double)expected_pps * this->m_span_ns / 1e9;
+		bits = (double)this->m_blocks * BLOCK_BITS;
+		k = per_filter < 1 ? MAX_HASHES :
+			(unsigned)(bits / per_filter * log(2.0) + 0.5);
+		this->m_hashes = k < 1 ? 1 : (k > MAX_HASHES ? MAX_HASHES : k);
+
+		this->m_bits = NULL;
+		try {
+			this->m_bits = new uint64_t[this->m_blocks * generations *
+				(BLOCK_BITS / 64)];
+			this->m_set = new uint64_t[generations * 2];
+		} catch (bad_alloc & e) {
+			delete[] this->m_bits;
+			throw Exception(e.what());
+		}
+		this->m_inserted = this->m_set + generations;
+		this->clear();
+	}
+
+	/*
+	 * destructor of Deduplicator
+	 */
+	Deduplicator::~Deduplicator()
+	{
+		delete[] this->m_bits;
+		delete[] this->m_set;
+	}
+
+	/*
+	 * check a packet and remember it
+	 *
+	 * @packet: the packet
+	 *
+	 * return: true if a copy was seen within the window
+	 */
+	bool Deduplicator::duplicate(const Packet * packet) NG_THROWS
+	{
+		struct timespec ts = packet->preciseTimestamp();
+
+		return this->duplicate((uint64_t)ts.tv_sec * 1000000000ULL +
+			ts.tv_nsec, packet->data(), packet->capturedLength(),
+			(uint32_t)packet->length());
+	}
+
+	/*
+	 * check a frame and remember it
+	 *
+	 * @ts_ns: timestamp in nanoseconds since the epoch
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @length: original length of the frame
+	 *
+	 * return: true if a copy was seen within the window
+	 */
+	bool Deduplicator::duplicate(uint64_t ts_ns, const u_char * data,
+		size_t caplen, uint32_t length)
+	{
+		return this->check(ts_ns,
+			Deduplicator::fingerprint(data, caplen, length));
+	}
+
+	/*
+	 * check a fingerprint and remember it, the filters turn as the
+	 * timestamps advance
+	 *
+	 * @ts_ns: timestamp in nanoseconds since the epoch
+	 * @fingerprint: fingerprint of the packet
+	 *
+	 * return: true if the fingerprint was seen within the window
+	 */
+	bool Deduplicator::check(uint64_t ts_ns, uint64_t fingerprint)
+	{
+		const size_t words = BLOCK_BITS / 64;
+		uint64_t h = 0;
+		size_t block = (size_t)(fingerprint & (this->m_blocks - 1));
+		uint64_t masks[BLOCK_BITS / 64];
+		uint64_t * current = NULL;
+
+		if (ts_ns >= this->m_rotate_ns) {
+			this->rotate(ts_ns);
+		}
+		++this->m_packets;
+
+		memset(masks, 0, sizeof(masks));
+		/* independent 9-bit positions, seven per mixed word */
+		for (unsigned i = 0; i < this->m_hashes; ++i) {
+			unsigned bit = 0;
+
+			if (i % 7 == 0) {
+				h = Hash::mix64(fingerprint + i);
+			}
+			bit = (unsigned)(h % BLOCK_BITS);
+			h /= BLOCK_BITS;
+			masks[bit / 64] |= (uint64_t)1 << (bit % 64);
+		}
+
+		/* seen if all bits are set in any filter */
+		for (unsigned g = 0; g < this->m_generations; ++g) {
+			const uint64_t * b = this->m_bits +
+				(g * this->m_blocks + block) * words;
+			bool all = true;
+
+			for (size_t w = 0; w < words && all; ++w) {
+				all = (b[w] & masks[w]) == masks[w];
+			}
+			if (all) {
+				++this->m_duplicates;
+				return true;
+			}
+		}
+
+		current = this->m_bits +
+			(this->m_current * this->m_blocks + block) * words;
+		for (size_t w = 0; w < words; ++w) {
+			this->m_set[this->m_current] +=
+				__builtin_popcountll(masks[w] & ~current[w]);
+			current[w] |= masks[w];
+		}
+		++this->m_inserted[this->m_current];
+		return false;
+	}
+
+	/*
+	 * estimate the probability that a new packet is taken for a
+	 * duplicate; fingerprints spread over the blocks of a filter as a
+	 * Poisson process, and a block holding j of them has its bits set
+	 * independently with probability 1 - (1 - 1/512)^(j k)
+	 *
+	 * return: false positive rate
+	 */
+	double Deduplicator::falsePositiveRate() const
+	{
+		double miss = 1;
+
+		for (unsigned g = 0; g < this->m_generations; ++g) {
+			double lambda = (double)this->m_inserted[g] / this->m_blocks;
+			double p = exp(-lambda);	/* P(load = j) */
+			double fp = 0;
+			unsigned limit = (unsigned)(lambda + 10 * sqrt(lambda)) + 10;
+
+			for (unsigned j = 0; j <= limit; ++j) {
+				double bit = 1 - pow(1 - 1.0 / BLOCK_BITS,
+					(double)j * this->m_hashes);
+
+				fp += p * pow(bit, (double)this->m_hashes);
+				p *= lambda / (j + 1);
+			}
+			miss *= 1 - (fp < 1 ? fp : 1);
+		}
+		return 1 - miss;
+	}
+
+	/*
+	 * get the counters and filter state
+	 *
+	 * return: statistics
+	 */
+	struct Deduplicator::Statistics Deduplicator::statistics() const
+	{
+		struct Deduplicator::Statistics s;
+
+		s.packets = this->m_packets;
+		s.duplicates = this->m_duplicates;
+		s.rotations = this->m_rotations;
+		s.fill = this->m_set[this->m_current] /
+			((double)this->m_blocks * BLOCK_BITS);
+		s.false_positive_rate = this->falsePositiveRate();
+		return s;
+	}
+
+	/*
+	 * forget every fingerprint and reset the counters
+	 */
+	void Deduplicator::clear()
+	{
+		memset(this->m_bits, 0, this->m_blocks * this->m_generations *
+			BLOCK_BITS / 8);
+		memset(this->m_set, 0, this->m_generations * 2 *
+			sizeof(uint64_t));
+		this->m_current = 0;
+		this->m_rotate_ns = 0;
+		this->m_packets = 0;
+		this->m_duplicates = 0;
+		this->m_rotations = 0;
+	}
+
+	/*
+	 * get the number of bits set per packet
+	 *
+	 * return: number of hashes
+	 */
+	unsigned Deduplicator::hashes() const
+	{
+		return this->m_hashes;
+	}
+
+	/*
+	 * get the memory used by the filters
+	 *
+	 * return: memory used in bytes
+	 */
+	size_t Deduplicator::memory() const
+	{
+		return sizeof(*this) + this->m_blocks * this->m_generations *
+			BLOCK_BITS / 8 + this->m_generations * 2 * sizeof(uint64_t);
+	}
+
+	/*
+	 * fingerprint the invariant bytes of a frame: the original length
+	 * and the first bytes from the network layer on, with the IPv4 TTL
+	 * and header checksum zeroed
+	 *
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @length: original length of the frame
+	 *
+	 * return: 64-bit fingerprint
+	 */
+	uint64_t Deduplicator::fingerprint(const u_char * data, size_t caplen,
+		uint32_t length)
+	{
+		struct Dissector::Dissection d;
+		u_char bytes[FINGERPRINT_BYTES];
+		size_t n = 0;
+
+		Dissector::dissect(data, caplen, d);
+		if (d.l3_offset == 0 || d.l3_offset >= caplen) {
+			return Hash::bytes(data, caplen < FINGERPRINT_BYTES ?
+				caplen : FINGERPRINT_BYTES, length);
+		}
+
+		/* an IPv4 header is complete if HAS_IPV4 is set */
+		n = caplen - d.l3_offset;
+		if (n > FINGERPRINT_BYTES) {
+			n = FINGERPRINT_BYTES;
+		}
+		memcpy(bytes, data + d.l3_offset, n);
+		if (d.flags & Dissector::HAS_IPV4) {
+			bytes[8] = 0;
+			bytes[10] = 0;
+			bytes[11] = 0;
+		}
+		/* the link header length is not part of the packet */
+		return Hash::bytes(bytes, n, length - d.l3_offset);
+	}
+
+	/*
+	 * turn the ring, clearing the oldest filter for the current one
+	 *
+	 * @ts_ns: timestamp that reached the end of the current filter
+	 */
+	void Deduplicator::rotate(uint64_t ts_ns)
+	{
+		const size_t words = BLOCK_BITS / 64;
+		uint64_t gap = 0;
+		unsigned turns = 0;
+
+		if (this->m_rotate_ns == 0) {
+			/* first packet */
+			this->m_rotate_ns = ts_ns + this->m_span_ns;
+			return;
+		}
+
+		/* after a long gap every filter is stale */
+		gap = (ts_ns - this->m_rotate_ns) / this->m_span_ns;
+		turns = gap + 1 < this->m_generations ? (unsigned)gap + 1 :
+			this->m_generations;
+		for (unsigned i = 0; i < turns; ++i) {
+			this->m_current = (this->m_current + 1) %
+				this->m_generations;
+			memset(this->m_bits + this->m_current * this->m_blocks *
+				words, 0, this->m_blocks * BLOCK_BITS / 8);
+			this->m_set[this->m_current] = 0;
+			this->m_inserted[this->m_current] = 0;
+			++this->m_rotations;
+		}
+		this->m_rotate_ns = ts_ns + this->m_span_ns;
+	}
+}
@@ -0,0 +1,168 @@
+/*
+ * implementation of class Dissector
+ */
+
+#include <cstring>	/* for std::memset and std::memcpy */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+
+using std::memset;
+using std::memcpy;
+
+namespace netgazer {
+	/*
+	 * read a 16-bit big endian value
+	 *
+	 * @p: pointer to the value
+	 *
+	 * return: value in host order
+	 */
+	static inline uint16_t be16(const u_char * p)
+	{
+		return (uint16_t)((p[0] << 8) | p[1]);
+	}
+
+	/*
+	 * read a 32-bit big endian value
+	 *
+	 * @p: pointer to the value
+	 *
+	 * return: value in host order
+	 */
+	static inline uint32_t be32(const u_char * p)
+	{
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+			((uint32_t)p[2] << 8) | p[3];
+	}
+
+	/*
+	 * dissect the Ethernet, IPv4 and TCP/UDP headers of a frame in a
+	 * single bounds-checked pass, never reading past caplen
+	 *
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @d: dissection to fill in
+	 */
+	void Dissector::dissect(const u_char * data, size_t caplen,
+		struct Dissector::Dissection & d)
+	{
+		size_t off = 12;
+		size_t ihl = 0;
+
+		memset(&d, 0, sizeof(d));
+
+		/* Ethernet header, skipping any 802.1Q/802.1ad tags */
+		if (caplen < 14) {
+			d.flags |= Dissector::TRUNCATED;
+			return;
+		}
+		d.ether_type = be16(data + off);
+		while (d.ether_type == 0x8100 || d.ether_type == 0x88a8) {
+			off += 4;
+			if (off + 2 > caplen) {
+				d.flags |= Dissector::TRUNCATED;
+				return;
+			}
+			d.ether_type = be16(data + off);
+		}
+		off += 2;
+		d.l3_offset = (uint16_t)off;
+		d.l4_offset = (uint16_t)off;
+		d.payload_offset = (uint16_t)off;
+
+		/* IPv4 header */
+		if (d.ether_type != 0x0800) {
+			return;
+		}
+		if (off + 20 > caplen || (data[off] >> 4) != 4) {
+			d.flags |= Dissector::TRUNCATED;
+			return;
+		}
+		ihl = (data[off] & 0x0f) * 4;
+		if (ihl < 20) {
+			return;
+		}
+		d.flags |= Dissector::HAS_IPV4;
+		d.protocol = data[off + 9];
+		memcpy(&(d.src_addr), data + off + 12, 4);
+		memcpy(&(d.dest_addr), data + off + 16, 4);
+		if ((be16(data + off + 6) & 0x1fff) != 0) {
+			/* only the first fragment carries the L4 header */
+			d.flags |= Dissector::FRAGMENT;
+			return;
+		}
+		off += ihl;
+		d.l4_offset = (uint16_t)off;
+		d.payload_offset = (uint16_t)off;
+
+		/* TCP or UDP header */
+		switch (d.protocol) {
+		case 6:
+			if (off + 20 > caplen) {
+				d.flags |= Dissector::TRUNCATED;
+				return;
+			}
+			d.seq = be32(data + off + 4);
+			d.ack = be32(data + off + 8);
+			d.tcp_flags = data[off + 13];
+			d.window = be16(data + off + 14);
+			d.payload_offset = (uint16_t)(off +
+				(data[off + 12] >> 4) * 4);
+			break;
+
+		case 17:
+			if (off + 8 > caplen) {
+				d.flags |= Dissector::TRUNCATED;
+				return;
+			}
+			d.payload_offset = (uint16_t)(off + 8);
+			break;
+
+		default:
+			return;
+		}
+		d.src_port = be16(data + off);
+		d.dest_port = be16(data + off + 2);
+		d.flags |= Dissector::HAS_PORTS;
+		if (d.payload_offset > caplen) {
+			d.flags |= Dissector::TRUNCATED;
+		}
+	}
+
+	/*
+	 * get the number of captured L4 payload bytes of a dissected frame,
+	 * excluding Ethernet padding beyond the IPv4 and UDP lengths
+	 *
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @d: dissection of the frame
+	 *
+	 * return: payload bytes starting at d.payload_offset, 0 if the frame
+	 *         has no TCP or UDP payload
+	 */
+	size_t Dissector::payloadLength(const u_char * data, size_t caplen,
+		const struct Dissector::Dissection & d)
+	{
+		size_t end = caplen;
+
+		if (!(d.flags & Dissector::HAS_PORTS) ||
+			(d.flags & Dissector::TRUNCATED) ||
+			d.payload_offset >= caplen) {
+			return 0;
+		}
+
+		/* the IPv4 total length bounds the datagram */
+		if ((size_t)d.l3_offset + be16(data + d.l3_offset + 2) < end) {
+			end = d.l3_offset + be16(data + d.l3_offset + 2);
+		}
+		/* and the UDP length the UDP payload */
+		if (d.protocol == 17 &&
+			(size_t)d.l4_offset + be16(data + d.l4_offset + 4) < end) {
+			end = d.l4_offset + be16(data + d.l4_offset + 4);
+		}
+		return end > d.payload_offset ? end - d.payload_offset : 0;
+	}
+}
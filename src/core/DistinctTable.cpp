@@ -0,0 +1,409 @@
+/*
+ * implementation of class DistinctTable
+ */
+
+#include <vector>	/* for std::vector */
+#include <utility>	/* for std::pair and std::make_pair */
+#include <algorithm>	/* for std::sort */
+#include <new>		/* for std::bad_alloc */
+#include <cstring>	/* for std::memset */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <arpa/inet.h>	/* for ntohl */
+
+#include "core/DistinctTable.h"	/* for netgazer::DistinctTable */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/HyperLogLog.h"	/* for netgazer::HyperLogLog */
+#include "core/Hash.h"		/* for netgazer::Hash */
+#include "core/Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+using std::vector;
+using std::pair;
+using std::make_pair;
+using std::sort;
+using std::bad_alloc;
+using std::memset;
+
+namespace netgazer {
+	/*
+	 * extract a field of a summary record
+	 *
+	 * @s: summary record
+	 * @field: field to extract
+	 *
+	 * return: addresses in host order or ports
+	 */
+	static inline uint32_t fieldOf(const struct PacketSummary & s,
+		enum DistinctTable::Field field)
+	{
+		switch (field) {
+		case DistinctTable::SRC_ADDR:
+			return ntohl(s.src_addr);
+		case DistinctTable::DEST_ADDR:
+			return ntohl(s.dest_addr);
+		case DistinctTable::SRC_PORT:
+			return s.src_port;
+		default:
+			return s.dest_port;
+		}
+	}
+
+	/*
+	 * order keys by descending estimate
+	 */
+	static bool larger(const pair<uint32_t, double> & a,
+		const pair<uint32_t, double> & b)
+	{
+		return a.second > b.second;
+	}
+
+	/*
+	 * constructor of DistinctTable
+	 *
+	 * @key: field the estimators are keyed by
+	 * @prefix: prefix length applied to address keys, e.g. 24
+	 * @item: field whose distinct values are counted
+	 * @memory_limit: memory budget in bytes for both windows
+	 * @precision: index bits of each estimator
+	 */
+	DistinctTable::DistinctTable(enum DistinctTable::Field key,
+		unsigned prefix, enum DistinctTable::Field item,
+		size_t memory_limit, unsigned precision) NG_THROWS
+	{
+		size_t m = 0;
+		size_t slot_cost = 0;
+		size_t slots = 4;
+
+		if (precision < 4 || precision > 16) {
+			throw Exception("precision out of range");
+		}
+		if (prefix > 32) {
+			throw Exception("prefix out of range");
+		}
+		m = (size_t)1 << precision;
+		slot_cost = m + sizeof(uint32_t) + 1;
+
+		/* the largest power of two of slots fitting both windows, at
+		 * least four so that a quarter of them always stays free */
+		while (2 * (slots * 2 * slot_cost + m) <= memory_limit) {
+			slots *= 2;
+		}
+		if (2 * (slots * slot_cost + m) > memory_limit) {
+			throw Exception("memory limit too small");
+		}
+
+		this->m_key = key;
+		this->m_item = item;
+		this->m_mask = (key == DistinctTable::SRC_ADDR ||
+			key == DistinctTable::DEST_ADDR) && prefix < 32 ?
+			~(0xffffffffU >> prefix) : 0xffffffffU;
+		this->m_precision = precision;
+		this->m_slots = slots;
+		this->m_max_keys = slots * 3 / 4;
+		this->m_current = 0;
+		memset(this->m_generations, 0, sizeof(this->m_generations));
+
+		for (int i = 0; i < 2; ++i) {
+			struct Generation & g = this->m_generations[i];
+
+			try {
+				g.keys = new uint32_t[slots];
+				g.used = new uint8_t[slots];
+				g.registers = new uint8_t[slots * m];
+				g.overflow = new uint8_t[m];
+			} catch (bad_alloc & e) {
+				for (int j = 0; j <= i; ++j) {
+					delete[] this->m_generations[j].keys;
+					delete[] this->m_generations[j].used;
+					delete[] this->m_generations[j].registers;
+					delete[] this->m_generations[j].overflow;
+				}
+				throw Exception(e.what());
+			}
+			this->reset(g);
+		}
+		this->charge(this->memory());
+	}
+
+	/*
+	 * destructor of DistinctTable
+	 */
+	DistinctTable::~DistinctTable()
+	{
+		this->release(this->memory());
+		for (int i = 0; i < 2; ++i) {
+			delete[] this->m_generations[i].keys;
+			delete[] this->m_generations[i].used;
+			delete[] this->m_generations[i].registers;
+			delete[] this->m_generations[i].overflow;
+		}
+	}
+
+	/*
+	 * account a packet in the current window
+	 *
+	 * @s: summary record of the packet
+	 */
+	void DistinctTable::add(const struct PacketSummary & s)
+	{
+		struct Generation & g = this->m_generations[this->m_current];
+		uint32_t key = 0;
+		uint64_t hash = 0;
+		uint8_t * registers = NULL;
+		size_t i = 0;
+		size_t probes = 0;
+
+		/* address fields need IPv4, port fields TCP or UDP */
+		if (!(s.flags & PacketSummary::IPV4) ||
+			((this->m_key >= DistinctTable::SRC_PORT ||
+			this->m_item >= DistinctTable::SRC_PORT) &&
+			!(s.flags & PacketSummary::PORTS))) {
+			return;
+		}
+		key = fieldOf(s, this->m_key) & this->m_mask;
+		hash = Hash::mix64(fieldOf(s, this->m_item) ^
+			((uint64_t)this->m_item << 32));
+
+		/* find or claim the slot of the key */
+		i = Hash::mix64(key) & (this->m_slots - 1);
+		while (g.used[i] && g.keys[i] != key &&
+			++probes < this->m_slots) {
+			i = (i + 1) & (this->m_slots - 1);
+		}
+		if (g.used[i] && g.keys[i] == key) {
+			registers = g.registers + (i << this->m_precision);
+		} else if (!g.used[i] && g.size < this->m_max_keys) {
+			g.used[i] = 1;
+			g.keys[i] = key;
+			++g.size;
+			registers = g.registers + (i << this->m_precision);
+		} else {
+			registers = g.overflow;
+			++g.overflowed;
+		}
+
+		HyperLogLog::add(registers, this->m_precision, hash);
+	}
+
+	/*
+	 * estimate the number of distinct items seen with a key
+	 *
+	 * @key: key in host order, already masked by the prefix
+	 * @previous: whether to query the previous window
+	 *
+	 * return: estimated cardinality, 0 if the key was not seen
+	 */
+	double DistinctTable::estimate(uint32_t key, bool previous) const
+	{
+		const struct Generation & g =
+			this->m_generations[this->m_current ^ previous];
+		long i = this->find(g, key);
+
+		if (i < 0) {
+			return 0.0;
+		}
+		return HyperLogLog::estimate(g.registers +
+			((size_t)i << this->m_precision), this->m_precision);
+	}
+
+	/*
+	 * estimate the number of distinct items over all keys that did not
+	 * fit in the table
+	 *
+	 * @previous: whether to query the previous window
+	 *
+	 * return: estimated cardinality
+	 */
+	double DistinctTable::overflowEstimate(bool previous) const
+	{
+		const struct Generation & g =
+			this->m_generations[this->m_current ^ previous];
+
+		if (g.overflowed == 0) {
+			return 0.0;
+		}
+		return HyperLogLog::estimate(g.overflow, this->m_precision);
+	}
+
+	/*
+	 * get the keys with the most distinct items, e.g. scan sources
+	 *
+	 * @n: maximum number of keys
+	 * @previous: whether to query the previous window
+	 *
+	 * return: at most n keys and estimates by descending estimate
+	 */
+	vector<pair<uint32_t, double> > DistinctTable::top(size_t n,
+		bool previous) const NG_THROWS
+	{
+		const struct Generation & g =
+			this->m_generations[this->m_current ^ previous];
+		vector<pair<uint32_t, double> > keys;
+
+		try {
+			keys.reserve(g.size);
+			for (size_t i = 0; i < this->m_slots; ++i) {
+				if (!g.used[i]) {
+					continue;
+				}
+				keys.push_back(make_pair(g.keys[i],
+					HyperLogLog::estimate(g.registers +
+					(i << this->m_precision),
+					this->m_precision)));
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		sort(keys.begin(), keys.end(), larger);
+		if (keys.size() > n) {
+			keys.resize(n);
+		}
+		return keys;
+	}
+
+	/*
+	 * close the current window: it becomes the previous one and the
+	 * window before it is cleared for reuse
+	 */
+	void DistinctTable::rotate()
+	{
+		this->m_current ^= 1;
+		this->reset(this->m_generations[this->m_current]);
+	}
+
+	/*
+	 * get the number of keys in the current window
+	 *
+	 * return: number of keys
+	 */
+	size_t DistinctTable::size() const
+	{
+		return this->m_generations[this->m_current].size;
+	}
+
+	/*
+	 * get the maximum number of keys per window
+	 *
+	 * return: number of keys
+	 */
+	size_t DistinctTable::capacity() const
+	{
+		return this->m_max_keys;
+	}
+
+	/*
+	 * get the number of packets in the current window whose key did not
+	 * fit in the table
+	 *
+	 * return: number of packets
+	 */
+	uint64_t DistinctTable::overflowed() const
+	{
+		return this->m_generations[this->m_current].overflowed;
+	}
+
+	/*
+	 * get the memory used, which is fixed at construction
+	 *
+	 * return: memory used in bytes
+	 */
+	size_t DistinctTable::memory() const
+	{
+		size_t m = (size_t)1 << this->m_precision;
+
+		return sizeof(*this) + 2 * (this->m_slots *
+			(m + sizeof(uint32_t) + 1) + m);
+	}
+
+	/*
+	 * give memory back, the windows are allocated once so none is
+	 *
+	 * @bytes: amount of memory asked back
+	 *
+	 * return: 0
+	 */
+	size_t DistinctTable::shed(size_t /* bytes */)
+	{
+		return 0;
+	}
+
+	/*
+	 * describe the state for a Checkpoint
+	 *
+	 * @extents: the extents are appended to it
+	 */
+	void DistinctTable::extents(
+		vector<struct Checkpointable::Extent> & extents) const
+		NG_THROWS
+	{
+		size_t m = (size_t)1 << this->m_precision;
+		struct Checkpointable::Extent x[] = {
+			{ &(this->m_key), sizeof(this->m_key), true },
+			{ &(this->m_item), sizeof(this->m_item), true },
+			{ &(this->m_mask), sizeof(this->m_mask), true },
+			{ &(this->m_precision), sizeof(this->m_precision), true },
+			{ &(this->m_slots), sizeof(this->m_slots), true },
+			{ &(this->m_current), sizeof(this->m_current), false },
+		};
+
+		try {
+			extents.insert(extents.end(), x, x + 6);
+			for (int i = 0; i < 2; ++i) {
+				const struct Generation & g = this->m_generations[i];
+				struct Checkpointable::Extent y[] = {
+					{ g.keys, this->m_slots * sizeof(uint32_t),
+						false },
+					{ g.used, this->m_slots, false },
+					{ g.registers, this->m_slots * m, false },
+					{ g.overflow, m, false },
+					{ &(g.size), sizeof(g.size), false },
+					{ &(g.overflowed), sizeof(g.overflowed),
+						false },
+				};
+
+				extents.insert(extents.end(), y, y + 6);
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * look up the slot of a key
+	 *
+	 * @g: window to search
+	 * @key: the key
+	 *
+	 * return: slot index, -1 if the key is not indexed
+	 */
+	long DistinctTable::find(const struct DistinctTable::Generation & g,
+		uint32_t key) const
+	{
+		size_t i = Hash::mix64(key) & (this->m_slots - 1);
+
+		for (size_t n = 0; n < this->m_slots && g.used[i]; ++n) {
+			if (g.keys[i] == key) {
+				return (long)i;
+			}
+			i = (i + 1) & (this->m_slots - 1);
+		}
+		return -1;
+	}
+
+	/*
+	 * clear a window
+	 *
+	 * @g: window to clear
+	 */
+	void DistinctTable::reset(struct DistinctTable::Generation & g)
+	{
+		memset(g.used, 0, this->m_slots);
+		memset(g.registers, 0, this->m_slots << this->m_precision);
+		memset(g.overflow, 0, (size_t)1 << this->m_precision);
+		g.size = 0;
+		g.overflowed = 0;
+	}
+}
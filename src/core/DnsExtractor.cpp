@@ -0,0 +1,222 @@
+/*
+ * implementation of class DnsExtractor
+ */
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/DnsExtractor.h"	/* for netgazer::DnsExtractor */
+#include "core/ByteCursor.h"	/* for netgazer::ByteCursor */
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+
+namespace netgazer {
+	/* compression pointers followed per name before giving up */
+	static const int MAX_JUMPS = 16;
+
+	/*
+	 * extract the metadata of a DNS message
+	 *
+	 * @payload: DNS message
+	 * @length: length of the message
+	 * @r: record to fill in
+	 *
+	 * return: true if a question was parsed, false if the payload is not
+	 *         a well-formed DNS message
+	 */
+	bool DnsExtractor::extract(const u_char * payload, size_t length,
+		struct DnsExtractor::Record & r)
+	{
+		ByteCursor c(payload, length);
+		uint16_t bits = 0;
+		uint16_t questions = 0;
+		uint16_t authorities = 0;
+		uint16_t additionals = 0;
+		bool truncated = false;
+
+		c.u16(r.id);
+		c.u16(bits);
+		c.u16(questions);
+		c.u16(r.answer_count);
+		c.u16(authorities);
+		c.u16(additionals);
+		if (!c.ok() || questions == 0) {
+			return false;
+		}
+
+		r.opcode = (bits >> 11) & 0x0f;
+		r.rcode = bits & 0x0f;
+		r.flags = 0;
+		if (bits & 0x8000) {
+			r.flags |= DnsExtractor::RESPONSE;
+		}
+		if (bits & 0x0400) {
+			r.flags |= DnsExtractor::AUTHORITATIVE;
+		}
+		if (bits & 0x0200) {
+			r.flags |= DnsExtractor::TRUNCATED;
+		}
+		r.address_count = 0;
+
+		/* the first question */
+		if (!DnsExtractor::name(c, r.name, &(r.name_length),
+			&truncated) || !c.u16(r.qtype) || !c.u16(r.qclass)) {
+			return false;
+		}
+		if (truncated) {
+			r.flags |= DnsExtractor::NAME_TRUNCATED;
+		}
+		if (!(r.flags & DnsExtractor::RESPONSE)) {
+			return true;
+		}
+
+		/* skip the other questions */
+		for (uint16_t i = 1; i < questions; ++i) {
+			if (!DnsExtractor::name(c, NULL, NULL, NULL) ||
+				!c.skip(4)) {
+				return true;
+			}
+		}
+
+		/* collect A records of the answers, e.g. behind CNAMEs */
+		for (uint16_t i = 0; i < r.answer_count &&
+			r.address_count < DnsExtractor::MAX_ADDRESSES; ++i) {
+			uint16_t type = 0;
+			uint16_t cls = 0;
+			uint16_t rdlength = 0;
+			uint32_t ttl = 0;
+			const u_char * rdata = NULL;
+
+			if (!DnsExtractor::name(c, NULL, NULL, NULL) ||
+				!c.u16(type) || !c.u16(cls) || !c.u32(ttl) ||
+				!c.u16(rdlength) || !c.bytes(rdlength, &rdata)) {
+				break;
+			}
+			if (type == 1 && cls == 1 && rdlength == 4) {
+				uint32_t addr = 0;
+
+				/* keep network order */
+				((u_char *)&addr)[0] = rdata[0];
+				((u_char *)&addr)[1] = rdata[1];
+				((u_char *)&addr)[2] = rdata[2];
+				((u_char *)&addr)[3] = rdata[3];
+				r.addresses[r.address_count++] = addr;
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * extract the metadata of a DNS message carried by a frame, over UDP
+	 * or TCP on port 53 or UDP on port 5353
+	 *
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @d: dissection of the frame
+	 * @r: record to fill in
+	 *
+	 * return: true if a DNS message was parsed, false otherwise
+	 */
+	bool DnsExtractor::extract(const u_char * data, size_t caplen,
+		const struct Dissector::Dissection & d,
+		struct DnsExtractor::Record & r)
+	{
+		size_t length = Dissector::payloadLength(data, caplen, d);
+		const u_char * payload = data + d.payload_offset;
+		bool port53 = d.src_port == 53 || d.dest_port == 53;
+
+		if (length == 0) {
+			return false;
+		}
+		if (d.protocol == 17 && (port53 || d.src_port == 5353 ||
+			d.dest_port == 5353)) {
+			return DnsExtractor::extract(payload, length, r);
+		}
+		/* TCP messages start with a length prefix */
+		if (d.protocol == 6 && port53 && length > 2) {
+			return DnsExtractor::extract(payload + 2, length - 2, r);
+		}
+		return false;
+	}
+
+	/*
+	 * read a possibly compressed domain name in presentation form
+	 *
+	 * @c: cursor over the whole message, at the name; moved past it
+	 * @out: buffer of MAX_NAME + 1 bytes, NULL to only skip the name
+	 * @length: set to the length written to out
+	 * @truncated: set to whether the name exceeded MAX_NAME
+	 *
+	 * return: true on success, false if the name is malformed
+	 */
+	bool DnsExtractor::name(ByteCursor & c, char * out, uint16_t * length,
+		bool * truncated)
+	{
+		ByteCursor p = c;
+		size_t n = 0;
+		bool jumped = false;
+		int jumps = 0;
+
+		if (out != NULL) {
+			*truncated = false;
+		}
+		for (;;) {
+			uint8_t label = 0;
+			const u_char * bytes = NULL;
+
+			if (!p.u8(label)) {
+				return false;
+			}
+			if (label == 0) {
+				break;
+			}
+
+			/* compression pointer, resume after the first one */
+			if ((label & 0xc0) == 0xc0) {
+				uint8_t low = 0;
+
+				if (!p.u8(low) || ++jumps > MAX_JUMPS) {
+					return false;
+				}
+				if (!jumped) {
+					c = p;
+					jumped = true;
+				}
+				if (!p.seek(((size_t)(label & 0x3f) << 8) | low)) {
+					return false;
+				}
+				continue;
+			}
+			if (label & 0xc0) {
+				return false;
+			}
+
+			if (!p.bytes(label, &bytes)) {
+				return false;
+			}
+			if (out == NULL) {
+				continue;
+			}
+			for (size_t i = (n > 0 ? 0 : 1); i <= label; ++i) {
+				if (n == DnsExtractor::MAX_NAME) {
+					*truncated = true;
+					break;
+				}
+				out[n++] = i == 0 ? '.' : (char)bytes[i - 1];
+			}
+		}
+
+		if (!jumped) {
+			c = p;
+		}
+		if (out != NULL) {
+			/* the root */
+			if (n == 0) {
+				out[n++] = '.';
+			}
+			out[n] = '\0';
+			*length = (uint16_t)n;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,554 @@
+/*
+ * implementation of class HeavyHitters
+ */
+
+#include <vector>	/* for std::vector */
+#include <map>		/* for std::map */
+#include <algorithm>	/* for std::sort and std::min */
+#include <new>		/* for std::bad_alloc */
+#include <cstring>	/* for std::memset */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "core/HeavyHitters.h"	/* for netgazer::HeavyHitters */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/FlowKey.h"	/* for netgazer::FlowKey */
+#include "core/Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+using std::vector;
+using std::map;
+using std::sort;
+using std::min;
+using std::bad_alloc;
+using std::memset;
+
+namespace netgazer {
+	/*
+	 * round up to a power of two
+	 *
+	 * @n: value to round
+	 *
+	 * return: smallest power of two not less than n
+	 */
+	static size_t powerOfTwo(size_t n)
+	{
+		size_t p = 1;
+
+		while (p < n) {
+			p <<= 1;
+		}
+		return p;
+	}
+
+	/*
+	 * order entries by descending count
+	 */
+	static bool heavier(const struct HeavyHitters::Entry & a,
+		const struct HeavyHitters::Entry & b)
+	{
+		return a.count != b.count ? a.count > b.count : a.key < b.key;
+	}
+
+	/*
+	 * constructor of HeavyHitters
+	 *
+	 * @k: number of monitored keys
+	 * @type: which packet fields make up a key
+	 * @weight: whether keys are weighted by packets or bytes
+	 * @width: sketch width, rounded up to a power of two
+	 * @depth: sketch depth
+	 */
+	HeavyHitters::HeavyHitters(size_t k, enum FlowKey::KeyType type,
+		enum HeavyHitters::Weight weight, size_t width, size_t depth)
+		NG_THROWS
+	{
+		if (k == 0 || width == 0 || depth == 0) {
+			throw Exception("invalid sketch dimensions");
+		}
+
+		this->m_k = k;
+		this->m_type = type;
+		this->m_weight = weight;
+		this->m_size = 0;
+		this->m_table_mask = powerOfTwo(k * 2) - 1;
+		this->m_width = powerOfTwo(width);
+		this->m_depth = depth;
+		this->m_total = 0;
+		this->m_heap = NULL;
+		this->m_table = NULL;
+		this->m_cms = NULL;
+
+		try {
+			this->m_heap = new struct HeavyHitters::Counter[k];
+			this->m_table = new uint32_t[this->m_table_mask + 1];
+			this->m_cms = new uint64_t[this->m_width * depth];
+		} catch (bad_alloc & e) {
+			delete[] this->m_heap;
+			delete[] this->m_table;
+			throw Exception(e.what());
+		}
+		this->clear();
+		this->charge(this->memory());
+	}
+
+	/*
+	 * destructor of HeavyHitters
+	 */
+	HeavyHitters::~HeavyHitters()
+	{
+		this->release(this->memory());
+		delete[] this->m_heap;
+		delete[] this->m_table;
+		delete[] this->m_cms;
+	}
+
+	/*
+	 * account a key
+	 *
+	 * @key: the key
+	 * @weight: weight to add
+	 */
+	void HeavyHitters::add(const struct FlowKey & key, uint64_t weight)
+	{
+		uint64_t hash = key.hash();
+		uint64_t est = this->update(hash, weight);
+		long pos = this->find(key, hash);
+		struct HeavyHitters::Counter * c = NULL;
+
+		this->m_total += weight;
+
+		/* already monitored */
+		if (pos >= 0) {
+			this->m_heap[pos].count += weight;
+			this->siftDown(pos);
+			return;
+		}
+
+		/* free counter left, nothing was ever evicted: exact count */
+		if (this->m_size < this->m_k) {
+			c = &(this->m_heap[this->m_size]);
+			c->key = key;
+			c->hash = hash;
+			c->count = weight;
+			c->error = 0;
+			this->insert(this->m_size);
+			++this->m_size;
+
+			/* a new leaf only ever moves up, restore from the top */
+			for (size_t i = this->m_size - 1; i > 0 &&
+				this->m_heap[(i - 1) / 2].count >
+				this->m_heap[i].count; i = (i - 1) / 2) {
+				this->swap(i, (i - 1) / 2);
+			}
+			return;
+		}
+
+		/* admit only keys the sketch says outweigh the minimum */
+		c = &(this->m_heap[0]);
+		if (est <= c->count) {
+			return;
+		}
+		this->erase(0);
+		c->key = key;
+		c->hash = hash;
+		c->count = min(est, c->count + weight);
+		c->error = c->count - weight;
+		this->insert(0);
+		this->siftDown(0);
+	}
+
+	/*
+	 * estimate the weight of any key from the sketch
+	 *
+	 * @key: the key
+	 *
+	 * return: upper bound of the weight of the key
+	 */
+	uint64_t HeavyHitters::estimate(const struct FlowKey & key) const
+	{
+		uint64_t hash = key.hash();
+		long pos = this->find(key, hash);
+		uint64_t est = this->sketch(hash);
+
+		if (pos >= 0 && this->m_heap[pos].count < est) {
+			return this->m_heap[pos].count;
+		}
+		return est;
+	}
+
+	/*
+	 * get the heaviest keys
+	 *
+	 * @n: maximum number of keys
+	 *
+	 * return: at most n entries by descending count
+	 */
+	vector<struct HeavyHitters::Entry> HeavyHitters::top(size_t n) const
+		NG_THROWS
+	{
+		vector<struct HeavyHitters::Entry> entries;
+
+		try {
+			entries.reserve(this->m_size);
+			for (size_t i = 0; i < this->m_size; ++i) {
+				struct HeavyHitters::Entry e;
+
+				e.key = this->m_heap[i].key;
+				e.count = this->m_heap[i].count;
+				e.error = this->m_heap[i].error;
+				entries.push_back(e);
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		sort(entries.begin(), entries.end(), heavier);
+		if (entries.size() > n) {
+			entries.resize(n);
+		}
+		return entries;
+	}
+
+	/*
+	 * merge another instance into this one, following the mergeable
+	 * Space-Saving construction: a key missing from one side is credited
+	 * with that side's minimum count
+	 *
+	 * @other: instance with the same parameters
+	 */
+	void HeavyHitters::merge(const HeavyHitters & other) NG_THROWS
+	{
+		map<struct FlowKey, struct HeavyHitters::Entry> merged;
+		vector<struct HeavyHitters::Entry> entries;
+		uint64_t min_this = 0, min_other = 0;
+
+		if (this->m_k != other.m_k || this->m_type != other.m_type ||
+			this->m_weight != other.m_weight ||
+			this->m_width != other.m_width ||
+			this->m_depth != other.m_depth) {
+			throw Exception("sketch parameters differ");
+		}
+
+		/* sketches merge cell by cell */
+		for (size_t i = 0; i < this->m_width * this->m_depth; ++i) {
+			this->m_cms[i] += other.m_cms[i];
+		}
+
+		if (this->m_size == this->m_k) {
+			min_this = this->m_heap[0].count;
+		}
+		if (other.m_size == other.m_k) {
+			min_other = other.m_heap[0].count;
+		}
+
+		try {
+			for (size_t i = 0; i < this->m_size; ++i) {
+				struct HeavyHitters::Entry & e =
+					merged[this->m_heap[i].key];
+
+				e.key = this->m_heap[i].key;
+				e.count = this->m_heap[i].count + min_other;
+				e.error = this->m_heap[i].error + min_other;
+			}
+			for (size_t i = 0; i < other.m_size; ++i) {
+				const struct HeavyHitters::Counter & c =
+					other.m_heap[i];
+				map<struct FlowKey, struct HeavyHitters::Entry>::
+					iterator j = merged.find(c.key);
+
+				if (j != merged.end()) {
+					/* undo the credit, the key is known */
+					j->second.count += c.count - min_other;
+					j->second.error += c.error - min_other;
+				} else {
+					struct HeavyHitters::Entry & e =
+						merged[c.key];
+
+					e.key = c.key;
+					e.count = c.count + min_this;
+					e.error = c.error + min_this;
+				}
+			}
+			for (map<struct FlowKey, struct HeavyHitters::Entry>::
+				iterator j = merged.begin(); j != merged.end(); ++j) {
+				entries.push_back(j->second);
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		/* keep the k heaviest, capped by the merged sketch */
+		for (vector<struct HeavyHitters::Entry>::iterator i =
+			entries.begin(); i != entries.end(); ++i) {
+			uint64_t est = this->sketch(i->key.hash());
+
+			if (i->count > est) {
+				i->error -= min(i->error, i->count - est);
+				i->count = est;
+			}
+		}
+		sort(entries.begin(), entries.end(), heavier);
+		if (entries.size() > this->m_k) {
+			entries.resize(this->m_k);
+		}
+
+		/* rebuild the heap and its index */
+		memset(this->m_table, 0,
+			(this->m_table_mask + 1) * sizeof(uint32_t));
+		this->m_size = entries.size();
+		for (size_t i = 0; i < this->m_size; ++i) {
+			struct HeavyHitters::Counter & c = this->m_heap[i];
+
+			c.key = entries[this->m_size - 1 - i].key;
+			c.hash = c.key.hash();
+			c.count = entries[this->m_size - 1 - i].count;
+			c.error = entries[this->m_size - 1 - i].error;
+			this->insert(i);
+		}
+		this->m_total += other.m_total;
+	}
+
+	/*
+	 * forget all keys and counts
+	 */
+	void HeavyHitters::clear()
+	{
+		memset(this->m_table, 0,
+			(this->m_table_mask + 1) * sizeof(uint32_t));
+		memset(this->m_cms, 0,
+			this->m_width * this->m_depth * sizeof(uint64_t));
+		this->m_size = 0;
+		this->m_total = 0;
+	}
+
+	/*
+	 * get the total weight added
+	 *
+	 * return: total weight
+	 */
+	uint64_t HeavyHitters::total() const
+	{
+		return this->m_total;
+	}
+
+	/*
+	 * get the memory used, which is fixed at construction
+	 *
+	 * return: memory used in bytes
+	 */
+	size_t HeavyHitters::memory() const
+	{
+		return sizeof(*this) +
+			this->m_k * sizeof(struct HeavyHitters::Counter) +
+			(this->m_table_mask + 1) * sizeof(uint32_t) +
+			this->m_width * this->m_depth * sizeof(uint64_t);
+	}
+
+	/*
+	 * give memory back; the summary has a constant size, so none is
+	 *
+	 * @bytes: amount of memory asked back
+	 *
+	 * return: 0
+	 */
+	size_t HeavyHitters::shed(size_t /* bytes */)
+	{
+		return 0;
+	}
+
+	/*
+	 * describe the state for a Checkpoint
+	 *
+	 * @extents: the extents are appended to it
+	 */
+	void HeavyHitters::extents(
+		vector<struct Checkpointable::Extent> & extents) const
+		NG_THROWS
+	{
+		struct Checkpointable::Extent x[] = {
+			{ &(this->m_k), sizeof(this->m_k), true },
+			{ &(this->m_type), sizeof(this->m_type), true },
+			{ &(this->m_weight), sizeof(this->m_weight), true },
+			{ &(this->m_width), sizeof(this->m_width), true },
+			{ &(this->m_depth), sizeof(this->m_depth), true },
+			{ this->m_heap, this->m_k *
+				sizeof(struct HeavyHitters::Counter), false },
+			{ &(this->m_size), sizeof(this->m_size), false },
+			{ this->m_table, (this->m_table_mask + 1) *
+				sizeof(uint32_t), false },
+			{ this->m_cms, this->m_width * this->m_depth *
+				sizeof(uint64_t), false },
+			{ &(this->m_total), sizeof(this->m_total), false },
+		};
+
+		try {
+			extents.insert(extents.end(), x, x + 10);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * look up a monitored key
+	 *
+	 * @key: the key
+	 * @hash: hash of the key
+	 *
+	 * return: heap position of the key, -1 if it is not monitored
+	 */
+	long HeavyHitters::find(const struct FlowKey & key, uint64_t hash) const
+	{
+		size_t i = hash & this->m_table_mask;
+
+		while (this->m_table[i] != 0) {
+			const struct HeavyHitters::Counter & c =
+				this->m_heap[this->m_table[i] - 1];
+
+			if (c.hash == hash && c.key == key) {
+				return this->m_table[i] - 1;
+			}
+			i = (i + 1) & this->m_table_mask;
+		}
+		return -1;
+	}
+
+	/*
+	 * index a heap position in the hash table
+	 *
+	 * @pos: heap position
+	 */
+	void HeavyHitters::insert(size_t pos)
+	{
+		size_t i = this->m_heap[pos].hash & this->m_table_mask;
+
+		while (this->m_table[i] != 0) {
+			i = (i + 1) & this->m_table_mask;
+		}
+		this->m_table[i] = pos + 1;
+		this->m_heap[pos].slot = i;
+	}
+
+	/*
+	 * remove a heap position from the hash table, shifting back later
+	 * entries of the probe sequence so no tombstones are needed
+	 *
+	 * @pos: heap position
+	 */
+	void HeavyHitters::erase(size_t pos)
+	{
+		size_t i = this->m_heap[pos].slot;
+		size_t j = i;
+
+		this->m_table[i] = 0;
+		for (;;) {
+			size_t home = 0;
+
+			j = (j + 1) & this->m_table_mask;
+			if (this->m_table[j] == 0) {
+				break;
+			}
+			home = this->m_heap[this->m_table[j] - 1].hash &
+				this->m_table_mask;
+
+			/* move j into the hole unless home lies in (i, j] */
+			if ((i <= j) ? (home <= i || home > j) :
+				(home <= i && home > j)) {
+				this->m_table[i] = this->m_table[j];
+				this->m_heap[this->m_table[i] - 1].slot = i;
+				this->m_table[j] = 0;
+				i = j;
+			}
+		}
+	}
+
+	/*
+	 * swap two heap positions and fix up their index entries
+	 *
+	 * @a: heap position
+	 * @b: heap position
+	 */
+	void HeavyHitters::swap(size_t a, size_t b)
+	{
+		struct HeavyHitters::Counter t = this->m_heap[a];
+
+		this->m_heap[a] = this->m_heap[b];
+		this->m_heap[b] = t;
+		this->m_table[this->m_heap[a].slot] = a + 1;
+		this->m_table[this->m_heap[b].slot] = b + 1;
+	}
+
+	/*
+	 * restore the heap order below a position whose count grew
+	 *
+	 * @pos: heap position
+	 */
+	void HeavyHitters::siftDown(size_t pos)
+	{
+		for (;;) {
+			size_t l = pos * 2 + 1, r = l + 1, m = pos;
+
+			if (l < this->m_size &&
+				this->m_heap[l].count < this->m_heap[m].count) {
+				m = l;
+			}
+			if (r < this->m_size &&
+				this->m_heap[r].count < this->m_heap[m].count) {
+				m = r;
+			}
+			if (m == pos) {
+				return;
+			}
+			this->swap(pos, m);
+			pos = m;
+		}
+	}
+
+	/*
+	 * add to the sketch with conservative update, raising each cell
+	 * only as far as the new estimate
+	 *
+	 * @hash: hash of the key
+	 * @weight: weight to add
+	 *
+	 * return: new estimate of the key
+	 */
+	uint64_t HeavyHitters::update(uint64_t hash, uint64_t weight)
+	{
+		uint64_t est = this->sketch(hash) + weight;
+		uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+
+		for (size_t d = 0; d < this->m_depth; ++d) {
+			uint64_t & cell = this->m_cms[d * this->m_width +
+				((h1 + d * h2) & (this->m_width - 1))];
+
+			if (cell < est) {
+				cell = est;
+			}
+		}
+		return est;
+	}
+
+	/*
+	 * query the sketch
+	 *
+	 * @hash: hash of the key
+	 *
+	 * return: smallest cell of the key
+	 */
+	uint64_t HeavyHitters::sketch(uint64_t hash) const
+	{
+		uint32_t h1 = (uint32_t)hash, h2 = (uint32_t)(hash >> 32) | 1;
+		uint64_t est = (uint64_t)-1;
+
+		for (size_t d = 0; d < this->m_depth; ++d) {
+			uint64_t cell = this->m_cms[d * this->m_width +
+				((h1 + d * h2) & (this->m_width - 1))];
+
+			if (cell < est) {
+				est = cell;
+			}
+		}
+		return est;
+	}
+}
@@ -0,0 +1,187 @@
+/*
+ * implementation of class HttpExtractor
+ */
+
+#include <cstring>	/* for std::memcpy, std::memcmp and std::memchr */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/HttpExtractor.h"	/* for netgazer::HttpExtractor */
+#include "core/ByteCursor.h"	/* for netgazer::ByteCursor */
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+
+using std::memcpy;
+using std::memcmp;
+using std::memchr;
+
+namespace netgazer {
+	/*
+	 * copy a string into a fixed-size field
+	 *
+	 * @out: field of max + 1 bytes
+	 * @max: maximum string length
+	 * @in: string to copy
+	 * @n: length of the string
+	 *
+	 * return: number of bytes copied
+	 */
+	static inline size_t copyField(char * out, size_t max,
+		const u_char * in, size_t n)
+	{
+		if (n > max) {
+			n = max;
+		}
+		memcpy(out, in, n);
+		out[n] = '\0';
+		return n;
+	}
+
+	/*
+	 * check whether a header line names a header, ignoring case
+	 *
+	 * @line: header line
+	 * @n: length of the line
+	 * @name: lower case header name
+	 * @name_length: length of the name
+	 *
+	 * return: true if the line is that header
+	 */
+	static inline bool isHeader(const u_char * line, size_t n,
+		const char * name, size_t name_length)
+	{
+		if (n <= name_length || line[name_length] != ':') {
+			return false;
+		}
+		for (size_t i = 0; i < name_length; ++i) {
+			if ((line[i] | 0x20) != name[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * extract the metadata of an HTTP request
+	 *
+	 * @payload: start of the request
+	 * @length: number of bytes available
+	 * @r: record to fill in
+	 *
+	 * return: true if a request line was parsed, false if the payload
+	 *         does not start an HTTP/1.x request
+	 */
+	bool HttpExtractor::extract(const u_char * payload, size_t length,
+		struct HttpExtractor::Record & r)
+	{
+		ByteCursor c(payload, length);
+		const u_char * line = NULL;
+		const u_char * space = NULL;
+		const u_char * version = NULL;
+		size_t n = 0;
+		size_t method = 0;
+
+		/* cheap rejection of everything not starting with a method */
+		if (length < 16 || payload[0] < 'A' || payload[0] > 'Z') {
+			return false;
+		}
+		if (!c.line(&line, &n)) {
+			return false;
+		}
+
+		/* METHOD SP URI SP HTTP/x.y */
+		while (method < n && method <= HttpExtractor::MAX_METHOD &&
+			line[method] >= 'A' && line[method] <= 'Z') {
+			++method;
+		}
+		if (method == 0 || method >= n || line[method] != ' ') {
+			return false;
+		}
+		space = (const u_char *)memchr(line + method + 1, ' ',
+			n - method - 1);
+		if (space == NULL || line + n - (space + 1) != 8) {
+			return false;
+		}
+		version = space + 1;
+		if (memcmp(version, "HTTP/", 5) != 0 ||
+			version[5] < '0' || version[5] > '9' || version[6] != '.' ||
+			version[7] < '0' || version[7] > '9') {
+			return false;
+		}
+
+		r.flags = 0;
+		r.method_length = (uint8_t)copyField(r.method,
+			HttpExtractor::MAX_METHOD, line, method);
+		n = space - (line + method + 1);
+		if (n > HttpExtractor::MAX_URI) {
+			r.flags |= HttpExtractor::URI_TRUNCATED;
+		}
+		r.uri_length = (uint16_t)copyField(r.uri, HttpExtractor::MAX_URI,
+			line + method + 1, n);
+		r.version_major = version[5] - '0';
+		r.version_minor = version[7] - '0';
+		r.host_length = 0;
+		r.host[0] = '\0';
+
+		/* header lines up to the empty line */
+		for (;;) {
+			if (!c.line(&line, &n)) {
+				r.flags |= HttpExtractor::INCOMPLETE;
+				break;
+			}
+			if (n == 0) {
+				break;
+			}
+			if (!isHeader(line, n, "host", 4)) {
+				continue;
+			}
+
+			/* trim optional white space around the value */
+			line += 5;
+			n -= 5;
+			while (n > 0 && (line[0] == ' ' || line[0] == '\t')) {
+				++line;
+				--n;
+			}
+			while (n > 0 && (line[n - 1] == ' ' ||
+				line[n - 1] == '\t')) {
+				--n;
+			}
+			if (n > HttpExtractor::MAX_HOST) {
+				r.flags |= HttpExtractor::HOST_TRUNCATED;
+			}
+			r.host_length = (uint16_t)copyField(r.host,
+				HttpExtractor::MAX_HOST, line, n);
+			r.flags |= HttpExtractor::HAS_HOST;
+			break;
+		}
+		return true;
+	}
+
+	/*
+	 * extract the metadata of an HTTP request starting a TCP segment of
+	 * a frame, on any port
+	 *
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @d: dissection of the frame
+	 * @r: record to fill in
+	 *
+	 * return: true if a request was parsed, false otherwise
+	 */
+	bool HttpExtractor::extract(const u_char * data, size_t caplen,
+		const struct Dissector::Dissection & d,
+		struct HttpExtractor::Record & r)
+	{
+		size_t length = 0;
+
+		if (d.protocol != 6) {
+			return false;
+		}
+		length = Dissector::payloadLength(data, caplen, d);
+		if (length == 0) {
+			return false;
+		}
+		return HttpExtractor::extract(data + d.payload_offset, length, r);
+	}
+}
@@ -0,0 +1,199 @@
+/*
+ * implementation of class HyperLogLog
+ */
+
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <cmath>	/* for std::log and std::ldexp */
+#include <cstring>	/* for std::memset */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#ifdef __SSE2__
+#include <emmintrin.h>	/* for SSE2 intrinsics */
+#endif
+
+#include "core/HyperLogLog.h"	/* for netgazer::HyperLogLog */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/Checkpointable.h"	/* for netgazer::Checkpointable */
+
+using std::vector;
+using std::bad_alloc;
+using std::log;
+using std::ldexp;
+using std::memset;
+
+namespace netgazer {
+	/*
+	 * constructor of HyperLogLog
+	 *
+	 * @precision: number of index bits, between 4 and 18
+	 */
+	HyperLogLog::HyperLogLog(unsigned precision) NG_THROWS
+	{
+		if (precision < 4 || precision > 18) {
+			throw Exception("precision out of range");
+		}
+
+		try {
+			this->m_registers = new uint8_t[(size_t)1 << precision];
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		this->m_precision = precision;
+		this->clear();
+	}
+
+	/*
+	 * destructor of HyperLogLog
+	 */
+	HyperLogLog::~HyperLogLog()
+	{
+		delete[] this->m_registers;
+	}
+
+	/*
+	 * estimate the number of distinct items added
+	 *
+	 * return: estimated cardinality
+	 */
+	double HyperLogLog::estimate() const
+	{
+		return HyperLogLog::estimate(this->m_registers,
+			this->m_precision);
+	}
+
+	/*
+	 * merge another estimator, the result estimates the union
+	 *
+	 * @other: estimator with the same precision
+	 */
+	void HyperLogLog::merge(const HyperLogLog & other) NG_THROWS
+	{
+		if (this->m_precision != other.m_precision) {
+			throw Exception("precision differs");
+		}
+		HyperLogLog::merge(this->m_registers, other.m_registers,
+			(size_t)1 << this->m_precision);
+	}
+
+	/*
+	 * forget all items, e.g. when a window rotates
+	 */
+	void HyperLogLog::clear()
+	{
+		memset(this->m_registers, 0, (size_t)1 << this->m_precision);
+	}
+
+	/*
+	 * get the number of index bits
+	 *
+	 * return: precision of this HyperLogLog
+	 */
+	unsigned HyperLogLog::precision() const
+	{
+		return this->m_precision;
+	}
+
+	/*
+	 * get the memory used
+	 *
+	 * return: memory used in bytes
+	 */
+	size_t HyperLogLog::memory() const
+	{
+		return sizeof(*this) + ((size_t)1 << this->m_precision);
+	}
+
+	/*
+	 * describe the state for a Checkpoint
+	 *
+	 * @extents: the extents are appended to it
+	 */
+	void HyperLogLog::extents(
+		vector<struct Checkpointable::Extent> & extents) const
+		NG_THROWS
+	{
+		struct Checkpointable::Extent x[] = {
+			{ &(this->m_precision), sizeof(this->m_precision), true },
+			{ this->m_registers, (size_t)1 << this->m_precision,
+				false },
+		};
+
+		try {
+			extents.insert(extents.end(), x, x + 2);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * estimate the cardinality of a register array, using linear
+	 * counting for small cardinalities
+	 *
+	 * @registers: 2^precision registers
+	 * @precision: number of index bits
+	 *
+	 * return: estimated cardinality
+	 */
+	double HyperLogLog::estimate(const uint8_t * registers,
+		unsigned precision)
+	{
+		size_t m = (size_t)1 << precision;
+		double alpha = 0.7213 / (1.0 + 1.079 / m);
+		double sum = 0.0, e = 0.0;
+		size_t zeros = 0;
+
+		switch (m) {
+		case 16:
+			alpha = 0.673;
+			break;
+		case 32:
+			alpha = 0.697;
+			break;
+		case 64:
+			alpha = 0.709;
+			break;
+		default:
+			break;
+		}
+
+		for (size_t i = 0; i < m; ++i) {
+			sum += ldexp(1.0, -(int)registers[i]);
+			zeros += (registers[i] == 0);
+		}
+		e = alpha * m * m / sum;
+
+		if (e <= 2.5 * m && zeros != 0) {
+			return m * log((double)m / zeros);
+		}
+		return e;
+	}
+
+	/*
+	 * merge register arrays by taking the byte-wise maximum
+	 *
+	 * @dest: registers to merge into
+	 * @src: registers to merge from
+	 * @count: number of registers
+	 */
+	void HyperLogLog::merge(uint8_t * dest, const uint8_t * src,
+		size_t count)
+	{
+		size_t i = 0;
+
+#ifdef __SSE2__
+		for (; i + 16 <= count; i += 16) {
+			__m128i a = _mm_loadu_si128((const __m128i *)(dest + i));
+			__m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+
+			_mm_storeu_si128((__m128i *)(dest + i),
+				_mm_max_epu8(a, b));
+		}
+#endif
+		for (; i < count; ++i) {
+			if (dest[i] < src[i]) {
+				dest[i] = src[i];
+			}
+		}
+	}
+}
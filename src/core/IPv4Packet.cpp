@@ -3,6 +3,7 @@
  */
 
 #include <iostream>	/* for std::ostream */
+#include <new>		/* for std::bad_alloc */
 #include <pcap/pcap.h>	/* for libpcap types and functions */
 
 #include "core/Exception.h"	/* for netgazer::Exception */
@@ -13,17 +14,24 @@ using std::ostream;
 
 namespace netgazer {
 	/*
-	 * constructor of IPv4Packet
+	 * constructor of IPv4Packet, the frame must hold a whole IPv4
+	 * header
 	 *
 	 * @header: a pointer to the pcap packet header
 	 * @data: packet data
+	 * @nano: whether the timestamp carries nanoseconds
 	 */
 	IPv4Packet::IPv4Packet(const struct pcap_pkthdr * header,
-		const u_char * data) throw (Exception)
-		: Packet(header, data)
+		const u_char * data, bool nano) NG_THROWS
+		: Packet(header, data, nano)
 	{
-		this->m_ip_header = (struct IPv4Packet::IPv4Header *)(data +
-			sizeof(struct Packet::PacketHeader));
+		if (header->caplen < sizeof(struct Packet::PacketHeader) +
+			sizeof(struct IPv4Packet::IPv4Header)) {
+			/* ~Packet() frees the copy */
+			throw Exception("data size too small");
+		}
+		this->m_ip_header = (struct IPv4Packet::IPv4Header *)
+			(this->m_data + sizeof(struct Packet::PacketHeader));
 	}
 
 	/*
@@ -34,99 +42,29 @@ namespace netgazer {
 	}
 
 	/*
-	 * get the IP packet header length
-	 *
-	 * return: header length of this IPv4Packet
-	 */
-	int IPv4Packet::headerLength() const throw (Exception)
-	{
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
-		}
-		return this->m_ip_header->ihl;
-	}
-
-	/*
-	 * get the IP packet length
-	 *
-	 * return: total length of this IPv4Packet
-	 */
-	int IPv4Packet::totalLength() const throw (Exception)
-	{
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
-		}
-		return this->m_ip_header->length;
-	}
-
-	/*
-	 * get the IP type
-	 *
-	 * return: IP type of this IPv4Packet
-	 */
-	enum IPv4Packet::IPType IPv4Packet::ipType() const throw (Exception)
-	{
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
-		}
-
-		switch (this->m_ip_header->protocol) {
-		/* Internet Control Message Protocol */
-		case 1:
-			return IPv4Packet::ICMP;
-
-		/* The Internet Group Management Protocol */
-		case 2:
-			return IPv4Packet::IGMP;
-
-		/* Transmission Control Protocol */
-		case 6:
-			return IPv4Packet::TCP;
-
-		/* User Datagram Protocol */
-		case 17:
-			return IPv4Packet::UDP;
-
-		/* other protocols */
-		default:
-			return IPv4Packet::OTHER;
-		}
-	}
-
-	u_short IPv4Packet::checksum() const throw (Exception)
-	{
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
-		}
-		return this->m_ip_header->checksum;
-	}
-
-	/*
-	 * get the packet source IPv4 address
+	 * copy this packet, the copy is owned by the caller
 	 *
-	 * return: source IPv4 address of this Packet
+	 * return: a pointer to the copy
 	 */
-	struct IPv4Packet::IPv4Addr IPv4Packet::srcIPv4Addr() const
-		throw (Exception)
+	Packet * IPv4Packet::clone() const NG_THROWS
 	{
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
+		try {
+			return new IPv4Packet(this->m_header, this->m_data,
+				this->m_nano);
+		} catch (std::bad_alloc & e) {
+			throw Exception(e.what());
 		}
-		return this->m_ip_header->src;
 	}
 
 	/*
-	 * get the packet destination IPv4 address
+	 * get the memory held by this packet
 	 *
-	 * return: destination IPv4 address of this Packet
+	 * return: memory used in bytes
 	 */
-	struct IPv4Packet::IPv4Addr IPv4Packet::destIPv4Addr() const
-		throw (Exception)
+	size_t IPv4Packet::memory() const NG_NOEXCEPT
 	{
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
-		}
-		return this->m_ip_header->dest;
+		return sizeof(*this) + sizeof(*(this->m_header)) +
+			this->m_header->caplen;
 	}
 
 	/*
@@ -0,0 +1,125 @@
+/*
+ * implementation of class MemoryConsumer
+ */
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+#include "core/MemoryGovernor.h"	/* for netgazer::MemoryGovernor */
+
+namespace netgazer {
+	/*
+	 * constructor of MemoryConsumer, unregistered and empty
+	 */
+	MemoryConsumer::MemoryConsumer()
+		: m_governor(NULL), m_quota(0), m_priority(0), m_current(0),
+		  m_peak(0), m_pressure(0), m_floor(0), m_shed(0), m_denied(0)
+	{
+	}
+
+	/*
+	 * destructor of MemoryConsumer, unregistering it
+	 */
+	MemoryConsumer::~MemoryConsumer()
+	{
+		if (this->m_governor != NULL) {
+			this->m_governor->remove(this);
+		}
+	}
+
+	/*
+	 * get the memory currently charged
+	 *
+	 * return: number of bytes
+	 */
+	size_t MemoryConsumer::memoryUsage() const
+	{
+		return __atomic_load_n(&(this->m_current), __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * get the most memory ever charged at once
+	 *
+	 * return: number of bytes
+	 */
+	size_t MemoryConsumer::memoryPeak() const
+	{
+		return this->m_peak;
+	}
+
+	/*
+	 * account for allocated memory
+	 *
+	 * @bytes: number of bytes allocated
+	 *
+	 * return: false if memory should be given back with relieve()
+	 */
+	bool MemoryConsumer::charge(size_t bytes)
+	{
+		size_t current = 0;
+
+		if (this->m_governor != NULL) {
+			return this->m_governor->charge(this, bytes);
+		}
+		current = __atomic_add_fetch(&(this->m_current), bytes,
+			__ATOMIC_RELAXED);
+		if (current > this->m_peak) {
+			this->m_peak = current;
+		}
+		return true;
+	}
+
+	/*
+	 * account for freed memory
+	 *
+	 * @bytes: number of bytes freed
+	 */
+	void MemoryConsumer::release(size_t bytes)
+	{
+		if (this->m_governor != NULL) {
+			this->m_governor->release(this, bytes);
+			return;
+		}
+		__atomic_sub_fetch(&(this->m_current), bytes, __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * get the amount of memory to give back, to meet the quota or the
+	 * request of the governor
+	 *
+	 * return: number of bytes
+	 */
+	size_t MemoryConsumer::excess() const
+	{
+		size_t current = __atomic_load_n(&(this->m_current),
+			__ATOMIC_RELAXED);
+		size_t excess = __atomic_load_n(&(this->m_pressure),
+			__ATOMIC_RELAXED);
+
+		if (this->m_quota != 0 && current > this->m_quota &&
+			current - this->m_quota > excess) {
+			excess = current - this->m_quota;
+		}
+		return excess < current ? excess : current;
+	}
+
+	/*
+	 * shed the excess memory, if any; what cannot be shed is asked of
+	 * the other consumers instead
+	 */
+	void MemoryConsumer::relieve()
+	{
+		size_t excess = this->excess();
+		size_t released = 0;
+
+		if (excess == 0) {
+			return;
+		}
+		released = this->shed(excess);
+		__atomic_add_fetch(&(this->m_shed), released, __ATOMIC_RELAXED);
+		if (released < excess && this->m_governor != NULL) {
+			this->m_governor->settle(this);
+		}
+	}
+}
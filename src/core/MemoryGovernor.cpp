@@ -0,0 +1,401 @@
+/*
+ * implementation of class MemoryGovernor
+ */
+
+#include <string>	/* for std::string */
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pthread.h>	/* for pthread_mutex_t */
+
+#include "core/MemoryGovernor.h"	/* for netgazer::MemoryGovernor */
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+#include "core/Exception.h"		/* for netgazer::Exception */
+
+using std::vector;
+using std::bad_alloc;
+
+namespace netgazer {
+	/* initialize ref */
+	MemoryGovernor * MemoryGovernor::ref = NULL;
+
+	/*
+	 * constructor of MemoryGovernor, without a budget
+	 */
+	MemoryGovernor::MemoryGovernor() NG_THROWS
+		: m_budget(0), m_total(0), m_peak(0), m_pending(0)
+	{
+		/* clear previous instance */
+		if (MemoryGovernor::ref != NULL) {
+			delete MemoryGovernor::ref;
+		}
+		pthread_mutex_init(&(this->m_lock), NULL);
+		MemoryGovernor::ref = this;
+	}
+
+	/*
+	 * destructor of MemoryGovernor, the consumers keep counting their
+	 * own usage
+	 */
+	MemoryGovernor::~MemoryGovernor()
+	{
+		for (vector<MemoryConsumer *>::iterator i =
+			this->m_consumers.begin(); i != this->m_consumers.end();
+			++i) {
+			(*i)->m_governor = NULL;
+			(*i)->m_quota = 0;
+			__atomic_store_n(&((*i)->m_pressure), 0, __ATOMIC_RELAXED);
+		}
+		pthread_mutex_destroy(&(this->m_lock));
+
+		/* clear instance reference */
+		if (MemoryGovernor::ref == this) {
+			MemoryGovernor::ref = NULL;
+		}
+	}
+
+	/*
+	 * register a consumer, what it already charged counts against the
+	 * budget from now on
+	 *
+	 * @consumer: the consumer, not owned
+	 * @name: name shown in the usage report
+	 * @quota: most memory the consumer may keep, 0 for no quota
+	 * @priority: consumers of lower priority are shed first
+	 */
+	void MemoryGovernor::add(MemoryConsumer * consumer, const char * name,
+		size_t quota, int priority) NG_THROWS
+	{
+		vector<MemoryConsumer *>::iterator i;
+
+		if (consumer == NULL) {
+			throw Exception("consumer is NULL");
+		}
+		if (consumer->m_governor != NULL) {
+			throw Exception("consumer is already registered");
+		}
+
+		pthread_mutex_lock(&(this->m_lock));
+		try {
+			consumer->m_label = name != NULL ? name : "";
+			/* keep the list ordered by priority, stable for ties */
+			for (i = this->m_consumers.begin();
+				i != this->m_consumers.end() &&
+				(*i)->m_priority <= priority; ++i) {
+			}
+			this->m_consumers.insert(i, consumer);
+		} catch (bad_alloc & e) {
+			pthread_mutex_unlock(&(this->m_lock));
+			throw Exception(e.what());
+		}
+		consumer->m_quota = quota;
+		consumer->m_priority = priority;
+		__atomic_add_fetch(&(this->m_total), consumer->memoryUsage(),
+			__ATOMIC_RELAXED);
+		consumer->m_governor = this;
+		pthread_mutex_unlock(&(this->m_lock));
+	}
+
+	/*
+	 * unregister a consumer, taking its usage off the budget
+	 *
+	 * @consumer: the consumer
+	 */
+	void MemoryGovernor::remove(MemoryConsumer * consumer)
+	{
+		if (consumer == NULL || consumer->m_governor != this) {
+			return;
+		}
+
+		pthread_mutex_lock(&(this->m_lock));
+		for (vector<MemoryConsumer *>::iterator i =
+			this->m_consumers.begin(); i != this->m_consumers.end();
+			++i) {
+			if (*i == consumer) {
+				this->m_consumers.erase(i);
+				break;
+			}
+		}
+		consumer->m_governor = NULL;
+		consumer->m_quota = 0;
+		__atomic_sub_fetch(&(this->m_pending),
+			__atomic_exchange_n(&(consumer->m_pressure), 0,
+			__ATOMIC_RELAXED), __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&(this->m_total), consumer->memoryUsage(),
+			__ATOMIC_RELAXED);
+		pthread_mutex_unlock(&(this->m_lock));
+	}
+
+	/*
+	 * set the process-wide budget, lowering it below the current usage
+	 * asks the excess back at once
+	 *
+	 * @bytes: budget in bytes, 0 for no budget
+	 */
+	void MemoryGovernor::setBudget(size_t bytes)
+	{
+		size_t total = 0;
+
+		this->m_budget = bytes;
+		total = __atomic_load_n(&(this->m_total), __ATOMIC_RELAXED);
+		if (bytes != 0 && total > bytes) {
+			this->squeeze(total - bytes);
+		}
+	}
+
+	/*
+	 * get the process-wide budget
+	 *
+	 * return: budget in bytes, 0 for no budget
+	 */
+	size_t MemoryGovernor::budget() const
+	{
+		return this->m_budget;
+	}
+
+	/*
+	 * get the memory charged by all consumers
+	 *
+	 * return: number of bytes
+	 */
+	size_t MemoryGovernor::current() const
+	{
+		return __atomic_load_n(&(this->m_total), __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * get the most memory ever charged at once by all consumers
+	 *
+	 * return: number of bytes
+	 */
+	size_t MemoryGovernor::peak() const
+	{
+		return __atomic_load_n(&(this->m_peak), __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * get the accounting of every consumer
+	 *
+	 * return: one entry per consumer, by increasing priority
+	 */
+	vector<struct MemoryGovernor::Usage> MemoryGovernor::usage() const
+		NG_THROWS
+	{
+		vector<struct MemoryGovernor::Usage> usage;
+
+		pthread_mutex_lock(&(this->m_lock));
+		try {
+			for (vector<MemoryConsumer *>::const_iterator i =
+				this->m_consumers.begin();
+				i != this->m_consumers.end(); ++i) {
+				struct MemoryGovernor::Usage u;
+
+				u.name = (*i)->m_label;
+				u.current = (*i)->memoryUsage();
+				u.peak = (*i)->m_peak;
+				u.quota = (*i)->m_quota;
+				u.priority = (*i)->m_priority;
+				u.shed = __atomic_load_n(&((*i)->m_shed),
+					__ATOMIC_RELAXED);
+				u.denied = __atomic_load_n(&((*i)->m_denied),
+					__ATOMIC_RELAXED);
+				usage.push_back(u);
+			}
+		} catch (bad_alloc & e) {
+			pthread_mutex_unlock(&(this->m_lock));
+			throw Exception(e.what());
+		}
+		pthread_mutex_unlock(&(this->m_lock));
+		return usage;
+	}
+
+	/*
+	 * shed the consumers asked for memory now rather than at their next
+	 * charge; only safe while none of them is in use by another thread
+	 *
+	 * return: number of bytes released
+	 */
+	size_t MemoryGovernor::reclaim() NG_THROWS
+	{
+		vector<MemoryConsumer *> consumers;
+		size_t released = 0;
+
+		/* relieve() may come back to settle(), so work on a copy */
+		pthread_mutex_lock(&(this->m_lock));
+		try {
+			consumers = this->m_consumers;
+		} catch (bad_alloc & e) {
+			pthread_mutex_unlock(&(this->m_lock));
+			throw Exception(e.what());
+		}
+		pthread_mutex_unlock(&(this->m_lock));
+
+		for (vector<MemoryConsumer *>::iterator i = consumers.begin();
+			i != consumers.end(); ++i) {
+			size_t before = (*i)->memoryUsage();
+
+			(*i)->relieve();
+			if ((*i)->memoryUsage() < before) {
+				released += before - (*i)->memoryUsage();
+			}
+		}
+		return released;
+	}
+
+	/*
+	 * get an instance of MemoryGovernor
+	 *
+	 * return: a pointer to MemoryGovernor
+	 */
+	MemoryGovernor * MemoryGovernor::instance() NG_THROWS
+	{
+		if (MemoryGovernor::ref == NULL) {
+			try {
+				new MemoryGovernor();
+			} catch (bad_alloc & e) {
+				throw Exception(e.what());
+			}
+		}
+		return MemoryGovernor::ref;
+	}
+
+	/*
+	 * dispose the previously acquired instance of MemoryGovernor
+	 */
+	void MemoryGovernor::dispose()
+	{
+		if (MemoryGovernor::ref != NULL) {
+			delete MemoryGovernor::ref;
+		}
+	}
+
+	/*
+	 * account for memory allocated by a consumer
+	 *
+	 * @consumer: the consumer
+	 * @bytes: number of bytes allocated
+	 *
+	 * return: false if the consumer has memory to give back
+	 */
+	bool MemoryGovernor::charge(MemoryConsumer * consumer, size_t bytes)
+	{
+		size_t current = __atomic_add_fetch(&(consumer->m_current),
+			bytes, __ATOMIC_RELAXED);
+		size_t total = __atomic_add_fetch(&(this->m_total), bytes,
+			__ATOMIC_RELAXED);
+		size_t peak = __atomic_load_n(&(this->m_peak), __ATOMIC_RELAXED);
+
+		if (current > consumer->m_peak) {
+			consumer->m_peak = current;
+		}
+		while (total > peak && !__atomic_compare_exchange_n(
+			&(this->m_peak), &peak, total, true, __ATOMIC_RELAXED,
+			__ATOMIC_RELAXED)) {
+		}
+
+		/* only look for victims if the excess is not asked for yet */
+		if (this->m_budget != 0 && total > this->m_budget &&
+			total - this->m_budget > __atomic_load_n(
+			&(this->m_pending), __ATOMIC_RELAXED)) {
+			this->squeeze(total - this->m_budget);
+		}
+		if (consumer->excess() > 0) {
+			__atomic_add_fetch(&(consumer->m_denied), 1,
+				__ATOMIC_RELAXED);
+			return false;
+		}
+		return true;
+	}
+
+	/*
+	 * account for memory freed by a consumer, counting it towards what
+	 * was asked of it
+	 *
+	 * @consumer: the consumer
+	 * @bytes: number of bytes freed
+	 */
+	void MemoryGovernor::release(MemoryConsumer * consumer, size_t bytes)
+	{
+		size_t pressure = __atomic_load_n(&(consumer->m_pressure),
+			__ATOMIC_RELAXED);
+
+		__atomic_sub_fetch(&(consumer->m_current), bytes,
+			__ATOMIC_RELAXED);
+		__atomic_sub_fetch(&(this->m_total), bytes, __ATOMIC_RELAXED);
+		while (pressure > 0) {
+			size_t left = pressure > bytes ? pressure - bytes : 0;
+
+			if (__atomic_compare_exchange_n(&(consumer->m_pressure),
+				&pressure, left, true, __ATOMIC_RELAXED,
+				__ATOMIC_RELAXED)) {
+				__atomic_sub_fetch(&(this->m_pending),
+					pressure - left, __ATOMIC_RELAXED);
+				break;
+			}
+		}
+	}
+
+	/*
+	 * drop what is still asked of a consumer that shed all it could,
+	 * remembering its usage so that the next squeeze looks further
+	 *
+	 * @consumer: the consumer
+	 */
+	void MemoryGovernor::settle(MemoryConsumer * consumer)
+	{
+		size_t total = 0;
+
+		pthread_mutex_lock(&(this->m_lock));
+		consumer->m_floor = consumer->memoryUsage();
+		__atomic_sub_fetch(&(this->m_pending),
+			__atomic_exchange_n(&(consumer->m_pressure), 0,
+			__ATOMIC_RELAXED), __ATOMIC_RELAXED);
+		pthread_mutex_unlock(&(this->m_lock));
+
+		total = __atomic_load_n(&(this->m_total), __ATOMIC_RELAXED);
+		if (this->m_budget != 0 && total > this->m_budget) {
+			this->squeeze(total - this->m_budget);
+		}
+	}
+
+	/*
+	 * ask memory back from the consumers, lowest priority first
+	 *
+	 * @bytes: amount over the budget, including what was already asked
+	 */
+	void MemoryGovernor::squeeze(size_t bytes)
+	{
+		size_t pending = 0;
+
+		pthread_mutex_lock(&(this->m_lock));
+		pending = __atomic_load_n(&(this->m_pending), __ATOMIC_RELAXED);
+		if (bytes <= pending) {
+			pthread_mutex_unlock(&(this->m_lock));
+			return;
+		}
+		bytes -= pending;
+
+		for (vector<MemoryConsumer *>::iterator i =
+			this->m_consumers.begin();
+			i != this->m_consumers.end() && bytes > 0; ++i) {
+			size_t current = (*i)->memoryUsage();
+			size_t pressure = __atomic_load_n(&((*i)->m_pressure),
+				__ATOMIC_RELAXED);
+			size_t held = (*i)->m_floor + pressure;
+			size_t take = 0;
+
+			/* skip what is asked already or could not be shed */
+			if (current <= held) {
+				continue;
+			}
+			take = current - held < bytes ? current - held : bytes;
+			__atomic_add_fetch(&((*i)->m_pressure), take,
+				__ATOMIC_RELAXED);
+			__atomic_add_fetch(&(this->m_pending), take,
+				__ATOMIC_RELAXED);
+			bytes -= take;
+		}
+		pthread_mutex_unlock(&(this->m_lock));
+	}
+}
@@ -4,12 +4,11 @@
 
 #include <vector>	/* for std::vector */
 #include <new>		/* for std::bad_alloc */
-#include <cstring>	/* for std::strcmp */
-#include <pcap/pcap.h>	/* for libpcap types and functions */
 
 #include "core/NetworkService.h"	/* for netgazer::NetworkService */
 #include "core/Exception.h"		/* for netgazer::Exception */
 #include "core/Adapter.h"		/* for netgazer::Adapter */
+#include "core/AdapterRegistry.h"	/* for netgazer::AdapterRegistry */
 
 using std::vector;
 using std::bad_alloc;
@@ -19,22 +18,16 @@ namespace netgazer {
 	NetworkService * netgazer::NetworkService::ref = NULL;
 
 	/*
-	 * constructor of NetworkService
+	 * constructor of NetworkService, adapters are enumerated on demand
 	 */
-	NetworkService::NetworkService() throw (Exception)
+	NetworkService::NetworkService() NG_THROWS
 	{
-		char errbuf[PCAP_ERRBUF_SIZE];
-
 		/* clear previous instance */
 		if (NetworkService::ref != NULL) {
 			delete NetworkService::ref;
 		}
-		/* do find all adapters */
-		if (pcap_findalldevs(&(this->m_pcap_all_adapters), errbuf) == -1) {
-			throw Exception(errbuf);
-		}
 		NetworkService::ref = this;
-		this->m_pcap_adapter = this->m_pcap_all_adapters;
+		this->m_cursor = 0;
 	}
 
 	/*
@@ -42,18 +35,6 @@ namespace netgazer {
 	 */
 	NetworkService::~NetworkService()
 	{
-		/* free all opened adapters */
-		for (vector<Adapter *>::iterator i = this->m_adapters.begin();
-			i != this->m_adapters.end(); ++i) {
-			delete *i;
-		}
-		this->m_adapters.clear();
-
-		/* free all adapters */
-		if (this->m_pcap_all_adapters != NULL) {
-			pcap_freealldevs(this->m_pcap_all_adapters);
-		}
-
 		/* clear instance reference */
 		if (NetworkService::ref != NULL) {
 			NetworkService::ref = NULL;
@@ -65,27 +46,19 @@ namespace netgazer {
 	 *
 	 * return: a pointer to the next adapter on success, NULL otherwise
 	 */
-	Adapter * NetworkService::nextAdapter() throw (Exception)
+	Adapter * NetworkService::nextAdapter() NG_THROWS
 	{
-		Adapter * adapter = NULL;
+		const vector<Adapter *> & adapters = this->m_registry.adapters();
 
-		/* no next adapter */
-		if (this->m_pcap_adapter == NULL) {
-			return NULL;
-		}
+		/* skip adapters of removed interfaces */
+		while (this->m_cursor < adapters.size()) {
+			Adapter * adapter = adapters[this->m_cursor++];
 
-		try {
-			adapter = new Adapter(this->m_pcap_adapter);
-		} catch (bad_alloc & e) {
-			throw Exception(e.what());
+			if (adapter->present()) {
+				return adapter;
+			}
 		}
-
-		/* move the current pcap pointer to the next */
-		this->m_pcap_adapter = this->m_pcap_adapter->next;
-
-		/* store the Adapter pointer */
-		this->m_adapters.push_back(adapter);
-		return adapter;
+		return NULL;
 	}
 
 	/*
@@ -95,91 +68,66 @@ namespace netgazer {
 	 *
 	 * return: a pointer to the specified adapter on success, NULL otherwise
 	 */
-	Adapter * NetworkService::adapterBy(const char * name) throw (Exception)
+	Adapter * NetworkService::adapterBy(const char * name) NG_THROWS
 	{
-		pcap_if_t * p = this->m_pcap_all_adapters;
-		Adapter * adapter = NULL;
-
-		/* do find by name */
-		while (p != NULL) {
-			if (p->name != NULL && strcmp(p->name, name) == 0) {
-				try {
-					adapter = new Adapter(p);
-				} catch (bad_alloc & e) {
-					throw Exception(e.what());
-				}
-
-				this->m_adapters.push_back(adapter);
-				return adapter;
-			}
-			p = p->next;
-		}
-
-		/* not found */
-		return NULL;
+		return this->m_registry.byName(name);
 	}
 
 	/*
 	 * get adapter by index, it needs not to be freed by the caller
 	 *
-	 * @index: zero-based index
+	 * @index: zero-based index in the order of nextAdapter()
 	 *
 	 * return: a pointer to the specified adapter on success, NULL otherwise
 	 */
-	Adapter * NetworkService::adapterBy(int index) throw (Exception)
+	Adapter * NetworkService::adapterBy(int index) NG_THROWS
 	{
-		pcap_if_t * p = this->m_pcap_all_adapters;
-		Adapter * adapter = NULL;
+		const vector<Adapter *> & adapters = this->m_registry.adapters();
 
-		/* no adapter avaliable */
-		if (p == NULL) {
-			throw Exception("adapter index out of range");
-		}
-		/* do iterate */
-		else {
-			for (; index > 0; --index) {
-				if (p->next == NULL) {
-					throw Exception("adapter index out of "
-						"range");
+		if (index >= 0) {
+			for (vector<Adapter *>::const_iterator i =
+				adapters.begin(); i != adapters.end(); ++i) {
+				if ((*i)->present() && index-- == 0) {
+					return *i;
 				}
-				p = p->next;
 			}
 		}
-
-		try {
-			adapter = new Adapter(p);
-		} catch (bad_alloc & e) {
-			throw Exception(e.what());
-		}
-
-		this->m_adapters.push_back(adapter);
-		return adapter;
+		throw Exception("adapter index out of range");
 	}
 
 	/*
-	 * reset the NetworkService
+	 * get adapter by kernel interface index, it needs not to be freed
+	 * by the caller
+	 *
+	 * @ifindex: interface index
+	 *
+	 * return: a pointer to the specified adapter on success, NULL otherwise
 	 */
-	void NetworkService::reset() throw (Exception)
+	Adapter * NetworkService::adapterByIfindex(int ifindex)
+		NG_THROWS
 	{
-		char errbuf[PCAP_ERRBUF_SIZE];
-
-		/* free all opened adapters */
-		for (vector<Adapter *>::iterator i = this->m_adapters.begin();
-			i != this->m_adapters.end(); ++i) {
-			delete *i;
-		}
-		this->m_adapters.clear();
+		return this->m_registry.byIndex(ifindex);
+	}
 
-		/* free all adapters */
-		if (this->m_pcap_all_adapters != NULL) {
-			pcap_freealldevs(this->m_pcap_all_adapters);
-		}
+	/*
+	 * get the adapter registry, e.g. to watch its descriptor for link
+	 * events
+	 *
+	 * return: the adapter registry
+	 */
+	AdapterRegistry * NetworkService::registry()
+	{
+		return &(this->m_registry);
+	}
 
-		/* find all adapters */
-		if (pcap_findalldevs(&(this->m_pcap_all_adapters), errbuf) == -1) {
-			throw Exception(errbuf);
-		}
-		this->m_pcap_adapter = this->m_pcap_all_adapters;
+	/*
+	 * reset the NetworkService: apply pending link events and restart
+	 * nextAdapter() from the first adapter; cached adapters stay valid
+	 */
+	void NetworkService::reset() NG_THROWS
+	{
+		this->m_registry.poll();
+		this->m_cursor = 0;
 	}
 
 	/*
@@ -187,7 +135,7 @@ namespace netgazer {
 	 *
 	 * return: a pointer to NetworkService on success, NULL otherwise
 	 */
-	NetworkService * NetworkService::instance() throw (Exception)
+	NetworkService * NetworkService::instance() NG_THROWS
 	{
 		NetworkService * p = NULL;
 
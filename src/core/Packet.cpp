@@ -27,13 +27,14 @@ namespace netgazer {
 	 *
 	 * @header: a pointer to the pcap packet header
 	 * @data: packet data
+	 * @nano: whether the timestamp carries nanoseconds
 	 */
-	Packet::Packet(const struct pcap_pkthdr * header, const u_char * data)
-		throw (Exception)
+	Packet::Packet(const struct pcap_pkthdr * header, const u_char * data,
+		bool nano) NG_THROWS
 	{
 		if (header == NULL) {
 			throw Exception("header is NULL");
-		} else if (header->len < sizeof(struct Packet::PacketHeader)) {
+		} else if (header->caplen < sizeof(struct Packet::PacketHeader)) {
 			throw Exception("data size too small");
 		}
 		if (data == NULL) {
@@ -43,14 +44,15 @@ namespace netgazer {
 		try {
 			/* memory allocation */
 			this->m_header = new struct pcap_pkthdr;
-			this->m_data = new u_char[header->len];
+			this->m_data = new u_char[header->caplen];
 		} catch (bad_alloc & e) {
 			throw Exception(e.what());
 		}
 
 		/* initialize */
 		memcpy(this->m_header, header, sizeof(*header));
-		memcpy(this->m_data, data, header->len * sizeof(u_char));
+		memcpy(this->m_data, data, header->caplen * sizeof(u_char));
+		this->m_nano = nano;
 	}
 
 	/*
@@ -63,128 +65,50 @@ namespace netgazer {
 	}
 
 	/*
-	 * get the packet length
+	 * copy this packet, the copy is owned by the caller and outlives
+	 * the retention of the adapter that captured it
 	 *
-	 * return: length of this Packet
+	 * return: a pointer to the copy
 	 */
-	size_t Packet::length() const throw (Exception)
+	Packet * Packet::clone() const NG_THROWS
 	{
-		if (this->m_header == NULL) {
-			throw Exception("header is NULL");
-		}
-		return this->m_header->len;
-	}
-
-	/*
-	 * get the packet data
-	 *
-	 * return: data of this Packet
-	 */
-	const u_char * Packet::data() const throw (Exception)
-	{
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
-		}
-		return this->m_data;
-	}
-
-	/*
-	 * get the packet timestamp
-	 *
-	 * return: timestamp of this Packet
-	 */
-	struct timeval Packet::timestamp() const throw (Exception)
-	{
-		if (this->m_header == NULL) {
-			throw Exception("header is NULL");
+		try {
+			return new Packet(this->m_header, this->m_data,
+				this->m_nano);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
 		}
-		return this->m_header->ts;
 	}
 
 	/*
-	 * get the Ethernet packet type
+	 * get the memory held by this packet
 	 *
-	 * return: Ethernet type of this Packet
+	 * return: memory used in bytes
 	 */
-	enum Packet::EthernetType Packet::ethernetType() const throw (Exception)
+	size_t Packet::memory() const NG_NOEXCEPT
 	{
-		struct Packet::PacketHeader * p = (struct Packet::PacketHeader *)
-			this->m_data;
-
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
-		}
-
-		switch(p->type) {
-		/* Internet Protocol */
-		case 0x0800: case 0x0008:
-			return Packet::IP;
-
-		/* Address Resolution Protocol */
-		case 0x0806: case 0x0608:
-			return Packet::ARP;
-
-		/* Reverse Address Resolution Protocol */
-		case 0x8035: case 0x3508:
-			return Packet::RARP;
-
-		/* other protocols */
-		default:
-			return Packet::OTHER;
-		}
+		return sizeof(*this) + sizeof(*(this->m_header)) +
+			this->m_header->caplen;
 	}
 
 	/*
-	 * get the packet source MAC address
+	 * check whether a frame carries a whole IPv4 header and can be
+	 * decoded into an IPv4Packet
 	 *
-	 * return: source MAC address of this Packet
-	 */
-	struct Packet::MacAddr Packet::srcMacAddr() const throw (Exception)
-	{
-		struct Packet::PacketHeader * p = (struct Packet::PacketHeader *)
-			this->m_data;
-		struct Packet::MacAddr mac;
-
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
-		}
-
-		memcpy(&mac, &(p->src), sizeof(mac));
-		return mac;
-	}
-
-	/*
-	 * get the packet destination MAC address
+	 * @header: a pointer to the pcap packet header
+	 * @data: frame data
 	 *
-	 * return: destination MAC address of this Packet
+	 * return: true if it can, false otherwise
 	 */
-	struct Packet::MacAddr Packet::destMacAddr() const throw (Exception)
-	{
-		struct Packet::PacketHeader * p = (struct Packet::PacketHeader *)
-			this->m_data;
-		struct Packet::MacAddr mac;
-
-		if (this->m_data == NULL) {
-			throw Exception("data is NULL");
-		}
-
-		memcpy(&mac, &(p->dest), sizeof(mac));
-		return mac;
-	}
-
 	bool Packet::isIpv4Packet(const struct pcap_pkthdr * header,
-			const u_char * data) throw (Exception)
+			const u_char * data) NG_NOEXCEPT
 	{
 		struct Packet::PacketHeader * p = (struct Packet::PacketHeader *)
 			data;
 
-		if (header == NULL) {
-			throw Exception("header is NULL");
-		} else if (header->len < sizeof(struct Packet::PacketHeader)) {
-			throw Exception("data size too small");
-		}
-		if (data == NULL) {
-			throw Exception("data is NULL");
+		if (header == NULL || data == NULL || header->caplen <
+			sizeof(struct Packet::PacketHeader) + 20) {
+			return false;
 		}
 
 		return (p->type == 0x0800 || p->type == 0x0008);
@@ -241,6 +165,29 @@ namespace netgazer {
 		return os;
 	}
 
+	/*
+	 * operator << for ostream to output nanosecond timestamp
+	 *
+	 * @os: reference of an ostream object
+	 * @ts: timestamp representation
+	 *
+	 * return: os
+	 */
+	ostream & operator<<(ostream & os, const struct timespec & ts)
+	{
+		char buf[20];
+
+		/* do format */
+		strftime(buf, sizeof(buf), "%F %T", localtime(&ts.tv_sec));
+
+		/* do output */
+		std::ios::fmtflags f(os.flags());
+		os << buf << "." << setw(9) << setfill('0') << ts.tv_nsec;
+		os.flags(f);
+
+		return os;
+	}
+
 	/*
 	 * operator << for ostream to output MAC address
 	 *
@@ -0,0 +1,56 @@
+/*
+ * implementation of struct PacketSummary
+ */
+
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+#include "core/Hash.h"		/* for netgazer::Hash */
+
+namespace netgazer {
+	/* the record must stay exactly half a cache line */
+	typedef char summary_size_check[sizeof(struct PacketSummary) == 32 ?
+		1 : -1];
+
+	/*
+	 * fill in a summary record from a captured frame
+	 *
+	 * @header: a pointer to the pcap packet header
+	 * @data: packet data
+	 * @nano: whether the timestamp carries nanoseconds
+	 * @summary: record to fill in
+	 */
+	void PacketSummary::summarize(const struct pcap_pkthdr * header,
+		const u_char * data, bool nano, struct PacketSummary & summary)
+	{
+		struct Dissector::Dissection d;
+		uint8_t flags = 0;
+
+		Dissector::dissect(data, header->caplen, d);
+
+		summary.ts_ns = (uint64_t)header->ts.tv_sec * 1000000000ULL +
+			(uint64_t)header->ts.tv_usec * (nano ? 1 : 1000);
+		summary.length = header->len;
+		summary.mac_hash = header->caplen >= 12 ?
+			(uint32_t)Hash::bytes(data, 12) : 0;
+		summary.src_addr = d.src_addr;
+		summary.dest_addr = d.dest_addr;
+		summary.src_port = d.src_port;
+		summary.dest_port = d.dest_port;
+		summary.ether_type = d.ether_type;
+		summary.protocol = d.protocol;
+
+		/* the dissector flags share the low bits of the record */
+		flags = d.flags & (PacketSummary::IPV4 | PacketSummary::PORTS |
+			PacketSummary::FRAGMENT | PacketSummary::TRUNCATED);
+		if (d.protocol == 6 && (d.flags & Dissector::HAS_PORTS)) {
+			flags |= (d.tcp_flags & 0x01) ? PacketSummary::TCP_FIN : 0;
+			flags |= (d.tcp_flags & 0x02) ? PacketSummary::TCP_SYN : 0;
+			flags |= (d.tcp_flags & 0x04) ? PacketSummary::TCP_RST : 0;
+			flags |= (d.tcp_flags & 0x10) ? PacketSummary::TCP_ACK : 0;
+		}
+		summary.flags = flags;
+	}
+}
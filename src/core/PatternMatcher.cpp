@@ -0,0 +1,505 @@
+/*
+ * implementation of class PatternMatcher
+ */
+
+#include <vector>	/* for std::vector */
+#include <deque>	/* for std::deque */
+#include <new>		/* for std::bad_alloc */
+#include <cstring>	/* for std::memset */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/PatternMatcher.h"	/* for netgazer::PatternMatcher */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "core/Packet.h"		/* for netgazer::Packet */
+#include "core/Dissector.h"		/* for netgazer::Dissector */
+
+using std::vector;
+using std::deque;
+using std::bad_alloc;
+using std::memset;
+
+namespace netgazer {
+	/* table entry flag: the target state has outputs */
+	static const uint32_t ACCEPT = 0x80000000U;
+	/* transition not built yet */
+	static const uint32_t NONE = 0xffffffffU;
+
+	/*
+	 * constructor of PatternMatcher
+	 */
+	PatternMatcher::PatternMatcher()
+	{
+		this->m_compiled = false;
+		this->m_class_count = 0;
+		this->m_prefix = 0;
+		memset(this->m_classes, 0, sizeof(this->m_classes));
+		memset(this->m_masks, 0xff, sizeof(this->m_masks));
+	}
+
+	/*
+	 * destructor of PatternMatcher
+	 */
+	PatternMatcher::~PatternMatcher()
+	{
+	}
+
+	/*
+	 * add a pattern, before compile()
+	 *
+	 * @pattern: bytes of the pattern
+	 * @length: length of the pattern
+	 * @id: id reported with matches of the pattern
+	 */
+	void PatternMatcher::add(const void * pattern, size_t length,
+		uint32_t id) NG_THROWS
+	{
+		const u_char * p = (const u_char *)pattern;
+
+		if (this->m_compiled) {
+			throw Exception("matcher is already compiled");
+		}
+		if (p == NULL || length == 0) {
+			throw Exception("empty pattern");
+		}
+
+		try {
+			if (this->m_starts.empty()) {
+				this->m_starts.push_back(0);
+			}
+			this->m_bytes.insert(this->m_bytes.end(), p, p + length);
+			this->m_starts.push_back((uint32_t)this->m_bytes.size());
+			this->m_ids.push_back(id);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * build the DFA and the prefilter from the added patterns
+	 */
+	void PatternMatcher::compile() NG_THROWS
+	{
+		size_t n = this->m_ids.size();
+		vector<vector<uint32_t> > outputs;
+		vector<uint32_t> fail;
+		deque<uint32_t> queue;
+		size_t min_length = (size_t)-1;
+		uint32_t classes = 1;
+		uint32_t states = 1;
+		unsigned starters = 0;
+
+		if (this->m_compiled) {
+			throw Exception("matcher is already compiled");
+		}
+		if (n == 0) {
+			throw Exception("no patterns");
+		}
+
+		/* bytes absent from all patterns share class 0 */
+		for (size_t i = 0; i < this->m_bytes.size(); ++i) {
+			u_char b = this->m_bytes[i];
+
+			if (this->m_classes[b] == 0) {
+				this->m_classes[b] = (uint8_t)classes++;
+			}
+		}
+		/* 256 used bytes wrap class 256 to 0, merge it into the last */
+		if (classes > 256) {
+			for (int b = 0; b < 256; ++b) {
+				if (this->m_classes[b] == 0) {
+					this->m_classes[b] = 255;
+				}
+			}
+			classes = 256;
+		}
+		this->m_class_count = classes;
+
+		try {
+			/* trie */
+			this->m_table.assign(classes, NONE);
+			outputs.resize(1);
+			this->m_depths.assign(1, 0);
+			for (size_t p = 0; p < n; ++p) {
+				uint32_t s = 0;
+
+				for (uint32_t i = this->m_starts[p];
+					i < this->m_starts[p + 1]; ++i) {
+					uint32_t c = this->m_classes[this->m_bytes[i]];
+
+					if (this->m_table[s * classes + c] == NONE) {
+						this->m_table.resize((states + 1) *
+							(size_t)classes, NONE);
+						this->m_table[s * classes + c] = states;
+						outputs.resize(states + 1);
+						this->m_depths.push_back(
+							this->m_depths[s] < 0xffff ?
+							this->m_depths[s] + 1 : 0xffff);
+						++states;
+					}
+					s = this->m_table[s * classes + c];
+				}
+				outputs[s].push_back((uint32_t)p);
+				if (this->m_starts[p + 1] - this->m_starts[p] <
+					min_length) {
+					min_length = this->m_starts[p + 1] -
+						this->m_starts[p];
+				}
+			}
+
+			/* failure links, resolving missing transitions */
+			fail.assign(states, 0);
+			for (uint32_t c = 0; c < classes; ++c) {
+				uint32_t & t = this->m_table[c];
+
+				if (t == NONE) {
+					t = 0;
+				} else {
+					queue.push_back(t);
+				}
+			}
+			while (!queue.empty()) {
+				uint32_t u = queue.front();
+
+				queue.pop_front();
+				for (uint32_t c = 0; c < classes; ++c) {
+					uint32_t & t = this->m_table[u * classes + c];
+					uint32_t f = this->m_table[fail[u] *
+						classes + c];
+
+					if (t == NONE) {
+						t = f;
+						continue;
+					}
+					fail[t] = f;
+					outputs[t].insert(outputs[t].end(),
+						outputs[f].begin(), outputs[f].end());
+					queue.push_back(t);
+				}
+			}
+
+			/* flatten outputs, premultiply and flag targets */
+			this->m_accepts.resize(states);
+			for (uint32_t s = 0; s < states; ++s) {
+				this->m_accepts[s].first =
+					(uint32_t)this->m_outputs.size();
+				this->m_accepts[s].count =
+					(uint32_t)outputs[s].size();
+				this->m_outputs.insert(this->m_outputs.end(),
+					outputs[s].begin(), outputs[s].end());
+			}
+			for (size_t i = 0; i < this->m_table.size(); ++i) {
+				uint32_t t = this->m_table[i];
+
+				this->m_table[i] = t * classes |
+					(outputs[t].empty() ? 0 : ACCEPT);
+			}
+		} catch (bad_alloc & e) {
+			this->m_table.clear();
+			throw Exception(e.what());
+		}
+		if ((uint64_t)states * classes >= ACCEPT) {
+			this->m_table.clear();
+			throw Exception("too many states");
+		}
+
+		/*
+		 * shift-or over the common prefix length; bit i of a mask is
+		 * clear if some pattern has the byte at position i
+		 */
+		this->m_prefix = min_length < 64 ? (unsigned)min_length : 64;
+		for (size_t p = 0; p < n; ++p) {
+			for (unsigned i = 0; i < this->m_prefix; ++i) {
+				this->m_masks[this->m_bytes[this->m_starts[p] + i]] &=
+					~((uint64_t)1 << i);
+			}
+		}
+		for (int b = 0; b < 256; ++b) {
+			if (!(this->m_masks[b] & 1)) {
+				++starters;
+			}
+		}
+		/* not worth it when almost every byte may start a match */
+		if (this->m_prefix < 2 || starters > 128) {
+			this->m_prefix = 0;
+		}
+		this->m_compiled = true;
+	}
+
+	/*
+	 * scan a payload
+	 *
+	 * @data: payload
+	 * @length: length of the payload
+	 * @callback: receiver of the matches, offsets are in the payload
+	 *
+	 * return: number of matches reported
+	 */
+	size_t PatternMatcher::scan(const u_char * data, size_t length,
+		PatternMatcher::Callback * callback) const NG_THROWS
+	{
+		uint64_t shift = ~(uint64_t)0;
+		uint32_t state = 0;
+		size_t start = 0;
+		bool stopped = false;
+
+		if (!this->m_compiled) {
+			throw Exception("matcher is not compiled");
+		}
+		if (this->m_prefix > 0) {
+			/* no match starts before the first candidate */
+			if (!this->candidate(data, length, shift, &start)) {
+				return 0;
+			}
+		}
+		return this->run(state, data + start, length - start, start, 0,
+			callback, &stopped);
+	}
+
+	/*
+	 * scan the TCP or UDP payloads of a batch of packets
+	 *
+	 * @packets: the packets
+	 * @count: number of packets
+	 * @callback: receiver of the matches, offsets are in the payload
+	 *            and packet is the index in the batch
+	 *
+	 * return: number of matches reported
+	 */
+	size_t PatternMatcher::scan(Packet * const * packets, size_t count,
+		PatternMatcher::Callback * callback) const NG_THROWS
+	{
+		struct Dissector::Dissection d;
+		size_t matches = 0;
+
+		if (!this->m_compiled) {
+			throw Exception("matcher is not compiled");
+		}
+		for (size_t i = 0; i < count; ++i) {
+			const u_char * data = packets[i]->data();
+			size_t caplen = packets[i]->capturedLength();
+			size_t length = 0;
+			uint64_t shift = ~(uint64_t)0;
+			uint32_t state = 0;
+			size_t start = 0;
+			bool stopped = false;
+
+			Dissector::dissect(data, caplen, d);
+			length = Dissector::payloadLength(data, caplen, d);
+			if (length == 0) {
+				continue;
+			}
+			data += d.payload_offset;
+			if (this->m_prefix > 0 &&
+				!this->candidate(data, length, shift, &start)) {
+				continue;
+			}
+			matches += this->run(state, data + start, length - start,
+				start, (uint32_t)i, callback, &stopped);
+		}
+		return matches;
+	}
+
+	/*
+	 * start a stream
+	 *
+	 * @stream: the stream state to reset
+	 */
+	void PatternMatcher::reset(struct PatternMatcher::Stream & stream) const
+	{
+		stream.state = 0;
+		stream.shift = ~(uint64_t)0;
+		stream.offset = 0;
+	}
+
+	/*
+	 * scan the next segment of a reassembled stream, finding matches
+	 * that span segments
+	 *
+	 * @stream: state of the stream, from reset() or the previous segment
+	 * @data: segment
+	 * @length: length of the segment
+	 * @callback: receiver of the matches, offsets are in the stream
+	 *
+	 * return: number of matches reported
+	 */
+	size_t PatternMatcher::scan(struct PatternMatcher::Stream & stream,
+		const u_char * data, size_t length,
+		PatternMatcher::Callback * callback) const NG_THROWS
+	{
+		size_t tail = this->m_prefix > 0 ? this->m_prefix - 1 : 0;
+		uint64_t base = stream.offset;
+		uint64_t shift = stream.shift;
+		size_t start = 0;
+		size_t matches = 0;
+		bool stopped = false;
+
+		if (!this->m_compiled) {
+			throw Exception("matcher is not compiled");
+		}
+		stream.offset += length;
+
+		/*
+		 * a segment may be skipped if no pattern prefix ends in it and
+		 * no partial match of prefix length is carried into it; the
+		 * exit state then only depends on its last bytes
+		 */
+		if (this->m_prefix > 0 &&
+			this->m_depths[stream.state / this->m_class_count] <
+			this->m_prefix &&
+			!this->candidate(data, length, shift, &start)) {
+			/* the prefilter ran over the whole segment */
+			stream.shift = shift;
+			if (length >= tail) {
+				stream.state = 0;
+				data += length - tail;
+				length = tail;
+			}
+			this->run(stream.state, data, length, 0, 0, NULL,
+				&stopped);
+			return 0;
+		}
+
+		matches = this->run(stream.state, data, length, base, 0,
+			callback, &stopped);
+		/*
+		 * advance the prefilter state from before the segment, as
+		 * candidate() stopped partway if it ran; the state depends on
+		 * the last bytes only
+		 */
+		if (this->m_prefix > 0) {
+			size_t skip = length > 64 ? length - 64 : 0;
+
+			for (size_t i = skip; i < length; ++i) {
+				stream.shift = (stream.shift << 1) |
+					this->m_masks[data[i]];
+			}
+		}
+		if (stopped) {
+			this->reset(stream);
+			stream.offset = base + length;
+		}
+		return matches;
+	}
+
+	/*
+	 * get the number of patterns
+	 *
+	 * return: number of patterns
+	 */
+	size_t PatternMatcher::patterns() const
+	{
+		return this->m_ids.size();
+	}
+
+	/*
+	 * get the number of DFA states
+	 *
+	 * return: number of states, 0 before compile()
+	 */
+	size_t PatternMatcher::states() const
+	{
+		return this->m_compiled ? this->m_accepts.size() : 0;
+	}
+
+	/*
+	 * get the memory used by the patterns and the automaton
+	 *
+	 * return: memory used in bytes
+	 */
+	size_t PatternMatcher::memory() const
+	{
+		return sizeof(*this) + this->m_bytes.capacity() +
+			this->m_starts.capacity() * sizeof(uint32_t) +
+			this->m_ids.capacity() * sizeof(uint32_t) +
+			this->m_table.capacity() * sizeof(uint32_t) +
+			this->m_depths.capacity() * sizeof(uint16_t) +
+			this->m_accepts.capacity() * sizeof(struct Output) +
+			this->m_outputs.capacity() * sizeof(uint32_t);
+	}
+
+	/*
+	 * run the shift-or prefilter up to the first position where the
+	 * prefix of some pattern may end
+	 *
+	 * @data: input
+	 * @length: length of the input
+	 * @shift: shift-or state, updated
+	 * @start: set to the first position a match may start at
+	 *
+	 * return: true if a candidate was found, false otherwise
+	 */
+	bool PatternMatcher::candidate(const u_char * data, size_t length,
+		uint64_t & shift, size_t * start) const
+	{
+		uint64_t d = shift;
+		uint64_t bit = (uint64_t)1 << (this->m_prefix - 1);
+
+		for (size_t i = 0; i < length; ++i) {
+			d = (d << 1) | this->m_masks[data[i]];
+			if (!(d & bit)) {
+				shift = d;
+				*start = i + 1 >= this->m_prefix ?
+					i + 1 - this->m_prefix : 0;
+				return true;
+			}
+		}
+		shift = d;
+		return false;
+	}
+
+	/*
+	 * run the DFA over an input
+	 *
+	 * @state: DFA state, updated
+	 * @data: input
+	 * @length: length of the input
+	 * @base: offset of the input in the payload or stream
+	 * @packet: index of the packet in the batch
+	 * @callback: receiver of the matches, NULL to only advance
+	 * @stopped: set to true if the callback stopped the scan
+	 *
+	 * return: number of matches reported
+	 */
+	size_t PatternMatcher::run(uint32_t & state, const u_char * data,
+		size_t length, uint64_t base, uint32_t packet,
+		PatternMatcher::Callback * callback, bool * stopped) const
+	{
+		const uint32_t * table = &(this->m_table[0]);
+		const uint8_t * classes = this->m_classes;
+		uint32_t s = state;
+		size_t matches = 0;
+
+		*stopped = false;
+		for (size_t i = 0; i < length; ++i) {
+			uint32_t t = table[s + classes[data[i]]];
+
+			s = t & ~ACCEPT;
+			if (!(t & ACCEPT) || callback == NULL) {
+				continue;
+			}
+
+			const struct Output & out =
+				this->m_accepts[s / this->m_class_count];
+
+			for (uint32_t j = 0; j < out.count; ++j) {
+				uint32_t p = this->m_outputs[out.first + j];
+				struct Match m;
+
+				m.id = this->m_ids[p];
+				m.packet = packet;
+				m.offset = base + i + 1 -
+					(this->m_starts[p + 1] - this->m_starts[p]);
+				++matches;
+				if (!callback->onMatch(m)) {
+					*stopped = true;
+					state = s;
+					return matches;
+				}
+			}
+		}
+		state = s;
+		return matches;
+	}
+}
@@ -0,0 +1,663 @@
+/*
+ * implementation of class PcapAnalyzer
+ */
+
+#include <vector>	/* for std::vector */
+#include <string>	/* for std::string */
+#include <algorithm>	/* for std::sort */
+#include <tr1/unordered_map>	/* for std::tr1::unordered_map */
+#include <new>		/* for std::bad_alloc */
+#include <cerrno>	/* for errno */
+#include <cstring>	/* for std::strerror, std::memcpy and std::memset */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for clock_gettime */
+#include <fcntl.h>	/* for open */
+#include <unistd.h>	/* for close */
+#include <pthread.h>	/* for pthread_create and pthread_join */
+#include <sys/mman.h>	/* for mmap and madvise */
+#include <sys/stat.h>	/* for fstat */
+#include <pcap/pcap.h>	/* for DLT_EN10MB */
+
+#include "core/PcapAnalyzer.h"	/* for netgazer::PcapAnalyzer */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+#include "core/FlowKey.h"	/* for netgazer::FlowKey */
+#include "core/Topology.h"	/* for netgazer::Topology */
+
+using std::vector;
+using std::string;
+using std::sort;
+using std::bad_alloc;
+using std::strerror;
+using std::memcpy;
+using std::memset;
+
+namespace netgazer {
+	/* sizes of the file and record headers */
+	static const size_t FILE_HEADER = 24;
+	static const size_t RECORD_HEADER = 16;
+
+	/* largest frame accepted as a record */
+	static const uint32_t MAX_LENGTH = 262144;
+
+	/* records checked before a scanned offset is taken as a boundary */
+	static const int CHAIN = 16;
+
+	/* largest time step between records of a plausible chain */
+	static const uint64_t MAX_STEP_NS = 3600ULL * 1000000000ULL;
+
+	/*
+	 * order flows by key
+	 *
+	 * @a: a flow
+	 * @b: another flow
+	 *
+	 * return: true if a goes first
+	 */
+	static bool byKey(const struct PcapAnalyzer::Flow & a,
+		const struct PcapAnalyzer::Flow & b)
+	{
+		return a.key < b.key;
+	}
+
+	/*
+	 * read the monotonic clock
+	 *
+	 * return: monotonic time in seconds
+	 */
+	static double monotonic()
+	{
+		struct timespec ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+
+	/*
+	 * constructor of Options, with the defaults: one thread per CPU,
+	 * 64 MiB chunks and a five-tuple flow table
+	 */
+	PcapAnalyzer::Options::Options()
+		: threads(0), chunk_size(64 * 1024 * 1024), flows(true),
+		  key_type(FlowKey::FIVE_TUPLE)
+	{
+	}
+
+	/*
+	 * constructor of PcapAnalyzer, mapping a pcap file
+	 *
+	 * @file: path of the pcap file
+	 */
+	PcapAnalyzer::PcapAnalyzer(const char * file) NG_THROWS
+	{
+		struct stat st;
+		uint32_t magic = 0;
+		uint32_t value = 0;
+		void * p = NULL;
+		int fd = -1;
+
+		if (file == NULL) {
+			throw Exception("file is NULL");
+		}
+		if ((fd = open(file, O_RDONLY | O_CLOEXEC)) < 0) {
+			throw Exception(strerror(errno));
+		}
+		if (fstat(fd, &st) < 0) {
+			int error = errno;
+
+			::close(fd);
+			throw Exception(strerror(error));
+		}
+		if ((size_t)st.st_size < FILE_HEADER) {
+			::close(fd);
+			throw Exception("not a pcap file");
+		}
+		p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED) {
+			throw Exception(strerror(errno));
+		}
+		this->m_data = (const u_char *)p;
+		this->m_size = st.st_size;
+
+		memcpy(&magic, this->m_data, 4);
+		switch (magic) {
+		case 0xa1b2c3d4:
+		case 0xa1b23c4d:
+			this->m_swapped = false;
+			break;
+
+		case 0xd4c3b2a1:
+		case 0x4d3cb2a1:
+			this->m_swapped = true;
+			magic = __builtin_bswap32(magic);
+			break;
+
+		default:
+			munmap(p, this->m_size);
+			throw Exception("not a pcap file");
+		}
+		this->m_nano = (magic == 0xa1b23c4d);
+
+		memcpy(&value, this->m_data + 16, 4);
+		this->m_snaplen = this->m_swapped ? __builtin_bswap32(value) :
+			value;
+		if (this->m_snaplen == 0 || this->m_snaplen > MAX_LENGTH) {
+			this->m_snaplen = MAX_LENGTH;
+		}
+		memcpy(&value, this->m_data + 20, 4);
+		this->m_link_type = (int)((this->m_swapped ?
+			__builtin_bswap32(value) : value) & 0xffff);
+	}
+
+	/*
+	 * destructor of PcapAnalyzer
+	 */
+	PcapAnalyzer::~PcapAnalyzer()
+	{
+		munmap((void *)this->m_data, this->m_size);
+	}
+
+	/*
+	 * analyze the file
+	 *
+	 * @options: threads, chunking and flow table
+	 * @analysis: user analysis, or NULL; its add() runs on the worker
+	 *            threads, merge() runs under a lock; an exception
+	 *            thrown by either ends the run and is thrown here
+	 *
+	 * return: counters, flows and what was skipped
+	 */
+	struct PcapAnalyzer::Result PcapAnalyzer::run(
+		const struct PcapAnalyzer::Options & options,
+		PcapAnalyzer::Analysis * analysis) NG_THROWS
+	{
+		struct PcapAnalyzer::Result result;
+		struct PcapAnalyzer::Job job;
+		struct PcapAnalyzer::Chunk total;
+		vector<pthread_t> threads;
+		unsigned wanted = options.threads != 0 ? options.threads :
+			(unsigned)Topology::cpus();
+		double start = monotonic();
+
+		if (options.chunk_size == 0) {
+			throw Exception("chunk size is 0");
+		}
+
+		memset(&(total.totals), 0, sizeof(total.totals));
+		total.analysis = analysis;
+		total.resyncs = 0;
+		total.skipped = 0;
+
+		job.owner = this;
+		job.options = &options;
+		job.analysis = analysis;
+		job.prototype = NULL;
+		job.count = (this->m_size - FILE_HEADER + options.chunk_size -
+			1) / options.chunk_size;
+		job.next = 0;
+		job.merged = 0;
+		job.total = &total;
+		job.last_stop = FILE_HEADER;
+		job.mismatches = 0;
+		if (wanted > job.count) {
+			wanted = job.count > 0 ? (unsigned)job.count : 1;
+		}
+		try {
+			job.done.resize(job.count, NULL);
+			threads.reserve(wanted);
+			if (analysis != NULL) {
+				job.prototype = analysis->fork();
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		pthread_mutex_init(&(job.lock), NULL);
+		for (unsigned i = 0; i < wanted; ++i) {
+			pthread_t thread;
+
+			if (pthread_create(&thread, NULL, PcapAnalyzer::work,
+				&job) != 0) {
+				break;
+			}
+			threads.push_back(thread);
+		}
+		/* without threads, do the work here */
+		if (threads.empty()) {
+			PcapAnalyzer::work(&job);
+		}
+		for (vector<pthread_t>::iterator i = threads.begin();
+			i != threads.end(); ++i) {
+			pthread_join(*i, NULL);
+		}
+		pthread_mutex_destroy(&(job.lock));
+
+		for (vector<struct PcapAnalyzer::Chunk *>::iterator i =
+			job.done.begin(); i != job.done.end(); ++i) {
+			if (*i != NULL) {
+				delete (*i)->analysis;
+				delete *i;
+			}
+		}
+		delete job.prototype;
+		if (!job.error.empty()) {
+			throw Exception(job.error.c_str());
+		}
+
+		result.totals = total.totals;
+		result.chunks = job.count;
+		result.threads = threads.empty() ? 1 :
+			(unsigned)threads.size();
+		result.resyncs = total.resyncs;
+		result.skipped = total.skipped;
+		result.mismatches = job.mismatches;
+		try {
+			result.flows.reserve(total.flows.size());
+			for (PcapAnalyzer::FlowTable::const_iterator i =
+				total.flows.begin(); i != total.flows.end(); ++i) {
+				result.flows.push_back(i->second);
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		sort(result.flows.begin(), result.flows.end(), byKey);
+		result.elapsed = monotonic() - start;
+		return result;
+	}
+
+	/*
+	 * get the size of the file
+	 *
+	 * return: size in bytes
+	 */
+	size_t PcapAnalyzer::size() const
+	{
+		return this->m_size;
+	}
+
+	/*
+	 * get the link-layer header type of the file
+	 *
+	 * return: DLT_* value
+	 */
+	int PcapAnalyzer::linkType() const
+	{
+		return this->m_link_type;
+	}
+
+	/*
+	 * tell whether the file has nanosecond timestamps
+	 *
+	 * return: true for nanoseconds, false for microseconds
+	 */
+	bool PcapAnalyzer::nano() const
+	{
+		return this->m_nano;
+	}
+
+	/*
+	 * read and check a record header
+	 *
+	 * @offset: offset of the header in the file
+	 * @ts_ns: set to the timestamp in nanoseconds
+	 * @caplen: set to the captured length
+	 * @length: set to the original length
+	 *
+	 * return: true if the header is well-formed and its record lies
+	 *         within the file
+	 */
+	bool PcapAnalyzer::header(size_t offset, uint64_t * ts_ns,
+		uint32_t * caplen, uint32_t * length) const
+	{
+		uint32_t h[4];
+
+		if (offset + RECORD_HEADER > this->m_size) {
+			return false;
+		}
+		memcpy(h, this->m_data + offset, sizeof(h));
+		if (this->m_swapped) {
+			for (int i = 0; i < 4; ++i) {
+				h[i] = __builtin_bswap32(h[i]);
+			}
+		}
+		if (h[1] >= (this->m_nano ? 1000000000U : 1000000U) ||
+			h[2] > this->m_snaplen || h[2] > h[3] ||
+			h[3] > MAX_LENGTH || h[3] == 0 ||
+			h[2] > this->m_size - offset - RECORD_HEADER) {
+			return false;
+		}
+		*ts_ns = (uint64_t)h[0] * 1000000000ULL +
+			(uint64_t)h[1] * (this->m_nano ? 1 : 1000);
+		*caplen = h[2];
+		*length = h[3];
+		return true;
+	}
+
+	/*
+	 * tell whether a chain of well-formed records with close timestamps
+	 * starts at an offset
+	 *
+	 * @offset: candidate offset
+	 *
+	 * return: true if CHAIN records, or all records up to the end of
+	 *         the file, follow from the offset
+	 */
+	bool PcapAnalyzer::plausible(size_t offset) const
+	{
+		uint64_t previous = 0;
+
+		for (int i = 0; i < CHAIN && offset < this->m_size; ++i) {
+			uint64_t ts = 0;
+			uint32_t caplen = 0;
+			uint32_t length = 0;
+
+			if (!this->header(offset, &ts, &caplen, &length)) {
+				return false;
+			}
+			if (i > 0 && (ts > previous ? ts - previous :
+				previous - ts) > MAX_STEP_NS) {
+				return false;
+			}
+			previous = ts;
+			offset += RECORD_HEADER + caplen;
+		}
+		return true;
+	}
+
+	/*
+	 * find the first record boundary in a range
+	 *
+	 * @from: first candidate offset
+	 * @limit: end of the range
+	 *
+	 * return: offset of the boundary, limit if there is none
+	 */
+	size_t PcapAnalyzer::sync(size_t from, size_t limit) const
+	{
+		for (size_t offset = from; offset < limit; ++offset) {
+			if (this->plausible(offset)) {
+				return offset;
+			}
+		}
+		return limit;
+	}
+
+	/*
+	 * decode the records starting in a chunk
+	 *
+	 * @c: the chunk
+	 * @options: flow table options
+	 */
+	void PcapAnalyzer::decode(struct PcapAnalyzer::Chunk & c,
+		const struct PcapAnalyzer::Options & options) const
+	{
+		bool ethernet = (this->m_link_type == DLT_EN10MB);
+		size_t offset = c.begin;
+
+		while (offset < c.end) {
+			struct Dissector::Dissection d;
+			const u_char * data = NULL;
+			uint64_t ts = 0;
+			uint32_t caplen = 0;
+			uint32_t length = 0;
+
+			if (!this->header(offset, &ts, &caplen, &length)) {
+				size_t next = this->sync(offset + 1, c.end);
+
+				++c.resyncs;
+				c.skipped += next - offset;
+				offset = next;
+				continue;
+			}
+			data = this->m_data + offset + RECORD_HEADER;
+			offset += RECORD_HEADER + caplen;
+
+			++c.totals.packets;
+			c.totals.bytes += length;
+			c.totals.captured += caplen;
+			if (c.totals.first_ns == 0 || ts < c.totals.first_ns) {
+				c.totals.first_ns = ts;
+			}
+			if (ts > c.totals.last_ns) {
+				c.totals.last_ns = ts;
+			}
+
+			memset(&d, 0, sizeof(d));
+			if (ethernet) {
+				Dissector::dissect(data, caplen, d);
+			}
+			if (d.flags & Dissector::TRUNCATED) {
+				++c.totals.truncated;
+			}
+			if (d.flags & Dissector::HAS_IPV4) {
+				++c.totals.ipv4;
+				if (d.protocol == 6) {
+					++c.totals.tcp;
+				} else if (d.protocol == 17) {
+					++c.totals.udp;
+				}
+				if (d.flags & Dissector::FRAGMENT) {
+					++c.totals.fragments;
+				}
+			}
+
+			if (options.flows && (d.flags & Dissector::HAS_IPV4)) {
+				struct FlowKey k;
+				struct PcapAnalyzer::Flow * f = NULL;
+
+				memset(&k, 0, sizeof(k));
+				if (options.key_type != FlowKey::DESTINATION) {
+					k.src_addr = d.src_addr;
+				}
+				if (options.key_type != FlowKey::SOURCE) {
+					k.dest_addr = d.dest_addr;
+				}
+				if (options.key_type == FlowKey::FIVE_TUPLE) {
+					k.src_port = d.src_port;
+					k.dest_port = d.dest_port;
+					k.protocol = d.protocol;
+				}
+
+				f = &(c.flows[k]);
+				if (f->packets == 0) {
+					f->key = k;
+					f->first_ns = ts;
+					f->last_ns = ts;
+				}
+				++f->packets;
+				f->bytes += length;
+				if (ts < f->first_ns) {
+					f->first_ns = ts;
+				}
+				if (ts > f->last_ns) {
+					f->last_ns = ts;
+				}
+			}
+
+			if (c.analysis != NULL) {
+				c.analysis->add(ts, data, caplen, length, d);
+			}
+		}
+		c.stop = offset;
+	}
+
+	/*
+	 * fold the counters and flows of a later chunk into another
+	 *
+	 * @into: chunk merged into
+	 * @from: later chunk
+	 */
+	void PcapAnalyzer::merge(struct PcapAnalyzer::Chunk & into,
+		struct PcapAnalyzer::Chunk & from)
+	{
+		struct PcapAnalyzer::Totals & t = into.totals;
+		const struct PcapAnalyzer::Totals & u = from.totals;
+
+		t.packets += u.packets;
+		t.bytes += u.bytes;
+		t.captured += u.captured;
+		t.ipv4 += u.ipv4;
+		t.tcp += u.tcp;
+		t.udp += u.udp;
+		t.fragments += u.fragments;
+		t.truncated += u.truncated;
+		if (u.first_ns != 0 && (t.first_ns == 0 ||
+			u.first_ns < t.first_ns)) {
+			t.first_ns = u.first_ns;
+		}
+		if (u.last_ns > t.last_ns) {
+			t.last_ns = u.last_ns;
+		}
+		into.resyncs += from.resyncs;
+		into.skipped += from.skipped;
+
+		for (PcapAnalyzer::FlowTable::const_iterator i =
+			from.flows.begin(); i != from.flows.end(); ++i) {
+			struct PcapAnalyzer::Flow & f = into.flows[i->first];
+
+			if (f.packets == 0) {
+				f = i->second;
+				continue;
+			}
+			f.packets += i->second.packets;
+			f.bytes += i->second.bytes;
+			if (i->second.first_ns < f.first_ns) {
+				f.first_ns = i->second.first_ns;
+			}
+			if (i->second.last_ns > f.last_ns) {
+				f.last_ns = i->second.last_ns;
+			}
+		}
+	}
+
+	/*
+	 * free a chunk that could not be decoded and record the first
+	 * failure of the job, which stops the other workers
+	 *
+	 * @job: the job
+	 * @c: the chunk, or NULL
+	 * @error: description of the failure
+	 */
+	void PcapAnalyzer::fail(struct PcapAnalyzer::Job * job,
+		struct PcapAnalyzer::Chunk * c, const char * error)
+	{
+		if (c != NULL) {
+			delete c->analysis;
+			delete c;
+		}
+		pthread_mutex_lock(&(job->lock));
+		if (job->error.empty()) {
+			job->error = error;
+		}
+		pthread_mutex_unlock(&(job->lock));
+	}
+
+	/*
+	 * worker thread, taking chunks until none is left and merging the
+	 * finished ones in order
+	 *
+	 * @arg: the job
+	 *
+	 * return: NULL
+	 */
+	void * PcapAnalyzer::work(void * arg)
+	{
+		struct PcapAnalyzer::Job * job = (struct PcapAnalyzer::Job *)arg;
+		const PcapAnalyzer * self = job->owner;
+		size_t chunk_size = job->options->chunk_size;
+
+		for (;;) {
+			struct PcapAnalyzer::Chunk * c = NULL;
+			size_t i = 0;
+
+			pthread_mutex_lock(&(job->lock));
+			if (!job->error.empty() || job->next >= job->count) {
+				pthread_mutex_unlock(&(job->lock));
+				break;
+			}
+			i = job->next++;
+			pthread_mutex_unlock(&(job->lock));
+
+			try {
+				size_t begin = FILE_HEADER + i * chunk_size;
+
+				c = new struct PcapAnalyzer::Chunk;
+				c->analysis = NULL;
+				c->end = begin + chunk_size < self->m_size ?
+					begin + chunk_size : self->m_size;
+				c->begin = i == 0 ? begin :
+					self->sync(begin, c->end);
+				c->stop = c->end;
+				memset(&(c->totals), 0, sizeof(c->totals));
+				c->resyncs = 0;
+				c->skipped = 0;
+				if (job->prototype != NULL) {
+					c->analysis = job->prototype->fork();
+				}
+				madvise((void *)((uintptr_t)(self->m_data + begin) &
+					~(uintptr_t)4095), c->end - begin + 4095,
+					MADV_WILLNEED);
+				self->decode(*c, *(job->options));
+			} catch (bad_alloc & e) {
+				PcapAnalyzer::fail(job, c, e.what());
+				break;
+			} catch (Exception & e) {
+				PcapAnalyzer::fail(job, c, e.what());
+				break;
+			}
+
+			pthread_mutex_lock(&(job->lock));
+			job->done[i] = c;
+			while (job->error.empty() && job->merged < job->count &&
+				job->done[job->merged] != NULL) {
+				struct PcapAnalyzer::Chunk * m =
+					job->done[job->merged];
+
+				size_t expected = job->last_stop < m->end ?
+					job->last_stop : m->end;
+
+				try {
+					/*
+					 * records of a chunk start where the last one
+					 * stopped; a chunk whose scan was fooled by
+					 * record-like payload is decoded again from there
+					 */
+					if (m->begin != expected) {
+						++job->mismatches;
+						m->begin = expected;
+						memset(&(m->totals), 0, sizeof(m->totals));
+						m->flows.clear();
+						m->resyncs = 0;
+						m->skipped = 0;
+						if (m->analysis != NULL) {
+							delete m->analysis;
+							m->analysis = NULL;
+							m->analysis = job->prototype->fork();
+						}
+						self->decode(*m, *(job->options));
+					}
+					if (m->stop > job->last_stop) {
+						job->last_stop = m->stop;
+					}
+					PcapAnalyzer::merge(*(job->total), *m);
+					if (m->analysis != NULL) {
+						job->analysis->merge(*(m->analysis));
+					}
+				} catch (bad_alloc & e) {
+					job->error = e.what();
+					break;
+				} catch (Exception & e) {
+					job->error = e.what();
+					break;
+				}
+				delete m->analysis;
+				delete m;
+				job->done[job->merged++] = NULL;
+			}
+			pthread_mutex_unlock(&(job->lock));
+		}
+		return NULL;
+	}
+}
@@ -0,0 +1,621 @@
+/*
+ * implementation of class PcapReplay
+ */
+
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <cstring>	/* for std::memcpy */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for clock_gettime and nanosleep */
+#include <pcap/pcap.h>	/* for libpcap functions */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>	/* for _mm_pause */
+#endif
+
+#include "core/PcapReplay.h"	/* for netgazer::PcapReplay */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/Adapter.h"	/* for netgazer::Adapter */
+#include "core/PacketHandler.h"	/* for netgazer::PacketHandler */
+#include "core/Packet.h"	/* for netgazer::Packet */
+#include "core/IPv4Packet.h"	/* for netgazer::IPv4Packet */
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+#include "core/Trace.h"		/* for netgazer::Trace */
+
+using std::vector;
+using std::bad_alloc;
+using std::memcpy;
+
+namespace netgazer {
+	/* gaps longer than this are slept rather than spun, in nanoseconds */
+	static const uint64_t SLEEP_THRESHOLD = 200000;
+	/* how much of a slept gap is left to spin, in nanoseconds */
+	static const uint64_t SPIN_MARGIN = 100000;
+	/* packets sent later than this behind schedule count as late */
+	static const uint64_t LATE_THRESHOLD = 10000;
+
+	/*
+	 * read a clock
+	 *
+	 * @clock: clock to read
+	 *
+	 * return: time in nanoseconds
+	 */
+	static uint64_t clockNs(clockid_t clock)
+	{
+		struct timespec ts;
+
+		clock_gettime(clock, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+	/*
+	 * relax the CPU inside a spin loop
+	 */
+	static inline void relax()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#endif
+	}
+
+	/*
+	 * read a big-endian 16-bit field
+	 *
+	 * @p: field
+	 *
+	 * return: host order value
+	 */
+	static inline uint16_t be16(const u_char * p)
+	{
+		return (uint16_t)(p[0] << 8 | p[1]);
+	}
+
+	/*
+	 * write a big-endian 16-bit field
+	 *
+	 * @p: field
+	 * @value: host order value
+	 */
+	static inline void putBe16(u_char * p, uint16_t value)
+	{
+		p[0] = (u_char)(value >> 8);
+		p[1] = (u_char)value;
+	}
+
+	/*
+	 * update an internet checksum for a 32-bit field changing value,
+	 * as in RFC 1624
+	 *
+	 * @sum: checksum, host order
+	 * @from: old value of the field, host order
+	 * @to: new value of the field, host order
+	 *
+	 * return: updated checksum, host order
+	 */
+	static inline uint16_t adjust(uint16_t sum, uint32_t from, uint32_t to)
+	{
+		uint32_t s = (uint16_t)~sum;
+
+		s += (uint16_t)~(from >> 16);
+		s += (uint16_t)~from;
+		s += to >> 16;
+		s += to & 0xffff;
+		s = (s & 0xffff) + (s >> 16);
+		s = (s & 0xffff) + (s >> 16);
+		return (uint16_t)~s;
+	}
+
+	/*
+	 * constructor of Options, with the default values: the recorded
+	 * timing, one pass, no address rewriting
+	 */
+	PcapReplay::Options::Options()
+		: mode(PcapReplay::ORIGINAL), speed(1.0), rate(0.0), loops(1),
+		  address_step(0), summaries(false)
+	{
+	}
+
+	/*
+	 * constructor of PcapReplay, loading a pcap file into memory
+	 *
+	 * @file: path of the pcap file
+	 */
+	PcapReplay::PcapReplay(const char * file) NG_THROWS
+		: m_bytes(0), m_running(false), m_stop(false)
+	{
+		char errbuf[PCAP_ERRBUF_SIZE];
+		pcap_t * handle = NULL;
+		struct pcap_pkthdr * header = NULL;
+		const u_char * data = NULL;
+		int ret = 0;
+
+		if (file == NULL) {
+			throw Exception("file is NULL");
+		}
+		handle = pcap_open_offline_with_tstamp_precision(file,
+			PCAP_TSTAMP_PRECISION_NANO, errbuf);
+		if (handle == NULL) {
+			throw Exception(errbuf);
+		}
+		this->m_link_type = pcap_datalink(handle);
+
+		try {
+			while ((ret = pcap_next_ex(handle, &header, &data)) == 1) {
+				struct PcapReplay::Record r;
+
+				r.ts_ns = (uint64_t)header->ts.tv_sec * 1000000000ULL +
+					header->ts.tv_usec;
+				r.offset = this->m_data.size();
+				r.caplen = header->caplen;
+				r.length = header->len;
+				this->m_data.insert(this->m_data.end(), data,
+					data + header->caplen);
+				this->m_records.push_back(r);
+				this->m_bytes += header->len;
+			}
+		} catch (bad_alloc & e) {
+			pcap_close(handle);
+			throw Exception(e.what());
+		}
+		if (ret == -1) {
+			Exception e(pcap_geterr(handle));
+
+			pcap_close(handle);
+			throw e;
+		}
+		pcap_close(handle);
+	}
+
+	/*
+	 * destructor of PcapReplay
+	 */
+	PcapReplay::~PcapReplay()
+	{
+	}
+
+	/*
+	 * replay the file into a handler, as if it was captured; packets
+	 * come from a NULL adapter
+	 *
+	 * @handler: handler receiving the packets or summaries
+	 * @options: pacing, passes and rewriting
+	 *
+	 * return: what was sent and at which rate
+	 */
+	struct PcapReplay::Report PcapReplay::replay(PacketHandler * handler,
+		const struct PcapReplay::Options & options) NG_THROWS
+	{
+		if (handler == NULL) {
+			throw Exception("handler is NULL");
+		}
+		return this->start(handler, NULL, options);
+	}
+
+	/*
+	 * replay the file out of an opened adapter, e.g. a veth or tap
+	 * interface
+	 *
+	 * @output: adapter sending the frames
+	 * @options: pacing, passes and rewriting; summaries is ignored
+	 *
+	 * return: what was sent and at which rate
+	 */
+	struct PcapReplay::Report PcapReplay::replay(Adapter * output,
+		const struct PcapReplay::Options & options) NG_THROWS
+	{
+		if (output == NULL) {
+			throw Exception("adapter is NULL");
+		}
+		return this->start(NULL, output, options);
+	}
+
+	/*
+	 * stop a replay running in another thread after the current packet;
+	 * if none is running yet, the next one returns at once
+	 */
+	void PcapReplay::stop()
+	{
+		__atomic_store_n(&(this->m_stop), true, __ATOMIC_RELEASE);
+	}
+
+	/*
+	 * get the number of frames in the file
+	 *
+	 * return: number of frames
+	 */
+	size_t PcapReplay::packets() const
+	{
+		return this->m_records.size();
+	}
+
+	/*
+	 * get the total original length of the frames in the file
+	 *
+	 * return: number of bytes
+	 */
+	uint64_t PcapReplay::bytes() const
+	{
+		return this->m_bytes;
+	}
+
+	/*
+	 * get the time between the first and the last frame of the file
+	 *
+	 * return: duration in nanoseconds
+	 */
+	uint64_t PcapReplay::duration() const
+	{
+		if (this->m_records.size() < 2) {
+			return 0;
+		}
+		return this->m_records.back().ts_ns -
+			this->m_records.front().ts_ns;
+	}
+
+	/*
+	 * get the link-layer header type of the file
+	 *
+	 * return: DLT_* value
+	 */
+	int PcapReplay::linkType() const
+	{
+		return this->m_link_type;
+	}
+
+	/*
+	 * run a replay unless one is in progress, consuming the stop request
+	 * it ended with
+	 *
+	 * @handler: handler receiving the packets, or NULL
+	 * @output: adapter sending the frames, or NULL
+	 * @options: pacing, passes and rewriting
+	 *
+	 * return: what was sent and at which rate
+	 */
+	struct PcapReplay::Report PcapReplay::start(PacketHandler * handler,
+		Adapter * output, const struct PcapReplay::Options & options)
+		NG_THROWS
+	{
+		struct PcapReplay::Report report;
+
+		if (__atomic_exchange_n(&(this->m_running), true,
+			__ATOMIC_ACQ_REL)) {
+			throw Exception("replay is already running");
+		}
+		try {
+			report = this->run(handler, output, options);
+		} catch (Exception & e) {
+			__atomic_store_n(&(this->m_stop), false, __ATOMIC_RELAXED);
+			__atomic_store_n(&(this->m_running), false,
+				__ATOMIC_RELEASE);
+			throw e;
+		}
+		__atomic_store_n(&(this->m_stop), false, __ATOMIC_RELAXED);
+		__atomic_store_n(&(this->m_running), false, __ATOMIC_RELEASE);
+		return report;
+	}
+
+	/*
+	 * send every pass of the file on schedule
+	 *
+	 * @handler: handler receiving the packets, or NULL
+	 * @output: adapter sending the frames, or NULL
+	 * @options: pacing, passes and rewriting
+	 *
+	 * return: what was sent and at which rate
+	 */
+	struct PcapReplay::Report PcapReplay::run(PacketHandler * handler,
+		Adapter * output, const struct PcapReplay::Options & options)
+		NG_THROWS
+	{
+		struct PcapReplay::Report report = {
+			0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0.0
+		};
+		size_t count = this->m_records.size();
+		double ticks_per_ns = PcapReplay::ticksPerNs();
+		double bits = 0.0;
+		/* a pass lasts the file plus one mean gap, so loops keep pace */
+		uint64_t span = this->duration() +
+			(count > 1 ? this->duration() / (count - 1) : 0);
+		uint64_t first = count > 0 ? this->m_records[0].ts_ns : 0;
+		bool rewrite = options.address_step != 0 &&
+			this->m_link_type == DLT_EN10MB;
+		vector<u_char> scratch;
+		uint64_t start_ticks = 0;
+		uint64_t start_ns = 0;
+		uint64_t end_ticks = 0;
+		uint64_t sent = 0;
+
+		switch (options.mode) {
+		case PcapReplay::ORIGINAL:
+		case PcapReplay::FLAT_OUT:
+			break;
+
+		case PcapReplay::SCALED:
+			if (!(options.speed > 0.0)) {
+				throw Exception("speed must be positive");
+			}
+			break;
+
+		case PcapReplay::FIXED_PPS:
+		case PcapReplay::FIXED_BPS:
+			if (!(options.rate > 0.0)) {
+				throw Exception("rate must be positive");
+			}
+			break;
+
+		default:
+			throw Exception("unknown replay mode");
+		}
+		if (count == 0) {
+			return report;
+		}
+		if (rewrite) {
+			try {
+				scratch.resize(65536);
+			} catch (bad_alloc & e) {
+				throw Exception(e.what());
+			}
+		}
+
+		start_ns = clockNs(CLOCK_REALTIME);
+		start_ticks = Trace::now();
+		for (unsigned pass = 0; !this->stopping() &&
+			(options.loops == 0 || pass < options.loops); ++pass) {
+			uint32_t delta = pass * options.address_step;
+
+			for (size_t i = 0; i < count && !this->stopping(); ++i) {
+				const struct PcapReplay::Record & r =
+					this->m_records[i];
+				double target = 0.0;	/* nanoseconds from start */
+				uint64_t target_ticks = 0;
+				uint64_t now = 0;
+
+				switch (options.mode) {
+				case PcapReplay::ORIGINAL:
+					target = (double)pass * span +
+						(r.ts_ns - first);
+					break;
+
+				case PcapReplay::SCALED:
+					target = ((double)pass * span +
+						(r.ts_ns - first)) / options.speed;
+					break;
+
+				case PcapReplay::FIXED_PPS:
+					target = sent * 1e9 / options.rate;
+					break;
+
+				case PcapReplay::FIXED_BPS:
+					target = bits * 1e9 / options.rate;
+					break;
+
+				default:
+					break;
+				}
+
+				target_ticks = start_ticks +
+					(uint64_t)(target * ticks_per_ns);
+				while ((now = Trace::now()) < target_ticks &&
+					!this->stopping()) {
+					uint64_t left = (uint64_t)((target_ticks -
+						now) / ticks_per_ns);
+
+					if (left > SLEEP_THRESHOLD) {
+						struct timespec ts;
+
+						left -= SPIN_MARGIN;
+						ts.tv_sec = left / 1000000000ULL;
+						ts.tv_nsec = left % 1000000000ULL;
+						nanosleep(&ts, NULL);
+					} else {
+						relax();
+					}
+				}
+				if (this->stopping()) {
+					break;
+				}
+				if (options.mode != PcapReplay::FLAT_OUT &&
+					now > target_ticks) {
+					double late = (now - target_ticks) /
+						ticks_per_ns;
+
+					if (late > LATE_THRESHOLD) {
+						++report.late;
+					}
+					if (late * 1e-9 > report.max_lateness) {
+						report.max_lateness = late * 1e-9;
+					}
+				}
+
+				++sent;
+				bits += r.length * 8.0;
+				if (!this->deliver(handler, output, r, start_ns +
+					(uint64_t)((now - start_ticks) / ticks_per_ns),
+					rewrite ? delta : 0, options.summaries,
+					rewrite ? &scratch[0] : NULL)) {
+					++report.skipped;
+					continue;
+				}
+				++report.packets;
+				report.bytes += r.length;
+			}
+		}
+		end_ticks = Trace::now();
+
+		report.elapsed = (end_ticks - start_ticks) / ticks_per_ns * 1e-9;
+		if (report.elapsed > 0.0) {
+			report.achieved_pps = report.packets / report.elapsed;
+			report.achieved_bps = report.bytes * 8.0 / report.elapsed;
+		}
+		switch (options.mode) {
+		case PcapReplay::ORIGINAL:
+		case PcapReplay::SCALED:
+			if (span > 0) {
+				double speed = options.mode == PcapReplay::SCALED ?
+					options.speed : 1.0;
+
+				report.requested_pps = count * 1e9 / span * speed;
+				report.requested_bps = this->m_bytes * 8e9 / span *
+					speed;
+			}
+			break;
+
+		case PcapReplay::FIXED_PPS:
+			report.requested_pps = options.rate;
+			report.requested_bps = options.rate * this->m_bytes * 8.0 /
+				count;
+			break;
+
+		case PcapReplay::FIXED_BPS:
+			report.requested_bps = options.rate;
+			report.requested_pps = options.rate * count /
+				(this->m_bytes * 8.0);
+			break;
+
+		default:
+			break;
+		}
+		return report;
+	}
+
+	/*
+	 * send one frame
+	 *
+	 * @handler: handler receiving the packet, or NULL
+	 * @output: adapter sending the frame, or NULL
+	 * @r: the frame
+	 * @ts_ns: timestamp given to the packet, nanoseconds since the epoch
+	 * @delta: value added to the IPv4 addresses
+	 * @summaries: deliver a summary rather than a packet
+	 * @scratch: buffer for the rewritten frame, NULL if delta is 0
+	 *
+	 * return: false if the frame is too short to be delivered
+	 */
+	bool PcapReplay::deliver(PacketHandler * handler, Adapter * output,
+		const struct PcapReplay::Record & r, uint64_t ts_ns,
+		uint32_t delta, bool summaries, u_char * scratch)
+		NG_THROWS
+	{
+		const u_char * data = &this->m_data[0] + r.offset;
+		struct pcap_pkthdr header;
+
+		if (delta != 0 && r.caplen <= 65536) {
+			memcpy(scratch, data, r.caplen);
+			PcapReplay::rewrite(scratch, r.caplen, delta);
+			data = scratch;
+		}
+		if (output != NULL) {
+			output->inject(data, r.caplen);
+			return true;
+		}
+
+		if (r.caplen < sizeof(struct Packet::PacketHeader)) {
+			return false;
+		}
+		header.ts.tv_sec = ts_ns / 1000000000ULL;
+		header.ts.tv_usec = ts_ns % 1000000000ULL;
+		header.caplen = r.caplen;
+		header.len = r.length;
+
+		if (summaries) {
+			struct PacketSummary s;
+
+			PacketSummary::summarize(&header, data, true, s);
+			handler->onSummary(NULL, &s);
+		} else if (Packet::isIpv4Packet(&header, data)) {
+			IPv4Packet p(&header, data, true);
+
+			handler->onPacket(NULL, &p);
+		} else {
+			Packet p(&header, data, true);
+
+			handler->onPacket(NULL, &p);
+		}
+		return true;
+	}
+
+	/*
+	 * add a value to the IPv4 addresses of an Ethernet frame, fixing
+	 * the IPv4 and, unless fragmented, the TCP or UDP checksum up
+	 *
+	 * @frame: frame to rewrite in place
+	 * @caplen: captured length of the frame
+	 * @delta: value added to both addresses, in host order
+	 */
+	void PcapReplay::rewrite(u_char * frame, size_t caplen, uint32_t delta)
+	{
+		struct Dissector::Dissection d;
+		u_char * ip = NULL;
+		u_char * sum = NULL;
+		uint32_t addr[2];
+		uint32_t moved[2];
+
+		Dissector::dissect(frame, caplen, d);
+		if (!(d.flags & Dissector::HAS_IPV4) ||
+			(size_t)d.l3_offset + 20 > caplen) {
+			return;
+		}
+		ip = frame + d.l3_offset;
+
+		for (int i = 0; i < 2; ++i) {
+			u_char * p = ip + 12 + 4 * i;
+
+			addr[i] = (uint32_t)be16(p) << 16 | be16(p + 2);
+			moved[i] = addr[i] + delta;
+			putBe16(p, (uint16_t)(moved[i] >> 16));
+			putBe16(p + 2, (uint16_t)moved[i]);
+		}
+		putBe16(ip + 10, adjust(adjust(be16(ip + 10), addr[0],
+			moved[0]), addr[1], moved[1]));
+
+		/* the pseudo-header of TCP and UDP covers the addresses */
+		if ((d.flags & Dissector::FRAGMENT) || d.l4_offset == 0) {
+			return;
+		}
+		if (d.protocol == 6 && (size_t)d.l4_offset + 18 <= caplen) {
+			sum = frame + d.l4_offset + 16;
+		} else if (d.protocol == 17 &&
+			(size_t)d.l4_offset + 8 <= caplen) {
+			sum = frame + d.l4_offset + 6;
+			/* UDP without a checksum */
+			if (be16(sum) == 0) {
+				return;
+			}
+		}
+		if (sum != NULL) {
+			uint16_t value = adjust(adjust(be16(sum), addr[0],
+				moved[0]), addr[1], moved[1]);
+
+			if (d.protocol == 17 && value == 0) {
+				value = 0xffff;
+			}
+			putBe16(sum, value);
+		}
+	}
+
+	/*
+	 * get the rate of the Trace tick counter, measured once against the
+	 * monotonic clock
+	 *
+	 * return: ticks per nanosecond
+	 */
+	double PcapReplay::ticksPerNs()
+	{
+		static double rate = 0.0;
+
+		if (rate == 0.0) {
+			struct timespec ts = { 0, 10000000 };
+			uint64_t ns = clockNs(CLOCK_MONOTONIC);
+			uint64_t ticks = Trace::now();
+
+			nanosleep(&ts, NULL);
+			ticks = Trace::now() - ticks;
+			ns = clockNs(CLOCK_MONOTONIC) - ns;
+			rate = ns > 0 ? (double)ticks / ns : 1.0;
+		}
+		return rate;
+	}
+}
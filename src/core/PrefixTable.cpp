@@ -0,0 +1,174 @@
+/*
+ * implementation of class PrefixTable
+ */
+
+#include <vector>	/* for std::vector */
+#include <algorithm>	/* for std::stable_sort */
+#include <new>		/* for std::bad_alloc */
+#include <cstring>	/* for std::memset */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <arpa/inet.h>	/* for ntohl */
+
+#include "core/PrefixTable.h"	/* for netgazer::PrefixTable */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/Topology.h"	/* for netgazer::Topology */
+
+using std::vector;
+using std::stable_sort;
+using std::bad_alloc;
+using std::memset;
+
+namespace netgazer {
+	/* entries of the first-level table */
+	static const size_t TBL24_SIZE = 1 << 24;
+
+	/*
+	 * constructor of PrefixTable, matching nothing until compiled
+	 */
+	PrefixTable::PrefixTable() NG_THROWS
+	{
+		this->m_region = Topology::allocate(TBL24_SIZE *
+			sizeof(uint32_t));
+		this->m_tbl24 = (uint32_t *)this->m_region.addr;
+	}
+
+	/*
+	 * destructor of PrefixTable
+	 */
+	PrefixTable::~PrefixTable()
+	{
+		Topology::release(this->m_region);
+	}
+
+	/*
+	 * add a prefix, it takes effect at the next compile(); of two equal
+	 * prefixes the later one wins
+	 *
+	 * @addr: IPv4 address, network order; host bits are ignored
+	 * @length: prefix length, 0 to 32
+	 * @label: label id, 1 to MAX_LABEL
+	 */
+	void PrefixTable::add(uint32_t addr, unsigned length, uint32_t label)
+		NG_THROWS
+	{
+		struct PrefixTable::Prefix p;
+
+		if (length > 32) {
+			throw Exception("prefix length over 32");
+		}
+		if (label == 0 || label > PrefixTable::MAX_LABEL) {
+			throw Exception("label out of range");
+		}
+
+		p.addr = length == 0 ? 0 :
+			ntohl(addr) & (0xffffffffU << (32 - length));
+		p.length = length;
+		p.label = label;
+		try {
+			this->m_prefixes.push_back(p);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * build the lookup tables from the prefixes added so far; the table
+	 * must not be looked up meanwhile
+	 */
+	void PrefixTable::compile() NG_THROWS
+	{
+		vector<struct PrefixTable::Prefix> sorted;
+
+		/* longer prefixes are written last, over shorter ones */
+		try {
+			sorted = this->m_prefixes;
+			stable_sort(sorted.begin(), sorted.end(),
+				PrefixTable::Shorter());
+			this->m_tbl8.clear();
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		memset(this->m_tbl24, 0, TBL24_SIZE * sizeof(uint32_t));
+
+		for (vector<struct PrefixTable::Prefix>::const_iterator i =
+			sorted.begin(); i != sorted.end(); ++i) {
+			uint32_t * entries = this->m_tbl24;
+			size_t first = 0;
+			size_t count = 0;
+
+			if (i->length <= 24) {
+				first = i->addr >> 8;
+				count = (size_t)1 << (24 - i->length);
+			} else {
+				uint32_t & entry = this->m_tbl24[i->addr >> 8];
+				size_t n = this->m_tbl8.size();
+
+				/* a group inherits the label it replaces */
+				if (!(entry & PrefixTable::EXTENDED)) {
+					try {
+						this->m_tbl8.resize(n + 256, entry);
+					} catch (bad_alloc & e) {
+						throw Exception(e.what());
+					}
+					entry = PrefixTable::EXTENDED |
+						(uint32_t)(n >> 8);
+				}
+				entries = &(this->m_tbl8[(size_t)(entry ^
+					PrefixTable::EXTENDED) << 8]);
+				first = i->addr & 0xff;
+				count = (size_t)1 << (32 - i->length);
+			}
+			for (size_t j = first; j < first + count; ++j) {
+				entries[j] = i->label;
+			}
+		}
+	}
+
+	/*
+	 * find the labels of a batch of addresses; the lookups do not
+	 * depend on each other, so their memory accesses overlap
+	 *
+	 * @addrs: IPv4 addresses, network order
+	 * @labels: receives the label ids, 0 where no prefix matches
+	 * @count: number of addresses
+	 */
+	void PrefixTable::lookup(const uint32_t * addrs, uint32_t * labels,
+		size_t count) const
+	{
+		for (size_t i = 0; i < count; ++i) {
+			labels[i] = this->lookup(addrs[i]);
+		}
+	}
+
+	/*
+	 * get the number of prefixes added
+	 *
+	 * return: number of prefixes
+	 */
+	size_t PrefixTable::prefixes() const
+	{
+		return this->m_prefixes.size();
+	}
+
+	/*
+	 * get the number of 256-entry groups for prefixes longer than /24
+	 *
+	 * return: number of groups
+	 */
+	size_t PrefixTable::groups() const
+	{
+		return this->m_tbl8.size() >> 8;
+	}
+
+	/*
+	 * get the memory taken by the lookup tables
+	 *
+	 * return: bytes
+	 */
+	size_t PrefixTable::memory() const
+	{
+		return this->m_region.mapped +
+			this->m_tbl8.capacity() * sizeof(uint32_t);
+	}
+}
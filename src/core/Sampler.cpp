@@ -0,0 +1,202 @@
+/*
+ * implementation of class Sampler
+ */
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/Sampler.h"	/* for netgazer::Sampler */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+#include "core/Hash.h"		/* for netgazer::Hash */
+
+namespace netgazer {
+	/*
+	 * hash the endpoints of a flow the same way in both directions
+	 *
+	 * @src_addr: source address
+	 * @dest_addr: destination address
+	 * @src_port: source port
+	 * @dest_port: destination port
+	 * @protocol: IPv4 protocol number
+	 * @seed: hash seed
+	 *
+	 * return: 64-bit hash
+	 */
+	static inline uint64_t symmetricHash(uint32_t src_addr,
+		uint32_t dest_addr, uint16_t src_port, uint16_t dest_port,
+		uint8_t protocol, uint64_t seed)
+	{
+		if (src_addr > dest_addr ||
+			(src_addr == dest_addr && src_port > dest_port)) {
+			uint32_t addr = src_addr;
+			uint16_t port = src_port;
+
+			src_addr = dest_addr;
+			dest_addr = addr;
+			src_port = dest_port;
+			dest_port = port;
+		}
+		return Hash::mix64((((uint64_t)src_addr << 32) | dest_addr) ^
+			Hash::mix64(((uint64_t)src_port << 32) |
+			((uint64_t)dest_port << 16) | protocol) ^ seed);
+	}
+
+	/*
+	 * constructor of Sampler
+	 *
+	 * @mode: sampling mode
+	 * @rate: keep one in rate packets, 1 keeps all
+	 * @seed: seed of the random numbers and flow hashes; samplers on
+	 *        different adapters need the same seed to keep the same
+	 *        flows
+	 */
+	Sampler::Sampler(enum Sampler::Mode mode, uint32_t rate, uint64_t seed)
+		NG_THROWS
+	{
+		if (mode != Sampler::ONE_IN_N && mode != Sampler::PROBABILISTIC &&
+			mode != Sampler::FLOW_HASH) {
+			throw Exception("unknown sampling mode");
+		}
+
+		this->m_mode = mode;
+		this->m_seed = seed;
+		this->m_skip = 0;
+		this->m_state = Hash::mix64(seed) | 1;
+		this->m_offered = 0;
+		this->m_kept = 0;
+		this->setRate(rate);
+	}
+
+	/*
+	 * change the sampling rate, may be called from any thread
+	 *
+	 * @rate: keep one in rate packets, 0 or 1 keeps all
+	 */
+	void Sampler::setRate(uint32_t rate)
+	{
+		if (rate == 0) {
+			rate = 1;
+		}
+		__atomic_store_n(&(this->m_rate), rate, __ATOMIC_RELAXED);
+		__atomic_store_n(&(this->m_threshold),
+			((uint64_t)1 << 32) / rate, __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * get the current sampling rate
+	 *
+	 * return: one in this many packets is kept
+	 */
+	uint32_t Sampler::rate() const
+	{
+		return __atomic_load_n(&(this->m_rate), __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * get the sampling mode
+	 *
+	 * return: enum Sampler::Mode
+	 */
+	enum Sampler::Mode Sampler::mode() const
+	{
+		return this->m_mode;
+	}
+
+	/*
+	 * get the number of packets offered since the last reset
+	 *
+	 * return: number of packets
+	 */
+	uint64_t Sampler::offered() const
+	{
+		return this->m_offered;
+	}
+
+	/*
+	 * get the number of packets kept since the last reset
+	 *
+	 * return: number of packets
+	 */
+	uint64_t Sampler::kept() const
+	{
+		return this->m_kept;
+	}
+
+	/*
+	 * get the sampling rate actually achieved since the last reset,
+	 * which in FLOW_HASH mode depends on the flow size distribution
+	 *
+	 * return: offered packets per kept packet
+	 */
+	double Sampler::effectiveRate() const
+	{
+		if (this->m_kept == 0) {
+			return (double)this->rate();
+		}
+		return (double)this->m_offered / this->m_kept;
+	}
+
+	/*
+	 * reset the packet counters
+	 */
+	void Sampler::resetCounters()
+	{
+		this->m_offered = 0;
+		this->m_kept = 0;
+	}
+
+	/*
+	 * hash the flow of a captured frame; frames without IPv4 hash by
+	 * their MAC addresses in one direction only, and IPv4 packets
+	 * without ports by addresses and protocol
+	 *
+	 * @data: frame data
+	 * @caplen: captured length
+	 * @seed: hash seed
+	 *
+	 * return: 64-bit hash
+	 */
+	uint64_t Sampler::flowHash(const u_char * data, size_t caplen,
+		uint64_t seed)
+	{
+		struct Dissector::Dissection d;
+
+		Dissector::dissect(data, caplen, d);
+		if (d.flags & Dissector::HAS_IPV4) {
+			if (!(d.flags & Dissector::HAS_PORTS)) {
+				d.src_port = 0;
+				d.dest_port = 0;
+			}
+			return symmetricHash(d.src_addr, d.dest_addr, d.src_port,
+				d.dest_port, d.protocol, seed);
+		}
+		/* as PacketSummary::mac_hash */
+		return Hash::mix64((caplen >= 12 ?
+			(uint32_t)Hash::bytes(data, 12) : 0) ^ seed);
+	}
+
+	/*
+	 * hash the flow of a summarized packet, equal to the hash of the
+	 * frame it was summarized from
+	 *
+	 * @s: summary record of the packet
+	 * @seed: hash seed
+	 *
+	 * return: 64-bit hash
+	 */
+	uint64_t Sampler::flowHash(const struct PacketSummary & s,
+		uint64_t seed)
+	{
+		bool ports = s.flags & PacketSummary::PORTS;
+
+		if (s.flags & PacketSummary::IPV4) {
+			return symmetricHash(s.src_addr, s.dest_addr,
+				ports ? s.src_port : 0, ports ? s.dest_port : 0,
+				s.protocol, seed);
+		}
+		return Hash::mix64(s.mac_hash ^ seed);
+	}
+}
@@ -0,0 +1,116 @@
+/*
+ * implementation of class SamplingController
+ */
+
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for struct pcap_stat */
+
+#include "core/SamplingController.h"	/* for netgazer::SamplingController */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "core/Adapter.h"		/* for netgazer::Adapter */
+#include "core/Sampler.h"		/* for netgazer::Sampler */
+
+namespace netgazer {
+	/*
+	 * constructor of SamplingController
+	 *
+	 * @sampler: sampler to drive
+	 * @max_rate: highest rate to sample at, one in max_rate packets
+	 * @high_mark: queue fill ratio above which the rate is raised
+	 * @low_mark: queue fill ratio below which the rate may be lowered
+	 * @patience: consecutive calm updates before lowering the rate
+	 */
+	SamplingController::SamplingController(Sampler * sampler,
+		uint32_t max_rate, double high_mark, double low_mark,
+		unsigned patience) NG_THROWS
+	{
+		if (sampler == NULL) {
+			throw Exception("sampler is NULL");
+		}
+		if (max_rate == 0 || low_mark < 0.0 || low_mark > high_mark ||
+			high_mark > 1.0) {
+			throw Exception("invalid controller parameters");
+		}
+
+		this->m_sampler = sampler;
+		this->m_max_rate = max_rate;
+		this->m_high_mark = high_mark;
+		this->m_low_mark = low_mark;
+		this->m_patience = patience > 0 ? patience : 1;
+		this->m_calm = 0;
+		this->m_primed = false;
+		this->m_last_drops = 0;
+		this->m_drops = 0;
+	}
+
+	/*
+	 * adjust the sampling rate to the current load
+	 *
+	 * @depth: number of packets waiting for analysis
+	 * @capacity: capacity of the queue holding them
+	 * @stats: current capture statistics of the adapter
+	 *
+	 * return: the new sampling rate
+	 */
+	uint32_t SamplingController::update(size_t depth, size_t capacity,
+		const struct pcap_stat & stats)
+	{
+		uint64_t total = (uint64_t)stats.ps_drop + stats.ps_ifdrop;
+		uint64_t dropped = 0;
+		double fill = capacity > 0 ? (double)depth / capacity : 0.0;
+		uint32_t rate = this->m_sampler->rate();
+
+		/* counters may wrap or be reset by a reopen */
+		if (this->m_primed && total >= this->m_last_drops) {
+			dropped = total - this->m_last_drops;
+		}
+		this->m_primed = true;
+		this->m_last_drops = total;
+		this->m_drops += dropped;
+
+		if (dropped > 0 || fill >= this->m_high_mark) {
+			rate = rate > this->m_max_rate / 2 ?
+				this->m_max_rate : rate * 2;
+			this->m_calm = 0;
+		} else if (fill <= this->m_low_mark) {
+			if (++this->m_calm >= this->m_patience) {
+				rate = rate > 1 ? rate / 2 : 1;
+				this->m_calm = 0;
+			}
+		} else {
+			this->m_calm = 0;
+		}
+
+		this->m_sampler->setRate(rate);
+		return rate;
+	}
+
+	/*
+	 * adjust the sampling rate to the current load of an adapter
+	 *
+	 * @adapter: opened adapter the sampler is attached to
+	 * @depth: number of packets waiting for analysis
+	 * @capacity: capacity of the queue holding them
+	 *
+	 * return: the new sampling rate
+	 */
+	uint32_t SamplingController::update(Adapter * adapter, size_t depth,
+		size_t capacity) NG_THROWS
+	{
+		if (adapter == NULL) {
+			throw Exception("adapter is NULL");
+		}
+		return this->update(depth, capacity, adapter->stats());
+	}
+
+	/*
+	 * get the number of kernel drops observed across updates
+	 *
+	 * return: number of dropped packets
+	 */
+	uint64_t SamplingController::drops() const
+	{
+		return this->m_drops;
+	}
+}
@@ -0,0 +1,334 @@
+/*
+ * implementation of class SharedConsumer
+ */
+
+#include <cerrno>	/* for errno */
+#include <cstring>	/* for std::strerror */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <fcntl.h>	/* for O_* constants */
+#include <unistd.h>	/* for getpid and close */
+#include <sys/mman.h>	/* for shm_open and mmap */
+#include <sys/stat.h>	/* for fstat */
+
+#include "core/SharedConsumer.h"	/* for netgazer::SharedConsumer */
+#include "core/SharedRing.h"		/* for netgazer::SharedRing */
+#include "core/Exception.h"		/* for netgazer::Exception */
+
+using std::strerror;
+
+namespace netgazer {
+	/*
+	 * constructor of SharedConsumer, attaching to a named ring
+	 *
+	 * @name: POSIX shared memory name given to the SharedPublisher
+	 * @oldest: start at the oldest packet still in the ring instead of
+	 *          the next one published
+	 */
+	SharedConsumer::SharedConsumer(const char * name, bool oldest)
+		NG_THROWS
+	{
+		int fd = shm_open(name, O_RDWR, 0);
+
+		if (fd < 0) {
+			throw Exception(strerror(errno));
+		}
+		try {
+			this->attach(fd, oldest);
+		} catch (Exception & e) {
+			::close(fd);
+			throw e;
+		}
+		::close(fd);
+	}
+
+	/*
+	 * constructor of SharedConsumer, attaching to the ring behind a file
+	 * descriptor, e.g. an anonymous ring received over a UNIX socket
+	 *
+	 * @fd: file descriptor of the ring, not closed
+	 * @oldest: start at the oldest packet still in the ring instead of
+	 *          the next one published
+	 */
+	SharedConsumer::SharedConsumer(int fd, bool oldest) NG_THROWS
+	{
+		this->attach(fd, oldest);
+	}
+
+	/*
+	 * destructor of SharedConsumer, unregistering from the ring
+	 */
+	SharedConsumer::~SharedConsumer()
+	{
+		uint64_t token = this->m_token;
+
+		/* unless the publisher already freed it */
+		if (this->m_reader != NULL) {
+			__atomic_compare_exchange_n(&(this->m_reader->owner),
+				&token, 0, false, __ATOMIC_ACQ_REL,
+				__ATOMIC_RELAXED);
+		}
+		munmap(this->m_header, this->m_header->size);
+	}
+
+	/*
+	 * get the next packet, skipping the ones the publisher overwrote
+	 * before they were read
+	 *
+	 * @view: set to the packet
+	 *
+	 * return: true if a packet was available, false otherwise
+	 */
+	bool SharedConsumer::next(struct SharedConsumer::View & view)
+	{
+		for (;;) {
+			const struct SharedRing::Slot * s =
+				(const struct SharedRing::Slot *)(this->m_slots +
+				(this->m_cursor & this->m_mask) * this->m_stride);
+			uint64_t want = 2 * this->m_cursor + 2;
+			uint64_t seq = __atomic_load_n(&(s->sequence),
+				__ATOMIC_ACQUIRE);
+			uint64_t head = 0;
+			uint64_t target = 0;
+			uint64_t skip = 0;
+
+			if (seq == want) {
+				view.sequence = this->m_cursor;
+				view.ts_ns = s->ts_ns;
+				view.caplen = s->caplen;
+				view.length = s->length;
+				view.data = (const u_char *)(s + 1);
+				if (view.caplen > this->m_stride -
+					sizeof(struct SharedRing::Slot)) {
+					/* torn read of an overwritten slot */
+					view.caplen = 0;
+				}
+				/* the header fields were overwritten under us */
+				if (!this->valid(view)) {
+					continue;
+				}
+				++this->m_cursor;
+				++this->m_received;
+				break;
+			}
+			if (seq < want) {
+				/* not published yet, a good time to renew */
+				this->renew();
+				return false;
+			}
+
+			/* lapped: resume at the oldest slot not being written */
+			head = __atomic_load_n(&(this->m_header->head),
+				__ATOMIC_ACQUIRE);
+			target = head > this->m_mask ? head - this->m_mask : 0;
+			skip = target > this->m_cursor ?
+				target - this->m_cursor : 1;
+			this->m_cursor += skip;
+			this->m_drops += skip;
+		}
+
+		/* the clock is read on every 1024th packet only */
+		if ((this->m_received & 1023) == 0) {
+			this->renew();
+		}
+		/* the entry is another reader's once the lease ran out */
+		if (this->m_reader != NULL &&
+			__atomic_load_n(&(this->m_reader->owner),
+			__ATOMIC_RELAXED) == this->m_token) {
+			__atomic_store_n(&(this->m_reader->cursor), this->m_cursor,
+				__ATOMIC_RELAXED);
+			__atomic_store_n(&(this->m_reader->drops), this->m_drops,
+				__ATOMIC_RELAXED);
+		}
+		return true;
+	}
+
+	/*
+	 * check that the publisher did not overwrite a view, to be called
+	 * after the data of the view was used
+	 *
+	 * @view: view returned by next()
+	 *
+	 * return: true if everything read through the view is intact
+	 */
+	bool SharedConsumer::valid(const struct SharedConsumer::View & view)
+		const
+	{
+		const struct SharedRing::Slot * s =
+			(const struct SharedRing::Slot *)(this->m_slots +
+			(view.sequence & this->m_mask) * this->m_stride);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		return __atomic_load_n(&(s->sequence), __ATOMIC_RELAXED) ==
+			2 * view.sequence + 2;
+	}
+
+	/*
+	 * get the number of the next packet to read
+	 *
+	 * return: cursor
+	 */
+	uint64_t SharedConsumer::cursor() const
+	{
+		return this->m_cursor;
+	}
+
+	/*
+	 * get the number of packets published but not read yet
+	 *
+	 * return: lag in packets
+	 */
+	uint64_t SharedConsumer::lag() const
+	{
+		uint64_t head = __atomic_load_n(&(this->m_header->head),
+			__ATOMIC_ACQUIRE);
+
+		return head > this->m_cursor ? head - this->m_cursor : 0;
+	}
+
+	/*
+	 * get the number of packets read
+	 *
+	 * return: number of packets
+	 */
+	uint64_t SharedConsumer::received() const
+	{
+		return this->m_received;
+	}
+
+	/*
+	 * get the number of packets overwritten before they were read
+	 *
+	 * return: number of packets
+	 */
+	uint64_t SharedConsumer::drops() const
+	{
+		return this->m_drops;
+	}
+
+	/*
+	 * tell whether the reader is listed in the ring for the publisher
+	 * to report, which fails once MAX_READERS readers are attached
+	 *
+	 * return: true if registered
+	 */
+	bool SharedConsumer::registered() const
+	{
+		return this->m_reader != NULL;
+	}
+
+	/*
+	 * map a ring and register as a reader
+	 *
+	 * @fd: file descriptor of the ring
+	 * @oldest: start at the oldest packet still in the ring
+	 */
+	void SharedConsumer::attach(int fd, bool oldest) NG_THROWS
+	{
+		struct SharedRing::Header * h = NULL;
+		struct stat st;
+		void * p = NULL;
+		uint64_t head = 0;
+
+		if (fstat(fd, &st) < 0) {
+			throw Exception(strerror(errno));
+		}
+		if ((size_t)st.st_size < SharedRing::slotsOffset()) {
+			throw Exception("not a packet ring");
+		}
+		p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0);
+		if (p == MAP_FAILED) {
+			throw Exception(strerror(errno));
+		}
+
+		h = (struct SharedRing::Header *)p;
+		if (__atomic_load_n(&(h->magic), __ATOMIC_ACQUIRE) !=
+			SharedRing::MAGIC || h->version != SharedRing::VERSION ||
+			h->size != (uint64_t)st.st_size || h->slot_count == 0 ||
+			(h->slot_count & (h->slot_count - 1)) != 0 ||
+			h->stride <= sizeof(struct SharedRing::Slot) ||
+			SharedRing::slotsOffset() + h->slot_count * h->stride >
+			h->size) {
+			munmap(p, st.st_size);
+			throw Exception("not a packet ring");
+		}
+
+		this->m_header = h;
+		this->m_slots = (const u_char *)p + SharedRing::slotsOffset();
+		this->m_mask = h->slot_count - 1;
+		this->m_stride = h->stride;
+		this->m_received = 0;
+		this->m_drops = 0;
+		head = __atomic_load_n(&(h->head), __ATOMIC_ACQUIRE);
+		this->m_cursor = oldest && head > h->slot_count ? head - h->slot_count :
+			(oldest ? 0 : head);
+
+		this->m_reader = NULL;
+		this->m_renew_ns = 0;
+		/* unique enough across processes and namespaces */
+		this->m_token = (SharedRing::now() ^
+			((uint64_t)getpid() << 40) ^
+			(uint64_t)(uintptr_t)this) | 1;
+		this->renew();
+	}
+
+	/*
+	 * register as a reader in a free entry of the ring, if any
+	 *
+	 * @now: current time, see SharedRing::now()
+	 */
+	void SharedConsumer::claim(uint64_t now)
+	{
+		for (int i = 0; i < SharedRing::MAX_READERS; ++i) {
+			struct SharedRing::Reader * r =
+				&(this->m_header->readers[i]);
+			uint64_t free = 0;
+
+			if (__atomic_load_n(&(r->owner), __ATOMIC_RELAXED) != 0) {
+				continue;
+			}
+			/* lease first, the publisher never sees a stale one */
+			__atomic_store_n(&(r->lease_ns), now +
+				SharedRing::LEASE_MS * 1000000ULL,
+				__ATOMIC_RELAXED);
+			if (__atomic_compare_exchange_n(&(r->owner), &free,
+				this->m_token, false, __ATOMIC_ACQ_REL,
+				__ATOMIC_RELAXED)) {
+				__atomic_store_n(&(r->pid), (int32_t)getpid(),
+					__ATOMIC_RELAXED);
+				__atomic_store_n(&(r->cursor), this->m_cursor,
+					__ATOMIC_RELAXED);
+				__atomic_store_n(&(r->drops), this->m_drops,
+					__ATOMIC_RELAXED);
+				this->m_reader = r;
+				return;
+			}
+		}
+	}
+
+	/*
+	 * extend the lease of the reader entry, a few times per lease, and
+	 * claim a new entry if the publisher freed it in the meantime
+	 */
+	void SharedConsumer::renew()
+	{
+		uint64_t now = SharedRing::now();
+
+		if (now < this->m_renew_ns) {
+			return;
+		}
+		this->m_renew_ns = now + SharedRing::LEASE_MS * 1000000ULL / 4;
+
+		if (this->m_reader != NULL &&
+			__atomic_load_n(&(this->m_reader->owner),
+			__ATOMIC_ACQUIRE) == this->m_token) {
+			__atomic_store_n(&(this->m_reader->lease_ns), now +
+				SharedRing::LEASE_MS * 1000000ULL,
+				__ATOMIC_RELEASE);
+			return;
+		}
+		this->m_reader = NULL;
+		this->claim(now);
+	}
+}
@@ -0,0 +1,348 @@
+/*
+ * implementation of class SharedPublisher
+ */
+
+#include <string>	/* for std::string */
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <cerrno>	/* for errno */
+#include <cstring>	/* for std::strerror and std::memcpy */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for struct timespec */
+#include <fcntl.h>	/* for O_* constants */
+#include <unistd.h>	/* for ftruncate and close */
+#include <sys/mman.h>	/* for shm_open, memfd_create and mmap */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/SharedPublisher.h"	/* for netgazer::SharedPublisher */
+#include "core/SharedRing.h"		/* for netgazer::SharedRing */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "core/Packet.h"		/* for netgazer::Packet */
+#include "core/TruncationPolicy.h"	/* for netgazer::TruncationPolicy */
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+using std::string;
+using std::vector;
+using std::bad_alloc;
+using std::strerror;
+using std::memcpy;
+
+namespace netgazer {
+	/*
+	 * constructor of SharedPublisher, creating the ring
+	 *
+	 * @name: POSIX shared memory name such as "/netgazer", which must
+	 *        not exist yet, or NULL for an anonymous memfd to be handed
+	 *        to consumers through fd()
+	 * @slot_count: number of packets the ring holds, rounded up to a power
+	 *         of two
+	 * @snaplen: maximum bytes stored per packet, longer packets are
+	 *           truncated
+	 */
+	SharedPublisher::SharedPublisher(const char * name, size_t slot_count,
+		size_t snaplen) NG_THROWS
+	{
+		struct SharedRing::Header * h = NULL;
+		size_t count = 1;
+		size_t size = 0;
+		void * p = NULL;
+
+		if (slot_count == 0 || snaplen == 0) {
+			throw Exception("ring is empty");
+		}
+		while (count < slot_count) {
+			count <<= 1;
+		}
+		this->m_stride = (sizeof(struct SharedRing::Slot) + snaplen +
+			63) & ~(size_t)63;
+		this->m_snaplen = this->m_stride - sizeof(struct SharedRing::Slot);
+		size = SharedRing::slotsOffset() + count * this->m_stride;
+
+		try {
+			this->m_name = name != NULL ? name : "";
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		/* never take over the ring of a running publisher */
+		if (name != NULL) {
+			this->m_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL,
+				0600);
+		} else {
+			this->m_fd = memfd_create("netgazer", MFD_CLOEXEC);
+		}
+		if (this->m_fd < 0 && errno == EEXIST) {
+			throw Exception("shared memory name is in use");
+		}
+		if (this->m_fd < 0) {
+			throw Exception(strerror(errno));
+		}
+		if (ftruncate(this->m_fd, size) < 0) {
+			int error = errno;
+
+			::close(this->m_fd);
+			if (name != NULL) {
+				shm_unlink(name);
+			}
+			throw Exception(strerror(error));
+		}
+
+		/* fault every page in now rather than on the capture path */
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, this->m_fd, 0);
+		if (p == MAP_FAILED) {
+			int error = errno;
+
+			::close(this->m_fd);
+			if (name != NULL) {
+				shm_unlink(name);
+			}
+			throw Exception(strerror(error));
+		}
+
+		h = (struct SharedRing::Header *)p;
+		h->version = SharedRing::VERSION;
+		h->slot_count = count;
+		h->stride = this->m_stride;
+		h->size = size;
+		h->head = 0;
+		/* consumers only attach once the magic is there */
+		__atomic_store_n(&(h->magic), (uint32_t)SharedRing::MAGIC,
+			__ATOMIC_RELEASE);
+
+		this->m_header = h;
+		this->m_slots = (u_char *)p + SharedRing::slotsOffset();
+		this->m_mask = count - 1;
+		this->m_head = 0;
+		this->m_truncated = 0;
+		this->m_truncation = NULL;
+		this->charge(size);
+	}
+
+	/*
+	 * destructor of SharedPublisher, a named ring is unlinked but stays
+	 * mapped by the consumers attached to it
+	 */
+	SharedPublisher::~SharedPublisher()
+	{
+		this->release(this->m_header->size);
+		munmap(this->m_header, this->m_header->size);
+		::close(this->m_fd);
+		if (!this->m_name.empty()) {
+			shm_unlink(this->m_name.c_str());
+		}
+	}
+
+	/*
+	 * publish a delivered packet
+	 *
+	 * @adapter: adapter the packet was captured on
+	 * @packet: the packet
+	 */
+	void SharedPublisher::onPacket(Adapter * /* adapter */, Packet * packet)
+		NG_THROWS
+	{
+		struct timespec ts = packet->preciseTimestamp();
+
+		this->publish((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec,
+			packet->data(), (uint32_t)packet->capturedLength(),
+			(uint32_t)packet->length());
+	}
+
+	/*
+	 * publish a frame
+	 *
+	 * @header: pcap header of the frame
+	 * @data: frame data
+	 * @nano: whether the timestamp carries nanoseconds
+	 */
+	void SharedPublisher::publish(const struct pcap_pkthdr * header,
+		const u_char * data, bool nano)
+	{
+		this->publish((uint64_t)header->ts.tv_sec * 1000000000ULL +
+			(uint64_t)header->ts.tv_usec * (nano ? 1 : 1000),
+			data, header->caplen, header->len);
+	}
+
+	/*
+	 * publish a frame, overwriting the oldest slot; never blocks; the
+	 * truncation policy, if any, decides how much of it is stored
+	 *
+	 * @ts_ns: timestamp in nanoseconds since the epoch
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @length: original length of the frame
+	 */
+	void SharedPublisher::publish(uint64_t ts_ns, const u_char * data,
+		uint32_t caplen, uint32_t length)
+	{
+		uint64_t n = this->m_head;
+		struct SharedRing::Slot * s = (struct SharedRing::Slot *)
+			(this->m_slots + (n & this->m_mask) * this->m_stride);
+
+		if (this->m_truncation != NULL) {
+			caplen = (uint32_t)this->m_truncation->retain(data,
+				caplen);
+		}
+		if (caplen > this->m_snaplen) {
+			caplen = (uint32_t)this->m_snaplen;
+			++this->m_truncated;
+		}
+
+		/* odd while written, the fence keeps it ahead of the data */
+		__atomic_store_n(&(s->sequence), 2 * n + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		s->ts_ns = ts_ns;
+		s->caplen = caplen;
+		s->length = length;
+		memcpy(s + 1, data, caplen);
+		__atomic_store_n(&(s->sequence), 2 * n + 2, __ATOMIC_RELEASE);
+
+		this->m_head = n + 1;
+		__atomic_store_n(&(this->m_header->head), n + 1,
+			__ATOMIC_RELEASE);
+	}
+
+	/*
+	 * store only what a policy keeps of published frames, the policy
+	 * is not owned by the publisher
+	 *
+	 * @policy: the policy, NULL to store frames up to the snaplen
+	 */
+	void SharedPublisher::setTruncation(TruncationPolicy * policy)
+	{
+		this->m_truncation = policy;
+	}
+
+	/*
+	 * get the policy published frames are cut by
+	 *
+	 * return: the policy, NULL if frames are stored up to the snaplen
+	 */
+	TruncationPolicy * SharedPublisher::truncation() const
+	{
+		return this->m_truncation;
+	}
+
+	/*
+	 * get the registered readers, freeing the entries of readers whose
+	 * lease ran out
+	 *
+	 * return: one entry per live reader
+	 */
+	vector<struct SharedPublisher::ReaderInfo> SharedPublisher::readers()
+		const NG_THROWS
+	{
+		vector<struct SharedPublisher::ReaderInfo> readers;
+		uint64_t now = SharedRing::now();
+
+		try {
+			for (int i = 0; i < SharedRing::MAX_READERS; ++i) {
+				struct SharedRing::Reader * r =
+					&(this->m_header->readers[i]);
+				struct SharedPublisher::ReaderInfo info;
+				uint64_t owner = __atomic_load_n(&(r->owner),
+					__ATOMIC_ACQUIRE);
+
+				if (owner == 0) {
+					continue;
+				}
+				/* the reader stopped renewing, it is gone */
+				if (__atomic_load_n(&(r->lease_ns),
+					__ATOMIC_RELAXED) < now) {
+					__atomic_compare_exchange_n(&(r->owner),
+						&owner, 0, false, __ATOMIC_ACQ_REL,
+						__ATOMIC_RELAXED);
+					continue;
+				}
+				info.pid = __atomic_load_n(&(r->pid),
+					__ATOMIC_RELAXED);
+				info.cursor = __atomic_load_n(&(r->cursor),
+					__ATOMIC_RELAXED);
+				info.lag = this->m_head > info.cursor ?
+					this->m_head - info.cursor : 0;
+				info.drops = __atomic_load_n(&(r->drops),
+					__ATOMIC_RELAXED);
+				readers.push_back(info);
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		return readers;
+	}
+
+	/*
+	 * get the number of packets published
+	 *
+	 * return: number of packets
+	 */
+	uint64_t SharedPublisher::published() const
+	{
+		return this->m_head;
+	}
+
+	/*
+	 * get the number of packets cut at the snaplen of the ring
+	 *
+	 * return: number of packets
+	 */
+	uint64_t SharedPublisher::truncated() const
+	{
+		return this->m_truncated;
+	}
+
+	/*
+	 * get the number of slots
+	 *
+	 * return: number of packets the ring holds
+	 */
+	size_t SharedPublisher::slotCount() const
+	{
+		return this->m_mask + 1;
+	}
+
+	/*
+	 * get the maximum bytes stored per packet
+	 *
+	 * return: snaplen of the ring
+	 */
+	size_t SharedPublisher::snaplen() const
+	{
+		return this->m_snaplen;
+	}
+
+	/*
+	 * get the file descriptor of the ring, e.g. to pass an anonymous
+	 * ring to a consumer over a UNIX socket
+	 *
+	 * return: file descriptor
+	 */
+	int SharedPublisher::fd() const
+	{
+		return this->m_fd;
+	}
+
+	/*
+	 * get the shared memory name of the ring
+	 *
+	 * return: name, empty for an anonymous ring
+	 */
+	const char * SharedPublisher::name() const
+	{
+		return this->m_name.c_str();
+	}
+
+	/*
+	 * give memory back, which the ring cannot do while consumers may
+	 * read it
+	 *
+	 * @bytes: amount of memory asked back
+	 *
+	 * return: 0
+	 */
+	size_t SharedPublisher::shed(size_t /* bytes */)
+	{
+		return 0;
+	}
+}
@@ -0,0 +1,382 @@
+/*
+ * implementation of class SubnetTagger
+ */
+
+#include <string>	/* for std::string */
+#include <deque>	/* for std::deque */
+#include <map>		/* for std::map */
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <cstdio>	/* for std::fopen, std::fgets and std::sscanf */
+#include <cstring>	/* for std::memset */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pthread.h>	/* for pthread functions */
+#include <sched.h>	/* for sched_yield */
+#include <arpa/inet.h>	/* for htonl */
+
+#include "core/SubnetTagger.h"		/* for netgazer::SubnetTagger */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "core/PrefixTable.h"		/* for netgazer::PrefixTable */
+#include "core/PacketSummary.h"		/* for netgazer::PacketSummary */
+
+using std::string;
+using std::deque;
+using std::map;
+using std::vector;
+using std::bad_alloc;
+using std::fopen;
+using std::fgets;
+using std::sscanf;
+using std::fclose;
+using std::memset;
+
+namespace netgazer {
+	/*
+	 * parse a line of a prefix file
+	 *
+	 * @line: the line
+	 * @addr: set to the address, network order
+	 * @length: set to the prefix length
+	 * @name: receives the label name, 256 bytes
+	 *
+	 * return: true for a prefix, false for an empty or comment line
+	 */
+	static bool parse(const char * line, uint32_t * addr, unsigned * length,
+		char * name) NG_THROWS
+	{
+		unsigned a = 0, b = 0, c = 0, d = 0;
+		char first = '\0';
+
+		if (sscanf(line, " %c", &first) != 1 || first == '#') {
+			return false;
+		}
+		if (sscanf(line, " %u.%u.%u.%u/%u %255s", &a, &b, &c, &d,
+			length, name) != 6 || a > 255 || b > 255 || c > 255 ||
+			d > 255) {
+			throw Exception("malformed line in prefix file");
+		}
+		*addr = htonl(a << 24 | b << 16 | c << 8 | d);
+		return true;
+	}
+
+	/*
+	 * constructor of SubnetTagger::Reader
+	 *
+	 * @owner: tagger the reader looks up in
+	 */
+	SubnetTagger::Reader::Reader(SubnetTagger * owner)
+	{
+		this->m_owner = owner;
+		this->m_generation = 0;
+	}
+
+	/*
+	 * find the labels of a batch of addresses, only to be called by
+	 * the owning thread
+	 *
+	 * @addrs: IPv4 addresses, network order
+	 * @labels: receives the label ids, 0 where no prefix matches
+	 * @count: number of addresses
+	 */
+	void SubnetTagger::Reader::lookup(const uint32_t * addrs,
+		uint32_t * labels, size_t count)
+	{
+		const PrefixTable * table = this->enter();
+
+		if (table != NULL) {
+			table->lookup(addrs, labels, count);
+		} else {
+			memset(labels, 0, count * sizeof(uint32_t));
+		}
+		this->leave();
+	}
+
+	/*
+	 * find the source and destination labels of a batch of packets,
+	 * only to be called by the owning thread; packets without IPv4
+	 * addresses get label 0
+	 *
+	 * @summaries: summary records
+	 * @count: number of records
+	 * @src_labels: receives the source labels
+	 * @dest_labels: receives the destination labels
+	 */
+	void SubnetTagger::Reader::tag(const struct PacketSummary * summaries,
+		size_t count, uint32_t * src_labels, uint32_t * dest_labels)
+	{
+		const PrefixTable * table = this->enter();
+
+		for (size_t i = 0; i < count; ++i) {
+			if (table == NULL ||
+				!(summaries[i].flags & PacketSummary::IPV4)) {
+				src_labels[i] = 0;
+				dest_labels[i] = 0;
+				continue;
+			}
+			src_labels[i] = table->lookup(summaries[i].src_addr);
+			dest_labels[i] = table->lookup(summaries[i].dest_addr);
+		}
+		this->leave();
+	}
+
+	/*
+	 * announce the current generation and take the current table
+	 *
+	 * return: the table, NULL if none was installed
+	 */
+	const PrefixTable * SubnetTagger::Reader::enter()
+	{
+		SubnetTagger * owner = this->m_owner;
+		uint64_t g = __atomic_load_n(&(owner->m_generation),
+			__ATOMIC_SEQ_CST);
+
+		/* the table is read after the generation is published */
+		__atomic_store_n(&(this->m_generation), g, __ATOMIC_SEQ_CST);
+		return __atomic_load_n(&(owner->m_table), __ATOMIC_SEQ_CST);
+	}
+
+	/*
+	 * announce that the table taken by enter() is no longer used
+	 */
+	void SubnetTagger::Reader::leave()
+	{
+		__atomic_store_n(&(this->m_generation), 0, __ATOMIC_RELEASE);
+	}
+
+	/*
+	 * constructor of SubnetTagger, tagging nothing until a table is
+	 * installed
+	 */
+	SubnetTagger::SubnetTagger() NG_THROWS
+	{
+		this->m_table = NULL;
+		this->m_generation = 1;
+		pthread_mutex_init(&(this->m_lock), NULL);
+		pthread_mutex_init(&(this->m_install_lock), NULL);
+	}
+
+	/*
+	 * destructor of SubnetTagger; the readers must no longer be used
+	 */
+	SubnetTagger::~SubnetTagger()
+	{
+		for (vector<Reader *>::iterator i = this->m_readers.begin();
+			i != this->m_readers.end(); ++i) {
+			delete *i;
+		}
+		delete this->m_table;
+		pthread_mutex_destroy(&(this->m_install_lock));
+		pthread_mutex_destroy(&(this->m_lock));
+	}
+
+	/*
+	 * create a lookup handle for a capture thread, it is owned by the
+	 * tagger
+	 *
+	 * return: a pointer to the reader
+	 */
+	SubnetTagger::Reader * SubnetTagger::reader() NG_THROWS
+	{
+		Reader * r = NULL;
+
+		try {
+			r = new Reader(this);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		pthread_mutex_lock(&(this->m_lock));
+		try {
+			this->m_readers.push_back(r);
+		} catch (bad_alloc & e) {
+			pthread_mutex_unlock(&(this->m_lock));
+			delete r;
+			throw Exception(e.what());
+		}
+		pthread_mutex_unlock(&(this->m_lock));
+		return r;
+	}
+
+	/*
+	 * get the label id of a name, assigning the next id to a new name
+	 *
+	 * @name: label name
+	 *
+	 * return: label id, starting at 1
+	 */
+	uint32_t SubnetTagger::label(const char * name) NG_THROWS
+	{
+		map<string, uint32_t>::iterator i;
+		size_t n = 0;
+		uint32_t id = 0;
+
+		if (name == NULL) {
+			throw Exception("name is NULL");
+		}
+
+		pthread_mutex_lock(&(this->m_lock));
+		try {
+			string key(name);
+
+			i = this->m_labels.find(key);
+			n = this->m_names.size();
+			if (i != this->m_labels.end()) {
+				id = i->second;
+			} else if (n >= PrefixTable::MAX_LABEL) {
+				pthread_mutex_unlock(&(this->m_lock));
+				throw Exception("too many labels");
+			} else {
+				this->m_names.push_back(key);
+				id = this->m_names.size();
+				this->m_labels[key] = id;
+			}
+		} catch (bad_alloc & e) {
+			pthread_mutex_unlock(&(this->m_lock));
+			throw Exception(e.what());
+		}
+		pthread_mutex_unlock(&(this->m_lock));
+		return id;
+	}
+
+	/*
+	 * get the name of a label id
+	 *
+	 * @label: label id
+	 *
+	 * return: the name, NULL for label 0 or an unknown id
+	 */
+	const char * SubnetTagger::name(uint32_t label) const
+	{
+		const char * name = NULL;
+
+		pthread_mutex_lock(&(this->m_lock));
+		if (label != 0 && label <= this->m_names.size()) {
+			name = this->m_names[label - 1].c_str();
+		}
+		pthread_mutex_unlock(&(this->m_lock));
+		return name;
+	}
+
+	/*
+	 * get the number of label names
+	 *
+	 * return: number of labels
+	 */
+	size_t SubnetTagger::labels() const
+	{
+		size_t n = 0;
+
+		pthread_mutex_lock(&(this->m_lock));
+		n = this->m_names.size();
+		pthread_mutex_unlock(&(this->m_lock));
+		return n;
+	}
+
+	/*
+	 * make a compiled table current and free the previous one once no
+	 * reader uses it; it returns when the previous table is freed
+	 *
+	 * @table: compiled table, owned by the tagger from now on
+	 */
+	void SubnetTagger::install(PrefixTable * table) NG_THROWS
+	{
+		PrefixTable * old = NULL;
+		uint64_t generation = 0;
+
+		if (table == NULL) {
+			throw Exception("table is NULL");
+		}
+
+		pthread_mutex_lock(&(this->m_install_lock));
+		old = __atomic_exchange_n(&(this->m_table), table,
+			__ATOMIC_SEQ_CST);
+		generation = __atomic_add_fetch(&(this->m_generation), 1,
+			__ATOMIC_SEQ_CST);
+
+		/* readers never go away, so they can be walked by index */
+		for (size_t i = 0; ; ++i) {
+			Reader * r = NULL;
+			uint64_t g = 0;
+
+			pthread_mutex_lock(&(this->m_lock));
+			if (i < this->m_readers.size()) {
+				r = this->m_readers[i];
+			}
+			pthread_mutex_unlock(&(this->m_lock));
+			if (r == NULL) {
+				break;
+			}
+
+			/* a reader that entered before the swap may use old */
+			while ((g = __atomic_load_n(&(r->m_generation),
+				__ATOMIC_SEQ_CST)) != 0 && g < generation) {
+				sched_yield();
+			}
+		}
+		delete old;
+		pthread_mutex_unlock(&(this->m_install_lock));
+	}
+
+	/*
+	 * build a table from a prefix file and install it
+	 *
+	 * The file has one "a.b.c.d/length name" pair per line; empty lines
+	 * and lines starting with '#' are ignored.
+	 *
+	 * @file: path of the prefix file
+	 */
+	void SubnetTagger::load(const char * file) NG_THROWS
+	{
+		PrefixTable * table = NULL;
+		FILE * f = NULL;
+		char line[512];
+
+		if (file == NULL) {
+			throw Exception("file is NULL");
+		}
+		if ((f = fopen(file, "r")) == NULL) {
+			throw Exception("failed to open prefix file");
+		}
+
+		try {
+			table = new PrefixTable();
+			while (fgets(line, sizeof(line), f) != NULL) {
+				uint32_t addr = 0;
+				unsigned length = 0;
+				char name[256];
+
+				if (parse(line, &addr, &length, name)) {
+					table->add(addr, length,
+						this->label(name));
+				}
+			}
+			fclose(f);
+			f = NULL;
+			table->compile();
+		} catch (bad_alloc & e) {
+			if (f != NULL) {
+				fclose(f);
+			}
+			delete table;
+			throw Exception(e.what());
+		} catch (Exception & e) {
+			if (f != NULL) {
+				fclose(f);
+			}
+			delete table;
+			throw;
+		}
+		this->install(table);
+	}
+
+	/*
+	 * get the generation of the current table
+	 *
+	 * return: 1 before any install, then bumped by each
+	 */
+	uint64_t SubnetTagger::generation() const
+	{
+		return __atomic_load_n(&(this->m_generation), __ATOMIC_RELAXED);
+	}
+}
@@ -0,0 +1,133 @@
+/*
+ * implementation of class SummaryBuffer
+ */
+
+#include <new>		/* for std::bad_alloc */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "core/SummaryBuffer.h"	/* for netgazer::SummaryBuffer */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/Topology.h"	/* for netgazer::Topology */
+
+using std::bad_alloc;
+
+namespace netgazer {
+	/*
+	 * constructor of SummaryBuffer
+	 *
+	 * @capacity: maximum number of retained records
+	 * @node: NUMA node to place the records on, -1 for any
+	 * @huge_pages: back the records with huge pages when available
+	 */
+	SummaryBuffer::SummaryBuffer(size_t capacity, int node, bool huge_pages)
+		NG_THROWS
+	{
+		if (capacity == 0) {
+			throw Exception("capacity is 0");
+		}
+
+		this->m_region.addr = NULL;
+		if (node >= 0 || huge_pages) {
+			this->m_region = Topology::allocate(capacity *
+				sizeof(struct PacketSummary), node, huge_pages ?
+				Topology::HUGE_1G : Topology::SMALL_PAGES);
+			this->m_records = (struct PacketSummary *)
+				this->m_region.addr;
+		} else {
+			try {
+				this->m_records = new struct PacketSummary[capacity];
+			} catch (bad_alloc & e) {
+				throw Exception(e.what());
+			}
+		}
+		this->m_capacity = capacity;
+		this->m_head = 0;
+		this->m_size = 0;
+		this->m_total = 0;
+	}
+
+	/*
+	 * destructor of SummaryBuffer
+	 */
+	SummaryBuffer::~SummaryBuffer()
+	{
+		if (this->m_region.addr != NULL) {
+			Topology::release(this->m_region);
+		} else {
+			delete[] this->m_records;
+		}
+	}
+
+	/*
+	 * get the number of retained records
+	 *
+	 * return: number of retained records
+	 */
+	size_t SummaryBuffer::size() const
+	{
+		return this->m_size;
+	}
+
+	/*
+	 * get the maximum number of retained records
+	 *
+	 * return: capacity of this SummaryBuffer
+	 */
+	size_t SummaryBuffer::capacity() const
+	{
+		return this->m_capacity;
+	}
+
+	/*
+	 * get the number of records ever pushed, including overwritten ones
+	 *
+	 * return: total number of records
+	 */
+	uint64_t SummaryBuffer::total() const
+	{
+		return this->m_total;
+	}
+
+	/*
+	 * drop all retained records
+	 */
+	void SummaryBuffer::clear()
+	{
+		this->m_head = 0;
+		this->m_size = 0;
+	}
+
+	/*
+	 * get the retained records as at most two contiguous arrays in
+	 * oldest-first order, so that aggregation loops can run over plain
+	 * arrays instead of calling at() per record
+	 *
+	 * @first: set to the older part
+	 * @first_size: set to the number of records in first
+	 * @second: set to the newer part
+	 * @second_size: set to the number of records in second
+	 *
+	 * return: total number of records
+	 */
+	size_t SummaryBuffer::segments(const struct PacketSummary ** first,
+		size_t * first_size, const struct PacketSummary ** second,
+		size_t * second_size) const
+	{
+		size_t start = (this->m_head + this->m_capacity - this->m_size) %
+			this->m_capacity;
+
+		*first = this->m_records + start;
+		if (start + this->m_size <= this->m_capacity) {
+			*first_size = this->m_size;
+			*second = this->m_records;
+			*second_size = 0;
+		} else {
+			*first_size = this->m_capacity - start;
+			*second = this->m_records;
+			*second_size = this->m_size - *first_size;
+		}
+		return this->m_size;
+	}
+}
@@ -0,0 +1,664 @@
+/*
+ * implementation of class TcpAnalyzer
+ */
+
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <cstring>	/* for std::memset */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for struct timespec */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/TcpAnalyzer.h"	/* for netgazer::TcpAnalyzer */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/Packet.h"	/* for netgazer::Packet */
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+#include "core/Hash.h"		/* for netgazer::Hash */
+#include "core/Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+using std::vector;
+using std::bad_alloc;
+using std::memset;
+
+namespace netgazer {
+	/* connections per bucket */
+	static const size_t WAYS = 4;
+	/* RTT not measured */
+	static const uint32_t NO_RTT = 0xffffffffU;
+	/* out-of-order window before an RTT is known, microseconds */
+	static const uint32_t DEFAULT_REORDER_WINDOW = 3000;
+
+	/* TCP flags */
+	enum {
+		TCP_FIN = 0x01,
+		TCP_SYN = 0x02,
+		TCP_RST = 0x04,
+		TCP_ACK = 0x10,
+	};
+
+	/*
+	 * hash a connection the same in both directions
+	 *
+	 * @d: dissection of a segment of the connection
+	 *
+	 * return: 64-bit hash
+	 */
+	static inline uint64_t connectionHash(
+		const struct Dissector::Dissection & d)
+	{
+		uint64_t addrs = ((uint64_t)(d.src_addr + d.dest_addr) << 32) |
+			(d.src_addr ^ d.dest_addr);
+		uint64_t ports = ((uint64_t)(d.src_port + d.dest_port) << 16) |
+			(uint16_t)(d.src_port ^ d.dest_port);
+
+		return Hash::mix64(addrs ^ Hash::mix64(ports));
+	}
+
+	/*
+	 * increment a counter, saturating
+	 *
+	 * @n: counter
+	 */
+	static inline void bump(uint16_t & n)
+	{
+		if (n != 0xffff) {
+			++n;
+		}
+	}
+
+	/*
+	 * add a value to a histogram
+	 *
+	 * @h: histogram
+	 * @v: value
+	 */
+	static inline void accumulate(struct TcpAnalyzer::Histogram & h,
+		uint32_t v)
+	{
+		++h.buckets[v == 0 ? 0 : 31 - __builtin_clz(v)];
+		++h.count;
+		h.sum += v;
+	}
+
+	/*
+	 * constructor of TcpAnalyzer
+	 *
+	 * @capacity: maximum number of tracked connections, rounded up to a
+	 *            power of two
+	 * @idle_timeout: seconds without packets before expire() removes a
+	 *                connection
+	 */
+	TcpAnalyzer::TcpAnalyzer(size_t capacity, unsigned idle_timeout)
+		NG_THROWS
+	{
+		size_t buckets = 1;
+
+		if (capacity < WAYS) {
+			throw Exception("capacity too small");
+		}
+		while (buckets * WAYS < capacity) {
+			buckets <<= 1;
+		}
+
+		this->m_bucket_mask = buckets - 1;
+		this->m_idle_timeout = (uint64_t)idle_timeout * 1000000;
+		this->m_listener = NULL;
+		try {
+			this->m_table = new struct TcpAnalyzer::Connection[buckets *
+				WAYS];
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		this->clear();
+		this->charge(this->memory());
+	}
+
+	/*
+	 * destructor of TcpAnalyzer
+	 */
+	TcpAnalyzer::~TcpAnalyzer()
+	{
+		this->release(this->memory());
+		delete[] this->m_table;
+	}
+
+	/*
+	 * analyze a delivered packet
+	 *
+	 * @adapter: adapter the packet was captured on
+	 * @packet: the packet
+	 */
+	void TcpAnalyzer::onPacket(Adapter * /* adapter */, Packet * packet)
+		NG_THROWS
+	{
+		struct Dissector::Dissection d;
+		const u_char * data = packet->data();
+		size_t caplen = packet->capturedLength();
+		struct timespec ts = packet->preciseTimestamp();
+
+		Dissector::dissect(data, caplen, d);
+		this->add((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec,
+			data, caplen, d);
+	}
+
+	/*
+	 * analyze a frame
+	 *
+	 * @header: pcap header of the frame
+	 * @data: frame data
+	 * @nano: whether the timestamp carries nanoseconds
+	 */
+	void TcpAnalyzer::add(const struct pcap_pkthdr * header,
+		const u_char * data, bool nano)
+	{
+		struct Dissector::Dissection d;
+
+		Dissector::dissect(data, header->caplen, d);
+		this->add((uint64_t)header->ts.tv_sec * 1000000000ULL +
+			(uint64_t)header->ts.tv_usec * (nano ? 1 : 1000),
+			data, header->caplen, d);
+	}
+
+	/*
+	 * analyze a dissected frame, anything but a TCP segment is ignored
+	 *
+	 * @ts_ns: timestamp in nanoseconds since the epoch
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @d: dissection of the frame
+	 */
+	void TcpAnalyzer::add(uint64_t ts_ns, const u_char * data,
+		size_t /* caplen */, const struct Dissector::Dissection & d)
+	{
+		struct TcpAnalyzer::Connection * c = NULL;
+		uint64_t now_us = ts_ns / 1000;
+		uint64_t elapsed = 0;
+		uint32_t now = 0;
+		uint32_t length = 0;
+		size_t headers = 0;
+		uint8_t flags = d.tcp_flags;
+		int side = 0;
+
+		if (d.protocol != 6 || !(d.flags & Dissector::HAS_PORTS)) {
+			return;
+		}
+		++this->m_totals.packets;
+		c = this->lookup(d, now_us, &side);
+		if (c == NULL || c->state == TcpAnalyzer::CLOSED) {
+			return;
+		}
+
+		elapsed = now_us > c->first_seen ? now_us - c->first_seen : 0;
+		now = (uint32_t)elapsed;
+		c->last_seen = (uint32_t)(elapsed / 1000);
+
+		if (flags & TCP_RST) {
+			this->close(c, TcpAnalyzer::RESET);
+			return;
+		}
+
+		/* the segment length from the IPv4 total length, not caplen */
+		headers = d.payload_offset - d.l3_offset;
+		length = (data[d.l3_offset + 2] << 8) | data[d.l3_offset + 3];
+		length = length > headers ? length - headers : 0;
+		length += (flags & TCP_SYN ? 1 : 0) + (flags & TCP_FIN ? 1 : 0);
+
+		/* handshake */
+		if ((flags & (TCP_SYN | TCP_ACK)) == TCP_SYN) {
+			if (side == 0 && (c->flags & TcpAnalyzer::SEQ_KNOWN)) {
+				c->flags |= TcpAnalyzer::SYN_RETRANSMITTED;
+			}
+		} else if (flags & TCP_SYN) {
+			if (side == 1 && c->state == TcpAnalyzer::SYN_SENT &&
+				d.ack == c->next_seq[0]) {
+				c->rtt[0] = now;
+				c->state = TcpAnalyzer::SYN_RECEIVED;
+			} else if (side == 1) {
+				c->flags |= TcpAnalyzer::SYN_RETRANSMITTED;
+			}
+		} else if (side == 0 && c->state == TcpAnalyzer::SYN_RECEIVED &&
+			(flags & TCP_ACK) && d.ack == c->next_seq[1]) {
+			c->state = TcpAnalyzer::ESTABLISHED;
+			if (!(c->flags & TcpAnalyzer::SYN_RETRANSMITTED)) {
+				c->rtt[1] = now - c->rtt[0];
+				accumulate(this->m_server_rtt, c->rtt[0]);
+				accumulate(this->m_client_rtt, c->rtt[1]);
+				accumulate(this->m_handshake_rtt, now);
+				++this->m_totals.handshakes;
+			}
+		}
+
+		this->sequence(c, side, d.seq, length, now);
+
+		/* zero window, counted once until the window opens again */
+		if (!(flags & TCP_SYN)) {
+			uint8_t bit = TcpAnalyzer::ZERO_WINDOW << side;
+
+			if (d.window != 0) {
+				c->flags &= ~bit;
+			} else if (!(c->flags & bit)) {
+				c->flags |= bit;
+				bump(c->zero_windows[side]);
+				++this->m_totals.zero_windows;
+			}
+		}
+
+		if (flags & TCP_FIN) {
+			c->flags |= TcpAnalyzer::FIN_SEEN << side;
+			if ((c->flags & (TcpAnalyzer::FIN_SEEN * 3)) ==
+				TcpAnalyzer::FIN_SEEN * 3) {
+				this->close(c, TcpAnalyzer::FINISHED);
+			}
+		}
+	}
+
+	/*
+	 * report and remove the connections idle past the timeout
+	 *
+	 * @now_ns: current time in nanoseconds since the epoch, in the
+	 *          clock of the packet timestamps
+	 *
+	 * return: number of entries removed
+	 */
+	size_t TcpAnalyzer::expire(uint64_t now_ns)
+	{
+		uint64_t now_us = now_ns / 1000;
+		size_t n = 0;
+
+		for (size_t i = 0; i < this->capacity(); ++i) {
+			struct TcpAnalyzer::Connection * c = &(this->m_table[i]);
+			uint64_t last = c->first_seen +
+				(uint64_t)c->last_seen * 1000;
+
+			if (c->state == TcpAnalyzer::FREE || now_us <= last ||
+				now_us - last <= this->m_idle_timeout) {
+				continue;
+			}
+			if (c->state != TcpAnalyzer::CLOSED) {
+				this->close(c, TcpAnalyzer::EXPIRED);
+				++this->m_totals.expirations;
+			}
+			c->state = TcpAnalyzer::FREE;
+			++n;
+		}
+		return n;
+	}
+
+	/*
+	 * get the connections currently tracked and not closed
+	 *
+	 * return: one record per connection
+	 */
+	vector<struct TcpAnalyzer::Record> TcpAnalyzer::connections() const
+		NG_THROWS
+	{
+		vector<struct TcpAnalyzer::Record> records;
+
+		try {
+			for (size_t i = 0; i < this->capacity(); ++i) {
+				const struct TcpAnalyzer::Connection * c =
+					&(this->m_table[i]);
+				struct TcpAnalyzer::Record r;
+
+				if (c->state == TcpAnalyzer::FREE ||
+					c->state == TcpAnalyzer::CLOSED) {
+					continue;
+				}
+				this->record(c, 0, r);
+				records.push_back(r);
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		return records;
+	}
+
+	/*
+	 * set the receiver of connections leaving the table
+	 *
+	 * @listener: the listener, NULL for none
+	 */
+	void TcpAnalyzer::setListener(TcpAnalyzer::Listener * listener)
+	{
+		this->m_listener = listener;
+	}
+
+	/*
+	 * get the aggregate counters
+	 *
+	 * return: the counters
+	 */
+	const struct TcpAnalyzer::Totals & TcpAnalyzer::totals() const
+	{
+		return this->m_totals;
+	}
+
+	/*
+	 * get the histogram of the server leg of the handshake RTT
+	 *
+	 * return: histogram in microseconds
+	 */
+	const struct TcpAnalyzer::Histogram & TcpAnalyzer::serverRtt() const
+	{
+		return this->m_server_rtt;
+	}
+
+	/*
+	 * get the histogram of the client leg of the handshake RTT
+	 *
+	 * return: histogram in microseconds
+	 */
+	const struct TcpAnalyzer::Histogram & TcpAnalyzer::clientRtt() const
+	{
+		return this->m_client_rtt;
+	}
+
+	/*
+	 * get the histogram of the full handshake RTT, SYN to ACK
+	 *
+	 * return: histogram in microseconds
+	 */
+	const struct TcpAnalyzer::Histogram & TcpAnalyzer::handshakeRtt() const
+	{
+		return this->m_handshake_rtt;
+	}
+
+	/*
+	 * drop all connections and reset the counters, without reporting
+	 */
+	void TcpAnalyzer::clear()
+	{
+		memset(this->m_table, 0, (this->m_bucket_mask + 1) * WAYS *
+			sizeof(struct TcpAnalyzer::Connection));
+		memset(&(this->m_totals), 0, sizeof(this->m_totals));
+		memset(&(this->m_server_rtt), 0, sizeof(this->m_server_rtt));
+		memset(&(this->m_client_rtt), 0, sizeof(this->m_client_rtt));
+		memset(&(this->m_handshake_rtt), 0,
+			sizeof(this->m_handshake_rtt));
+	}
+
+	/*
+	 * get the maximum number of tracked connections
+	 *
+	 * return: capacity of the table
+	 */
+	size_t TcpAnalyzer::capacity() const
+	{
+		return (this->m_bucket_mask + 1) * WAYS;
+	}
+
+	/*
+	 * get the memory used
+	 *
+	 * return: memory used in bytes
+	 */
+	size_t TcpAnalyzer::memory() const
+	{
+		return sizeof(*this) + this->capacity() *
+			sizeof(struct TcpAnalyzer::Connection);
+	}
+
+	/*
+	 * give memory back, which the fixed table cannot do
+	 *
+	 * @bytes: amount of memory asked back
+	 *
+	 * return: 0
+	 */
+	size_t TcpAnalyzer::shed(size_t /* bytes */)
+	{
+		return 0;
+	}
+
+	/*
+	 * describe the state for a Checkpoint; connections keep their
+	 * timestamps, so those idle over the restart expire as usual
+	 *
+	 * @extents: the extents are appended to it
+	 */
+	void TcpAnalyzer::extents(
+		vector<struct Checkpointable::Extent> & extents) const
+		NG_THROWS
+	{
+		struct Checkpointable::Extent x[] = {
+			{ &(this->m_bucket_mask), sizeof(this->m_bucket_mask),
+				true },
+			{ this->m_table, this->capacity() *
+				sizeof(struct TcpAnalyzer::Connection), false },
+			{ &(this->m_totals), sizeof(this->m_totals), false },
+			{ &(this->m_server_rtt), sizeof(this->m_server_rtt),
+				false },
+			{ &(this->m_client_rtt), sizeof(this->m_client_rtt),
+				false },
+			{ &(this->m_handshake_rtt),
+				sizeof(this->m_handshake_rtt), false },
+		};
+
+		try {
+			extents.insert(extents.end(), x, x + 6);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * estimate a quantile of a histogram
+	 *
+	 * @h: histogram
+	 * @q: quantile in [0, 1]
+	 *
+	 * return: upper bound of the bucket holding the quantile, 0 if the
+	 *         histogram is empty
+	 */
+	uint64_t TcpAnalyzer::quantile(const struct TcpAnalyzer::Histogram & h,
+		double q)
+	{
+		uint64_t rank = (uint64_t)(q * h.count + 0.5);
+		uint64_t seen = 0;
+
+		if (h.count == 0) {
+			return 0;
+		}
+		if (rank == 0) {
+			rank = 1;
+		}
+		for (int i = 0; i < 32; ++i) {
+			seen += h.buckets[i];
+			if (seen >= rank) {
+				return ((uint64_t)1 << (i + 1)) - 1;
+			}
+		}
+		return 0xffffffffULL;
+	}
+
+	/*
+	 * find the connection of a segment, tracking a new one if needed
+	 *
+	 * @d: dissection of the segment
+	 * @now_us: timestamp of the segment in microseconds
+	 * @side: set to the side that sent the segment
+	 *
+	 * return: the connection, NULL if the segment starts none
+	 */
+	struct TcpAnalyzer::Connection * TcpAnalyzer::lookup(
+		const struct Dissector::Dissection & d, uint64_t now_us,
+		int * side)
+	{
+		struct TcpAnalyzer::Connection * bucket = &(this->m_table[
+			(connectionHash(d) & this->m_bucket_mask) * WAYS]);
+		struct TcpAnalyzer::Connection * victim = NULL;
+		bool syn = (d.tcp_flags & (TCP_SYN | TCP_ACK)) == TCP_SYN;
+
+		for (size_t i = 0; i < WAYS; ++i) {
+			struct TcpAnalyzer::Connection * c = &(bucket[i]);
+
+			if (c->state == TcpAnalyzer::FREE) {
+				continue;
+			}
+			if (c->addr[0] == d.src_addr && c->addr[1] == d.dest_addr &&
+				c->port[0] == d.src_port &&
+				c->port[1] == d.dest_port) {
+				*side = 0;
+			} else if (c->addr[0] == d.dest_addr &&
+				c->addr[1] == d.src_addr &&
+				c->port[0] == d.dest_port &&
+				c->port[1] == d.src_port) {
+				*side = 1;
+			} else {
+				continue;
+			}
+			/* a new SYN reuses the ports of a closed connection */
+			if (!(syn && c->state == TcpAnalyzer::CLOSED)) {
+				return c;
+			}
+			victim = c;
+			break;
+		}
+		if (d.tcp_flags & TCP_RST) {
+			return NULL;
+		}
+
+		/* free entry, else closed, else least recently seen */
+		for (size_t i = 0; victim == NULL && i < WAYS; ++i) {
+			if (bucket[i].state == TcpAnalyzer::FREE) {
+				victim = &(bucket[i]);
+			}
+		}
+		for (size_t i = 0; victim == NULL && i < WAYS; ++i) {
+			if (bucket[i].state == TcpAnalyzer::CLOSED) {
+				victim = &(bucket[i]);
+			}
+		}
+		if (victim == NULL) {
+			victim = &(bucket[0]);
+			for (size_t i = 1; i < WAYS; ++i) {
+				if (bucket[i].first_seen +
+					(uint64_t)bucket[i].last_seen * 1000 <
+					victim->first_seen +
+					(uint64_t)victim->last_seen * 1000) {
+					victim = &(bucket[i]);
+				}
+			}
+			this->close(victim, TcpAnalyzer::EVICTED);
+			++this->m_totals.evictions;
+		}
+
+		memset(victim, 0, sizeof(*victim));
+		victim->first_seen = now_us;
+		victim->addr[0] = d.src_addr;
+		victim->addr[1] = d.dest_addr;
+		victim->port[0] = d.src_port;
+		victim->port[1] = d.dest_port;
+		victim->rtt[0] = NO_RTT;
+		victim->rtt[1] = NO_RTT;
+		if (syn) {
+			victim->state = TcpAnalyzer::SYN_SENT;
+		} else {
+			victim->state = TcpAnalyzer::ESTABLISHED;
+			victim->flags = TcpAnalyzer::NO_CLIENT;
+		}
+		++this->m_totals.connections;
+		*side = 0;
+		return victim;
+	}
+
+	/*
+	 * track the sequence space of a side, classifying segments that
+	 * carry nothing new
+	 *
+	 * @c: the connection
+	 * @side: side that sent the segment
+	 * @seq: sequence number of the segment
+	 * @length: sequence space taken, SYN and FIN included
+	 * @now: microseconds since the connection was first seen
+	 */
+	void TcpAnalyzer::sequence(struct TcpAnalyzer::Connection * c, int side,
+		uint32_t seq, uint32_t length, uint32_t now)
+	{
+		uint8_t bit = TcpAnalyzer::SEQ_KNOWN << side;
+		uint32_t end = seq + length;
+		uint32_t window = DEFAULT_REORDER_WINDOW;
+
+		if (!(c->flags & bit)) {
+			c->flags |= bit;
+			c->next_seq[side] = end;
+			c->advanced[side] = now;
+			return;
+		}
+		if (length == 0) {
+			return;
+		}
+		if ((int32_t)(end - c->next_seq[side]) > 0) {
+			c->next_seq[side] = end;
+			c->advanced[side] = now;
+			return;
+		}
+
+		/* late within one RTT is reordering, later is a resend */
+		if (c->rtt[1] != NO_RTT) {
+			window = c->rtt[0] + c->rtt[1];
+		}
+		if (now - c->advanced[side] < window) {
+			bump(c->out_of_order[side]);
+			++this->m_totals.out_of_order;
+		} else {
+			bump(c->retransmissions[side]);
+			++this->m_totals.retransmissions;
+		}
+	}
+
+	/*
+	 * report a connection to the listener and mark it closed
+	 *
+	 * @c: the connection
+	 * @reason: enum Flag bit saying why it left
+	 */
+	void TcpAnalyzer::close(struct TcpAnalyzer::Connection * c,
+		uint8_t reason)
+	{
+		if (this->m_listener != NULL) {
+			struct TcpAnalyzer::Record r;
+
+			this->record(c, reason, r);
+			this->m_listener->onConnection(r);
+		}
+		c->state = TcpAnalyzer::CLOSED;
+	}
+
+	/*
+	 * fill in the record of a connection
+	 *
+	 * @c: the connection
+	 * @reason: enum Flag bits to add
+	 * @r: record to fill in
+	 */
+	void TcpAnalyzer::record(const struct TcpAnalyzer::Connection * c,
+		uint8_t reason, struct TcpAnalyzer::Record & r) const
+	{
+		bool measured = c->rtt[1] != NO_RTT;
+
+		r.addr[0] = c->addr[0];
+		r.addr[1] = c->addr[1];
+		r.port[0] = c->port[0];
+		r.port[1] = c->port[1];
+		r.first_seen = c->first_seen * 1000;
+		r.last_seen = (c->first_seen + (uint64_t)c->last_seen * 1000) *
+			1000;
+		r.server_rtt = measured ? c->rtt[0] : 0;
+		r.client_rtt = measured ? c->rtt[1] : 0;
+		for (int i = 0; i < 2; ++i) {
+			r.retransmissions[i] = c->retransmissions[i];
+			r.out_of_order[i] = c->out_of_order[i];
+			r.zero_windows[i] = c->zero_windows[i];
+		}
+		r.flags = reason;
+		if (measured) {
+			r.flags |= TcpAnalyzer::HANDSHAKE;
+		}
+		if (c->flags & TcpAnalyzer::NO_CLIENT) {
+			r.flags |= TcpAnalyzer::MIDSTREAM;
+		}
+	}
+}
@@ -0,0 +1,205 @@
+/*
+ * implementation of class TlsExtractor
+ */
+
+#include <cstring>	/* for std::memcpy */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "core/TlsExtractor.h"	/* for netgazer::TlsExtractor */
+#include "core/ByteCursor.h"	/* for netgazer::ByteCursor */
+#include "core/Dissector.h"	/* for netgazer::Dissector */
+
+using std::memcpy;
+
+namespace netgazer {
+	/* TLS constants */
+	enum {
+		CONTENT_HANDSHAKE = 22,
+		HANDSHAKE_CLIENT_HELLO = 1,
+		EXTENSION_SERVER_NAME = 0,
+		EXTENSION_ALPN = 16,
+		NAME_TYPE_HOST_NAME = 0,
+	};
+
+	/*
+	 * extract the metadata of a ClientHello
+	 *
+	 * @payload: start of the TLS record
+	 * @length: number of bytes available
+	 * @r: record to fill in
+	 *
+	 * return: true if a ClientHello was recognized, false otherwise
+	 */
+	bool TlsExtractor::extract(const u_char * payload, size_t length,
+		struct TlsExtractor::Record & r)
+	{
+		ByteCursor c(payload, length);
+		ByteCursor body(NULL, 0);
+		ByteCursor extensions(NULL, 0);
+		uint8_t content = 0;
+		uint8_t type = 0;
+		uint8_t n8 = 0;
+		uint16_t n16 = 0;
+		uint16_t record_length = 0;
+		uint32_t hello_length = 0;
+
+		/* cheap rejection of everything but a handshake record */
+		if (length < 6 || payload[0] != CONTENT_HANDSHAKE ||
+			payload[1] != 3 || payload[5] != HANDSHAKE_CLIENT_HELLO) {
+			return false;
+		}
+
+		c.u8(content);
+		c.u16(r.record_version);
+		c.u16(record_length);
+		r.flags = 0;
+		r.cipher_count = 0;
+		r.extension_count = 0;
+		r.sni_length = 0;
+		r.sni[0] = '\0';
+		r.alpn_length = 0;
+		r.alpn[0] = '\0';
+
+		/* parse what was captured of the record */
+		if (record_length > c.remaining()) {
+			r.flags |= TlsExtractor::INCOMPLETE;
+			record_length = (uint16_t)c.remaining();
+		}
+		c.sub(record_length, body);
+
+		body.u8(type);
+		body.u24(hello_length);
+		body.u16(r.client_version);
+		body.skip(32);				/* random */
+		body.u8(n8);
+		body.skip(n8);				/* session id */
+		if (!body.u16(n16) || !body.skip(n16)) {
+			return false;
+		}
+		r.cipher_count = n16 / 2;
+		body.u8(n8);
+		body.skip(n8);				/* compression */
+
+		/* extensions are optional */
+		if (!body.u16(n16)) {
+			return true;
+		}
+		if (n16 > body.remaining()) {
+			r.flags |= TlsExtractor::INCOMPLETE;
+			n16 = (uint16_t)body.remaining();
+		}
+		body.sub(n16, extensions);
+
+		for (;;) {
+			ByteCursor data(NULL, 0);
+			uint16_t ext = 0;
+
+			if (extensions.remaining() == 0) {
+				break;
+			}
+			if (!extensions.u16(ext) || !extensions.u16(n16) ||
+				!extensions.sub(n16, data)) {
+				r.flags |= TlsExtractor::INCOMPLETE;
+				break;
+			}
+			++r.extension_count;
+			if (ext == EXTENSION_SERVER_NAME) {
+				TlsExtractor::serverName(data, r);
+			} else if (ext == EXTENSION_ALPN) {
+				TlsExtractor::alpn(data, r);
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * extract the metadata of a ClientHello starting a TCP segment of a
+	 * frame, on any port
+	 *
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @d: dissection of the frame
+	 * @r: record to fill in
+	 *
+	 * return: true if a ClientHello was recognized, false otherwise
+	 */
+	bool TlsExtractor::extract(const u_char * data, size_t caplen,
+		const struct Dissector::Dissection & d,
+		struct TlsExtractor::Record & r)
+	{
+		size_t length = 0;
+
+		if (d.protocol != 6) {
+			return false;
+		}
+		length = Dissector::payloadLength(data, caplen, d);
+		if (length == 0) {
+			return false;
+		}
+		return TlsExtractor::extract(data + d.payload_offset, length, r);
+	}
+
+	/*
+	 * read the host name of a server_name extension
+	 *
+	 * @c: cursor over the extension data
+	 * @r: record to fill in
+	 */
+	void TlsExtractor::serverName(ByteCursor & c,
+		struct TlsExtractor::Record & r)
+	{
+		ByteCursor list(NULL, 0);
+		uint16_t n = 0;
+
+		if (!c.u16(n) || !c.sub(n, list)) {
+			return;
+		}
+		while (list.remaining() > 0) {
+			const u_char * name = NULL;
+			uint8_t type = 0;
+
+			if (!list.u8(type) || !list.u16(n) ||
+				!list.bytes(n, &name)) {
+				return;
+			}
+			if (type != NAME_TYPE_HOST_NAME) {
+				continue;
+			}
+			if (n > TlsExtractor::MAX_SNI) {
+				r.flags |= TlsExtractor::SNI_TRUNCATED;
+				n = TlsExtractor::MAX_SNI;
+			}
+			memcpy(r.sni, name, n);
+			r.sni[n] = '\0';
+			r.sni_length = n;
+			r.flags |= TlsExtractor::HAS_SNI;
+			return;
+		}
+	}
+
+	/*
+	 * read the first protocol of an ALPN extension
+	 *
+	 * @c: cursor over the extension data
+	 * @r: record to fill in
+	 */
+	void TlsExtractor::alpn(ByteCursor & c, struct TlsExtractor::Record & r)
+	{
+		const u_char * protocol = NULL;
+		uint16_t list = 0;
+		uint8_t n = 0;
+
+		if (!c.u16(list) || !c.u8(n) || !c.bytes(n, &protocol)) {
+			return;
+		}
+		if (n > TlsExtractor::MAX_ALPN) {
+			n = TlsExtractor::MAX_ALPN;
+		}
+		memcpy(r.alpn, protocol, n);
+		r.alpn[n] = '\0';
+		r.alpn_length = n;
+		r.flags |= TlsExtractor::HAS_ALPN;
+	}
+}
@@ -0,0 +1,568 @@
+/*
+ * implementation of class Topology
+ */
+
+#include <iostream>	/* for std::ostream and std::endl */
+#include <string>	/* for std::string */
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <cstdio>	/* for std::fopen, std::fscanf and std::fgets */
+#include <cstdlib>	/* for std::strtol */
+#include <cstring>	/* for std::strerror and std::strncmp */
+#include <cerrno>	/* for errno */
+#include <stdio.h>	/* for snprintf */
+#include <stddef.h>	/* for size_t */
+#include <sched.h>	/* for cpu_set_t */
+#include <pthread.h>	/* for pthread_setaffinity_np */
+#include <unistd.h>	/* for sysconf and syscall */
+#include <dirent.h>	/* for opendir and readdir */
+#include <sys/mman.h>	/* for mmap and madvise */
+#include <sys/syscall.h>	/* for SYS_mbind */
+
+#include "core/Topology.h"	/* for netgazer::Topology */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/Adapter.h"	/* for netgazer::Adapter */
+
+using std::ostream;
+using std::endl;
+using std::string;
+using std::vector;
+using std::bad_alloc;
+using std::fopen;
+using std::fscanf;
+using std::fgets;
+using std::fclose;
+using std::strtol;
+using std::strerror;
+using std::strncmp;
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+namespace netgazer {
+	/* directories of NUMA nodes, CPUs and huge pages in sysfs */
+	static const char * const SYSFS_NODE = "/sys/devices/system/node";
+	static const char * const SYSFS_CPU = "/sys/devices/system/cpu";
+	static const char * const SYSFS_NET = "/sys/class/net";
+	static const char * const SYSFS_HUGEPAGES = "/sys/kernel/mm/hugepages";
+
+	/* memory policy of mbind, as in <numaif.h> */
+	static const int MPOL_PREFERRED_POLICY = 1;
+
+	/* huge page sizes */
+	static const size_t SIZE_2M = (size_t)1 << 21;
+	static const size_t SIZE_1G = (size_t)1 << 30;
+
+	/*
+	 * read the first line of a file
+	 *
+	 * @path: path of the file
+	 * @line: set to the line without its newline
+	 *
+	 * return: true on success, false if the file cannot be read
+	 */
+	static bool readLine(const string & path, string & line)
+	{
+		char buffer[4096];
+		FILE * f = fopen(path.c_str(), "r");
+		bool ok = false;
+
+		if (f == NULL) {
+			return false;
+		}
+		if (fgets(buffer, sizeof(buffer), f) != NULL) {
+			size_t n = 0;
+
+			while (buffer[n] != '\0' && buffer[n] != '\n') {
+				++n;
+			}
+			try {
+				line.assign(buffer, n);
+				ok = true;
+			} catch (bad_alloc &) {
+			}
+		}
+		fclose(f);
+		return ok;
+	}
+
+	/*
+	 * read an integer from a file
+	 *
+	 * @path: path of the file
+	 * @fallback: value returned if the file cannot be read
+	 *
+	 * return: the integer
+	 */
+	static long readLong(const string & path, long fallback)
+	{
+		FILE * f = fopen(path.c_str(), "r");
+		long value = fallback;
+
+		if (f == NULL) {
+			return fallback;
+		}
+		if (fscanf(f, "%ld", &value) != 1) {
+			value = fallback;
+		}
+		fclose(f);
+		return value;
+	}
+
+	/*
+	 * format a sorted CPU list as ranges
+	 *
+	 * @os: stream written to
+	 * @cpus: the CPUs
+	 */
+	static void printList(ostream & os, const vector<int> & cpus)
+	{
+		size_t i = 0;
+
+		if (cpus.empty()) {
+			os << "none";
+		}
+		while (i < cpus.size()) {
+			size_t j = i;
+
+			while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+				++j;
+			}
+			os << (i > 0 ? "," : "") << cpus[i];
+			if (j > i) {
+				os << "-" << cpus[j];
+			}
+			i = j + 1;
+		}
+	}
+
+	/*
+	 * get the number of online CPUs
+	 *
+	 * return: number of CPUs
+	 */
+	int Topology::cpus()
+	{
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+		return n > 0 ? (int)n : 1;
+	}
+
+	/*
+	 * get the number of NUMA nodes
+	 *
+	 * return: number of nodes, 1 without NUMA support
+	 */
+	int Topology::nodes()
+	{
+		struct dirent * entry = NULL;
+		DIR * dir = opendir(SYSFS_NODE);
+		int count = 0;
+
+		if (dir == NULL) {
+			return 1;
+		}
+		while ((entry = readdir(dir)) != NULL) {
+			if (strncmp(entry->d_name, "node", 4) == 0 &&
+				entry->d_name[4] >= '0' &&
+				entry->d_name[4] <= '9') {
+				++count;
+			}
+		}
+		closedir(dir);
+		return count > 0 ? count : 1;
+	}
+
+	/*
+	 * get the NUMA node of a CPU
+	 *
+	 * @cpu: CPU number
+	 *
+	 * return: node, -1 if unknown
+	 */
+	int Topology::nodeOfCpu(int cpu)
+	{
+		struct dirent * entry = NULL;
+		DIR * dir = NULL;
+		int node = -1;
+		char number[16];
+		string path;
+
+		snprintf(number, sizeof(number), "%d", cpu);
+		try {
+			path = string(SYSFS_CPU) + "/cpu" + number;
+		} catch (bad_alloc &) {
+			return -1;
+		}
+
+		/* the CPU directory holds a nodeN link */
+		if ((dir = opendir(path.c_str())) == NULL) {
+			return -1;
+		}
+		while ((entry = readdir(dir)) != NULL) {
+			if (strncmp(entry->d_name, "node", 4) == 0 &&
+				entry->d_name[4] >= '0' &&
+				entry->d_name[4] <= '9') {
+				node = (int)strtol(entry->d_name + 4, NULL, 10);
+				break;
+			}
+		}
+		closedir(dir);
+		return node;
+	}
+
+	/*
+	 * get the NUMA node a network interface is attached to
+	 *
+	 * @name: interface name
+	 *
+	 * return: node, -1 if unknown, e.g. for virtual interfaces
+	 */
+	int Topology::nodeOfAdapter(const char * name)
+	{
+		string path;
+
+		if (name == NULL) {
+			return -1;
+		}
+		try {
+			path = string(SYSFS_NET) + "/" + name + "/device/numa_node";
+		} catch (bad_alloc &) {
+			return -1;
+		}
+		return (int)readLong(path, -1);
+	}
+
+	/*
+	 * get the CPUs of a NUMA node
+	 *
+	 * @node: node, -1 for all online CPUs
+	 *
+	 * return: the CPUs in increasing order, empty if the node is unknown
+	 */
+	vector<int> Topology::cpusOfNode(int node) NG_THROWS
+	{
+		vector<int> cpus;
+		string path;
+		string line;
+
+		try {
+			if (node < 0) {
+				path = string(SYSFS_CPU) + "/online";
+			} else {
+				char number[16];
+
+				snprintf(number, sizeof(number), "%d", node);
+				path = string(SYSFS_NODE) + "/node" + number +
+					"/cpulist";
+			}
+			if (readLine(path, line)) {
+				cpus = Topology::parseCpuList(line.c_str());
+			} else if (node < 0) {
+				for (int i = 0; i < Topology::cpus(); ++i) {
+					cpus.push_back(i);
+				}
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		return cpus;
+	}
+
+	/*
+	 * parse a CPU list in the sysfs format, such as "0-3,8,10-11"
+	 *
+	 * @list: the list
+	 *
+	 * return: the CPUs, in the order listed
+	 */
+	vector<int> Topology::parseCpuList(const char * list) NG_THROWS
+	{
+		vector<int> cpus;
+
+		if (list == NULL) {
+			throw Exception("list is NULL");
+		}
+		try {
+			while (*list != '\0') {
+				char * end = NULL;
+				long first = strtol(list, &end, 10);
+				long last = first;
+
+				if (end == list || first < 0) {
+					throw Exception("bad CPU list");
+				}
+				list = end;
+				if (*list == '-') {
+					last = strtol(list + 1, &end, 10);
+					if (end == list + 1 || last < first) {
+						throw Exception("bad CPU list");
+					}
+					list = end;
+				}
+				for (long cpu = first; cpu <= last; ++cpu) {
+					cpus.push_back((int)cpu);
+				}
+				if (*list == ',') {
+					++list;
+				} else if (*list != '\0') {
+					throw Exception("bad CPU list");
+				}
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		return cpus;
+	}
+
+	/*
+	 * restrict a thread to a set of CPUs
+	 *
+	 * @thread: the thread, e.g. pthread_self()
+	 * @cpus: CPUs it may run on
+	 */
+	void Topology::pin(pthread_t thread, const vector<int> & cpus)
+		NG_THROWS
+	{
+		cpu_set_t set;
+		int ret = 0;
+
+		if (cpus.empty()) {
+			throw Exception("no CPU given");
+		}
+		CPU_ZERO(&set);
+		for (vector<int>::const_iterator i = cpus.begin();
+			i != cpus.end(); ++i) {
+			if (*i < 0 || *i >= CPU_SETSIZE) {
+				throw Exception("CPU out of range");
+			}
+			CPU_SET(*i, &set);
+		}
+		ret = pthread_setaffinity_np(thread, sizeof(set), &set);
+		if (ret != 0) {
+			throw Exception(strerror(ret));
+		}
+	}
+
+	/*
+	 * get the CPUs a thread may run on
+	 *
+	 * @thread: the thread
+	 *
+	 * return: the CPUs in increasing order
+	 */
+	vector<int> Topology::affinity(pthread_t thread) NG_THROWS
+	{
+		vector<int> cpus;
+		cpu_set_t set;
+		int ret = pthread_getaffinity_np(thread, sizeof(set), &set);
+
+		if (ret != 0) {
+			throw Exception(strerror(ret));
+		}
+		try {
+			for (int i = 0; i < CPU_SETSIZE; ++i) {
+				if (CPU_ISSET(i, &set)) {
+					cpus.push_back(i);
+				}
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+		return cpus;
+	}
+
+	/*
+	 * map a zeroed buffer, on the largest huge pages available up to a
+	 * limit, preferring a NUMA node; the pages are faulted in on the
+	 * node before returning, so that the hot path never faults
+	 *
+	 * @size: size in bytes
+	 * @node: preferred node, -1 for any
+	 * @largest: largest page size to try
+	 *
+	 * return: the region, to be freed with release(); node is -1 if the
+	 *         placement could not be applied
+	 */
+	struct Topology::Region Topology::allocate(size_t size, int node,
+		enum Topology::PageSize largest) NG_THROWS
+	{
+		struct Topology::Region r;
+		size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		size_t step = page;
+
+		if (size == 0) {
+			throw Exception("size is 0");
+		}
+		r.addr = MAP_FAILED;
+		r.size = size;
+		r.node = node;
+
+		/* hugetlb mappings fail at once without reserved pages */
+		if (largest >= Topology::HUGE_1G && size >= SIZE_1G) {
+			r.mapped = (size + SIZE_1G - 1) & ~(SIZE_1G - 1);
+			r.pages = Topology::HUGE_1G;
+			step = SIZE_1G;
+			r.addr = mmap(NULL, r.mapped, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+				MAP_HUGE_1GB, -1, 0);
+		}
+		if (r.addr == MAP_FAILED && largest >= Topology::HUGE_2M &&
+			size >= SIZE_2M) {
+			r.mapped = (size + SIZE_2M - 1) & ~(SIZE_2M - 1);
+			r.pages = Topology::HUGE_2M;
+			step = SIZE_2M;
+			r.addr = mmap(NULL, r.mapped, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+				MAP_HUGE_2MB, -1, 0);
+		}
+		if (r.addr == MAP_FAILED) {
+			r.mapped = (size + page - 1) & ~(page - 1);
+			r.pages = Topology::SMALL_PAGES;
+			step = page;
+			r.addr = mmap(NULL, r.mapped, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (r.addr == MAP_FAILED) {
+				throw Exception(strerror(errno));
+			}
+			/* let transparent huge pages back it if they can */
+			if (largest != Topology::SMALL_PAGES &&
+				r.mapped >= SIZE_2M) {
+				madvise(r.addr, r.mapped, MADV_HUGEPAGE);
+			}
+		}
+
+		/* bind before the first touch, which allocates the pages */
+		if (node >= 0) {
+			unsigned long mask[16] = { 0 };
+			size_t bits = sizeof(mask[0]) * 8;
+
+			if ((size_t)node < bits * 16) {
+				mask[node / bits] |= 1UL << (node % bits);
+			}
+			if ((size_t)node >= bits * 16 ||
+				syscall(SYS_mbind, r.addr, r.mapped,
+				MPOL_PREFERRED_POLICY, mask, bits * 16 + 1, 0) < 0) {
+				r.node = -1;
+			}
+		}
+		for (size_t off = 0; off < r.mapped; off += step) {
+			((volatile char *)r.addr)[off] = 0;
+		}
+		return r;
+	}
+
+	/*
+	 * free a region returned by allocate()
+	 *
+	 * @region: the region
+	 */
+	void Topology::release(const struct Topology::Region & region)
+	{
+		if (region.addr != NULL && region.addr != MAP_FAILED) {
+			munmap(region.addr, region.mapped);
+		}
+	}
+
+	/*
+	 * get the number of free huge pages of a size
+	 *
+	 * @pages: huge page size
+	 *
+	 * return: number of free pages, -1 if unknown
+	 */
+	long Topology::freeHugePages(enum Topology::PageSize pages)
+	{
+		string path;
+
+		try {
+			switch (pages) {
+			case Topology::HUGE_2M:
+				path = string(SYSFS_HUGEPAGES) +
+					"/hugepages-2048kB/free_hugepages";
+				break;
+
+			case Topology::HUGE_1G:
+				path = string(SYSFS_HUGEPAGES) +
+					"/hugepages-1048576kB/free_hugepages";
+				break;
+
+			default:
+				return -1;
+			}
+		} catch (bad_alloc &) {
+			return -1;
+		}
+		return readLong(path, -1);
+	}
+
+	/*
+	 * write the CPU and NUMA layout, the free huge pages, the nodes of
+	 * some adapters and the CPUs of the calling thread
+	 *
+	 * @os: stream written to
+	 * @adapters: adapters to locate
+	 */
+	void Topology::report(ostream & os, const vector<Adapter *> & adapters)
+		NG_THROWS
+	{
+		int nodes = Topology::nodes();
+
+		os << "Topology: " << Topology::cpus() << " CPUs online, "
+		   << nodes << " NUMA node" << (nodes > 1 ? "s" : "") << endl;
+		for (int node = 0; node < nodes; ++node) {
+			os << "  node " << node << ": CPUs ";
+			printList(os, Topology::cpusOfNode(node));
+			os << endl;
+		}
+		os << "  free huge pages: 2M "
+		   << Topology::freeHugePages(Topology::HUGE_2M) << ", 1G "
+		   << Topology::freeHugePages(Topology::HUGE_1G) << endl;
+		for (vector<Adapter *>::const_iterator i = adapters.begin();
+			i != adapters.end(); ++i) {
+			int node = Topology::nodeOfAdapter((*i)->name());
+
+			os << "  adapter " << (*i)->name() << ": ";
+			if (node < 0) {
+				os << "no NUMA node";
+			} else {
+				os << "node " << node;
+			}
+			os << endl;
+		}
+		os << "  this thread: CPUs ";
+		printList(os, Topology::affinity(pthread_self()));
+		os << endl;
+	}
+
+	/*
+	 * get the name of a page size
+	 *
+	 * @pages: the page size
+	 *
+	 * return: name of the page size
+	 */
+	const char * Topology::pageSizeName(enum Topology::PageSize pages)
+	{
+		switch (pages) {
+		case Topology::SMALL_PAGES:
+			return "small";
+
+		case Topology::HUGE_2M:
+			return "2M";
+
+		case Topology::HUGE_1G:
+			return "1G";
+
+		default:
+			return "unknown";
+		}
+	}
+}
@@ -0,0 +1,277 @@
+/*
+ * implementation of class Trace
+ */
+
+#include <iostream>	/* for std::ostream */
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <stdint.h>	/* for fixed width integer types */
+#include <time.h>	/* for clock_gettime */
+#include <pthread.h>	/* for pthread_mutex_t */
+#include <unistd.h>	/* for syscall */
+#include <sys/syscall.h>	/* for SYS_gettid */
+
+#include "core/Trace.h"		/* for netgazer::Trace */
+#include "core/Exception.h"	/* for netgazer::Exception */
+
+using std::ostream;
+using std::vector;
+using std::bad_alloc;
+
+namespace netgazer {
+	/* initialize static fields */
+	bool Trace::on = false;
+	struct Trace::Ring * Trace::rings = NULL;
+	uint64_t Trace::base_ticks = 0;
+	uint64_t Trace::base_ns = 0;
+	__thread struct Trace::Ring * Trace::local = NULL;
+
+	/* protects the list of rings, only taken on the cold path */
+	static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+	/* gives the ring of an exiting thread back */
+	static pthread_key_t ring_key;
+	static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+	/*
+	 * read the monotonic clock
+	 *
+	 * return: monotonic time in nanoseconds
+	 */
+	static uint64_t monotonicNs()
+	{
+		struct timespec ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+
+	/*
+	 * enable or disable span recording, enabling also records the
+	 * reference point used to convert ticks into wall time
+	 *
+	 * @on: whether to record spans
+	 */
+	void Trace::enable(bool on) NG_THROWS
+	{
+		if (on && Trace::base_ns == 0) {
+			Trace::base_ticks = Trace::now();
+			Trace::base_ns = monotonicNs();
+		}
+		__atomic_store_n(&(Trace::on), on, __ATOMIC_RELEASE);
+	}
+
+	/*
+	 * get the ring of the calling thread on first use, taking over the
+	 * ring of an exited thread if there is one
+	 *
+	 * return: ring of the calling thread
+	 */
+	struct Trace::Ring * Trace::ring() NG_THROWS
+	{
+		struct Trace::Ring * r = NULL;
+
+		if (Trace::local != NULL) {
+			return Trace::local;
+		}
+		pthread_once(&ring_key_once, Trace::createKey);
+
+		/* dump() holds the lock while reading, so a ring is reset
+		 * only when no one reads it */
+		pthread_mutex_lock(&rings_lock);
+		for (r = Trace::rings; r != NULL && r->owned; r = r->next) {
+		}
+		if (r == NULL) {
+			try {
+				r = new struct Trace::Ring;
+			} catch (bad_alloc & e) {
+				pthread_mutex_unlock(&rings_lock);
+				throw Exception(e.what());
+			}
+			/* publish the ring so that dump() can find it */
+			r->next = Trace::rings;
+			Trace::rings = r;
+		}
+		r->head = 0;
+		r->tid = (uint32_t)syscall(SYS_gettid);
+		r->owned = true;
+		pthread_mutex_unlock(&rings_lock);
+
+		pthread_setspecific(ring_key, r);
+		Trace::local = r;
+		return r;
+	}
+
+	/*
+	 * create the key whose destructor gives rings back
+	 */
+	void Trace::createKey()
+	{
+		pthread_key_create(&ring_key, Trace::release);
+	}
+
+	/*
+	 * give the ring of an exiting thread back, its spans stay readable
+	 * until another thread takes it over
+	 *
+	 * @ring: the ring
+	 */
+	void Trace::release(void * ring)
+	{
+		pthread_mutex_lock(&rings_lock);
+		((struct Trace::Ring *)ring)->owned = false;
+		pthread_mutex_unlock(&rings_lock);
+	}
+
+	/*
+	 * record a span into the ring of the calling thread, the oldest
+	 * span is overwritten when the ring is full
+	 *
+	 * @stage: traced stage
+	 * @begin: tick counter at the beginning of the span
+	 * @end: tick counter at the end of the span
+	 * @count: number of packets handled in the span
+	 */
+	void Trace::record(enum Trace::Stage stage, uint64_t begin,
+		uint64_t end, uint32_t count)
+	{
+		struct Trace::Ring * r = Trace::local;
+		struct Trace::Span * s = NULL;
+
+		if (r == NULL) {
+			try {
+				r = Trace::ring();
+			} catch (Exception & e) {
+				/* drop the span rather than disturb capture */
+				return;
+			}
+		}
+
+		s = &(r->spans[r->head & (Trace::Ring::CAPACITY - 1)]);
+
+		/* keep the overwrite behind the previous head, dump() then
+		 * tells overwritten spans apart by head */
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		__atomic_store_n(&(s->begin), begin, __ATOMIC_RELAXED);
+		__atomic_store_n(&(s->end), end, __ATOMIC_RELAXED);
+		__atomic_store_n(&(s->stage), (uint32_t)stage, __ATOMIC_RELAXED);
+		__atomic_store_n(&(s->count), count, __ATOMIC_RELAXED);
+
+		/* make the span visible before advancing head */
+		__atomic_store_n(&(r->head), r->head + 1, __ATOMIC_RELEASE);
+	}
+
+	/*
+	 * dump all recorded spans in Chrome trace event format, suitable
+	 * for chrome://tracing or Perfetto
+	 *
+	 * @os: reference of an ostream object
+	 */
+	void Trace::dump(ostream & os) NG_THROWS
+	{
+		uint64_t end_ticks = Trace::now();
+		uint64_t end_ns = monotonicNs();
+		double ns_per_tick = 1.0;
+		bool first = true;
+		vector<struct Trace::Span> snapshot;
+
+		if (Trace::base_ns == 0) {
+			throw Exception("tracing has never been enabled");
+		}
+		if (end_ticks > Trace::base_ticks) {
+			ns_per_tick = (double)(end_ns - Trace::base_ns) /
+				(double)(end_ticks - Trace::base_ticks);
+		}
+
+		std::ios::fmtflags f(os.flags());
+		os << std::fixed;
+		os.precision(3);
+		os << "{\"traceEvents\":[";
+
+		try {
+			snapshot.resize(Trace::Ring::CAPACITY);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+
+		pthread_mutex_lock(&rings_lock);
+		for (struct Trace::Ring * r = Trace::rings; r != NULL;
+			r = r->next) {
+			uint64_t head = __atomic_load_n(&(r->head),
+				__ATOMIC_ACQUIRE);
+			uint64_t i = head > Trace::Ring::CAPACITY ?
+				head - Trace::Ring::CAPACITY : 0;
+			uint64_t after = 0;
+
+			/* copy the ring while its owner may append to it */
+			for (uint64_t j = i; j < head; ++j) {
+				const struct Trace::Span & s = r->spans[j &
+					(Trace::Ring::CAPACITY - 1)];
+				struct Trace::Span & c = snapshot[j &
+					(Trace::Ring::CAPACITY - 1)];
+
+				c.begin = __atomic_load_n(&(s.begin),
+					__ATOMIC_RELAXED);
+				c.end = __atomic_load_n(&(s.end),
+					__ATOMIC_RELAXED);
+				c.stage = __atomic_load_n(&(s.stage),
+					__ATOMIC_RELAXED);
+				c.count = __atomic_load_n(&(s.count),
+					__ATOMIC_RELAXED);
+			}
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+			/* spans the owner may have overwritten meanwhile,
+			 * including the one it is writing, are dropped */
+			after = __atomic_load_n(&(r->head), __ATOMIC_RELAXED);
+			if (after + 1 > i + Trace::Ring::CAPACITY) {
+				i = after + 1 - Trace::Ring::CAPACITY;
+			}
+
+			for (; i < head; ++i) {
+				const struct Trace::Span & s = snapshot[i &
+					(Trace::Ring::CAPACITY - 1)];
+
+				/* spans recorded before enable() are unusable */
+				if (s.begin < Trace::base_ticks) {
+					continue;
+				}
+				os << (first ? "" : ",") << "\n{\"name\":\""
+				   << Trace::stageName((enum Trace::Stage)s.stage)
+				   << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << r->tid
+				   << ",\"ts\":" << (s.begin - Trace::base_ticks) *
+					ns_per_tick / 1000.0
+				   << ",\"dur\":" << (s.end - s.begin) *
+					ns_per_tick / 1000.0
+				   << ",\"args\":{\"count\":" << s.count << "}}";
+				first = false;
+			}
+		}
+		pthread_mutex_unlock(&rings_lock);
+
+		os << "\n],\"displayTimeUnit\":\"ns\"}" << std::endl;
+		os.flags(f);
+	}
+
+	/*
+	 * get the name of a stage
+	 *
+	 * @stage: traced stage
+	 *
+	 * return: name of the stage
+	 */
+	const char * Trace::stageName(enum Trace::Stage stage)
+	{
+		switch (stage) {
+		case Trace::WAIT:
+			return "wait";
+		case Trace::DECODE:
+			return "decode";
+		case Trace::RETAIN:
+			return "retain";
+		case Trace::OUTPUT:
+			return "output";
+		default:
+			return "unknown";
+		}
+	}
+}
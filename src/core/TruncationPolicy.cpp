@@ -0,0 +1,263 @@
+/*
+ * implementation of class TruncationPolicy
+ */
+
+#include <cstring>		/* for std::memset */
+#include <vector>		/* for std::vector */
+#include <new>			/* for std::bad_alloc */
+#include <stddef.h>		/* for size_t */
+#include <stdint.h>		/* for fixed width integer types */
+#include <pcap/pcap.h>		/* for libpcap types */
+
+#include "core/TruncationPolicy.h"	/* for netgazer::TruncationPolicy */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "core/Dissector.h"		/* for netgazer::Dissector */
+#include "core/FlowKey.h"		/* for netgazer::FlowKey */
+
+using std::memset;
+using std::vector;
+using std::bad_alloc;
+
+namespace netgazer {
+	/*
+	 * constructor of TruncationPolicy
+	 *
+	 * @payload: payload bytes kept of frames no rule matches
+	 */
+	TruncationPolicy::TruncationPolicy(uint32_t payload) NG_THROWS
+	{
+		this->setDefault(payload);
+		this->clear();
+		this->resetCounters();
+	}
+
+	/*
+	 * set the rule of frames no other rule matches
+	 *
+	 * @payload: payload bytes to keep, HEADERS or FULL
+	 */
+	void TruncationPolicy::setDefault(uint32_t payload)
+	{
+		this->m_default = payload < TruncationPolicy::FULL ? payload :
+			(uint32_t)TruncationPolicy::FULL;
+	}
+
+	/*
+	 * add a rule for an IPv4 protocol
+	 *
+	 * @protocol: IPv4 protocol number
+	 * @payload: payload bytes to keep, HEADERS or FULL
+	 */
+	void TruncationPolicy::byProtocol(uint8_t protocol, uint32_t payload)
+	{
+		this->m_protocols[protocol] = payload < TruncationPolicy::FULL ?
+			payload : (uint32_t)TruncationPolicy::FULL;
+	}
+
+	/*
+	 * add a rule for a TCP or UDP port, matched as source or
+	 * destination; when both ports of a frame have rules, the one
+	 * keeping more bytes applies
+	 *
+	 * @port: port in host order
+	 * @payload: payload bytes to keep, HEADERS or FULL
+	 */
+	void TruncationPolicy::byPort(uint16_t port, uint32_t payload)
+		NG_THROWS
+	{
+		if (this->m_ports.empty()) {
+			try {
+				this->m_ports.resize(65536,
+					(uint32_t)TruncationPolicy::NONE);
+			} catch (bad_alloc & e) {
+				throw Exception(e.what());
+			}
+		}
+		this->m_ports[port] = payload < TruncationPolicy::FULL ?
+			payload : (uint32_t)TruncationPolicy::FULL;
+	}
+
+	/*
+	 * add a rule for a flow, matched in both directions
+	 *
+	 * @key: flow key, FlowKey::FIVE_TUPLE for TCP and UDP flows or
+	 *       FlowKey::PAIR with zero ports and protocol for others
+	 * @payload: payload bytes to keep, HEADERS or FULL
+	 */
+	void TruncationPolicy::byFlow(const struct FlowKey & key,
+		uint32_t payload) NG_THROWS
+	{
+		struct FlowKey reverse = key;
+
+		if (payload > TruncationPolicy::FULL) {
+			payload = TruncationPolicy::FULL;
+		}
+		reverse.src_addr = key.dest_addr;
+		reverse.dest_addr = key.src_addr;
+		reverse.src_port = key.dest_port;
+		reverse.dest_port = key.src_port;
+		try {
+			this->m_flows[key] = payload;
+			this->m_flows[reverse] = payload;
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * remove all rules but the default
+	 */
+	void TruncationPolicy::clear()
+	{
+		for (int i = 0; i < 256; ++i) {
+			this->m_protocols[i] = TruncationPolicy::NONE;
+		}
+		vector<uint32_t>().swap(this->m_ports);
+		this->m_flows.clear();
+	}
+
+	/*
+	 * decide how many bytes of a frame to keep
+	 *
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 *
+	 * return: number of bytes to keep, at most caplen
+	 */
+	size_t TruncationPolicy::retain(const u_char * data, size_t caplen)
+	{
+		struct Dissector::Dissection d;
+
+		Dissector::dissect(data, caplen, d);
+		return this->retain(data, caplen, d);
+	}
+
+	/*
+	 * decide how many bytes of a dissected frame to keep
+	 *
+	 * @data: frame data
+	 * @caplen: number of captured bytes
+	 * @d: dissection of the frame
+	 *
+	 * return: number of bytes to keep, at most caplen
+	 */
+	size_t TruncationPolicy::retain(const u_char * data, size_t caplen,
+		const struct Dissector::Dissection & d)
+	{
+		uint32_t payload = this->payload(d);
+		size_t keep = caplen;
+
+		if (payload != TruncationPolicy::FULL) {
+			keep = TruncationPolicy::headers(data, d) + payload;
+			if (keep > caplen) {
+				keep = caplen;
+			}
+		}
+
+		++this->m_stats.packets;
+		if (keep < caplen) {
+			++this->m_stats.truncated;
+		}
+		this->m_stats.captured += caplen;
+		this->m_stats.retained += keep;
+		return keep;
+	}
+
+	/*
+	 * get the counters
+	 *
+	 * return: what was evaluated and kept since the last reset
+	 */
+	const struct TruncationPolicy::Stats & TruncationPolicy::stats() const
+	{
+		return this->m_stats;
+	}
+
+	/*
+	 * reset the counters
+	 */
+	void TruncationPolicy::resetCounters()
+	{
+		memset(&(this->m_stats), 0, sizeof(this->m_stats));
+	}
+
+	/*
+	 * find the rule of a frame
+	 *
+	 * @d: dissection of the frame
+	 *
+	 * return: payload bytes to keep
+	 */
+	uint32_t TruncationPolicy::payload(
+		const struct Dissector::Dissection & d) const
+	{
+		uint32_t payload = TruncationPolicy::NONE;
+
+		if (!(d.flags & Dissector::HAS_IPV4)) {
+			return this->m_default;
+		}
+
+		/* flow */
+		if (!this->m_flows.empty()) {
+			struct FlowKey k;
+
+			memset(&k, 0, sizeof(k));
+			k.src_addr = d.src_addr;
+			k.dest_addr = d.dest_addr;
+			if (d.flags & Dissector::HAS_PORTS) {
+				k.src_port = d.src_port;
+				k.dest_port = d.dest_port;
+				k.protocol = d.protocol;
+			}
+			std::tr1::unordered_map<struct FlowKey, uint32_t,
+				struct KeyHash>::const_iterator it =
+				this->m_flows.find(k);
+			if (it != this->m_flows.end()) {
+				return it->second;
+			}
+		}
+
+		/* port, the larger of both */
+		if (!this->m_ports.empty() &&
+			(d.flags & Dissector::HAS_PORTS)) {
+			uint32_t src = this->m_ports[d.src_port];
+			uint32_t dest = this->m_ports[d.dest_port];
+
+			if (src != TruncationPolicy::NONE) {
+				payload = src;
+			}
+			if (dest != TruncationPolicy::NONE &&
+				(payload == TruncationPolicy::NONE ||
+				dest > payload)) {
+				payload = dest;
+			}
+			if (payload != TruncationPolicy::NONE) {
+				return payload;
+			}
+		}
+
+		/* protocol */
+		payload = this->m_protocols[d.protocol];
+		return payload != TruncationPolicy::NONE ? payload :
+			this->m_default;
+	}
+
+	/*
+	 * get the length of the headers of a dissected frame; fragments
+	 * keep their IPv4 header, which the dissection stops at
+	 *
+	 * @data: frame data
+	 * @d: dissection of the frame
+	 *
+	 * return: offset of the first byte past the headers
+	 */
+	size_t TruncationPolicy::headers(const u_char * data,
+		const struct Dissector::Dissection & d)
+	{
+		if ((d.flags & Dissector::FRAGMENT) &&
+			!(d.flags & Dissector::TRUNCATED)) {
+			return d.l3_offset + (data[d.l3_offset] & 0x0f) * 4;
+		}
+		return d.payload_offset;
+	}
+}
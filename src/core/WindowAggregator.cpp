@@ -0,0 +1,786 @@
+/*
+ * implementation of class WindowAggregator
+ */
+
+#include <deque>	/* for std::deque */
+#include <map>		/* for std::map */
+#include <vector>	/* for std::vector */
+#include <new>		/* for std::bad_alloc */
+#include <cstring>	/* for std::memset, std::memcmp and std::memcpy */
+#include <stddef.h>	/* for size_t */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pthread.h>	/* for pthread functions */
+
+#include "core/WindowAggregator.h"	/* for netgazer::WindowAggregator */
+#include "core/Exception.h"		/* for netgazer::Exception */
+#include "core/PacketSummary.h"		/* for netgazer::PacketSummary */
+#include "core/IPv4Packet.h"		/* for netgazer::IPv4Packet */
+#include "core/Hash.h"			/* for netgazer::Hash */
+#include "core/Checkpointable.h"	/* for netgazer::Checkpointable */
+#include "core/MemoryConsumer.h"	/* for netgazer::MemoryConsumer */
+
+using std::deque;
+using std::map;
+using std::vector;
+using std::bad_alloc;
+using std::memset;
+using std::memcmp;
+using std::memcpy;
+
+namespace netgazer {
+	/*
+	 * map an IPv4 protocol number to an IP type
+	 *
+	 * @protocol: IPv4 protocol number
+	 *
+	 * return: IP type
+	 */
+	static inline enum IPv4Packet::IPType ipTypeOf(uint8_t protocol)
+	{
+		switch (protocol) {
+		case 1:
+			return IPv4Packet::ICMP;
+		case 2:
+			return IPv4Packet::IGMP;
+		case 6:
+			return IPv4Packet::TCP;
+		case 17:
+			return IPv4Packet::UDP;
+		default:
+			return IPv4Packet::OTHER;
+		}
+	}
+
+	/*
+	 * get the average packet length of a group
+	 *
+	 * return: average length in bytes
+	 */
+	double WindowAggregator::Result::averageLength() const
+	{
+		if (this->aggregate.count == 0) {
+			return 0.0;
+		}
+		return (double)this->aggregate.bytes / this->aggregate.count;
+	}
+
+	/*
+	 * get the effective sampling rate of a group, which may differ from
+	 * the rate of any single packet when the rate changed mid-window
+	 *
+	 * return: on average, one in this many packets was accounted
+	 */
+	double WindowAggregator::Result::samplingRate() const
+	{
+		if (this->aggregate.count == 0) {
+			return 1.0;
+		}
+		return (double)this->aggregate.scaled_count /
+			this->aggregate.count;
+	}
+
+	/*
+	 * constructor of WindowAggregator::Pane
+	 *
+	 * @index: timestamp divided by the pane length
+	 */
+	WindowAggregator::Pane::Pane(uint64_t index)
+		: index(index), buckets(64, 0)
+	{
+	}
+
+	/*
+	 * find or create the aggregates of a group
+	 *
+	 * @key: group key
+	 *
+	 * return: reference to the aggregates
+	 */
+	struct WindowAggregator::Aggregate & WindowAggregator::Pane::at(
+		const struct WindowAggregator::GroupKey & key)
+	{
+		size_t mask = this->buckets.size() - 1;
+		size_t i = Hash::bytes(&key, sizeof(key)) & mask;
+		struct WindowAggregator::Result r;
+
+		while (this->buckets[i] != 0) {
+			struct WindowAggregator::Result & e =
+				this->entries[this->buckets[i] - 1];
+
+			if (memcmp(&(e.key), &key, sizeof(key)) == 0) {
+				return e.aggregate;
+			}
+			i = (i + 1) & mask;
+		}
+
+		/* grow at 3/4 load, then probe again */
+		if ((this->entries.size() + 1) * 4 > this->buckets.size() * 3) {
+			this->buckets.assign(this->buckets.size() * 2, 0);
+			mask = this->buckets.size() - 1;
+			for (size_t j = 0; j < this->entries.size(); ++j) {
+				size_t k = Hash::bytes(&(this->entries[j].key),
+					sizeof(key)) & mask;
+
+				while (this->buckets[k] != 0) {
+					k = (k + 1) & mask;
+				}
+				this->buckets[k] = j + 1;
+			}
+			i = Hash::bytes(&key, sizeof(key)) & mask;
+			while (this->buckets[i] != 0) {
+				i = (i + 1) & mask;
+			}
+		}
+
+		r.key = key;
+		r.aggregate.count = 0;
+		r.aggregate.bytes = 0;
+		r.aggregate.scaled_count = 0;
+		r.aggregate.scaled_bytes = 0;
+		r.aggregate.min_length = 0xffffffffU;
+		r.aggregate.max_length = 0;
+		this->entries.push_back(r);
+		this->buckets[i] = this->entries.size();
+		return this->entries.back().aggregate;
+	}
+
+	/*
+	 * merge the aggregates of another pane into this one
+	 *
+	 * @other: pane to merge from
+	 */
+	void WindowAggregator::Pane::merge(const WindowAggregator::Pane & other)
+	{
+		for (vector<struct WindowAggregator::Result>::const_iterator i =
+			other.entries.begin(); i != other.entries.end(); ++i) {
+			struct WindowAggregator::Aggregate & a = this->at(i->key);
+
+			a.count += i->aggregate.count;
+			a.bytes += i->aggregate.bytes;
+			a.scaled_count += i->aggregate.scaled_count;
+			a.scaled_bytes += i->aggregate.scaled_bytes;
+			if (i->aggregate.min_length < a.min_length) {
+				a.min_length = i->aggregate.min_length;
+			}
+			if (i->aggregate.max_length > a.max_length) {
+				a.max_length = i->aggregate.max_length;
+			}
+		}
+	}
+
+	/*
+	 * estimate the memory held by the pane
+	 *
+	 * return: number of bytes
+	 */
+	size_t WindowAggregator::Pane::memory() const
+	{
+		return sizeof(*this) + this->entries.capacity() *
+			sizeof(struct WindowAggregator::Result) +
+			this->buckets.capacity() * sizeof(uint32_t);
+	}
+
+	/*
+	 * constructor of WindowAggregator::Partial
+	 *
+	 * @owner: aggregator the partial feeds
+	 */
+	WindowAggregator::Partial::Partial(WindowAggregator * owner)
+	{
+		this->m_owner = owner;
+		this->m_pane = NULL;
+		this->m_progress = 0;
+		this->m_late = 0;
+	}
+
+	/*
+	 * destructor of WindowAggregator::Partial
+	 */
+	WindowAggregator::Partial::~Partial()
+	{
+		delete this->m_pane;
+	}
+
+	/*
+	 * account a packet, only to be called by the owning thread;
+	 * packets older than the current pane are counted as late and
+	 * dropped
+	 *
+	 * @s: summary record of the packet
+	 * @rate: sampling rate the packet was kept at, one in rate packets
+	 * @src_label: label of the source address, from SubnetTagger
+	 * @dest_label: label of the destination address, from SubnetTagger
+	 */
+	void WindowAggregator::Partial::add(const struct PacketSummary & s,
+		uint32_t rate, uint32_t src_label, uint32_t dest_label)
+		NG_THROWS
+	{
+		WindowAggregator * owner = this->m_owner;
+		uint64_t index = s.ts_ns / owner->m_pane_ns;
+		struct WindowAggregator::GroupKey key;
+		unsigned by = owner->m_group_by;
+
+		if (this->m_pane == NULL || index != this->m_pane->index) {
+			if (index < this->m_progress || (this->m_pane != NULL &&
+				index < this->m_pane->index)) {
+				++this->m_late;
+				return;
+			}
+			this->seal(index);
+			try {
+				this->m_pane = new WindowAggregator::Pane(index);
+			} catch (bad_alloc & e) {
+				throw Exception(e.what());
+			}
+		}
+
+		memset(&key, 0, sizeof(key));
+		if (by & WindowAggregator::BY_ETHER_TYPE) {
+			key.ether_type = s.ether_type;
+		}
+		if (by & WindowAggregator::BY_IP_TYPE) {
+			key.ip_type = (s.flags & PacketSummary::IPV4) ?
+				ipTypeOf(s.protocol) : IPv4Packet::OTHER;
+		}
+		if (by & WindowAggregator::BY_SRC_ADDR) {
+			key.src_addr = s.src_addr;
+		}
+		if (by & WindowAggregator::BY_DEST_ADDR) {
+			key.dest_addr = s.dest_addr;
+		}
+		if (by & WindowAggregator::BY_SRC_PORT) {
+			key.src_port = s.src_port;
+		}
+		if (by & WindowAggregator::BY_DEST_PORT) {
+			key.dest_port = s.dest_port;
+		}
+		if (by & WindowAggregator::BY_SRC_LABEL) {
+			key.src_label = src_label;
+		}
+		if (by & WindowAggregator::BY_DEST_LABEL) {
+			key.dest_label = dest_label;
+		}
+
+		try {
+			struct WindowAggregator::Aggregate & a =
+				this->m_pane->at(key);
+
+			++a.count;
+			a.bytes += s.length;
+			a.scaled_count += rate;
+			a.scaled_bytes += (uint64_t)s.length * rate;
+			if (s.length < a.min_length) {
+				a.min_length = s.length;
+			}
+			if (s.length > a.max_length) {
+				a.max_length = s.length;
+			}
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * let time advance without packets, so that an idle thread does not
+	 * hold back windows of the others
+	 *
+	 * @now_ns: current time in nanoseconds since the epoch
+	 */
+	void WindowAggregator::Partial::tick(uint64_t now_ns) NG_THROWS
+	{
+		uint64_t index = now_ns / this->m_owner->m_pane_ns;
+
+		if (index > this->m_progress && (this->m_pane == NULL ||
+			index > this->m_pane->index)) {
+			this->seal(index);
+		}
+	}
+
+	/*
+	 * get the number of packets dropped for arriving after their pane
+	 *
+	 * return: number of late packets
+	 */
+	uint64_t WindowAggregator::Partial::late() const
+	{
+		return this->m_late;
+	}
+
+	/*
+	 * hand the current pane to the emitter thread
+	 *
+	 * @next: index of the next pane, all panes before it are sealed
+	 */
+	void WindowAggregator::Partial::seal(uint64_t next) NG_THROWS
+	{
+		WindowAggregator * owner = this->m_owner;
+
+		pthread_mutex_lock(&(owner->m_lock));
+		if (this->m_pane != NULL) {
+			try {
+				owner->m_sealed.push_back(this->m_pane);
+			} catch (bad_alloc & e) {
+				pthread_mutex_unlock(&(owner->m_lock));
+				throw Exception(e.what());
+			}
+			this->m_pane = NULL;
+		}
+		this->m_progress = next;
+		owner->m_dirty = true;
+		pthread_cond_signal(&(owner->m_cond));
+		pthread_mutex_unlock(&(owner->m_lock));
+	}
+
+	/*
+	 * constructor of WindowAggregator
+	 *
+	 * @group_by: enum GroupBy bits
+	 * @size_ns: window length in nanoseconds
+	 * @slide_ns: window slide in nanoseconds, equal to size_ns for
+	 *            tumbling windows; size_ns must be a multiple of it
+	 * @callback: receiver of closed windows
+	 */
+	WindowAggregator::WindowAggregator(unsigned group_by, uint64_t size_ns,
+		uint64_t slide_ns, Callback * callback) NG_THROWS
+	{
+		if (callback == NULL) {
+			throw Exception("callback is NULL");
+		}
+		if (slide_ns == 0 || size_ns < slide_ns ||
+			size_ns % slide_ns != 0) {
+			throw Exception("window size is not a multiple of slide");
+		}
+
+		this->m_group_by = group_by;
+		this->m_pane_ns = slide_ns;
+		this->m_panes_per_window = size_ns / slide_ns;
+		this->m_callback = callback;
+		this->m_next_emit = 0;
+		this->m_settled = 0;
+		this->m_late = 0;
+		this->m_charged = 0;
+		this->m_image_emit = 0;
+		this->m_dirty = false;
+		this->m_stopping = false;
+		pthread_mutex_init(&(this->m_lock), NULL);
+		pthread_cond_init(&(this->m_cond), NULL);
+		pthread_mutex_init(&(this->m_state_lock), NULL);
+
+		if (pthread_create(&(this->m_thread), NULL, WindowAggregator::run,
+			this) != 0) {
+			pthread_mutex_destroy(&(this->m_state_lock));
+			pthread_cond_destroy(&(this->m_cond));
+			pthread_mutex_destroy(&(this->m_lock));
+			throw Exception("failed to start emitter thread");
+		}
+	}
+
+	/*
+	 * destructor of WindowAggregator, closes it first if needed
+	 */
+	WindowAggregator::~WindowAggregator()
+	{
+		try {
+			this->close();
+		} catch (Exception & e) {
+			/* nothing left to report to */
+		}
+
+		for (vector<Partial *>::iterator i = this->m_partials.begin();
+			i != this->m_partials.end(); ++i) {
+			delete *i;
+		}
+		for (map<uint64_t, Pane *>::iterator i = this->m_open.begin();
+			i != this->m_open.end(); ++i) {
+			delete i->second;
+		}
+		for (deque<Pane *>::iterator i = this->m_sealed.begin();
+			i != this->m_sealed.end(); ++i) {
+			delete *i;
+		}
+		this->release(this->m_charged);
+		pthread_mutex_destroy(&(this->m_state_lock));
+		pthread_cond_destroy(&(this->m_cond));
+		pthread_mutex_destroy(&(this->m_lock));
+	}
+
+	/*
+	 * create a feeder for a capture thread, it is owned by the
+	 * aggregator
+	 *
+	 * return: a pointer to the partial
+	 */
+	WindowAggregator::Partial * WindowAggregator::partial()
+		NG_THROWS
+	{
+		Partial * p = NULL;
+
+		try {
+			p = new Partial(this);
+			pthread_mutex_lock(&(this->m_lock));
+			this->m_partials.push_back(p);
+			pthread_mutex_unlock(&(this->m_lock));
+		} catch (bad_alloc & e) {
+			delete p;
+			throw Exception(e.what());
+		}
+		return p;
+	}
+
+	/*
+	 * seal every partial, report all remaining windows and stop the
+	 * emitter thread; the partials must no longer be fed
+	 */
+	void WindowAggregator::close() NG_THROWS
+	{
+		pthread_mutex_lock(&(this->m_lock));
+		if (this->m_stopping) {
+			pthread_mutex_unlock(&(this->m_lock));
+			return;
+		}
+		for (vector<Partial *>::iterator i = this->m_partials.begin();
+			i != this->m_partials.end(); ++i) {
+			if ((*i)->m_pane != NULL) {
+				this->m_sealed.push_back((*i)->m_pane);
+				(*i)->m_pane = NULL;
+			}
+		}
+		this->m_stopping = true;
+		pthread_cond_signal(&(this->m_cond));
+		pthread_mutex_unlock(&(this->m_lock));
+
+		pthread_join(this->m_thread, NULL);
+	}
+
+	/*
+	 * describe the state for a Checkpoint: the open panes are copied
+	 * into an image that stays unchanged until the next call
+	 *
+	 * @extents: the extents are appended to it
+	 */
+	void WindowAggregator::extents(
+		vector<struct Checkpointable::Extent> & extents) const
+		NG_THROWS
+	{
+		pthread_mutex_lock(&(this->m_state_lock));
+		try {
+			this->m_image.clear();
+			for (map<uint64_t, Pane *>::const_iterator i =
+				this->m_open.begin(); i != this->m_open.end(); ++i) {
+				const vector<struct Result> & e = i->second->entries;
+
+				for (size_t j = 0; j < e.size(); ++j) {
+					struct WindowAggregator::Row r;
+
+					r.index = i->first;
+					r.result = e[j];
+					this->m_image.push_back(r);
+				}
+			}
+		} catch (bad_alloc & e) {
+			pthread_mutex_unlock(&(this->m_state_lock));
+			throw Exception(e.what());
+		}
+		this->m_image_emit = this->m_next_emit;
+		pthread_mutex_unlock(&(this->m_state_lock));
+
+		struct Checkpointable::Extent x[] = {
+			{ &(this->m_group_by), sizeof(this->m_group_by), true },
+			{ &(this->m_pane_ns), sizeof(this->m_pane_ns), true },
+			{ &(this->m_panes_per_window),
+				sizeof(this->m_panes_per_window), true },
+			{ &(this->m_image_emit), sizeof(this->m_image_emit),
+				false },
+			{ this->m_image.empty() ? NULL : &(this->m_image[0]),
+				this->m_image.size() *
+				sizeof(struct WindowAggregator::Row), false },
+		};
+
+		try {
+			extents.insert(extents.end(), x, x + 5);
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * replace the open panes by saved ones, before the partials are
+	 * fed; a snapshot of other windows or grouping is refused and the
+	 * state is left as it was
+	 *
+	 * @saved: the extents saved, valid during the call only
+	 */
+	void WindowAggregator::restore(
+		const vector<struct Checkpointable::Extent> & saved)
+		NG_THROWS
+	{
+		const struct Checkpointable::Extent dims[] = {
+			{ &(this->m_group_by), sizeof(this->m_group_by), true },
+			{ &(this->m_pane_ns), sizeof(this->m_pane_ns), true },
+			{ &(this->m_panes_per_window),
+				sizeof(this->m_panes_per_window), true },
+		};
+		map<uint64_t, Pane *> panes;
+		uint64_t next_emit = 0;
+		size_t rows = 0;
+
+		if (saved.size() != 5 ||
+			saved[3].length != sizeof(next_emit) ||
+			saved[4].length % sizeof(struct Row) != 0) {
+			throw Exception("snapshot dimensions differ");
+		}
+		for (int i = 0; i < 3; ++i) {
+			if (saved[i].length != dims[i].length ||
+				memcmp(saved[i].data, dims[i].data,
+				dims[i].length) != 0) {
+				throw Exception("snapshot dimensions differ");
+			}
+		}
+		memcpy(&next_emit, saved[3].data, sizeof(next_emit));
+		rows = saved[4].length / sizeof(struct Row);
+
+		try {
+			for (size_t i = 0; i < rows; ++i) {
+				struct WindowAggregator::Row r;
+				Pane * p = NULL;
+
+				memcpy(&r, (const char *)saved[4].data +
+					i * sizeof(r), sizeof(r));
+				if ((p = panes[r.index]) == NULL) {
+					p = new WindowAggregator::Pane(r.index);
+					panes[r.index] = p;
+				}
+				p->at(r.result.key) = r.result.aggregate;
+			}
+		} catch (bad_alloc & e) {
+			for (map<uint64_t, Pane *>::iterator i = panes.begin();
+				i != panes.end(); ++i) {
+				delete i->second;
+			}
+			throw Exception(e.what());
+		}
+
+		pthread_mutex_lock(&(this->m_state_lock));
+		this->m_open.swap(panes);
+		this->m_next_emit = next_emit;
+		pthread_mutex_unlock(&(this->m_state_lock));
+
+		for (map<uint64_t, Pane *>::iterator i = panes.begin();
+			i != panes.end(); ++i) {
+			delete i->second;
+		}
+	}
+
+	/*
+	 * give memory back by reporting the oldest windows early, flagged
+	 * incomplete, so that their panes can be freed; panes still to come
+	 * for them only count in later windows, or are dropped as late()
+	 * when there is none, only effective on the emitter thread
+	 *
+	 * @bytes: amount of memory to give back
+	 *
+	 * return: number of bytes released
+	 */
+	size_t WindowAggregator::shed(size_t bytes)
+	{
+		size_t freed = 0;
+
+		if (!pthread_equal(pthread_self(), this->m_thread)) {
+			return 0;
+		}
+		while (freed < bytes && !this->m_open.empty()) {
+			size_t held = 0;
+
+			this->publish(this->m_open.begin()->first +
+				this->m_panes_per_window);
+			held = this->footprint();
+			if (held < this->m_charged) {
+				freed += this->m_charged - held;
+				this->release(this->m_charged - held);
+				this->m_charged = held;
+			}
+		}
+		return freed;
+	}
+
+	/*
+	 * get the number of packets dropped because their pane was sealed
+	 * after every window containing it had been reported early
+	 *
+	 * return: number of packets
+	 */
+	uint64_t WindowAggregator::late() const
+	{
+		return __atomic_load_n(&(this->m_late), __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * report windows ending before a pane, on the emitter thread; those
+	 * ending at or after m_settled are flagged incomplete
+	 *
+	 * @until: index of the first pane whose windows are kept open
+	 */
+	void WindowAggregator::publish(uint64_t until)
+	{
+		uint64_t n = this->m_panes_per_window;
+
+		while (!this->m_open.empty()) {
+			uint64_t first = this->m_open.begin()->first;
+			uint64_t lo = 0;
+
+			/* skip windows that contain no pane at all */
+			if (this->m_next_emit < first) {
+				this->m_next_emit = first;
+			}
+			if (this->m_next_emit >= until) {
+				return;
+			}
+			lo = this->m_next_emit >= n - 1 ?
+				this->m_next_emit - (n - 1) : 0;
+
+			/* merge the panes of the window */
+			WindowAggregator::Pane window(this->m_next_emit);
+			for (map<uint64_t, Pane *>::iterator i =
+				this->m_open.lower_bound(lo);
+				i != this->m_open.end() &&
+				i->first <= this->m_next_emit; ++i) {
+				window.merge(*(i->second));
+			}
+			if (!window.entries.empty()) {
+				uint64_t end = this->m_next_emit + 1;
+
+				this->m_callback->onWindow(
+					(end >= n ? end - n : 0) * this->m_pane_ns,
+					end * this->m_pane_ns, window.entries,
+					this->m_next_emit < this->m_settled);
+			}
+
+			/* the oldest pane is not part of any later window */
+			while (this->m_next_emit >= n - 1 &&
+				!this->m_open.empty() &&
+				this->m_open.begin()->first <= lo) {
+				delete this->m_open.begin()->second;
+				this->m_open.erase(this->m_open.begin());
+			}
+			++this->m_next_emit;
+		}
+	}
+
+	/*
+	 * estimate the memory held by the open panes, on the emitter thread
+	 *
+	 * return: number of bytes
+	 */
+	size_t WindowAggregator::footprint() const
+	{
+		size_t bytes = 0;
+
+		for (map<uint64_t, Pane *>::const_iterator i =
+			this->m_open.begin(); i != this->m_open.end(); ++i) {
+			bytes += i->second->memory();
+		}
+		return bytes;
+	}
+
+	/*
+	 * charge or release the change in memory held by the open panes,
+	 * on the emitter thread
+	 */
+	void WindowAggregator::account()
+	{
+		size_t held = this->footprint();
+		bool granted = true;
+
+		if (held > this->m_charged) {
+			granted = this->charge(held - this->m_charged);
+		} else if (held < this->m_charged) {
+			this->release(this->m_charged - held);
+		}
+		this->m_charged = held;
+		if (!granted) {
+			this->relieve();
+		}
+	}
+
+	/*
+	 * emitter thread: merge sealed panes and report closed windows
+	 *
+	 * @arg: a pointer to the WindowAggregator
+	 *
+	 * return: NULL
+	 */
+	void * WindowAggregator::run(void * arg)
+	{
+		WindowAggregator * self = (WindowAggregator *)arg;
+
+		for (;;) {
+			deque<Pane *> sealed;
+			uint64_t complete = (uint64_t)-1;
+			bool stopping = false;
+
+			pthread_mutex_lock(&(self->m_lock));
+			while (!self->m_dirty && !self->m_stopping &&
+				self->m_sealed.empty()) {
+				pthread_cond_wait(&(self->m_cond), &(self->m_lock));
+			}
+			sealed.swap(self->m_sealed);
+			self->m_dirty = false;
+			stopping = self->m_stopping;
+
+			/* a pane is complete once every active partial passed it */
+			if (!stopping) {
+				for (vector<Partial *>::iterator i =
+					self->m_partials.begin();
+					i != self->m_partials.end(); ++i) {
+					if ((*i)->m_progress != 0 &&
+						(*i)->m_progress < complete) {
+						complete = (*i)->m_progress;
+					}
+				}
+			}
+			pthread_mutex_unlock(&(self->m_lock));
+
+			/* merge partial panes into the open panes */
+			pthread_mutex_lock(&(self->m_state_lock));
+			for (deque<Pane *>::iterator i = sealed.begin();
+				i != sealed.end(); ++i) {
+				map<uint64_t, Pane *>::iterator j =
+					self->m_open.find((*i)->index);
+
+				/* only after shed(): no window left to count it */
+				if ((*i)->index + self->m_panes_per_window <=
+					self->m_next_emit) {
+					uint64_t packets = 0;
+
+					for (size_t k = 0; k < (*i)->entries.size();
+						++k) {
+						packets += (*i)->entries[k].aggregate.count;
+					}
+					__atomic_add_fetch(&(self->m_late), packets,
+						__ATOMIC_RELAXED);
+					delete *i;
+				} else if (j == self->m_open.end()) {
+					self->m_open[(*i)->index] = *i;
+				} else {
+					j->second->merge(**i);
+					delete *i;
+				}
+			}
+
+			/* panes only ever seen partially still need later ones */
+			if (stopping) {
+				complete = self->m_open.empty() ? 0 :
+					self->m_open.rbegin()->first +
+					self->m_panes_per_window;
+			}
+			self->m_settled = complete;
+			self->publish(complete);
+			self->account();
+			pthread_mutex_unlock(&(self->m_state_lock));
+
+			if (stopping) {
+				return NULL;
+			}
+		}
+	}
+}
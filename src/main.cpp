@@ -1,7 +1,11 @@
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <fstream>
+#include <cstdlib>
+#include <vector>
 #include <signal.h>
+#include <pthread.h>
 
 #include "netgazer.h"
 
@@ -18,8 +22,15 @@ int main(int argc, char * const * argv)
 	NetworkService * service = NULL;
 	Adapter * adapter = NULL;
 	int adapter_count = 0, index = -1;
+	const char * trace_file = getenv("NETGAZER_TRACE");
+	const char * cpu_list = getenv("NETGAZER_CPUS");
 
 	try {
+		/* record hot-path spans when a trace file is requested */
+		if (trace_file != NULL) {
+			Trace::enable(true);
+		}
+
 		/* get network service */
 		service = NetworkService::instance();
 
@@ -42,7 +53,7 @@ int main(int argc, char * const * argv)
 			NetworkService::dispose();
 			return 0;
 		} else if (adapter_count == 1) {
-			adapter_count = 0;
+			index = 0;
 		} else {
 			cout << "Please input a number (0 - "
 				<< adapter_count - 1 << "): ",
@@ -61,11 +72,25 @@ int main(int argc, char * const * argv)
 
 		/* get and open the specified adapter */
 		adapter = service->adapterBy(index);
-		adapter->open(true, 1000);
+		Adapter::Options options;
+		options.promisc = true;
+		options.buffer_size = 32 * 1024 * 1024;
+		options.nano = true;
+		adapter->open(options);
+
+		/* pin the capture thread if asked, then show where it runs */
+		if (cpu_list != NULL) {
+			Topology::pin(pthread_self(),
+				Topology::parseCpuList(cpu_list));
+		}
+		Topology::report(cout, vector<Adapter *>(1, adapter));
+		cout << endl;
 
 		/* start capturing packets */
 		Packet * p = NULL;
-		while ((p = adapter->nextPacket()) != NULL) {
+		enum Adapter::Result result = Adapter::NONE;
+		while ((result = adapter->next(&p)) == Adapter::PACKET) {
+			NG_TRACE_BEGIN(OUTPUT, output_begin);
 			/* packet length */
 			cout << setw(20) << setfill(' ') << left
 			     << "length:" << p->length() << endl;
@@ -74,7 +99,7 @@ int main(int argc, char * const * argv)
 			    << "Ethernet type:" << p->ethernetType() << endl;
 			/* timestamp */
 			cout << setw(20) << setfill(' ') << left
-			     << "Timestamp:" << p->timestamp() << endl;
+			     << "Timestamp:" << p->preciseTimestamp() << endl;
 			/* source MAC address */
 			cout << setw(20) << setfill(' ') << left
 			     << "Source MAC:" << p->srcMacAddr() << endl;
@@ -82,8 +107,9 @@ int main(int argc, char * const * argv)
 			cout << setw(20) << setfill(' ') << left
 			     << "Destination MAC:" << p->destMacAddr() << endl;
 
-			if (p->ethernetType() == Packet::IP) {
-				IPv4Packet * ipp = dynamic_cast<IPv4Packet *>(p);
+			/* only frames with a whole IPv4 header are decoded */
+			IPv4Packet * ipp = dynamic_cast<IPv4Packet *>(p);
+			if (ipp != NULL) {
 				/* IP header length */
 				cout << setw(20) << setfill(' ') << left
 				     << "IP header length:" << ipp->headerLength()
@@ -110,11 +136,25 @@ int main(int argc, char * const * argv)
 				     << endl;
 			}
 			cout << setw(0) << endl;
+			NG_TRACE_END(OUTPUT, output_begin, 1);
+		}
+		if (result == Adapter::FAILED) {
+			cerr << adapter->error() << endl;
 		}
 	} catch (Exception & e) {
 		cerr << e.what() << endl;
 	}
 
+	/* convert recorded spans to Chrome trace JSON */
+	if (trace_file != NULL) {
+		ofstream trace_os(trace_file);
+		try {
+			Trace::dump(trace_os);
+		} catch (Exception & e) {
+			cerr << e.what() << endl;
+		}
+	}
+
 	NetworkService::dispose();
 	return 0;
 }
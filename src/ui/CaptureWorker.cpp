@@ -0,0 +1,214 @@
+/*
+ * implementation of class CaptureWorker
+ */
+
+#include <QThread>		/* for QThread */
+#include <QString>		/* for QString */
+#include <QElapsedTimer>	/* for QElapsedTimer */
+#include <vector>		/* for std::vector */
+#include <new>			/* for std::bad_alloc */
+#include <stddef.h>		/* for size_t */
+#include <pthread.h>		/* for pthread_self */
+
+#include "ui/CaptureWorker.h"	/* for netgazer::CaptureWorker */
+#include "core/Adapter.h"	/* for netgazer::Adapter */
+#include "core/Exception.h"	/* for netgazer::Exception */
+#include "core/PacketSummary.h"	/* for netgazer::PacketSummary */
+#include "core/Topology.h"	/* for netgazer::Topology */
+
+using std::vector;
+using std::bad_alloc;
+
+namespace netgazer {
+	/*
+	 * constructor of CaptureWorker
+	 *
+	 * @adapter: adapter opened with summaries enabled
+	 * @fps: batches published per second at most
+	 * @max_batch: maximum number of records per batch
+	 * @parent: parent object
+	 */
+	CaptureWorker::CaptureWorker(Adapter * adapter, int fps,
+		size_t max_batch, QObject * parent) NG_THROWS :
+		QThread(parent), m_published(4), m_free(8)
+	{
+		if (adapter == NULL || adapter->summaries() == NULL) {
+			throw Exception("adapter is not capturing summaries");
+		}
+		if (fps <= 0 || max_batch == 0) {
+			throw Exception("invalid frame rate or batch size");
+		}
+
+		this->m_adapter = adapter;
+		this->m_frame_ms = 1000 / fps > 0 ? 1000 / fps : 1;
+		this->m_max_batch = max_batch;
+		this->m_stopping = false;
+		this->m_back = NULL;
+		try {
+			this->m_back = new struct Batch;
+			this->m_back->records.reserve(max_batch);
+		} catch (bad_alloc & e) {
+			delete this->m_back;
+			throw Exception(e.what());
+		}
+		this->m_back->dropped = 0;
+	}
+
+	/*
+	 * destructor of CaptureWorker, stops the capture thread
+	 */
+	CaptureWorker::~CaptureWorker()
+	{
+		struct Batch * batch = NULL;
+
+		this->stop();
+		this->wait();
+
+		delete this->m_back;
+		while (this->m_published.pop(batch)) {
+			delete batch;
+		}
+		while (this->m_free.pop(batch)) {
+			delete batch;
+		}
+	}
+
+	/*
+	 * ask the capture thread to return, it notices within one capture
+	 * timeout of the adapter
+	 */
+	void CaptureWorker::stop()
+	{
+		this->m_stopping = true;
+	}
+
+	/*
+	 * pin the capture thread to some CPUs, best on the node of the
+	 * adapter; takes effect when the thread starts
+	 *
+	 * @cpus: CPUs the capture thread may run on, empty for any
+	 */
+	void CaptureWorker::setAffinity(const vector<int> & cpus)
+		NG_THROWS
+	{
+		try {
+			this->m_cpus = cpus;
+		} catch (bad_alloc & e) {
+			throw Exception(e.what());
+		}
+	}
+
+	/*
+	 * take the oldest published batch, GUI thread only
+	 *
+	 * return: the batch, to be passed back to recycle(), or NULL if none
+	 *         is pending
+	 */
+	struct CaptureWorker::Batch * CaptureWorker::take()
+	{
+		struct Batch * batch = NULL;
+
+		return this->m_published.pop(batch) ? batch : NULL;
+	}
+
+	/*
+	 * hand a consumed batch back to the capture thread, GUI thread only
+	 *
+	 * @batch: batch returned by take()
+	 */
+	void CaptureWorker::recycle(struct Batch * batch)
+	{
+		if (batch != NULL && !this->m_free.push(batch)) {
+			delete batch;
+		}
+	}
+
+	/*
+	 * capture loop, publishing the current batch once per frame
+	 */
+	void CaptureWorker::run()
+	{
+		QElapsedTimer frame;
+
+		frame.start();
+		try {
+			if (!this->m_cpus.empty()) {
+				Topology::pin(pthread_self(), this->m_cpus);
+			}
+			while (!this->m_stopping) {
+				this->m_adapter->dispatch(-1, this);
+				if (frame.elapsed() >= this->m_frame_ms) {
+					this->publish();
+					frame.restart();
+				}
+			}
+			this->publish();
+		} catch (Exception & e) {
+			emit this->failed(QString(e.what()));
+		}
+	}
+
+	/*
+	 * packets are not retained in summary mode
+	 */
+	void CaptureWorker::onPacket(Adapter * /* adapter */,
+		Packet * /* packet */) NG_THROWS
+	{
+	}
+
+	/*
+	 * append a summary record to the current batch
+	 *
+	 * @adapter: the capturing adapter
+	 * @summary: summary record of the packet
+	 */
+	void CaptureWorker::onSummary(Adapter * /* adapter */,
+		const struct PacketSummary * summary) NG_THROWS
+	{
+		vector<struct PacketSummary> & records = this->m_back->records;
+
+		/* this runs inside the libpcap callback, nothing may unwind
+		 * through it, a record that cannot be kept is dropped */
+		try {
+			/* the GUI is behind, keep the newer half */
+			if (records.size() >= this->m_max_batch) {
+				size_t half = records.size() / 2;
+
+				records.erase(records.begin(),
+					records.begin() + half);
+				this->m_back->dropped += half;
+			}
+			records.push_back(*summary);
+		} catch (...) {
+			++this->m_back->dropped;
+		}
+	}
+
+	/*
+	 * publish the current batch unless it is empty or the GUI has not
+	 * taken the previous ones yet, then start a new one
+	 */
+	void CaptureWorker::publish()
+	{
+		struct Batch * batch = NULL;
+
+		if (this->m_back->records.empty() ||
+			!this->m_published.push(this->m_back)) {
+			return;
+		}
+		if (!this->m_free.pop(batch)) {
+			try {
+				batch = new struct Batch;
+				batch->records.reserve(this->m_max_batch);
+			} catch (bad_alloc & e) {
+				/* the published batch is no longer ours */
+				delete batch;
+				this->m_back = NULL;
+				throw Exception(e.what());
+			}
+		}
+		batch->records.clear();
+		batch->dropped = 0;
+		this->m_back = batch;
+	}
+}
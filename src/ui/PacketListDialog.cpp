@@ -0,0 +1,114 @@
+/*
+ * implementation of class PacketListDialog
+ */
+
+#include <QDialog>	/* for QDialog */
+#include <QHeaderView>	/* for QHeaderView */
+#include <QTableView>	/* for QTableView */
+#include <QScrollBar>	/* for QScrollBar */
+#include <QString>	/* for QString */
+
+#include "ui/PacketListDialog.h"	/* for netgazer::PacketListDialog */
+#include "ui/CaptureWorker.h"		/* for netgazer::CaptureWorker */
+#include "ui/PacketTableModel.h"	/* for netgazer::PacketTableModel */
+#include "core/Adapter.h"		/* for netgazer::Adapter */
+#include "core/Exception.h"		/* for netgazer::Exception */
+
+namespace netgazer {
+	/*
+	 * constructor of PacketListDialog, opens the adapter and starts
+	 * capturing
+	 *
+	 * @adapter: adapter to capture on, not yet opened
+	 * @parent: parent widget
+	 */
+	PacketListDialog::PacketListDialog(Adapter * adapter,
+		QWidget * parent) NG_THROWS : QDialog(parent),
+		m_model(NULL), m_worker(NULL), m_dropped(0)
+	{
+		Adapter::Options options;
+		QTableView * view = NULL;
+
+		/* the capture timeout bounds the latency of a frame */
+		options.promisc = true;
+		options.timeout = 1000 / PacketListDialog::FRAME_RATE;
+		options.buffer_size = 32 * 1024 * 1024;
+		options.nano = true;
+		options.summaries = true;
+		adapter->open(options);
+
+		this->m_ui.setupUi(this);
+		this->setWindowTitle(QString(adapter->name()) + " - Net Gazer");
+
+		/*
+		 * fixed row heights keep the view from asking the model for
+		 * anything but the visible rows
+		 */
+		view = this->m_ui.packetView;
+		this->m_model = new PacketTableModel(PacketListDialog::ROWS,
+			this);
+		view->setModel(this->m_model);
+		view->setWordWrap(false);
+		view->verticalHeader()->hide();
+		view->verticalHeader()->setDefaultSectionSize(
+			view->fontMetrics().height() + 4);
+		view->horizontalHeader()->setStretchLastSection(true);
+
+		this->m_worker = new CaptureWorker(adapter,
+			PacketListDialog::FRAME_RATE, PacketListDialog::MAX_BATCH,
+			this);
+		connect(this->m_worker, SIGNAL(failed(const QString &)),
+			this, SLOT(captureFailed(const QString &)));
+		connect(&(this->m_timer), SIGNAL(timeout()),
+			this, SLOT(refresh()));
+
+		this->m_worker->start();
+		this->m_timer.start(1000 / PacketListDialog::FRAME_RATE);
+	}
+
+	/*
+	 * destructor of PacketListDialog, stops capturing
+	 */
+	PacketListDialog::~PacketListDialog()
+	{
+		this->m_timer.stop();
+		delete this->m_worker;
+	}
+
+	/*
+	 * move the batches published since the last frame into the model
+	 */
+	void PacketListDialog::refresh()
+	{
+		QScrollBar * bar = this->m_ui.packetView->verticalScrollBar();
+		bool follow = bar->value() == bar->maximum();
+		struct CaptureWorker::Batch * batch = NULL;
+		bool changed = false;
+
+		while ((batch = this->m_worker->take()) != NULL) {
+			this->m_model->append(&(batch->records[0]),
+				batch->records.size());
+			this->m_dropped += batch->dropped;
+			this->m_worker->recycle(batch);
+			changed = true;
+		}
+
+		/* keep following the newest packets unless scrolled away */
+		if (changed && follow) {
+			this->m_ui.packetView->scrollToBottom();
+		}
+	}
+
+	/*
+	 * report a capture error and stop refreshing
+	 *
+	 * @message: error message
+	 */
+	void PacketListDialog::captureFailed(const QString & message)
+	{
+		this->refresh();
+		this->m_timer.stop();
+		this->setWindowTitle(this->windowTitle() + " (" + message +
+			")");
+	}
+}
@@ -0,0 +1,257 @@
+/*
+ * implementation of class PacketTableModel
+ */
+
+#include <QAbstractTableModel>	/* for QAbstractTableModel */
+#include <QModelIndex>		/* for QModelIndex */
+#include <QVariant>		/* for QVariant */
+#include <QString>		/* for QString */
+#include <stddef.h>		/* for size_t */
+#include <stdint.h>		/* for fixed width integer types */
+#include <arpa/inet.h>		/* for ntohl */
+
+#include "ui/PacketTableModel.h"	/* for netgazer::PacketTableModel */
+#include "core/PacketSummary.h"		/* for netgazer::PacketSummary */
+
+namespace netgazer {
+	/* header titles, indexed by enum PacketTableModel::Column */
+	static const char * const titles[PacketTableModel::COLUMN_COUNT] = {
+		"No.", "Time", "Source", "Destination", "Protocol", "Length",
+		"Info",
+	};
+
+	/*
+	 * format an IPv4 address in dotted decimal
+	 *
+	 * @addr: address in network order
+	 *
+	 * return: formatted address
+	 */
+	static QString formatAddress(uint32_t addr)
+	{
+		uint32_t a = ntohl(addr);
+
+		return QString("%1.%2.%3.%4").arg(a >> 24).arg((a >> 16) & 0xff)
+			.arg((a >> 8) & 0xff).arg(a & 0xff);
+	}
+
+	/*
+	 * get the protocol name of a summary record
+	 *
+	 * @s: summary record
+	 *
+	 * return: protocol name
+	 */
+	static QString protocolName(const struct PacketSummary & s)
+	{
+		if (s.flags & PacketSummary::IPV4) {
+			switch (s.protocol) {
+			case 1:
+				return "ICMP";
+			case 6:
+				return "TCP";
+			case 17:
+				return "UDP";
+			default:
+				return QString("IP %1").arg((uint)s.protocol);
+			}
+		}
+		switch (s.ether_type) {
+		case 0x0806:
+			return "ARP";
+		case 0x86dd:
+			return "IPv6";
+		default:
+			return QString("0x%1").arg(s.ether_type, 4, 16,
+				QChar('0'));
+		}
+	}
+
+	/*
+	 * constructor of PacketTableModel
+	 *
+	 * @capacity: maximum number of rows, older rows are dropped
+	 * @parent: parent object
+	 */
+	PacketTableModel::PacketTableModel(size_t capacity, QObject * parent) :
+		QAbstractTableModel(parent), m_buffer(capacity), m_hidden(0)
+	{
+	}
+
+	/*
+	 * destructor of PacketTableModel
+	 */
+	PacketTableModel::~PacketTableModel()
+	{
+	}
+
+	/*
+	 * get the number of rows
+	 *
+	 * @parent: parent index, rows only exist at the top level
+	 *
+	 * return: number of rows
+	 */
+	int PacketTableModel::rowCount(const QModelIndex & parent) const
+	{
+		if (parent.isValid()) {
+			return 0;
+		}
+		return (int)(this->m_buffer.size() - this->m_hidden);
+	}
+
+	/*
+	 * get the number of columns
+	 *
+	 * @parent: parent index, columns only exist at the top level
+	 *
+	 * return: number of columns
+	 */
+	int PacketTableModel::columnCount(const QModelIndex & parent) const
+	{
+		if (parent.isValid()) {
+			return 0;
+		}
+		return PacketTableModel::COLUMN_COUNT;
+	}
+
+	/*
+	 * get the data of a cell, formatted on demand
+	 *
+	 * @index: index of the cell
+	 * @role: requested role
+	 *
+	 * return: cell data
+	 */
+	QVariant PacketTableModel::data(const QModelIndex & index, int role)
+		const
+	{
+		if (!index.isValid() || index.row() >= this->rowCount()) {
+			return QVariant();
+		}
+		if (role == Qt::TextAlignmentRole) {
+			if (index.column() == PacketTableModel::NUMBER ||
+				index.column() == PacketTableModel::LENGTH) {
+				return (int)(Qt::AlignRight | Qt::AlignVCenter);
+			}
+			return QVariant();
+		}
+		if (role != Qt::DisplayRole) {
+			return QVariant();
+		}
+		return this->format(this->m_buffer.at(this->m_hidden +
+			index.row()), index.column(), index.row());
+	}
+
+	/*
+	 * get the title of a column
+	 *
+	 * @section: column or row number
+	 * @orientation: horizontal for columns
+	 * @role: requested role
+	 *
+	 * return: column title
+	 */
+	QVariant PacketTableModel::headerData(int section,
+		Qt::Orientation orientation, int role) const
+	{
+		if (role != Qt::DisplayRole || orientation != Qt::Horizontal ||
+			section < 0 || section >= PacketTableModel::COLUMN_COUNT) {
+			return QVariant();
+		}
+		return QString(titles[section]);
+	}
+
+	/*
+	 * append a batch of records, dropping the oldest rows beyond the
+	 * capacity; the view is notified once per batch
+	 *
+	 * @records: records to append
+	 * @count: number of records
+	 */
+	void PacketTableModel::append(const struct PacketSummary * records,
+		size_t count)
+	{
+		size_t capacity = this->m_buffer.capacity();
+		size_t size = this->m_buffer.size();
+		size_t overflow = 0;
+		int rows = 0;
+
+		if (count == 0) {
+			return;
+		}
+		if (count > capacity) {
+			records += count - capacity;
+			count = capacity;
+		}
+
+		/* hide the rows about to be overwritten before they go */
+		if (size + count > capacity) {
+			overflow = size + count - capacity;
+			this->beginRemoveRows(QModelIndex(), 0, (int)overflow - 1);
+			this->m_hidden = overflow;
+			this->endRemoveRows();
+		}
+
+		rows = this->rowCount();
+		this->beginInsertRows(QModelIndex(), rows,
+			rows + (int)count - 1);
+		for (size_t i = 0; i < count; ++i) {
+			this->m_buffer.push() = records[i];
+		}
+		this->m_hidden = 0;
+		this->endInsertRows();
+	}
+
+	/*
+	 * remove all rows
+	 */
+	void PacketTableModel::clear()
+	{
+		this->beginResetModel();
+		this->m_buffer.clear();
+		this->m_hidden = 0;
+		this->endResetModel();
+	}
+
+	/*
+	 * format a cell of a record
+	 *
+	 * @s: summary record
+	 * @column: enum PacketTableModel::Column of the cell
+	 * @row: row of the record
+	 *
+	 * return: cell text
+	 */
+	QVariant PacketTableModel::format(const struct PacketSummary & s,
+		int column, int row) const
+	{
+		switch (column) {
+		case PacketTableModel::NUMBER:
+			return (qulonglong)(this->m_buffer.total() -
+				this->m_buffer.size() + this->m_hidden + row + 1);
+		case PacketTableModel::TIME:
+			return QString("%1.%2").arg((qulonglong)(s.ts_ns /
+				1000000000)).arg((qulonglong)(s.ts_ns % 1000000000),
+				9, 10, QChar('0'));
+		case PacketTableModel::SOURCE:
+			return s.flags & PacketSummary::IPV4 ?
+				formatAddress(s.src_addr) : QString();
+		case PacketTableModel::DESTINATION:
+			return s.flags & PacketSummary::IPV4 ?
+				formatAddress(s.dest_addr) : QString();
+		case PacketTableModel::PROTOCOL:
+			return protocolName(s);
+		case PacketTableModel::LENGTH:
+			return (uint)s.length;
+		case PacketTableModel::INFO:
+			if (!(s.flags & PacketSummary::PORTS)) {
+				return QString();
+			}
+			return QString("%1 -> %2").arg(s.src_port)
+				.arg(s.dest_port);
+		default:
+			return QVariant();
+		}
+	}
+}
@@ -0,0 +1,69 @@
+/*
+ * tests of class Adapter
+ *
+ * build and run from the top directory:
+ *   g++ -Iinclude test/AdapterTest.cpp src/core/Adapter.cpp \
+ *       src/core/Dissector.cpp src/core/IPv4Packet.cpp \
+ *       src/core/MemoryConsumer.cpp src/core/MemoryGovernor.cpp \
+ *       src/core/Packet.cpp src/core/PacketSummary.cpp src/core/Sampler.cpp \
+ *       src/core/SummaryBuffer.cpp src/core/Topology.cpp src/core/Trace.cpp \
+ *       src/core/TruncationPolicy.cpp -lpcap -lpthread -o AdapterTest && \
+ *       ./AdapterTest
+ */
+
+#include <cassert>	/* for assert */
+#include <cstring>	/* for std::memset and std::memcmp */
+#include <iostream>	/* for std::cout */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "netgazer.h"
+
+using std::memset;
+using std::memcmp;
+using std::cout;
+using std::endl;
+
+namespace netgazer {
+	/* drives the private retention path without a capture handle */
+	class AdapterTest {
+	public:
+		/*
+		 * retain frames with a given retention and check that every
+		 * returned packet stays valid until the next one
+		 *
+		 * @retain: retention of the adapter
+		 */
+		static void retention(size_t retain)
+		{
+			Adapter adapter("test0", NULL, 0);
+			struct pcap_pkthdr header;
+			u_char frame[64];
+
+			adapter.m_retain = retain;
+			memset(&header, 0, sizeof(header));
+			header.caplen = header.len = sizeof(frame);
+			for (int i = 0; i < 10; ++i) {
+				Packet * p = NULL;
+
+				memset(frame, i, sizeof(frame));
+				p = adapter.retain(&header, frame);
+				assert(p->capturedLength() == sizeof(frame));
+				assert(memcmp(p->data(), frame,
+					sizeof(frame)) == 0);
+				assert(adapter.m_packets.back() == p);
+				assert(adapter.m_packets.size() ==
+					(size_t)(i + 1 < (int)retain ? i + 1 :
+					(retain > 0 ? retain : 1)));
+			}
+		}
+	};
+}
+
+int main()
+{
+	netgazer::AdapterTest::retention(0);
+	netgazer::AdapterTest::retention(1);
+	netgazer::AdapterTest::retention(4);
+	cout << "AdapterTest passed" << endl;
+	return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * tests of class ByteCursor
+ *
+ * build and run from the top directory:
+ *   g++ -Iinclude test/ByteCursorTest.cpp -o ByteCursorTest && \
+ *       ./ByteCursorTest
+ */
+
+#include <cassert>	/* for assert */
+#include <iostream>	/* for std::cout */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "netgazer.h"
+
+using std::cout;
+using std::endl;
+
+using netgazer::ByteCursor;
+
+int main()
+{
+	static const u_char data[] = {
+		0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a
+	};
+
+	/* big endian reads */
+	{
+		ByteCursor c(data, sizeof(data));
+		uint8_t v8 = 0;
+		uint16_t v16 = 0;
+		uint32_t v24 = 0;
+		uint32_t v32 = 0;
+
+		assert(c.u8(v8) && v8 == 0x01);
+		assert(c.u16(v16) && v16 == 0x0203);
+		assert(c.u24(v24) && v24 == 0x040506);
+		assert(c.u32(v32) && v32 == 0x0708090a);
+		assert(c.remaining() == 0 && c.ok());
+	}
+
+	/* a read past the end fails, keeps the output and sticks */
+	{
+		ByteCursor c(data, 3);
+		uint8_t v8 = 0;
+		uint32_t v32 = 0xdeadbeef;
+
+		assert(!c.u32(v32) && v32 == 0xdeadbeef);
+		assert(!c.ok() && c.offset() == 0);
+		assert(!c.u8(v8) && v8 == 0);
+		assert(!c.has(0));
+	}
+
+	/* a huge length does not wrap around */
+	{
+		ByteCursor c(data, sizeof(data));
+		const u_char * view = NULL;
+
+		assert(c.skip(4));
+		assert(!c.bytes((size_t)-2, &view) && view == NULL);
+		assert(!c.ok());
+	}
+
+	/* sub-cursors are bounded by their length prefix */
+	{
+		ByteCursor c(data, sizeof(data));
+		ByteCursor s(NULL, 0);
+		uint16_t v16 = 0;
+
+		assert(c.sub(3, s) && c.offset() == 3);
+		assert(s.u16(v16) && v16 == 0x0102);
+		assert(!s.u16(v16) && v16 == 0x0102);
+		assert(c.ok());
+		assert(!c.sub(8, s) && !c.ok());
+	}
+
+	/* seeking, e.g. to follow DNS pointers */
+	{
+		ByteCursor c(data, sizeof(data));
+		uint8_t v8 = 0;
+
+		assert(c.seek(sizeof(data)) && c.remaining() == 0);
+		assert(c.seek(9) && c.u8(v8) && v8 == 0x0a);
+		assert(!c.seek(sizeof(data) + 1) && !c.ok());
+	}
+
+	/* lines end with CR LF or LF, a missing end fails */
+	{
+		static const u_char text[] = "GET /\r\nHost: a\n\nrest";
+		ByteCursor c(text, sizeof(text) - 1);
+		const u_char * line = NULL;
+		size_t n = 0;
+
+		assert(c.line(&line, &n) && n == 5 && line == text);
+		assert(c.line(&line, &n) && n == 7 && line[0] == 'H');
+		assert(c.line(&line, &n) && n == 0);
+		assert(!c.line(&line, &n) && !c.ok());
+	}
+
+	cout << "ByteCursorTest passed" << endl;
+	return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * tests of class CaptureWorker
+ *
+ * build and run from the top directory, with Qt 5:
+ *   moc -Iinclude include/ui/CaptureWorker.h -o moc_CaptureWorker.cpp
+ *   g++ -fPIC -Iinclude $(pkg-config --cflags Qt5Core) \
+ *       test/CaptureWorkerTest.cpp src/ui/CaptureWorker.cpp \
+ *       moc_CaptureWorker.cpp src/core/Adapter.cpp src/core/Dissector.cpp \
+ *       src/core/IPv4Packet.cpp src/core/MemoryConsumer.cpp \
+ *       src/core/MemoryGovernor.cpp src/core/Packet.cpp \
+ *       src/core/PacketSummary.cpp src/core/Sampler.cpp \
+ *       src/core/SummaryBuffer.cpp src/core/Topology.cpp src/core/Trace.cpp \
+ *       src/core/TruncationPolicy.cpp \
+ *       $(pkg-config --libs Qt5Core) -lpcap -lpthread \
+ *       -o CaptureWorkerTest && ./CaptureWorkerTest
+ */
+
+#include <cassert>	/* for assert */
+#include <cstring>	/* for std::memset */
+#include <iostream>	/* for std::cout */
+
+#include "netgazer.h"
+#include "ui/CaptureWorker.h"	/* for netgazer::CaptureWorker */
+
+using std::memset;
+using std::cout;
+using std::endl;
+
+namespace netgazer {
+	/* drives the batching of the worker without a capture thread */
+	class CaptureWorkerTest {
+	public:
+		/*
+		 * a worker needs an adapter capturing summaries
+		 */
+		static void construction()
+		{
+			Adapter adapter("test0", NULL, 0);
+			bool thrown = false;
+
+			try {
+				CaptureWorker worker(&adapter, 30, 8);
+			} catch (Exception &) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+
+		/*
+		 * fill batches past their limit and pass them to the GUI
+		 * side and back
+		 */
+		static void batching()
+		{
+			Adapter adapter("test0", NULL, 0);
+			struct PacketSummary summary;
+			CaptureWorker::Batch * batch = NULL;
+
+			adapter.m_summaries = new SummaryBuffer(16);
+			CaptureWorker worker(&adapter, 30, 8);
+
+			/* nothing to take before the first frame */
+			assert(worker.take() == NULL);
+			worker.publish();
+			assert(worker.take() == NULL);
+
+			/* the newer half survives an overflow */
+			memset(&summary, 0, sizeof(summary));
+			for (uint32_t i = 0; i < 10; ++i) {
+				summary.length = i;
+				worker.onSummary(&adapter, &summary);
+			}
+			worker.publish();
+			batch = worker.take();
+			assert(batch != NULL);
+			assert(batch->records.size() == 6);
+			assert(batch->dropped == 4);
+			assert(batch->records.front().length == 4);
+			assert(batch->records.back().length == 9);
+			assert(worker.take() == NULL);
+
+			/* a recycled batch comes back empty on the next frame */
+			worker.recycle(batch);
+			worker.onSummary(&adapter, &summary);
+			worker.publish();
+			batch = worker.take();
+			assert(batch != NULL);
+			assert(batch->records.size() == 1);
+			assert(batch->dropped == 0);
+			worker.recycle(batch);
+		}
+	};
+}
+
+int main()
+{
+	netgazer::CaptureWorkerTest::construction();
+	netgazer::CaptureWorkerTest::batching();
+	cout << "CaptureWorkerTest passed" << endl;
+	return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * tests of class Dissector
+ *
+ * build and run from the top directory:
+ *   g++ -Iinclude test/DissectorTest.cpp src/core/Dissector.cpp \
+ *       -o DissectorTest && ./DissectorTest
+ */
+
+#include <cassert>	/* for assert */
+#include <cstring>	/* for std::memcpy and std::memcmp */
+#include <vector>	/* for std::vector */
+#include <iostream>	/* for std::cout */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "netgazer.h"
+
+using std::memcpy;
+using std::memcmp;
+using std::vector;
+using std::cout;
+using std::endl;
+
+using netgazer::Dissector;
+
+/*
+ * append a big endian number
+ *
+ * @v: buffer
+ * @n: number
+ * @size: number of bytes
+ */
+static void put(vector<u_char> & v, uint32_t n, int size)
+{
+	for (int i = size - 1; i >= 0; --i) {
+		v.push_back((u_char)(n >> (8 * i)));
+	}
+}
+
+/*
+ * make a frame from 10.0.0.1:1234 to 10.0.0.2:80
+ *
+ * @tags: number of 802.1Q tags, the outer one 802.1ad if two or more
+ * @ihl: IPv4 header length in 32-bit words, options zeroed
+ * @protocol: IPv4 protocol, 6 with a 24-byte TCP header or 17
+ * @payload: number of payload bytes
+ *
+ * return: the frame
+ */
+static vector<u_char> frame(int tags, int ihl, uint8_t protocol,
+	size_t payload)
+{
+	size_t l4 = protocol == 6 ? 24 : 8;
+	vector<u_char> v(12, 0xee);
+
+	for (int i = 0; i < tags; ++i) {
+		put(v, i == 0 && tags > 1 ? 0x88a8 : 0x8100, 2);
+		put(v, 100 + i, 2);
+	}
+	put(v, 0x0800, 2);
+
+	v.push_back((u_char)(0x40 | ihl));
+	v.push_back(0);
+	put(v, ihl * 4 + l4 + payload, 2);
+	put(v, 0, 4);				/* id, fragment */
+	v.push_back(64);
+	v.push_back(protocol);
+	put(v, 0, 2);
+	put(v, 0x0a000001, 4);
+	put(v, 0x0a000002, 4);
+	v.insert(v.end(), ihl > 5 ? (ihl - 5) * 4 : 0, 0);
+
+	put(v, 1234, 2);
+	put(v, 80, 2);
+	if (protocol == 6) {
+		put(v, 1000, 4);
+		put(v, 2000, 4);
+		v.push_back(6 << 4);		/* data offset with options */
+		v.push_back(0x18);
+		put(v, 512, 2);
+		put(v, 0, 4);			/* checksum, urgent pointer */
+		put(v, 0, 4);			/* options */
+	} else {
+		put(v, 8 + payload, 2);
+		put(v, 0, 2);
+	}
+	v.insert(v.end(), payload, 'p');
+	return v;
+}
+
+/*
+ * dissect a copy of the first bytes of a frame, so that reads past them
+ * are caught by memory checkers
+ *
+ * @f: frame
+ * @n: number of bytes to copy
+ * @d: dissection to fill in
+ *
+ * return: payload length of the dissection
+ */
+static size_t dissect(const vector<u_char> & f, size_t n,
+	struct Dissector::Dissection & d)
+{
+	u_char * copy = new u_char[n];
+	size_t length = 0;
+
+	if (n > 0) {
+		memcpy(copy, &(f[0]), n);
+	}
+	Dissector::dissect(copy, n, d);
+	length = Dissector::payloadLength(copy, n, d);
+	delete[] copy;
+	return length;
+}
+
+int main()
+{
+	struct Dissector::Dissection d;
+	vector<u_char> f;
+
+	/* TCP with options, payload behind the data offset */
+	f = frame(0, 5, 6, 10);
+	assert(dissect(f, f.size(), d) == 10);
+	assert(d.flags == (Dissector::HAS_IPV4 | Dissector::HAS_PORTS));
+	assert(d.ether_type == 0x0800 && d.protocol == 6);
+	assert(d.l3_offset == 14 && d.l4_offset == 34);
+	assert(d.payload_offset == 58);
+	assert(memcmp(&(d.src_addr), "\x0a\x00\x00\x01", 4) == 0);
+	assert(memcmp(&(d.dest_addr), "\x0a\x00\x00\x02", 4) == 0);
+	assert(d.src_port == 1234 && d.dest_port == 80);
+	assert(d.seq == 1000 && d.ack == 2000 && d.window == 512);
+	assert(d.tcp_flags == 0x18);
+
+	/* Ethernet padding is not payload */
+	f = frame(0, 5, 17, 2);
+	f.insert(f.end(), 8, 0);
+	assert(dissect(f, f.size(), d) == 2);
+	assert(d.payload_offset == 42);
+
+	/* 802.1Q and 802.1ad tags are skipped */
+	f = frame(1, 5, 17, 4);
+	assert(dissect(f, f.size(), d) == 4);
+	assert(d.ether_type == 0x0800 && d.l3_offset == 18);
+	assert(d.flags == (Dissector::HAS_IPV4 | Dissector::HAS_PORTS));
+	f = frame(2, 5, 17, 4);
+	assert(dissect(f, f.size(), d) == 4);
+	assert(d.l3_offset == 22 && d.dest_port == 80);
+
+	/* a tag cut by the snaplen */
+	f = frame(2, 5, 17, 0);
+	dissect(f, 17, d);
+	assert(d.flags == Dissector::TRUNCATED);
+	dissect(f, 19, d);
+	assert(d.flags == Dissector::TRUNCATED);
+	dissect(f, 22, d);
+	assert(d.flags == Dissector::TRUNCATED);
+
+	/* other ether types stop at L3 */
+	f = frame(1, 5, 17, 0);
+	f[16] = 0x86;
+	f[17] = 0xdd;
+	assert(dissect(f, f.size(), d) == 0);
+	assert(d.flags == 0 && d.ether_type == 0x86dd && d.l3_offset == 18);
+
+	/* IPv4 options move the L4 header */
+	f = frame(0, 7, 17, 3);
+	assert(dissect(f, f.size(), d) == 3);
+	assert(d.l4_offset == 42 && d.dest_port == 80);
+
+	/* an IHL below 5 is not IPv4 */
+	f = frame(0, 5, 17, 3);
+	for (int ihl = 0; ihl < 5; ++ihl) {
+		f[14] = (u_char)(0x40 | ihl);
+		assert(dissect(f, f.size(), d) == 0);
+		assert(d.flags == 0 && d.l4_offset == 14);
+	}
+
+	/* not version 4 */
+	f[14] = 0x65;
+	dissect(f, f.size(), d);
+	assert(d.flags == Dissector::TRUNCATED);
+
+	/* a non-first fragment has no ports */
+	f = frame(0, 5, 6, 10);
+	f[20] = 0x00;
+	f[21] = 0x10;
+	assert(dissect(f, f.size(), d) == 0);
+	assert(d.flags == (Dissector::HAS_IPV4 | Dissector::FRAGMENT));
+	assert(d.l4_offset == 14 && d.src_port == 0);
+
+	/* TCP cut in its fixed header or in its options */
+	f = frame(0, 5, 6, 10);
+	assert(dissect(f, 53, d) == 0);
+	assert(d.flags == (Dissector::HAS_IPV4 | Dissector::TRUNCATED));
+	assert(d.src_port == 0);
+	assert(dissect(f, 56, d) == 0);
+	assert(d.flags == (Dissector::HAS_IPV4 | Dissector::HAS_PORTS |
+		Dissector::TRUNCATED));
+	assert(d.payload_offset == 58 && d.dest_port == 80);
+
+	/* UDP cut in its header */
+	f = frame(0, 5, 17, 10);
+	assert(dissect(f, 41, d) == 0);
+	assert(d.flags == (Dissector::HAS_IPV4 | Dissector::TRUNCATED));
+
+	/* every prefix of every kind of frame */
+	for (int tags = 0; tags < 3; ++tags) {
+		for (int ihl = 4; ihl < 7; ++ihl) {
+			for (int tcp = 0; tcp < 2; ++tcp) {
+				f = frame(tags, ihl, tcp ? 6 : 17, 5);
+				for (size_t n = 0; n <= f.size(); ++n) {
+					size_t length = dissect(f, n, d);
+
+					assert(length == 0 ||
+						d.payload_offset + length == n);
+					assert(length == 0 || ihl >= 5);
+				}
+				assert(dissect(f, f.size(), d) ==
+					(ihl >= 5 ? 5u : 0u));
+			}
+		}
+	}
+
+	cout << "DissectorTest passed" << endl;
+	return 0;
+}
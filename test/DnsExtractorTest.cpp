@@ -0,0 +1,177 @@
+/*
+ * tests of class DnsExtractor
+ *
+ * build and run from the top directory:
+ *   g++ -Iinclude test/DnsExtractorTest.cpp src/core/DnsExtractor.cpp \
+ *       src/core/Dissector.cpp -o DnsExtractorTest && ./DnsExtractorTest
+ */
+
+#include <cassert>	/* for assert */
+#include <cstring>	/* for std::memcpy, std::memcmp and std::strcmp */
+#include <vector>	/* for std::vector */
+#include <iostream>	/* for std::cout */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "netgazer.h"
+
+using std::memcpy;
+using std::memcmp;
+using std::strcmp;
+using std::vector;
+using std::cout;
+using std::endl;
+
+using netgazer::DnsExtractor;
+
+/* response for www.example.com, a CNAME to cdn.example.com and an A */
+static const u_char RESPONSE[] = {
+	0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02,
+	0x00, 0x00, 0x00, 0x00,
+	/* question at 12, example at 16 */
+	0x03, 'w', 'w', 'w', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e',
+	0x03, 'c', 'o', 'm', 0x00, 0x00, 0x01, 0x00, 0x01,
+	/* CNAME */
+	0xc0, 0x0c, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10,
+	0x00, 0x06, 0x03, 'c', 'd', 'n', 0xc0, 0x10,
+	/* A */
+	0xc0, 0x2d, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0e, 0x10,
+	0x00, 0x04, 0x5d, 0xb8, 0xd8, 0x22
+};
+
+/* length of the header and question of RESPONSE */
+static const size_t QUESTION_END = 33;
+
+/*
+ * extract from a copy of the first bytes of a message, so that reads
+ * past them are caught by memory checkers
+ *
+ * @message: message
+ * @n: number of bytes to copy
+ * @r: record to fill in
+ *
+ * return: result of DnsExtractor::extract
+ */
+static bool extract(const vector<u_char> & message, size_t n,
+	struct DnsExtractor::Record & r)
+{
+	u_char * copy = new u_char[n];
+	bool ret = false;
+
+	if (n > 0) {
+		memcpy(copy, &(message[0]), n);
+	}
+	ret = DnsExtractor::extract(copy, n, r);
+	delete[] copy;
+	return ret;
+}
+
+/*
+ * make a query with one question
+ *
+ * @name: question name in wire form, NUL not included
+ * @n: length of the name
+ *
+ * return: the message
+ */
+static vector<u_char> query(const u_char * name, size_t n)
+{
+	static const u_char header[] = {
+		0xab, 0xcd, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00
+	};
+	static const u_char tail[] = { 0x00, 0x00, 0x1c, 0x00, 0x01 };
+	vector<u_char> m(header, header + sizeof(header));
+
+	m.insert(m.end(), name, name + n);
+	m.insert(m.end(), tail, tail + sizeof(tail));
+	return m;
+}
+
+int main()
+{
+	vector<u_char> response(RESPONSE, RESPONSE + sizeof(RESPONSE));
+	struct DnsExtractor::Record r;
+
+	/* the question and the address behind the CNAME */
+	assert(extract(response, response.size(), r));
+	assert(r.id == 0x1234 && r.opcode == 0 && r.rcode == 0);
+	assert(r.flags == DnsExtractor::RESPONSE);
+	assert(strcmp(r.name, "www.example.com") == 0);
+	assert(r.name_length == 15);
+	assert(r.qtype == 1 && r.qclass == 1 && r.answer_count == 2);
+	assert(r.address_count == 1);
+	assert(memcmp(&(r.addresses[0]), "\x5d\xb8\xd8\x22", 4) == 0);
+
+	/* every prefix: no question, then no answers, then the address */
+	for (size_t n = 0; n < response.size(); ++n) {
+		bool ok = extract(response, n, r);
+
+		assert(ok == (n >= QUESTION_END));
+		if (ok) {
+			assert(strcmp(r.name, "www.example.com") == 0);
+			assert(r.address_count == 0);
+		}
+	}
+
+	/* a query is done after its question, in AAAA for the root */
+	{
+		vector<u_char> m = query(NULL, 0);
+
+		assert(extract(m, m.size(), r));
+		assert(!(r.flags & DnsExtractor::RESPONSE));
+		assert(r.qtype == 28 && strcmp(r.name, ".") == 0);
+	}
+
+	/* no question */
+	{
+		vector<u_char> m(response.begin(), response.begin() + 12);
+
+		m[5] = 0;
+		assert(!extract(m, m.size(), r));
+	}
+
+	/* a pointer to itself, to past the end and reserved label bits */
+	{
+		static const u_char loop[] = { 0xc0, 0x0c };
+		static const u_char beyond[] = { 0xc0, 0xff };
+		static const u_char reserved[] = { 0x41, 'a' };
+		vector<u_char> m;
+
+		m = query(loop, sizeof(loop));
+		assert(!extract(m, m.size(), r));
+		m = query(beyond, sizeof(beyond));
+		assert(!extract(m, m.size(), r));
+		m = query(reserved, sizeof(reserved));
+		assert(!extract(m, m.size(), r));
+	}
+
+	/* an answer with a pointer loop ends the answers, not the record */
+	{
+		vector<u_char> m(response);
+
+		m[QUESTION_END] = 0xc0;
+		m[QUESTION_END + 1] = (u_char)QUESTION_END;
+		assert(extract(m, m.size(), r));
+		assert(r.address_count == 0);
+	}
+
+	/* a name longer than MAX_NAME is cut */
+	{
+		vector<u_char> name;
+		vector<u_char> m;
+
+		for (int i = 0; i < 5; ++i) {
+			name.push_back(63);
+			name.insert(name.end(), 63, 'a');
+		}
+		m = query(&(name[0]), name.size());
+		assert(extract(m, m.size(), r));
+		assert(r.flags & DnsExtractor::NAME_TRUNCATED);
+		assert(r.name_length == DnsExtractor::MAX_NAME);
+		assert(r.name[DnsExtractor::MAX_NAME] == '\0');
+		assert(r.qtype == 28);
+	}
+
+	cout << "DnsExtractorTest passed" << endl;
+	return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * tests of class HttpExtractor
+ *
+ * build and run from the top directory:
+ *   g++ -Iinclude test/HttpExtractorTest.cpp src/core/HttpExtractor.cpp \
+ *       src/core/Dissector.cpp -o HttpExtractorTest && ./HttpExtractorTest
+ */
+
+#include <cassert>	/* for assert */
+#include <cstring>	/* for std::memcpy, std::strlen and std::strcmp */
+#include <string>	/* for std::string */
+#include <iostream>	/* for std::cout */
+
+#include "netgazer.h"
+
+using std::memcpy;
+using std::strlen;
+using std::strcmp;
+using std::string;
+using std::cout;
+using std::endl;
+
+using netgazer::HttpExtractor;
+
+static const char REQUEST[] =
+	"GET /index.html HTTP/1.1\r\n"
+	"User-Agent: test\r\n"
+	"hOsT: \t www.example.com \r\n"
+	"\r\n";
+
+/*
+ * extract from a copy of the first bytes of a request, so that reads
+ * past them are caught by memory checkers
+ *
+ * @request: request
+ * @n: number of bytes to copy
+ * @r: record to fill in
+ *
+ * return: result of HttpExtractor::extract
+ */
+static bool extract(const string & request, size_t n,
+	struct HttpExtractor::Record & r)
+{
+	u_char * copy = new u_char[n];
+	bool ret = false;
+
+	memcpy(copy, request.data(), n);
+	ret = HttpExtractor::extract(copy, n, r);
+	delete[] copy;
+	return ret;
+}
+
+/*
+ * extract from a whole request
+ *
+ * @request: request
+ * @r: record to fill in
+ *
+ * return: result of HttpExtractor::extract
+ */
+static bool extract(const string & request, struct HttpExtractor::Record & r)
+{
+	return extract(request, request.size(), r);
+}
+
+int main()
+{
+	string request(REQUEST);
+	size_t line_end = request.find('\n') + 1;
+	size_t host_end = request.find(" \r\n\r\n") + 3;
+	struct HttpExtractor::Record r;
+
+	/* the request line and the Host header, trimmed */
+	assert(extract(request, r));
+	assert(strcmp(r.method, "GET") == 0 && r.method_length == 3);
+	assert(strcmp(r.uri, "/index.html") == 0 && r.uri_length == 11);
+	assert(r.version_major == 1 && r.version_minor == 1);
+	assert(r.flags == HttpExtractor::HAS_HOST);
+	assert(strcmp(r.host, "www.example.com") == 0);
+	assert(r.host_length == 15);
+
+	/* every prefix: no request line, then no Host, then the Host */
+	for (size_t n = 0; n < request.size(); ++n) {
+		bool ok = extract(request, n, r);
+
+		assert(ok == (n >= line_end));
+		if (!ok) {
+			continue;
+		}
+		assert(strcmp(r.uri, "/index.html") == 0);
+		if (n < host_end) {
+			assert(r.flags == HttpExtractor::INCOMPLETE);
+			assert(r.host_length == 0 && r.host[0] == '\0');
+		} else {
+			assert(r.flags == HttpExtractor::HAS_HOST);
+		}
+	}
+
+	/* headers end before any Host */
+	assert(extract(string("POST /a HTTP/1.0\r\nAccept: x\r\n\r\n"
+		"Host: late\r\n"), r));
+	assert(r.flags == 0 && r.version_minor == 0);
+
+	/* malformed request lines */
+	assert(!extract(string("get /index.html HTTP/1.1\r\n\r\n"), r));
+	assert(!extract(string("GET /index.html HTTP/1.1 \r\n\r\n"), r));
+	assert(!extract(string("GET /index.html HTTP-1.1\r\n\r\n"), r));
+	assert(!extract(string("GET /index.html HTTP/x.1\r\n\r\n"), r));
+	assert(!extract(string("GET\t/index.html HTTP/1.1\r\n\r\n"), r));
+	assert(!extract(string("GETTINGTOOLONGMETHOD / HTTP/1.1\r\n"), r));
+	assert(!extract(string("GET /index.html\r\nHTTP/1.1\r\n"), r));
+
+	/* a Host header name needs its colon */
+	assert(extract(string("GET / HTTP/1.1\r\nHosts: a\r\nHost:\r\n\r\n"),
+		r));
+	assert(r.flags == HttpExtractor::HAS_HOST && r.host_length == 0);
+
+	/* long fields are cut */
+	{
+		string uri(300, 'u');
+		string host(300, 'h');
+
+		assert(extract("GET /" + uri + " HTTP/1.1\r\nHost: " + host +
+			"\r\n\r\n", r));
+		assert(r.flags == (HttpExtractor::HAS_HOST |
+			HttpExtractor::URI_TRUNCATED |
+			HttpExtractor::HOST_TRUNCATED));
+		assert(r.uri_length == HttpExtractor::MAX_URI);
+		assert(strlen(r.uri) == HttpExtractor::MAX_URI);
+		assert(r.host_length == HttpExtractor::MAX_HOST);
+		assert(strlen(r.host) == HttpExtractor::MAX_HOST);
+	}
+
+	cout << "HttpExtractorTest passed" << endl;
+	return 0;
+}
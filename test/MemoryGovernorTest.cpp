@@ -0,0 +1,134 @@
+/*
+ * tests of class MemoryGovernor
+ *
+ * build and run from the top directory:
+ *   g++ -Iinclude test/MemoryGovernorTest.cpp src/core/MemoryConsumer.cpp \
+ *       src/core/MemoryGovernor.cpp -lpthread -o MemoryGovernorTest && \
+ *       ./MemoryGovernorTest
+ */
+
+#include <cassert>	/* for assert */
+#include <vector>	/* for std::vector */
+#include <iostream>	/* for std::cout */
+#include <stddef.h>	/* for size_t */
+
+#include "netgazer.h"
+
+using std::vector;
+using std::cout;
+using std::endl;
+
+using netgazer::MemoryConsumer;
+using netgazer::MemoryGovernor;
+
+/* a consumer holding a number of bytes, sheddable unless fixed */
+class Pool : public MemoryConsumer {
+public:
+	explicit Pool(bool fixed = false)
+		: fixed(fixed)
+	{
+	}
+
+	~Pool()
+	{
+		this->release(this->memoryUsage());
+	}
+
+	/*
+	 * allocate, giving memory back when denied
+	 *
+	 * @bytes: number of bytes
+	 *
+	 * return: false if the charge was denied
+	 */
+	bool grow(size_t bytes)
+	{
+		if (!this->charge(bytes)) {
+			this->relieve();
+			return false;
+		}
+		return true;
+	}
+
+	size_t shed(size_t bytes)
+	{
+		if (this->fixed) {
+			return 0;
+		}
+		if (bytes > this->memoryUsage()) {
+			bytes = this->memoryUsage();
+		}
+		this->release(bytes);
+		return bytes;
+	}
+
+	bool fixed;
+};
+
+int main()
+{
+	/* a consumer over its quota sheds down to it */
+	{
+		Pool p;
+		vector<struct MemoryGovernor::Usage> u;
+
+		MemoryGovernor::instance()->add(&p, "quota", 1000);
+		assert(p.grow(600));
+		assert(!p.grow(600));
+		assert(p.memoryUsage() == 1000);
+		u = MemoryGovernor::instance()->usage();
+		assert(u.size() == 1 && u[0].name == "quota");
+		assert(u[0].current == 1000 && u[0].peak == 1200);
+		assert(u[0].denied == 1 && u[0].shed == 200);
+	}
+	MemoryGovernor::dispose();
+
+	/* over the budget, the lowest priority is shed first */
+	{
+		Pool low;
+		Pool high;
+
+		MemoryGovernor::instance()->setBudget(3000);
+		MemoryGovernor::instance()->add(&high, "high", 0, 1);
+		MemoryGovernor::instance()->add(&low, "low", 0, 0);
+		assert(low.grow(1500));
+		assert(high.grow(1500));
+		assert(high.grow(1000));
+		assert(MemoryGovernor::instance()->usage()[0].name == "low");
+
+		/* the request waits for the next charge of the low one */
+		assert(low.memoryUsage() == 1500);
+		assert(MemoryGovernor::instance()->reclaim() == 1000);
+		assert(low.memoryUsage() == 500);
+		assert(high.memoryUsage() == 2500);
+		assert(MemoryGovernor::instance()->current() == 3000);
+	}
+	MemoryGovernor::dispose();
+
+	/* what a consumer cannot shed is passed on to the next one */
+	{
+		Pool low(true);
+		Pool high;
+		vector<struct MemoryGovernor::Usage> u;
+
+		MemoryGovernor::instance()->setBudget(3000);
+		MemoryGovernor::instance()->add(&low, "low", 0, 0);
+		MemoryGovernor::instance()->add(&high, "high", 0, 1);
+		assert(low.grow(1500));
+		assert(high.grow(1500));
+		assert(high.grow(1000));
+		assert(MemoryGovernor::instance()->reclaim() == 1000);
+		assert(low.memoryUsage() == 1500);
+		assert(high.memoryUsage() == 1500);
+
+		/* the floor keeps the fixed consumer out of later requests */
+		assert(!high.grow(500));
+		assert(high.memoryUsage() == 1500);
+		u = MemoryGovernor::instance()->usage();
+		assert(u[0].shed == 0 && u[1].shed == 1500);
+	}
+	MemoryGovernor::dispose();
+
+	cout << "MemoryGovernorTest passed" << endl;
+	return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * tests of class PatternMatcher
+ *
+ * build and run from the top directory:
+ *   g++ -Iinclude test/PatternMatcherTest.cpp src/core/PatternMatcher.cpp \
+ *       src/core/Dissector.cpp -lpthread -o PatternMatcherTest && \
+ *       ./PatternMatcherTest
+ */
+
+#include <cassert>	/* for assert */
+#include <cstring>	/* for std::strlen and std::memcmp */
+#include <vector>	/* for std::vector */
+#include <utility>	/* for std::pair */
+#include <algorithm>	/* for std::sort */
+#include <iostream>	/* for std::cout */
+#include <stdint.h>	/* for fixed width integer types */
+#include <pcap/pcap.h>	/* for libpcap types */
+
+#include "netgazer.h"
+
+using std::strlen;
+using std::memcmp;
+using std::vector;
+using std::pair;
+using std::make_pair;
+using std::sort;
+using std::cout;
+using std::endl;
+
+using netgazer::PatternMatcher;
+
+/* patterns, long enough and rare enough to enable the prefilter */
+static const char * const PATTERNS[] = {
+	"GET /", "HTTP/1.1", "passwd", "abcabd", "bcab"
+};
+static const size_t PATTERN_COUNT = sizeof(PATTERNS) / sizeof(PATTERNS[0]);
+
+/* collects matches as (id, offset) pairs */
+class Collector : public PatternMatcher::Callback {
+public:
+	bool onMatch(const struct PatternMatcher::Match & match)
+	{
+		this->matches.push_back(make_pair(match.id, match.offset));
+		return true;
+	}
+
+	vector<pair<uint32_t, uint64_t> > matches;
+};
+
+/*
+ * find all occurrences by brute force
+ *
+ * @data: input
+ * @length: length of the input
+ *
+ * return: sorted (id, offset) pairs
+ */
+static vector<pair<uint32_t, uint64_t> > naive(const u_char * data,
+	size_t length)
+{
+	vector<pair<uint32_t, uint64_t> > found;
+
+	for (size_t p = 0; p < PATTERN_COUNT; ++p) {
+		size_t n = strlen(PATTERNS[p]);
+
+		for (size_t i = 0; i + n <= length; ++i) {
+			if (memcmp(data + i, PATTERNS[p], n) == 0) {
+				found.push_back(make_pair((uint32_t)p,
+					(uint64_t)i));
+			}
+		}
+	}
+	sort(found.begin(), found.end());
+	return found;
+}
+
+/*
+ * scan an input as a stream of segments cut at the given offsets
+ *
+ * @matcher: compiled matcher
+ * @data: input
+ * @length: length of the input
+ * @cuts: increasing offsets of the segment boundaries
+ *
+ * return: sorted (id, offset) pairs
+ */
+static vector<pair<uint32_t, uint64_t> > stream(
+	const PatternMatcher & matcher, const u_char * data, size_t length,
+	const vector<size_t> & cuts)
+{
+	struct PatternMatcher::Stream s;
+	Collector collector;
+	size_t from = 0;
+
+	matcher.reset(s);
+	for (size_t i = 0; i <= cuts.size(); ++i) {
+		size_t to = i < cuts.size() ? cuts[i] : length;
+
+		matcher.scan(s, data + from, to - from, &collector);
+		from = to;
+	}
+	assert(s.offset == length);
+	sort(collector.matches.begin(), collector.matches.end());
+	return collector.matches;
+}
+
+int main()
+{
+	PatternMatcher matcher;
+	const char * text =
+		"xxGET /index HTTP/1.1\r\nabcabcabd zz passwd qq bcabcab"
+		"d and some filler without any of the patterns at all, "
+		"followed by GET /etc/passwd HTTP/1.1 and abcabdabcabd, "
+		"bbcabacpabcpb";
+	const u_char * data = (const u_char *)text;
+	size_t length = strlen(text);
+	vector<pair<uint32_t, uint64_t> > expected = naive(data, length);
+	Collector whole;
+
+	for (size_t p = 0; p < PATTERN_COUNT; ++p) {
+		matcher.add(PATTERNS[p], strlen(PATTERNS[p]), (uint32_t)p);
+	}
+	matcher.compile();
+	assert(!expected.empty());
+
+	/* one payload */
+	matcher.scan(data, length, &whole);
+	sort(whole.matches.begin(), whole.matches.end());
+	assert(whole.matches == expected);
+
+	/* split once at every offset */
+	for (size_t i = 0; i <= length; ++i) {
+		vector<size_t> cuts(1, i);
+
+		assert(stream(matcher, data, length, cuts) == expected);
+	}
+
+	/* split twice at every pair of offsets, segments of any length */
+	for (size_t i = 0; i <= length; ++i) {
+		for (size_t j = i; j <= length; ++j) {
+			vector<size_t> cuts;
+
+			cuts.push_back(i);
+			cuts.push_back(j);
+			assert(stream(matcher, data, length, cuts) ==
+				expected);
+		}
+	}
+
+	/* one byte at a time */
+	{
+		vector<size_t> cuts;
+
+		for (size_t i = 1; i < length; ++i) {
+			cuts.push_back(i);
+		}
+		assert(stream(matcher, data, length, cuts) == expected);
+	}
+
+	cout << "PatternMatcherTest passed" << endl;
+	return 0;
+}
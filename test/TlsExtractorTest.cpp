@@ -0,0 +1,239 @@
+/*
+ * tests of class TlsExtractor
+ *
+ * build and run from the top directory:
+ *   g++ -Iinclude test/TlsExtractorTest.cpp src/core/TlsExtractor.cpp \
+ *       src/core/Dissector.cpp -o TlsExtractorTest && ./TlsExtractorTest
+ */
+
+#include <cassert>	/* for assert */
+#include <cstring>	/* for std::memcpy and std::strcmp */
+#include <string>	/* for std::string */
+#include <vector>	/* for std::vector */
+#include <iostream>	/* for std::cout */
+#include <stdint.h>	/* for fixed width integer types */
+
+#include "netgazer.h"
+
+using std::memcpy;
+using std::strcmp;
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+
+using netgazer::TlsExtractor;
+
+/* offset of the extensions in the hellos made by hello() */
+static const size_t EXTENSIONS = 5 + 4 + 2 + 32 + 1 + 2 + 4 + 2 + 2;
+
+/*
+ * append a big endian number
+ *
+ * @v: buffer
+ * @n: number
+ * @size: number of bytes
+ */
+static void put(vector<u_char> & v, size_t n, int size)
+{
+	for (int i = size - 1; i >= 0; --i) {
+		v.push_back((u_char)(n >> (8 * i)));
+	}
+}
+
+/*
+ * make an extension
+ *
+ * @type: extension type
+ * @data: extension data
+ *
+ * return: the extension
+ */
+static vector<u_char> extension(uint16_t type, const vector<u_char> & data)
+{
+	vector<u_char> v;
+
+	put(v, type, 2);
+	put(v, data.size(), 2);
+	v.insert(v.end(), data.begin(), data.end());
+	return v;
+}
+
+/*
+ * make server_name extension data with one name
+ *
+ * @type: name type
+ * @name: the name
+ *
+ * return: the data
+ */
+static vector<u_char> serverName(uint8_t type, const string & name)
+{
+	vector<u_char> v;
+
+	put(v, name.size() + 3, 2);
+	v.push_back(type);
+	put(v, name.size(), 2);
+	v.insert(v.end(), name.begin(), name.end());
+	return v;
+}
+
+/*
+ * make ALPN extension data
+ *
+ * @protocols: protocols, each prefixed with its length
+ *
+ * return: the data
+ */
+static vector<u_char> alpn(const string & protocols)
+{
+	vector<u_char> v;
+
+	put(v, protocols.size(), 2);
+	v.insert(v.end(), protocols.begin(), protocols.end());
+	return v;
+}
+
+/*
+ * make a TLS record holding a ClientHello with two cipher suites
+ *
+ * @extensions: the extensions
+ *
+ * return: the record
+ */
+static vector<u_char> hello(const vector<u_char> & extensions)
+{
+	vector<u_char> body;
+	vector<u_char> v;
+
+	put(body, 0x0303, 2);
+	body.insert(body.end(), 32, 0x5a);	/* random */
+	body.push_back(0);			/* session id */
+	put(body, 4, 2);
+	put(body, 0x13011302, 4);
+	body.push_back(1);			/* compression */
+	body.push_back(0);
+	put(body, extensions.size(), 2);
+	body.insert(body.end(), extensions.begin(), extensions.end());
+
+	v.push_back(22);
+	put(v, 0x0301, 2);
+	put(v, body.size() + 4, 2);
+	v.push_back(1);
+	put(v, body.size(), 3);
+	v.insert(v.end(), body.begin(), body.end());
+	return v;
+}
+
+/*
+ * extract from a copy of the first bytes of a record, so that reads
+ * past them are caught by memory checkers
+ *
+ * @record: record
+ * @n: number of bytes to copy
+ * @r: record to fill in
+ *
+ * return: result of TlsExtractor::extract
+ */
+static bool extract(const vector<u_char> & record, size_t n,
+	struct TlsExtractor::Record & r)
+{
+	u_char * copy = new u_char[n];
+	bool ret = false;
+
+	if (n > 0) {
+		memcpy(copy, &(record[0]), n);
+	}
+	ret = TlsExtractor::extract(copy, n, r);
+	delete[] copy;
+	return ret;
+}
+
+int main()
+{
+	vector<u_char> sni = extension(0, serverName(0, "example.com"));
+	vector<u_char> protocols = extension(16, alpn("\x02h2\x08http/1.1"));
+	vector<u_char> both(sni);
+	vector<u_char> record;
+	struct TlsExtractor::Record r;
+
+	both.insert(both.end(), protocols.begin(), protocols.end());
+	record = hello(both);
+
+	/* the server name and the first protocol */
+	assert(extract(record, record.size(), r));
+	assert(r.record_version == 0x0301 && r.client_version == 0x0303);
+	assert(r.cipher_count == 2 && r.extension_count == 2);
+	assert(r.flags == (TlsExtractor::HAS_SNI | TlsExtractor::HAS_ALPN));
+	assert(strcmp(r.sni, "example.com") == 0 && r.sni_length == 11);
+	assert(strcmp(r.alpn, "h2") == 0 && r.alpn_length == 2);
+
+	/* every prefix: nothing before the ciphers, then incomplete */
+	for (size_t n = 0; n < record.size(); ++n) {
+		bool ok = extract(record, n, r);
+
+		assert(ok == (n >= EXTENSIONS - 4));
+		if (!ok) {
+			continue;
+		}
+		assert(r.cipher_count == 2);
+		assert(r.flags & TlsExtractor::INCOMPLETE);
+		assert(!(r.flags & TlsExtractor::HAS_ALPN));
+		assert(!!(r.flags & TlsExtractor::HAS_SNI) ==
+			(n >= EXTENSIONS + sni.size()));
+	}
+
+	/* not a ClientHello */
+	record = hello(both);
+	record[0] = 23;
+	assert(!extract(record, record.size(), r));
+	record = hello(both);
+	record[5] = 2;
+	assert(!extract(record, record.size(), r));
+
+	/* an extension longer than the extensions ends them */
+	record = hello(both);
+	record[EXTENSIONS + sni.size() + 3] = 0xff;
+	assert(extract(record, record.size(), r));
+	assert(r.flags == (TlsExtractor::HAS_SNI | TlsExtractor::INCOMPLETE));
+	assert(r.extension_count == 1);
+
+	/* a name list or a name longer than the extension */
+	record = hello(both);
+	record[EXTENSIONS + 5] = 0xff;
+	assert(extract(record, record.size(), r));
+	assert(r.flags == TlsExtractor::HAS_ALPN && r.extension_count == 2);
+	record = hello(both);
+	record[EXTENSIONS + 8] = 0xff;
+	assert(extract(record, record.size(), r));
+	assert(r.flags == TlsExtractor::HAS_ALPN && r.sni_length == 0);
+
+	/* a protocol longer than the extension */
+	record = hello(extension(16, alpn("\x09h2")));
+	assert(extract(record, record.size(), r));
+	assert(r.flags == 0 && r.alpn_length == 0);
+
+	/* names of other types are skipped */
+	{
+		vector<u_char> names = serverName(1, "other");
+		vector<u_char> host = serverName(0, "host");
+
+		names.insert(names.end(), host.begin() + 2, host.end());
+		names[1] = (u_char)(names.size() - 2);
+		record = hello(extension(0, names));
+		assert(extract(record, record.size(), r));
+		assert(r.flags == TlsExtractor::HAS_SNI);
+		assert(strcmp(r.sni, "host") == 0);
+	}
+
+	/* a long name is cut */
+	record = hello(extension(0, serverName(0, string(300, 'n'))));
+	assert(extract(record, record.size(), r));
+	assert(r.flags == (TlsExtractor::HAS_SNI |
+		TlsExtractor::SNI_TRUNCATED));
+	assert(r.sni_length == TlsExtractor::MAX_SNI);
+	assert(r.sni[TlsExtractor::MAX_SNI] == '\0');
+
+	cout << "TlsExtractorTest passed" << endl;
+	return 0;
+}
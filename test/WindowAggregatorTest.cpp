@@ -0,0 +1,262 @@
+/*
+ * tests of class WindowAggregator
+ *
+ * build and run from the top directory:
+ *   g++ -Iinclude test/WindowAggregatorTest.cpp src/core/Checkpointable.cpp \
+ *       src/core/MemoryConsumer.cpp src/core/MemoryGovernor.cpp \
+ *       src/core/WindowAggregator.cpp -lpthread -o WindowAggregatorTest && \
+ *       ./WindowAggregatorTest
+ */
+
+#include <cassert>	/* for assert */
+#include <cstring>	/* for std::memset and std::memcmp */
+#include <vector>	/* for std::vector */
+#include <utility>	/* for std::pair */
+#include <algorithm>	/* for std::sort */
+#include <iostream>	/* for std::cout */
+#include <stdint.h>	/* for fixed width integer types */
+#include <unistd.h>	/* for usleep */
+
+#include "netgazer.h"
+
+using std::memset;
+using std::memcmp;
+using std::vector;
+using std::pair;
+using std::make_pair;
+using std::sort;
+using std::cout;
+using std::endl;
+
+using netgazer::Exception;
+using netgazer::Checkpointable;
+using netgazer::MemoryGovernor;
+using netgazer::PacketSummary;
+using netgazer::WindowAggregator;
+
+/* pane length and window length, three panes per window */
+static const uint64_t SLIDE_NS = 1000;
+static const uint64_t SIZE_NS = 3000;
+
+/* a reported window, groups as sorted (address, packets) pairs */
+struct Window {
+	uint64_t start_ns;
+	uint64_t end_ns;
+	vector<pair<uint32_t, uint64_t> > groups;
+	bool complete;
+
+	bool operator==(const Window & other) const
+	{
+		return this->start_ns == other.start_ns &&
+			this->end_ns == other.end_ns &&
+			this->groups == other.groups &&
+			this->complete == other.complete;
+	}
+};
+
+/* collects windows on the emitter thread */
+class Collector : public WindowAggregator::Callback {
+public:
+	Collector()
+		: reported(0)
+	{
+	}
+
+	void onWindow(uint64_t start_ns, uint64_t end_ns,
+		const vector<struct WindowAggregator::Result> & results,
+		bool complete)
+	{
+		struct Window w;
+
+		w.start_ns = start_ns;
+		w.end_ns = end_ns;
+		w.complete = complete;
+		for (size_t i = 0; i < results.size(); ++i) {
+			w.groups.push_back(make_pair(results[i].key.src_addr,
+				results[i].aggregate.count));
+		}
+		sort(w.groups.begin(), w.groups.end());
+		this->windows.push_back(w);
+		__atomic_add_fetch(&(this->reported), 1, __ATOMIC_RELEASE);
+	}
+
+	/*
+	 * wait for the emitter thread to report a number of windows
+	 *
+	 * @n: number of windows
+	 */
+	void await(unsigned n)
+	{
+		while (__atomic_load_n(&(this->reported), __ATOMIC_ACQUIRE) < n) {
+			usleep(1000);
+		}
+	}
+
+	vector<struct Window> windows;
+	unsigned reported;
+};
+
+/*
+ * feed a packet
+ *
+ * @partial: feeder
+ * @ts_ns: timestamp
+ * @src_addr: source address, the group
+ */
+static void feed(WindowAggregator::Partial * partial, uint64_t ts_ns,
+	uint32_t src_addr)
+{
+	struct PacketSummary s;
+
+	memset(&s, 0, sizeof(s));
+	s.ts_ns = ts_ns;
+	s.src_addr = src_addr;
+	s.length = 60;
+	partial->add(s);
+}
+
+/*
+ * feed the packets of the third pane
+ *
+ * @partial: feeder
+ */
+static void feedLastPane(WindowAggregator::Partial * partial)
+{
+	feed(partial, 2 * SLIDE_NS, 2);
+	feed(partial, 2 * SLIDE_NS + 10, 2);
+	feed(partial, 2 * SLIDE_NS + 20, 4);
+}
+
+/*
+ * shed an aggregator that may keep no memory: windows are reported as
+ * soon as their first pane is merged, flagged incomplete, and a pane
+ * sealed after all its windows is dropped as late
+ */
+static void shedding()
+{
+	Collector early;
+
+	{
+		WindowAggregator w(WindowAggregator::BY_SRC_ADDR, SIZE_NS,
+			SLIDE_NS, &early);
+		WindowAggregator::Partial * p = w.partial();
+		WindowAggregator::Partial * q = NULL;
+
+		MemoryGovernor::instance()->add(&w, "windows", 1);
+		feed(p, 0, 1);
+		feed(p, SLIDE_NS, 1);
+		early.await(3);
+		assert(early.windows[0].complete);
+		assert(!early.windows[1].complete);
+		assert(!early.windows[2].complete);
+		assert(early.windows[2].end_ns == SIZE_NS);
+
+		/* a slower partial delivers the first pane too late */
+		q = w.partial();
+		feed(q, 10, 2);
+		feed(q, 20, 2);
+		q->tick(5 * SLIDE_NS);
+		while (w.late() < 2) {
+			usleep(1000);
+		}
+		w.close();
+		assert(w.late() == 2);
+	}
+	MemoryGovernor::dispose();
+
+	/* pane 1 only lives on in the window ending with pane 3 */
+	assert(early.windows.size() == 4);
+	assert(early.windows[3].complete);
+	assert(early.windows[3].groups.size() == 1);
+	assert(early.windows[3].groups[0] == make_pair((uint32_t)1,
+		(uint64_t)1));
+}
+
+int main()
+{
+	Collector original;
+	Collector restored;
+	Collector other;
+	vector<vector<char> > copies;
+	vector<struct Checkpointable::Extent> saved;
+	vector<struct Checkpointable::Extent> current;
+
+	/* two panes merged by the emitter, the third still in the partial */
+	{
+		WindowAggregator a(WindowAggregator::BY_SRC_ADDR, SIZE_NS,
+			SLIDE_NS, &original);
+		WindowAggregator::Partial * p = a.partial();
+		vector<struct Checkpointable::Extent> x;
+
+		feed(p, 0, 1);
+		feed(p, 10, 2);
+		feed(p, 20, 1);
+		feed(p, SLIDE_NS, 1);
+		feed(p, SLIDE_NS + 10, 3);
+		feedLastPane(p);
+		original.await(2);
+
+		/* copy the extents, as a snapshot file would hold them */
+		a.extents(x);
+		for (size_t i = 0; i < x.size(); ++i) {
+			const char * data = (const char *)x[i].data;
+
+			copies.push_back(vector<char>(data, data + x[i].length));
+		}
+		for (size_t i = 0; i < x.size(); ++i) {
+			struct Checkpointable::Extent e;
+
+			e.data = copies[i].empty() ? NULL : &(copies[i][0]);
+			e.length = copies[i].size();
+			e.dimension = false;
+			saved.push_back(e);
+		}
+		assert(saved[4].length > 0);
+		a.close();
+	}
+	assert(original.windows.size() == 5);
+
+	/* the restored panes give the windows the original went on with */
+	{
+		WindowAggregator b(WindowAggregator::BY_SRC_ADDR, SIZE_NS,
+			SLIDE_NS, &restored);
+
+		b.restore(saved);
+		b.extents(current);
+		assert(current.size() == saved.size());
+		for (size_t i = 0; i < current.size(); ++i) {
+			assert(current[i].length == saved[i].length);
+			assert(current[i].length == 0 ||
+				memcmp(current[i].data, saved[i].data,
+				current[i].length) == 0);
+		}
+		feedLastPane(b.partial());
+		b.close();
+	}
+	assert(restored.windows.size() == 3);
+	for (size_t i = 0; i < restored.windows.size(); ++i) {
+		assert(restored.windows[i] == original.windows[i + 2]);
+	}
+	assert(restored.windows[0].groups.size() == 4);
+
+	/* a snapshot of other windows is refused and changes nothing */
+	{
+		WindowAggregator c(WindowAggregator::BY_SRC_ADDR, SIZE_NS,
+			SLIDE_NS / 2, &other);
+		bool refused = false;
+
+		try {
+			c.restore(saved);
+		} catch (Exception & e) {
+			refused = true;
+		}
+		assert(refused);
+		c.close();
+	}
+	assert(other.windows.empty());
+
+	shedding();
+
+	cout << "WindowAggregatorTest passed" << endl;
+	return 0;
+}